@@ -10,8 +10,9 @@ flat in int palette_offset;
 flat in int palette_limit;
 flat in int opacity;
 flat in uint options;
+flat in uint page;
 
-uniform sampler2D atlas;
+uniform sampler2DArray atlas;
 uniform sampler2D remaps;
 
 in vec4 gl_FragCoord;
@@ -41,7 +42,7 @@ vec4 handle(float index, float remap) {
 }
 
 void main() {
-    vec4 texel = texture(atlas, tex_coord);
+    vec4 texel = texture(atlas, vec3(tex_coord, float(page)));
 
     // Don't render if it's transparent pixel
     int index = int(texel.r * 255.0);
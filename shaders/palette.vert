@@ -1,7 +1,8 @@
 #version 330 core
 
-layout (location = 0) in vec2 in_position;
-layout (location = 1) in vec2 in_tex_coord;
+// Per-sprite attributes; the quad corners come from gl_VertexID.
+layout (location = 0) in vec4 in_rect;
+layout (location = 1) in vec4 in_tex_rect;
 layout (location = 2) in int in_transparency_index;
 layout (location = 3) in int in_remap_offset;
 layout (location = 4) in int in_remap_rounds;
@@ -9,8 +10,11 @@ layout (location = 5) in int in_palette_offset;
 layout (location = 6) in int in_palette_limit;
 layout (location = 7) in int in_opacity;
 layout (location = 8) in uint in_options;
+layout (location = 9) in uint in_page;
 uniform mat4 projection;
 
+const vec2 corners[4] = vec2[](vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 0.0));
+
 out vec2 tex_coord;
 flat out int transparency_index;
 flat out int remap_offset;
@@ -19,6 +23,7 @@ flat out int palette_offset;
 flat out int palette_limit;
 flat out int opacity;
 flat out uint options;
+flat out uint page;
 
 void main() {
     transparency_index = in_transparency_index;
@@ -28,6 +33,8 @@ void main() {
     remap_rounds = in_remap_rounds;
     opacity = in_opacity;
     options = in_options;
-    tex_coord = in_tex_coord.xy;
-    gl_Position = projection * vec4(in_position.xy, 0.0, 1.0);
+    page = in_page;
+    vec2 corner = corners[gl_VertexID];
+    tex_coord = mix(in_tex_rect.xy, in_tex_rect.zw, corner);
+    gl_Position = projection * vec4(in_rect.xy + in_rect.zw * corner, 0.0, 1.0);
 }
@@ -7,13 +7,19 @@ layout (std140) uniform palette {
 };
 
 uniform sampler2D framebuffer;
+uniform sampler2DArray atlas;
 uniform sampler2D remaps;
+uniform int show_atlas; // Debug view of the first atlas page
+uniform int output_index; // Write the palette index instead of the color, for frame recording
 
 // Out
 layout (location = 0) out vec4 color;
 
 void main() {
     vec4 texel = texture(framebuffer, tex_coord);
+    if (show_atlas != 0) {
+        texel = vec4(texture(atlas, vec3(tex_coord, 0.0)).r, 0.0, 0.0, 0.0);
+    }
     int remap_count = int(texel.b * 255.0);
     float remap_index = clamp(texel.g * 255.0, 0, 18.0) / 18.0;
     texel.r += texel.a;
@@ -23,5 +29,9 @@ void main() {
         texel = texture(remaps, vec2(texel.r, remap_index));
     }
 
-    color = colors[int(255.0 * texel.r)];
+    if (output_index != 0) {
+        color = vec4(texel.r, 0.0, 0.0, 0.0);
+    } else {
+        color = colors[int(255.0 * texel.r)];
+    }
 }
\ No newline at end of file
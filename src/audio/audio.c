@@ -38,6 +38,7 @@ typedef struct audio_system {
     resource_id music_id;
     xmp_context xmp_context;
     Mix_Chunk *channel_chunks[CHANNEL_MAX];
+    bool null_sink; // No device opened; all playback requests are dropped.
 } audio_system;
 
 static audio_system *audio = NULL;
@@ -247,7 +248,22 @@ error_0:
     return false;
 }
 
+bool audio_init_null(void) {
+    if(!(audio = omf_calloc(1, sizeof(audio_system)))) {
+        PERROR("Unable to allocate audio subsystem");
+        return false;
+    }
+    audio->null_sink = true;
+    audio->music_id = NUMBER_OF_RESOURCES;
+    INFO("Audio output disabled.");
+    return true;
+}
+
 void audio_close(void) {
+    if(audio != NULL && audio->null_sink) {
+        omf_free(audio);
+        return;
+    }
     if(audio != NULL) {
         DEBUG("closing audio");
         audio_stop_music();
@@ -276,6 +292,9 @@ void audio_play_sound(int id, float volume, float panning, float pitch) {
     Mix_Chunk *chunk;
     float pan_left, pan_right;
 
+    if(audio->null_sink)
+        goto error_0;
+
     // Anything beyond these are invalid
     if(id < 0 || id > 299)
         goto error_0;
@@ -311,6 +330,8 @@ error_0:
 void audio_play_music(resource_id id) {
     assert(audio);
     assert(is_music(id));
+    if(audio->null_sink)
+        return;
     if(audio->music_id != id) {
         audio_stop_music();
         audio_close_module();
@@ -326,6 +347,8 @@ void audio_play_music(resource_id id) {
 
 void audio_stop_music(void) {
     assert(audio);
+    if(audio->null_sink)
+        return;
     Mix_HaltMusic();
     Mix_HookMusic(NULL, NULL);
 }
@@ -333,11 +356,15 @@ void audio_stop_music(void) {
 void audio_set_music_volume(float volume) {
     assert(audio);
     audio->music_volume = clampf(volume, VOLUME_MIN, VOLUME_MAX);
+    if(audio->null_sink)
+        return;
     xmp_set_player(audio->xmp_context, XMP_PLAYER_VOLUME, audio->music_volume * 100);
 }
 
 void audio_set_sound_volume(float volume) {
     assert(audio);
+    if(audio->null_sink)
+        return;
     volume = clampf(volume, VOLUME_MIN, VOLUME_MAX);
     Mix_Volume(-1, volume * MIX_MAX_VOLUME);
 }
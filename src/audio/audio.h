@@ -41,6 +41,14 @@ typedef struct audio_freq {
  */
 bool audio_init(int freq, bool mono, int resampler, float music_volume, float sound_volume);
 
+/**
+ * Initializes the audio subsystem without opening an output device. All playback and volume
+ * requests are accepted and silently dropped.
+ *
+ * @return True if initialized, false if not.
+ */
+bool audio_init_null(void);
+
 /**
  * Closes the audio subsystem.
  */
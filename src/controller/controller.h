@@ -25,7 +25,8 @@ enum
     CTRL_TYPE_GAMEPAD,
     CTRL_TYPE_NETWORK,
     CTRL_TYPE_AI,
-    CTRL_TYPE_REC
+    CTRL_TYPE_REC,
+    CTRL_TYPE_SPECTATOR
 };
 
 enum
@@ -34,7 +35,11 @@ enum
     EVENT_TYPE_HB,
     EVENT_TYPE_PROPOSE_START,
     EVENT_TYPE_CONFIRM_START,
-    EVENT_TYPE_CLOSE
+    EVENT_TYPE_CLOSE,
+    EVENT_TYPE_HASH_BREAKDOWN,
+    EVENT_TYPE_SPECTATE_SETUP,
+    EVENT_TYPE_SPECTATE_INPUTS,
+    EVENT_TYPE_SPECTATE_END
 };
 
 typedef struct ctrl_event_t ctrl_event;
@@ -5,17 +5,42 @@
 #include <time.h>
 
 #include "controller/net_controller.h"
+#include "controller/net_sim.h"
+#include "controller/net_transcript.h"
+#include "controller/spectator_stream.h"
 #include "game/game_state_type.h"
 #include "game/protos/scene.h"
 #include "game/scenes/arena.h"
 #include "game/utils/serial.h"
 #include "game/utils/settings.h"
+#include "game/utils/state_hash.h"
+#include "game/utils/state_snapshot.h"
 #include "resources/ids.h"
 #include "utils/allocator.h"
-#include "utils/list.h"
 #include "utils/log.h"
 #include "utils/miscmath.h"
 
+// Hash breakdowns kept around for comparing with the peer's after a desync
+#define HASH_HISTORY 64
+
+// The game state is hashed on every Nth tick, so that both peers hash the same ticks. With input delay, it is
+// also checkpointed there. This is also how often the input horizon is sent to the peer when there are no new inputs.
+#define CHECKPOINT_INTERVAL 4
+
+// Upper limit for the input delay, in ticks
+#define MAX_INPUT_DELAY 15
+
+// Sent in every heartbeat; peers with a different version are disconnected. Bump on any packet format change.
+#define NET_PROTOCOL_VERSION 2
+
+// After new inputs are sent, the unacknowledged inputs are sent again on this many following ticks, so that a
+// single lost packet does not delay them until the next input.
+#define REDUNDANT_SENDS 3
+
+// Confirmed inputs are streamed to spectators in chunks of at least this many ticks, which keeps the per packet
+// overhead down to a few bytes a second
+#define SPECTATE_INTERVAL 25
+
 typedef struct {
     ENetHost *host;
     ENetPeer *peer;
@@ -36,30 +61,48 @@ typedef struct {
     bool confirmed;
     uint32_t last_tick;
     uint32_t last_sent;
-    list transcript;
+    net_transcript transcript;
     uint32_t last_received_tick;
     uint32_t last_acked_tick;
     int last_har_state;
     uint32_t last_traced_tick;
-    uint32_t peer_last_hash;
+    uint64_t peer_last_hash;
     uint32_t peer_last_hash_tick;
-    uint32_t last_hash;
+    uint64_t last_hash;
     uint32_t last_hash_tick;
+    state_hash hash;                       // Hash of the game state on the last replayed tick
+    state_hash hash_history[HASH_HISTORY]; // Breakdowns of the hashes sent to the peer, by tick
+    state_hash peer_hash;                  // Breakdown received from the peer
     SDL_RWops *trace_file;
-    game_state *gs_bak;
+    // Game state at the start of each of the last ticks, to roll back from. The checkpoint is stored apart, as it
+    // must outlive the ring slots.
+    state_snapshot_ring snapshots;
+    state_snapshot checkpoint_store;
+    state_snapshot *checkpoint; // Last game state both peers agree on, or NULL if not in a match
+    int input_delay;            // Ticks local inputs are delayed by; 0 applies them immediately and rolls back
+    int round_input_delay;      // Input delay the current round was started with
+    int arena_state;            // Arena state on the previous tick, to find where rounds start
+    uint32_t input_final;       // Local inputs before this tick have been sent to the peer, and can no longer change
+    uint32_t peer_final_tick;   // All peer inputs before this tick have been received
+    uint32_t last_applied_tick; // Last int_tick that transcript inputs were applied on
+    bool stalled;               // Holding the game until the peer's inputs catch up
+    uint32_t stalled_ticks;     // Static ticks spent stalled
+    uint32_t newest_sent;       // Newest tick with a local input that has been sent
+    int redundant_sends;        // Ticks left to resend the unacknowledged inputs on
+    bool peer_version_ok;       // The peer has sent a heartbeat with our protocol version
+    net_sim sim;                // Simulated network conditions, if any are set
+    ENetHost *relay_host;       // Host for the spectator relay connection, if a relay is set
+    ENetPeer *relay;            // Spectator relay the match is streamed to
+    bool spectated;             // The setup of the current match has been streamed to spectators
+    uint32_t spectate_sent;     // Confirmed inputs before this tick have been streamed to spectators
+    net_controller_stats stats;
 } wtf;
 
-typedef struct {
-    uint32_t tick;
-    uint16_t events[2];
-    uint8_t seen_peer;
-} tick_events;
-
 // simple standard deviation calculation
 float stddev(float average, int data[], int n) {
     float variance = 0.0f;
     for(int i = 0; i < n; i++) {
-        variance = (data[i] - average) * (data[i] - average);
+        variance += (data[i] - average) * (data[i] - average);
     }
     return sqrtf(variance / n);
 }
@@ -89,129 +132,472 @@ int avg_rtt(int data[], int n) {
     return truncf(average);
 }
 
-void insert_event(wtf *data, uint32_t tick, uint16_t action, int id) {
+/**
+ * Store an input in the transcript. If it does not fit, the peers can no longer agree on the match, so the
+ * connection is closed instead of carrying on out of sync.
+ *
+ * @return False if the connection is being closed
+ */
+bool insert_event(wtf *data, uint32_t tick, uint16_t action, int id) {
+    // inputs older than the transcript have already been agreed on, and are safe to drop
+    if(net_transcript_insert(&data->transcript, tick, action, id) || tick < data->transcript.base_tick) {
+        return true;
+    }
+    PERROR("Netplay transcript is full, disconnecting");
+    enet_peer_disconnect(data->peer, 0);
+    return false;
+}
 
-    iterator it;
-    list *transcript = &data->transcript;
-    list_iter_begin(transcript, &it);
-    tick_events *ev = NULL;
-    tick_events *nev = NULL;
-    tick_events event;
-    event.tick = tick;
-    event.events[id] = action;
-    event.events[abs(id - 1)] = 0;
-    event.seen_peer = 1 << id;
-    int i = 0;
-
-    while((ev = (tick_events *)list_iter_next(&it))) {
-        if(i == 0 && ev->tick > tick) {
-            event.seen_peer |= ev->seen_peer;
-            list_prepend(transcript, &event, sizeof(tick_events));
-            return;
-        } else if(ev->tick == tick) {
-            ev->events[id] |= action;
-            ev->seen_peer |= 1 << id;
-            return;
-        } else if(ev->tick < tick) {
-            // even though we have no events for this tick, mark the peer has events past here
-            ev->seen_peer |= 1 << id;
-        }
-        nev = list_iter_peek(&it);
-        if(ev->tick < tick && nev && nev->tick > tick) {
-            event.seen_peer |= nev->seen_peer;
-            list_iter_append(&it, &event, sizeof(tick_events));
-            return;
-        }
-        i++;
+/**
+ * Pick the input delay from the measured round trip time. Inputs that arrive at most max_rollback ticks late
+ * are handled by rolling back, and the rest of the latency is hidden by delaying local inputs. Only called
+ * when a match or a round starts, as the delay must not change while the round is fought.
+ */
+static void update_input_delay(wtf *data) {
+    const settings_network *net = &settings_get()->net;
+    if(net->net_input_delay >= 0) {
+        data->input_delay = min2(net->net_input_delay, MAX_INPUT_DELAY);
+        return;
     }
-    // either the list is empty, or this tick is later than anything else
-    list_append(transcript, &event, sizeof(tick_events));
+    int samples = data->rttfilled ? 100 : data->rttpos;
+    int delay = 1;
+    if(samples > 0) {
+        int rtt = avg_rtt(data->rttbuf, samples);
+        float jitter = stddev(rtt, data->rttbuf, samples);
+        // An input takes half a round trip to arrive, and the checkpoint it rolls back to may be a few ticks older
+        int latency = ceilf((rtt + 2 * jitter) / 2.0f) + CHECKPOINT_INTERVAL - 1;
+        delay = clamp(latency - net->net_max_rollback, 1, MAX_INPUT_DELAY);
+    }
+    if(delay != data->input_delay) {
+        DEBUG("input delay is now %d ticks", delay);
+    }
+    data->input_delay = delay;
 }
 
-bool has_event(wtf *data, uint32_t tick) {
+// Tick that a local input made on the given tick takes effect on.
+static uint32_t local_input_tick(wtf *data, uint32_t tick) {
+    if(data->input_delay == 0) {
+        return tick;
+    }
+    // Never before the inputs that the peer has already been told are final
+    return umax2(tick + data->input_delay, data->input_final);
+}
 
-    iterator it;
-    list_iter_begin(&data->transcript, &it);
-    tick_events *ev = NULL;
-    while((ev = (tick_events *)list_iter_next(&it))) {
-        if(ev->tick == tick - data->local_proposal && ev->events[data->id]) {
-            return true;
-        }
+/**
+ * Hold the game while the peer's inputs are too far behind. This caps the rollbacks: a late input rewinds the game
+ * to the checkpoint, so with input delay the game never runs more than net_max_rollback ticks past it while an
+ * input may still be missing.
+ */
+static void set_stalled(wtf *data, game_state *gs, bool stalled) {
+    if(stalled != data->stalled) {
+        DEBUG("%s the game at arena tick %" PRIu32, stalled ? "stalling" : "resuming",
+              gs->int_tick - data->local_proposal);
+        data->stats.stalls += stalled;
+        data->stalled_ticks = 0;
     }
-    return false;
+    data->stalled = stalled;
+    game_state_set_stalled(gs, stalled);
 }
 
-void print_transcript(list *transcript) {
+bool has_event(wtf *data, uint32_t tick) {
+    tick_events *ev = net_transcript_get(&data->transcript, tick - data->local_proposal);
+    return ev && ev->events[data->id];
+}
+
+void print_transcript(net_transcript *transcript) {
     iterator it;
-    list_iter_begin(transcript, &it);
+    net_transcript_iter_begin(transcript, &it, 0);
     tick_events *ev = NULL;
-    while((ev = (tick_events *)list_iter_next(&it))) {
+    while((ev = (tick_events *)iter_next(&it))) {
         DEBUG("tick %d has events %d -- %d (%d)", ev->tick, ev->events[0], ev->events[1], ev->seen_peer);
     }
 }
 
+static void write_action_header(serial *ser, uint32_t acked, uint32_t final, uint32_t hash_tick, uint64_t hash) {
+    serial_write_int8(ser, EVENT_TYPE_ACTION);
+    serial_write_uint32(ser, acked);
+    serial_write_uint32(ser, final);
+    serial_write_uint32(ser, hash_tick);
+    serial_write_uint64(ser, hash);
+}
+
+/**
+ * Send all local inputs the peer has not acknowledged yet. After the header, the inputs are written as a base
+ * tick and a count, and then a tick delta from the previous input and an action mask for each:
+ *
+ *   uint32 base, varint count, count * (varint delta, uint8 actions)
+ *
+ * Inputs are usually a few ticks apart, so one takes two bytes.
+ */
 void send_events(wtf *data) {
     serial ser;
     ENetPacket *packet;
     ENetPeer *peer = data->peer;
     ENetHost *host = data->host;
-    list *transcript = &data->transcript;
+    net_transcript *transcript = &data->transcript;
     iterator it;
-    list_iter_begin(transcript, &it);
+    uint32_t base = data->last_acked_tick + 1;
+    net_transcript_iter_begin(transcript, &it, base);
     tick_events *ev = NULL;
-    serial_create(&ser);
-    serial_write_int8(&ser, EVENT_TYPE_ACTION);
-    serial_write_uint32(&ser, data->last_received_tick);
-    serial_write_uint32(&ser, data->last_hash_tick);
-    serial_write_uint32(&ser, data->last_hash);
-
-    int events = 0;
-
-    while((ev = (tick_events *)list_iter_next(&it))) {
-        if(ev->events[data->id] != 0 && ev->tick > data->last_acked_tick &&
-           ev->tick < data->last_tick - data->local_proposal) {
-            serial_write_int16(&ser, ev->events[data->id]);
-            serial_write_uint32(&ser, ev->tick);
+    data->input_final = umax2(data->input_final, data->last_tick - data->local_proposal + data->input_delay);
+
+    // Count first, so that the events can be written right after the count
+    uint32_t events = 0;
+    uint32_t newest = 0;
+    while((ev = (tick_events *)iter_next(&it)) && ev->tick < data->input_final) {
+        if(ev->events[data->id] != 0) {
+            newest = ev->tick;
             events++;
         }
     }
 
-    if(!events) {
-        // serial_write_int16(&ser, 0);
-        // serial_write_int32(&ser, data->last_tick - 10);
+    serial_create(&ser);
+    write_action_header(&ser, data->last_received_tick, data->input_final, data->last_hash_tick, data->last_hash);
+    serial_write_uint32(&ser, base);
+    serial_write_varint(&ser, events);
+    uint32_t prev = base;
+    net_transcript_iter_begin(transcript, &it, base);
+    while((ev = (tick_events *)iter_next(&it)) && ev->tick < data->input_final) {
+        if(ev->events[data->id] != 0) {
+            serial_write_varint(&ser, ev->tick - prev);
+            serial_write_int8(&ser, ev->events[data->id]);
+            prev = ev->tick;
+        }
+    }
+
+    if(events == 0) {
+        data->redundant_sends = 0;
+    } else if(newest > data->newest_sent) {
+        data->newest_sent = newest;
+        data->redundant_sends = REDUNDANT_SENDS;
+    } else if(data->redundant_sends > 0) {
+        data->redundant_sends--;
     }
 
     data->last_sent = data->last_tick;
 
     packet = enet_packet_create(ser.data, serial_len(&ser), ENET_PACKET_FLAG_UNSEQUENCED);
-    enet_peer_send(peer, 1, packet);
+    net_sim_send(&data->sim, peer, 1, packet);
     if(data->lobby && peer != data->lobby) {
         // CC the events to the lobby, unless the lobby is already the peer
         packet = enet_packet_create(ser.data, serial_len(&ser), ENET_PACKET_FLAG_UNSEQUENCED);
-        enet_peer_send(data->lobby, 1, packet);
+        net_sim_send(&data->sim, data->lobby, 1, packet);
+    }
+    serial_free(&ser);
+    net_sim_flush(&data->sim, host);
+}
+
+// Remember the breakdown of a hash that the peer may compare against.
+static void remember_hash(wtf *data, const state_hash *hash) {
+    data->hash_history[hash->tick % HASH_HISTORY] = *hash;
+}
+
+static const state_hash *find_hash(wtf *data, uint32_t tick) {
+    const state_hash *hash = &data->hash_history[tick % HASH_HISTORY];
+    return hash->count > 0 && hash->tick == tick ? hash : NULL;
+}
+
+static void trace_hash_breakdown(wtf *data, const state_hash *hash) {
+    if(!data->trace_file) {
+        return;
+    }
+    char buf[255];
+    char name[32];
+    for(int i = 0; i < hash->count; i++) {
+        state_hash_part_name(&hash->parts[i], name, sizeof(name));
+        int sz = snprintf(buf, sizeof(buf), "  %s: %016" PRIx64 "\n", name, hash->parts[i].hash);
+        SDL_RWwrite(data->trace_file, buf, sz, 1);
     }
+}
+
+/**
+ * Send our breakdown of a mismatching hash to the peer, so that it can tell which part went wrong first.
+ * The connection is closed right after a mismatch, so the packet is flushed out immediately.
+ */
+static void send_hash_breakdown(wtf *data, const state_hash *hash) {
+    serial ser;
+    serial_create(&ser);
+    serial_write_int8(&ser, EVENT_TYPE_HASH_BREAKDOWN);
+    state_hash_serialize(hash, &ser);
+    ENetPacket *packet = enet_packet_create(ser.data, serial_len(&ser), ENET_PACKET_FLAG_RELIABLE);
+    serial_free(&ser);
+    net_sim_send(&data->sim, data->peer, 0, packet);
+    net_sim_flush(&data->sim, data->host);
+}
+
+// Spectators are sent the match by the side hosting it, and only through the spectator relay set in the
+// settings. Returns NULL if there is nobody to send to.
+static ENetPeer *spectate_peer(wtf *data) {
+    if(data->id != ROLE_SERVER || data->relay_host == NULL) {
+        return NULL;
+    }
+    return data->relay->state == ENET_PEER_STATE_CONNECTED ? data->relay : NULL;
+}
+
+static void spectate_send(wtf *data, ENetPeer *target, serial *ser) {
+    ENetPacket *packet = enet_packet_create(ser->data, serial_len(ser), ENET_PACKET_FLAG_RELIABLE);
+    if(enet_peer_send(target, SPECTATOR_STREAM_CHANNEL, packet) < 0) {
+        enet_packet_destroy(packet);
+    }
+    enet_host_flush(data->relay_host);
+}
+
+// Stream the setup of a match to spectators. The game state must be on tick 0 of the match.
+static void spectate_start(wtf *data, game_state *gs) {
+    ENetPeer *target = spectate_peer(data);
+    if(target == NULL) {
+        return;
+    }
+    spectator_setup setup;
+    setup.arena = game_state_get_scene(gs)->id;
+    setup.speed = gs->speed;
+    setup.warmup = gs->tick;
+    setup.seed = gs->rand.seed;
+    for(int i = 0; i < 2; i++) {
+        sd_pilot *pilot = game_player_get_pilot(game_state_get_player(gs, i));
+        spectator_player *player = &setup.players[i];
+        player->har_id = pilot->har_id;
+        player->pilot_id = pilot->pilot_id;
+        player->colors[0] = pilot->color_1;
+        player->colors[1] = pilot->color_2;
+        player->colors[2] = pilot->color_3;
+        player->stats[0] = pilot->arm_power;
+        player->stats[1] = pilot->leg_power;
+        player->stats[2] = pilot->arm_speed;
+        player->stats[3] = pilot->leg_speed;
+        player->stats[4] = pilot->armor;
+        player->stats[5] = pilot->stun_resistance;
+        player->stats[6] = pilot->power;
+        player->stats[7] = pilot->agility;
+        player->stats[8] = pilot->endurance;
+    }
+    serial ser;
+    serial_create(&ser);
+    spectator_setup_write(&ser, &setup);
+    spectate_send(data, target, &ser);
+    serial_free(&ser);
+    data->spectated = true;
+    data->spectate_sent = 0;
+}
+
+/**
+ * Stream the inputs before a tick to spectators. Both players must have confirmed them, ie. the tick can be no
+ * later than the checkpoint. Inputs are held back until there are SPECTATE_INTERVAL ticks of them, unless flushed.
+ *
+ * @param data Controller data
+ * @param tick One past the last tick to stream
+ * @param flush Stream the inputs even if there are only a few ticks of them
+ * @return First tick the transcript has to keep for spectators
+ */
+static uint32_t spectate_inputs(wtf *data, uint32_t tick, bool flush) {
+    if(!data->spectated || tick <= data->spectate_sent) {
+        return tick;
+    }
+    ENetPeer *target = spectate_peer(data);
+    if(target == NULL) {
+        // lost the connection; spectators can not follow the rest of the match anyway
+        data->spectated = false;
+        return tick;
+    }
+    if(!flush && tick - data->spectate_sent < SPECTATE_INTERVAL) {
+        return data->spectate_sent;
+    }
+    serial ser;
+    serial_create(&ser);
+    spectator_inputs_write(&ser, &data->transcript, data->spectate_sent, tick);
+    spectate_send(data, target, &ser);
     serial_free(&ser);
-    enet_host_flush(host);
+    data->spectate_sent = tick;
+    return tick;
+}
+
+// Stream the last confirmed inputs of a match to spectators, and tell them it is over.
+static void spectate_end(wtf *data, uint32_t tick) {
+    spectate_inputs(data, tick, true);
+    ENetPeer *target = spectate_peer(data);
+    if(data->spectated && target != NULL) {
+        serial ser;
+        serial_create(&ser);
+        serial_write_int8(&ser, EVENT_TYPE_SPECTATE_END);
+        spectate_send(data, target, &ser);
+        serial_free(&ser);
+    }
+    data->spectated = false;
 }
 
-int rewind_and_replay(wtf *data, game_state *gs_current) {
+// Keep the spectator relay connection alive. Nothing is expected from the relay.
+static void service_relay(wtf *data) {
+    ENetEvent event;
+    while(enet_host_service(data->relay_host, &event, 0) > 0) {
+        if(event.type == ENET_EVENT_TYPE_RECEIVE) {
+            enet_packet_destroy(event.packet);
+        } else if(event.type == ENET_EVENT_TYPE_CONNECT) {
+            DEBUG("connected to spectator relay");
+        } else if(event.type == ENET_EVENT_TYPE_DISCONNECT) {
+            DEBUG("spectator relay disconnected");
+        }
+    }
+}
+
+// Drop the transcript before the given tick, except for local inputs the peer has not acknowledged yet, and
+// inputs that have not been streamed to spectators yet.
+static void trim_transcript(wtf *data, uint32_t tick) {
+    tick = spectate_inputs(data, tick, false);
+    iterator it;
+    tick_events *ev = NULL;
+    net_transcript_iter_begin(&data->transcript, &it, data->last_acked_tick + 1);
+    while((ev = (tick_events *)iter_next(&it)) && ev->tick < tick) {
+        if(ev->events[data->id] != 0) {
+            tick = ev->tick;
+            break;
+        }
+    }
+    net_transcript_trim(&data->transcript, tick);
+}
+
+/**
+ * With input delay, the peer tells how far its inputs are final, so the game state is checkpointed as soon as
+ * all inputs before a tick are known, without having to roll back first. Only every CHECKPOINT_INTERVAL'th
+ * tick is saved, so that both peers hash the same ticks.
+ *
+ * @param data Controller data
+ * @param gs Game state, before the inputs on its current tick are applied
+ * @return true if a checkpoint was saved
+ */
+// Replace the checkpoint with the given game state.
+static void take_checkpoint(wtf *data, game_state *gs) {
+    state_snapshot_save(&data->checkpoint_store, gs);
+    data->checkpoint = &data->checkpoint_store;
+}
+
+static bool save_checkpoint(wtf *data, game_state *gs) {
+    uint32_t tick = gs->int_tick - data->local_proposal;
+    if(tick % CHECKPOINT_INTERVAL != 0 || tick > data->peer_final_tick || gs->int_tick <= data->checkpoint->int_tick) {
+        return false;
+    }
+    take_checkpoint(data, gs);
+    game_state_hash(gs, tick, &data->hash);
+    data->last_hash_tick = tick;
+    data->last_hash = data->hash.total;
+    remember_hash(data, &data->hash);
+    return true;
+}
+
+// Feed the inputs of both players on a tick to their HARs.
+static void apply_inputs(wtf *data, game_state *gs, tick_events *ev) {
+    for(int j = 0; j < 2; j++) {
+        int player_id = j;
+        game_player *player = game_state_get_player(gs, player_id);
+        if(ev->events[j]) {
+            DEBUG("replaying input %d from player %d at tick %d %d -- peer_seen %d", ev->events[j], player_id,
+                  ev->tick, gs->int_tick - data->local_proposal, ev->seen_peer);
+            if(((ev->events[j] & ~ACT_KICK) & ~ACT_PUNCH) != 0) {
+                object_act(game_state_find_object(gs, game_player_get_har_obj_id(player)),
+                           (ev->events[j] & ~ACT_KICK) & ~ACT_PUNCH);
+            }
+            if(ev->events[j] & ACT_PUNCH) {
+                object_act(game_state_find_object(gs, game_player_get_har_obj_id(player)), ACT_PUNCH);
+            } else if(ev->events[j] & ACT_KICK) {
+                object_act(game_state_find_object(gs, game_player_get_har_obj_id(player)), ACT_KICK);
+            }
+
+            // write_rec_move(gs->sc, player, ev->events[j]);
+            //} else {
+            //    object_act(game_state_find_object(gs, game_player_get_har_obj_id(player)), ACT_STOP);
+        }
+    }
+}
+
+// A hash from the peer is checked against ours as soon as it arrives, as with input delay there may not be a
+// rollback to check it in. Returns true on a mismatch.
+static bool check_peer_hash(wtf *data) {
+    const state_hash *local = find_hash(data, data->peer_last_hash_tick);
+    if(local == NULL || local->total == data->peer_last_hash) {
+        return false;
+    }
+    if(data->trace_file) {
+        char buf[255];
+        int sz = snprintf(buf, sizeof(buf), "---MISMATCH at %" PRIu32 " got %016" PRIx64 " expected %016" PRIx64 "\n",
+                          local->tick, data->peer_last_hash, local->total);
+        SDL_RWwrite(data->trace_file, buf, sz, 1);
+        trace_hash_breakdown(data, local);
+    }
+    DEBUG("arena hash mismatch at %" PRIu32 " -- got %016" PRIx64 " expected %016" PRIx64 "!", local->tick,
+          data->peer_last_hash, local->total);
+    send_hash_breakdown(data, local);
+    return true;
+}
+
+// Compare a breakdown from the peer against ours for the same tick, and report the first difference.
+static void compare_hash_breakdown(wtf *data) {
+    const state_hash *local = find_hash(data, data->peer_hash.tick);
+    if(local == NULL) {
+        DEBUG("no local hash for arena tick %" PRIu32 " to compare with the peer's", data->peer_hash.tick);
+        return;
+    }
+    state_hash_part part;
+    if(!state_hash_find_difference(local, &data->peer_hash, &part)) {
+        return;
+    }
+    char name[32];
+    state_hash_part_name(&part, name, sizeof(name));
+    DEBUG("arena state at %" PRIu32 " first differs from the peer's in %s", local->tick, name);
+    if(data->trace_file) {
+        char buf[255];
+        int sz = snprintf(buf, sizeof(buf), "---DIVERGED at %" PRIu32 " in %s\n", local->tick, name);
+        SDL_RWwrite(data->trace_file, buf, sz, 1);
+        trace_hash_breakdown(data, local);
+    }
+}
+
+/**
+ * Rebuild the game state from before a late input, and replay the inputs on top of it.
+ *
+ * With input delay, the game state is snapshotted on every tick, and the replay starts from the newest snapshot
+ * taken on or before the late input. Without it, every remote input counts as late, and the replay starts from
+ * the checkpoint.
+ *
+ * @param data Network controller data
+ * @param gs_current Live game state, which gets the replayed state as its new state
+ * @param late_tick Arena tick of the earliest late input
+ * @return 1 if the replay found that the peers are out of sync
+ */
+int rewind_and_replay(wtf *data, game_state *gs_current, uint32_t late_tick) {
     // first, find the last frame we have input from the other side
     // this will be our next checkpoint (as no events can come in before
     iterator it;
-    list *transcript = &data->transcript;
-    list_iter_begin(transcript, &it);
+    net_transcript *transcript = &data->transcript;
     tick_events *ev = NULL;
-    game_state *gs = data->gs_bak;
-    game_state *gs_new = NULL;
+    state_snapshot *checkpoint = data->checkpoint;
+    bool saved_checkpoint = false;
     char buf[255];
 
-    game_state *gs_old = omf_calloc(1, sizeof(game_state));
-    game_state_clone(gs, gs_old);
+    // Everything before the late input is still right, and need not be replayed
+    if(data->input_delay > 0) {
+        state_snapshot *snapshot = state_snapshot_ring_find(&data->snapshots, late_tick + data->local_proposal);
+        if(snapshot != NULL && snapshot->int_tick > checkpoint->int_tick) {
+            checkpoint = snapshot;
+        }
+    }
+
+    // Rebuild the state from the snapshot, and replay inputs on top of it.
+    game_state *gs = omf_calloc(1, sizeof(game_state));
+    state_snapshot_restore(checkpoint, gs);
+    // the replay never stalls; the next dyntick decides whether the replayed state has to wait
+    game_state_set_stalled(gs, 0);
 
     DEBUG("current game ticks is %" PRIu32 ", stored game ticks are %" PRIu32 ", last tick is %" PRIu32,
           gs_current->int_tick - data->local_proposal, gs->int_tick - data->local_proposal,
           data->last_tick - data->local_proposal);
 
+    uint32_t depth = data->last_tick - checkpoint->int_tick;
+    data->stats.rollbacks++;
+    data->stats.rollback_ticks += depth;
+    data->stats.max_rollback = umax2(data->stats.max_rollback, depth);
+    if(depth > (uint32_t)max2(settings_get()->net.net_max_rollback, 0)) {
+        data->stats.deep_rollbacks++;
+    }
+
     // fix the game state pointers in the controllers
     for(int i = 0; i < game_state_num_players(gs); i++) {
         game_player *gp = game_state_get_player(gs, i);
@@ -225,28 +611,28 @@ int rewind_and_replay(wtf *data, game_state *gs_current) {
 
     int last_seen_peer = 0;
 
-    while((ev = (tick_events *)list_iter_next(&it))) {
-        if(ev->tick + data->local_proposal < data->gs_bak->int_tick) {
-            // tick too old to matter
-            DEBUG("tick %" PRIu32 " is older than %" PRIu32, ev->tick, data->gs_bak->int_tick - data->local_proposal);
-            assert(ev->seen_peer == 3);
-            list_delete(transcript, &it);
-            continue;
+    // ticks before the checkpoint are too old to matter
+    if(data->checkpoint->int_tick > data->local_proposal) {
+        trim_transcript(data, data->checkpoint->int_tick - data->local_proposal);
+    }
+
+    net_transcript_iter_begin(transcript, &it, checkpoint->int_tick - data->local_proposal);
+    while((ev = (tick_events *)iter_next(&it))) {
+        // delayed inputs that are not due yet are applied when the game gets there
+        if(ev->tick + data->local_proposal > data->last_tick) {
+            break;
         }
 
         // XXX TODO disable this for now, for unknown reason
         // if(false && gs_new == NULL && ev->tick > umin2(data->last_acked_tick, data->last_received_tick) &&
         // ev->seen_peer == 3) {
-        if(gs_new == NULL && last_seen_peer == 3 && ev->seen_peer != 3) {
+        if(data->input_delay == 0 && !saved_checkpoint && last_seen_peer == 3 && ev->seen_peer != 3) {
             // DEBUG("tick %" PRIu32 " is newer than last acked tick %" PRIu32, ev->tick, data->last_acked_tick);
             DEBUG("saving game state at last agreed on tick %d", gs->int_tick - data->local_proposal);
             // save off the game state at the point we last agreed
             // on the state of the game
-            gs_new = omf_calloc(1, sizeof(game_state));
-            game_state_clone(gs, gs_new);
-            data->gs_bak = gs_new;
-            game_state_clone_free(gs_old);
-            omf_free(gs_old);
+            take_checkpoint(data, gs);
+            saved_checkpoint = true;
         }
         if(last_seen_peer && last_seen_peer != 3 && ev->seen_peer == 3) {
             print_transcript(transcript);
@@ -261,28 +647,43 @@ int rewind_and_replay(wtf *data, game_state *gs_current) {
         for(int dynamic_wait = ticks; dynamic_wait > 0; dynamic_wait--) {
             // Tick scene
             game_state_dynamic_tick(gs, true);
-            DEBUG("arena tick %" PRIu32 ", hash %" PRIu32, gs->int_tick - data->local_proposal, arena_state_hash(gs));
+            if(data->input_delay > 0) {
+                state_snapshot_ring_save(&data->snapshots, gs);
+                save_checkpoint(data, gs);
+            }
+            game_state_hash(gs, gs->int_tick - data->local_proposal, &data->hash);
+            if(data->input_delay == 0 && ev->seen_peer == 3 && data->hash.tick % CHECKPOINT_INTERVAL == 0 &&
+               data->hash.tick > data->last_hash_tick) {
+                // Confirmed by both peers. Only every CHECKPOINT_INTERVAL'th tick is kept, so that the peers
+                // hash the same ticks no matter how far they rolled back.
+                data->last_hash_tick = data->hash.tick;
+                data->last_hash = data->hash.total;
+                remember_hash(data, &data->hash);
+            }
+            DEBUG("arena tick %" PRIu32 ", hash %016" PRIx64, data->hash.tick, data->hash.total);
             arena_state_dump(gs);
             if(data->trace_file && (ev->events[0] || ev->events[1]) && ev->seen_peer == 3 &&
                ev->tick > data->last_traced_tick) {
                 data->last_traced_tick = ev->tick;
-                int sz = snprintf(buf, sizeof(buf), "tick %d -- player 1 %d -- player 2 %d -- hash %" PRIu32 "\n",
-                                  ev->tick, ev->events[0], ev->events[1], arena_state_hash(gs));
+                int sz = snprintf(buf, sizeof(buf), "tick %d -- player 1 %d -- player 2 %d -- hash %016" PRIx64 "\n",
+                                  ev->tick, ev->events[0], ev->events[1], data->hash.total);
                 SDL_RWwrite(data->trace_file, buf, sz, 1);
             }
 
-            if(gs->int_tick - data->local_proposal == data->peer_last_hash_tick &&
-               data->peer_last_hash != arena_state_hash(gs) && ev->seen_peer == 3) {
+            if(data->hash.tick == data->peer_last_hash_tick && data->peer_last_hash != data->hash.total &&
+               ev->seen_peer == 3) {
                 if(data->trace_file) {
-                    int sz = snprintf(buf, sizeof(buf), "---MISMATCH at %d (%d) got %" PRIu32 " expected %" PRIu32 "\n",
-                                      gs->int_tick - data->local_proposal, data->peer_last_hash_tick,
-                                      data->peer_last_hash, arena_state_hash(gs));
+                    int sz = snprintf(buf, sizeof(buf),
+                                      "---MISMATCH at %d (%d) got %016" PRIx64 " expected %016" PRIx64 "\n",
+                                      data->hash.tick, data->peer_last_hash_tick, data->peer_last_hash,
+                                      data->hash.total);
                     SDL_RWwrite(data->trace_file, buf, sz, 1);
+                    trace_hash_breakdown(data, &data->hash);
                 }
 
-                DEBUG("arena hash mismatch at %d (%d) -- got %" PRIu32 " expected %" PRIu32 "!",
-                      gs->int_tick - data->local_proposal, data->peer_last_hash_tick, data->peer_last_hash,
-                      arena_state_hash(gs));
+                DEBUG("arena hash mismatch at %d (%d) -- got %016" PRIx64 " expected %016" PRIx64 "!",
+                      data->hash.tick, data->peer_last_hash_tick, data->peer_last_hash, data->hash.total);
+                send_hash_breakdown(data, &data->hash);
                 for(int i = 0; i < game_state_num_players(gs); i++) {
                     game_player *gp = game_state_get_player(gs, i);
                     controller *c = game_player_get_ctrl(gp);
@@ -290,56 +691,23 @@ int rewind_and_replay(wtf *data, game_state *gs_current) {
                         c->gs = gs_current;
                     }
                 }
-                if(gs_old) {
-                    game_state_clone_free(gs_old);
-                    omf_free(gs_old);
-                }
+                game_state_clone_free(gs);
+                omf_free(gs);
                 return 1;
-            } else if(gs->int_tick - data->local_proposal == data->peer_last_hash_tick) {
+            } else if(data->hash.tick == data->peer_last_hash_tick) {
                 DEBUG("arena hashes agree!");
             }
         }
-        if(ev->seen_peer == 3 && data->last_hash_tick < gs->int_tick - data->local_proposal) {
-            data->last_hash_tick = gs->int_tick - data->local_proposal;
-            data->last_hash = arena_state_hash(gs);
-        }
 
         // feed in the inputs
         // XXX this is a hack for now
-
-        for(int j = 0; j < 2; j++) {
-            int player_id = j;
-            game_player *player = game_state_get_player(gs, player_id);
-            if(ev->events[j]) {
-                DEBUG("replaying input %d from player %d at tick %d %d -- peer_seen %d", ev->events[j], player_id,
-                      ev->tick, gs->int_tick - data->local_proposal, ev->seen_peer);
-                if(((ev->events[j] & ~ACT_KICK) & ~ACT_PUNCH) != 0) {
-                    object_act(game_state_find_object(gs, game_player_get_har_obj_id(player)),
-                               (ev->events[j] & ~ACT_KICK) & ~ACT_PUNCH);
-                }
-                if(ev->events[j] & ACT_PUNCH) {
-                    object_act(game_state_find_object(gs, game_player_get_har_obj_id(player)), ACT_PUNCH);
-                } else if(ev->events[j] & ACT_KICK) {
-                    object_act(game_state_find_object(gs, game_player_get_har_obj_id(player)), ACT_KICK);
-                }
-
-                // write_rec_move(gs->sc, player, ev->events[j]);
-                //} else {
-                //    object_act(game_state_find_object(gs, game_player_get_har_obj_id(player)), ACT_STOP);
-            }
-        }
+        apply_inputs(data, gs, ev);
         // controller_cmd(ctrl, action, ev);
     }
 
-    if(gs_new == NULL && gs->int_tick - data->local_proposal <= data->last_acked_tick) {
+    if(data->input_delay == 0 && !saved_checkpoint && gs->int_tick - data->local_proposal <= data->last_acked_tick) {
         // XXX what is the tick condition here?
-        gs_new = omf_calloc(1, sizeof(game_state));
-        game_state_clone(gs, gs_new);
-        data->gs_bak = gs_new;
-        game_state_clone_free(gs_old);
-        omf_free(gs_old);
-    } else if(gs_new == NULL) {
-        data->gs_bak = gs_old;
+        take_checkpoint(data, gs);
     }
 
     DEBUG("game state is %" PRIu32 ", want %" PRIu32, gs->int_tick, data->last_tick);
@@ -348,6 +716,10 @@ int rewind_and_replay(wtf *data, game_state *gs_current) {
     for(int dynamic_wait = (int)ticks; dynamic_wait > 0; dynamic_wait--) {
         // Tick scene
         game_state_dynamic_tick(gs, true);
+        if(data->input_delay > 0) {
+            state_snapshot_ring_save(&data->snapshots, gs);
+            save_checkpoint(data, gs);
+        }
     }
 
     DEBUG("advanced game state to %" PRIu32 ", expected %" PRIu32, gs->int_tick - data->local_proposal,
@@ -355,6 +727,7 @@ int rewind_and_replay(wtf *data, game_state *gs_current) {
 
     // replace the game state with the replayed one
     gs_current->new_state = gs;
+    data->last_applied_tick = data->last_tick;
     return 0;
 }
 
@@ -378,9 +751,47 @@ int net_controller_tick_offset(controller *ctrl) {
     return data->tick_offset / 2;
 }
 
+int net_controller_input_delay(controller *ctrl) {
+    wtf *data = ctrl->data;
+    if(!data->synchronized || data->checkpoint == NULL) {
+        return 0;
+    }
+    return data->input_delay;
+}
+
+void net_controller_get_stats(controller *ctrl, net_controller_stats *stats) {
+    wtf *data = ctrl->data;
+    *stats = data->stats;
+    stats->input_delay = data->input_delay;
+    stats->packets_sent = data->sim.sent;
+    stats->packets_dropped = data->sim.dropped;
+}
+
+uint32_t net_controller_last_hash_tick(controller *ctrl) {
+    wtf *data = ctrl->data;
+    return data->last_hash_tick;
+}
+
+bool net_controller_get_hash(controller *ctrl, uint32_t tick, uint64_t *hash) {
+    wtf *data = ctrl->data;
+    const state_hash *found = find_hash(data, tick);
+    if(found == NULL) {
+        return false;
+    }
+    *hash = found->total;
+    return true;
+}
+
 void net_controller_free(controller *ctrl) {
     wtf *data = ctrl->data;
 
+    if(data->stats.rollbacks > 0) {
+        INFO("netplay: %" PRIu32 " rollbacks, %" PRIu32 " ticks on average, %" PRIu32 " at most, %" PRIu32
+             " deeper than the limit; input delay %d",
+             data->stats.rollbacks, data->stats.rollback_ticks / data->stats.rollbacks, data->stats.max_rollback,
+             data->stats.deep_rollbacks, data->input_delay);
+    }
+
     if(data->trace_file) {
         char buf[255];
         int sz = snprintf(buf, sizeof(buf), "------BEGIN TRANSCRIPT-------\n");
@@ -388,9 +799,9 @@ void net_controller_free(controller *ctrl) {
         SDL_RWwrite(data->trace_file, buf, sz, 1);
 
         iterator it;
-        list_iter_begin(&data->transcript, &it);
+        net_transcript_iter_begin(&data->transcript, &it, 0);
         tick_events *ev = NULL;
-        while((ev = (tick_events *)list_iter_next(&it))) {
+        while((ev = (tick_events *)iter_next(&it))) {
             DEBUG("tick %" PRIu32 " has events %d -- %d", ev->tick, ev->events[0], ev->events[1]);
             int sz = snprintf(buf, sizeof(buf), "tick %" PRIu32 " -- player 1 %d -- player 2 %d -- seen_peer %d\n",
                               ev->tick, ev->events[0], ev->events[1], ev->seen_peer);
@@ -399,6 +810,18 @@ void net_controller_free(controller *ctrl) {
 
         SDL_RWclose(data->trace_file);
     }
+    if(data->checkpoint != NULL) {
+        // the match is cut short; let spectators see as much of it as was confirmed
+        spectate_end(data, data->checkpoint->int_tick - data->local_proposal);
+        net_sim_flush(&data->sim, data->host);
+    }
+    // anything still held back is lost, like on a real connection
+    net_sim_free(&data->sim);
+    if(data->relay_host) {
+        enet_peer_disconnect_now(data->relay, 0);
+        enet_host_destroy(data->relay_host);
+    }
+
     ENetEvent event;
     if(!data->disconnected) {
         DEBUG("closing connection");
@@ -425,11 +848,9 @@ done:
         enet_host_destroy(data->host);
         data->host = NULL;
     }
-    list_free(&data->transcript);
-    if(data->gs_bak) {
-        game_state_clone_free(data->gs_bak);
-        omf_free(data->gs_bak);
-    }
+    state_snapshot_ring_free(&data->snapshots);
+    state_snapshot_free(&data->checkpoint_store);
+    net_transcript_free(&data->transcript);
     if(ctrl->data) {
         omf_free(ctrl->data);
     }
@@ -443,10 +864,10 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
     serial ser;
     uint32_t ticks = ctrl->gs->int_tick;
 
-    if(has_event(data, ticks - 1) && ticks > data->last_tick) {
+    if(has_event(data, ticks - 1 + data->input_delay) && ticks > data->last_tick) {
         DEBUG("sending events %d -- %d", ticks - data->local_proposal, data->last_acked_tick);
-        send_events(data);
         data->last_tick = ticks;
+        send_events(data);
         // if(rewind_and_replay(data, ctrl->gs)) {
         //     enet_peer_disconnect(data->peer, 0);
         //     return 0;
@@ -455,13 +876,30 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
 
     data->last_tick = ticks;
 
+    if(data->synchronized && data->checkpoint && ticks > data->last_sent) {
+        if(data->redundant_sends > 0) {
+            // the inputs may not have made it, send them again
+            send_events(data);
+        } else if(data->input_delay > 0 && ticks - data->last_sent >= CHECKPOINT_INTERVAL) {
+            // keep the peer up to date on how far our inputs are final, so that it can checkpoint
+            send_events(data);
+        }
+    }
+
+    if(data->stalled && ++data->stalled_ticks % CHECKPOINT_INTERVAL == 0) {
+        // the clock stands still while stalled; keep telling the peer how far our inputs are final, as it may be
+        // waiting for them too
+        send_events(data);
+    }
+
     if(ticks == data->local_proposal && !data->synchronized) {
         if(data->confirmed) {
             DEBUG("time to start match: %" PRIu32, ticks);
             data->synchronized = true;
         } else {
-            // proposal expired
+            // proposal expired, allow making a new one
             data->local_proposal = 0;
+            data->peer_proposal = 0;
         }
     }
 
@@ -469,21 +907,26 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
         DEBUG("missed synchronize tick %" PRIu32 " -- @ %" PRIu32, data->local_proposal, ticks);
     }
 
-    if(data->gs_bak == NULL && is_arena(game_state_get_scene(ctrl->gs)->id) &&
+    if(data->checkpoint == NULL && is_arena(game_state_get_scene(ctrl->gs)->id) &&
        (ticks - data->local_proposal) % 7 == 0 &&
        game_state_find_object(ctrl->gs, game_player_get_har_obj_id(game_state_get_player(ctrl->gs, 1)))) {
         arena_reset(ctrl->gs->sc);
-        data->gs_bak = omf_calloc(1, sizeof(game_state));
-        game_state_clone(ctrl->gs, data->gs_bak);
-        DEBUG("cloned game state at arena tick %d hash %" PRIu32, data->gs_bak->int_tick - data->local_proposal,
-              arena_state_hash(data->gs_bak));
+        take_checkpoint(data, ctrl->gs);
         data->local_proposal = ticks; // reset the tick offset to the start of the match
-        data->last_hash_tick = data->gs_bak->int_tick - data->local_proposal;
-        data->last_hash = arena_state_hash(data->gs_bak);
-    } else if(data->gs_bak != NULL && !is_arena(game_state_get_scene(ctrl->gs)->id)) {
+        data->arena_state = arena_get_state(ctrl->gs->sc);
+        update_input_delay(data);
+        data->round_input_delay = data->input_delay;
+        game_state_hash(ctrl->gs, data->checkpoint->int_tick - data->local_proposal, &data->hash);
+        DEBUG("saved game state at arena tick %d hash %016" PRIx64, data->hash.tick, data->hash.total);
+        data->last_hash_tick = data->hash.tick;
+        data->last_hash = data->hash.total;
+        remember_hash(data, &data->hash);
+        spectate_start(data, ctrl->gs);
+    } else if(data->checkpoint != NULL && !is_arena(game_state_get_scene(ctrl->gs)->id)) {
+        spectate_end(data, data->checkpoint->int_tick - data->local_proposal);
+        set_stalled(data, ctrl->gs, false);
         // changed scene and no longer need a game state backup, release it
-        game_state_clone_free(data->gs_bak);
-        omf_free(data->gs_bak);
+        state_snapshot_ring_clear(&data->snapshots);
         data->last_action = ACT_STOP;
         data->synchronized = false;
         data->local_proposal = 0;
@@ -491,7 +934,7 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
         data->confirmed = false;
         data->last_tick = 0;
         data->last_sent = 0;
-        data->gs_bak = NULL;
+        data->checkpoint = NULL;
         data->last_received_tick = 0;
         data->last_acked_tick = 0;
         data->last_har_state = -1;
@@ -500,9 +943,30 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
         data->peer_last_hash_tick = 0;
         data->last_hash = 0;
         data->last_hash_tick = 0;
+        for(int i = 0; i < HASH_HISTORY; i++) {
+            data->hash_history[i].count = 0;
+        }
+        data->input_final = 0;
+        data->peer_final_tick = 0;
+        data->last_applied_tick = 0;
+        data->newest_sent = 0;
+        data->redundant_sends = 0;
+
+        net_transcript_clear(&data->transcript);
+    } else if(data->checkpoint != NULL) {
+        int arena_state = arena_get_state(game_state_get_scene(ctrl->gs));
+        if(arena_state == ARENA_STATE_STARTING && data->arena_state != ARENA_STATE_STARTING) {
+            // a new round is starting and nobody is fighting yet, so the delay can follow the current latency
+            update_input_delay(data);
+            data->round_input_delay = data->input_delay;
+        }
+        data->arena_state = arena_state;
+    }
 
-        list_free(&data->transcript);
-        list_create(&data->transcript);
+    // send out the packets the network simulation has held back
+    net_sim_flush(&data->sim, host);
+    if(data->relay_host) {
+        service_relay(data);
     }
 
     while(enet_host_service(host, &event, 0) > 0) {
@@ -511,21 +975,36 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
                 serial_create_from(&ser, (const char *)event.packet->data, event.packet->dataLength);
                 switch(serial_read_int8(&ser)) {
                     case EVENT_TYPE_ACTION: {
-                        assert(event.packet->dataLength % 6 == 1);
                         uint32_t last_received = 0;
+                        bool late = false;
+                        uint32_t late_tick = UINT32_MAX;
                         uint32_t last_acked = serial_read_uint32(&ser);
+                        uint32_t peer_final = serial_read_uint32(&ser);
                         uint32_t peer_last_hash_tick = serial_read_uint32(&ser);
-                        uint32_t peer_last_hash = serial_read_uint32(&ser);
+                        uint64_t peer_last_hash = serial_read_uint64(&ser);
+                        uint32_t remote_tick = serial_read_uint32(&ser);
+                        uint32_t count = serial_read_varint(&ser);
+                        if(count > event.packet->dataLength / 2) {
+                            DEBUG("dropping broken action packet with %" PRIu32 " events", count);
+                            break;
+                        }
 
-                        for(size_t i = 13; i < event.packet->dataLength; i += 6) {
+                        for(uint32_t i = 0; i < count; i++) {
                             // dispatch keypress to scene
-                            int action = serial_read_int16(&ser);
-                            unsigned remote_tick = serial_read_uint32(&ser);
+                            remote_tick += serial_read_varint(&ser);
+                            int action = (uint8_t)serial_read_int8(&ser);
 
-                            if(data->synchronized && data->gs_bak) {
+                            if(data->synchronized && data->checkpoint) {
                                 DEBUG("inserting event %d at tick %" PRIu32, action, remote_tick);
                                 if(remote_tick > data->last_received_tick) {
-                                    insert_event(data, remote_tick, action, abs(data->id - 1));
+                                    if(!insert_event(data, remote_tick, action, abs(data->id - 1))) {
+                                        break;
+                                    }
+                                    // the game has already gone past this input, so it needs a rollback
+                                    if(remote_tick + data->local_proposal <= data->last_applied_tick) {
+                                        late = true;
+                                        late_tick = umin2(late_tick, remote_tick);
+                                    }
                                 }
                                 last_received = remote_tick;
                                 // print_transcript(&data->transcript);
@@ -534,18 +1013,26 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
                                 controller_cmd(ctrl, action, ev);
                             }
                         }
-                        if(data->synchronized && data->gs_bak) {
+                        if(data->synchronized && data->checkpoint) {
                             // print_transcript(&data->transcript);
                             data->last_received_tick = max2(data->last_received_tick, last_received);
                             data->last_acked_tick = max2(data->last_acked_tick, last_acked);
+                            data->peer_final_tick = umax2(data->peer_final_tick, peer_final);
                             if(peer_last_hash_tick > data->peer_last_hash_tick) {
                                 data->peer_last_hash_tick = peer_last_hash_tick;
                                 data->peer_last_hash = peer_last_hash;
-                                DEBUG("peer last hash is %" PRIu32 " %d, local is %d %" PRIu32,
-                                      data->peer_last_hash_tick, data->peer_last_hash,
-                                      data->gs_bak->int_tick - data->local_proposal, arena_state_hash(data->gs_bak));
+                                DEBUG("peer last hash is %" PRIu32 " %016" PRIx64 ", local is %d %016" PRIx64,
+                                      data->peer_last_hash_tick, data->peer_last_hash, data->last_hash_tick,
+                                      data->last_hash);
+                                if(data->input_delay > 0 && check_peer_hash(data)) {
+                                    enet_peer_disconnect(data->peer, 0);
+                                    return 0;
+                                }
                             }
-                            if(last_received && rewind_and_replay(data, ctrl->gs)) {
+                            // Without input delay, every remote input is predicted wrong and needs a rollback.
+                            // With it, only the ones that arrive after their tick do.
+                            bool rollback = data->input_delay > 0 ? late : last_received != 0;
+                            if(rollback && rewind_and_replay(data, ctrl->gs, late_tick)) {
                                 enet_peer_disconnect(data->peer, 0);
                                 return 0;
                             }
@@ -556,9 +1043,20 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
                             }
                         }
                     } break;
+                    case EVENT_TYPE_HASH_BREAKDOWN: {
+                        state_hash_unserialize(&data->peer_hash, &ser);
+                        compare_hash_breakdown(data);
+                    } break;
                     case EVENT_TYPE_HB: {
                         // got a tick
                         int id = serial_read_int8(&ser);
+                        uint8_t version = serial_read_int8(&ser);
+                        if(version != NET_PROTOCOL_VERSION) {
+                            PERROR("peer uses netplay protocol version %d, but we use %d", version,
+                                   NET_PROTOCOL_VERSION);
+                            enet_peer_disconnect(peer, 0);
+                            break;
+                        }
                         if(id == data->id) {
                             // this is a reply to our own heartbeat, analyze it
                             uint32_t start = serial_read_int32(&ser);
@@ -577,7 +1075,7 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
                                 data->guesses = 0;
                             }
                             int newrtt = udist(ticks, start);
-                            if(data->guesses >= 10 &&
+                            if(data->guesses >= 10 && data->peer_version_ok &&
                                ((data->id == ROLE_SERVER && ticks % 37 == 0) ||
                                 (data->id == ROLE_CLIENT && ticks % 73 == 0)) &&
                                !data->synchronized && data->peer_proposal == 0) {
@@ -600,8 +1098,8 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
 
                                 start_packet = enet_packet_create(start_ser.data, serial_len(&start_ser),
                                                                   ENET_PACKET_FLAG_UNSEQUENCED);
-                                enet_peer_send(peer, 0, start_packet);
-                                enet_host_flush(host);
+                                net_sim_send(&data->sim, peer, 0, start_packet);
+                                net_sim_flush(&data->sim, host);
                                 serial_free(&start_ser);
                                 // enet_packet_destroy(start_packet);
                             }
@@ -622,6 +1120,7 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
                             data->outstanding_hb = 0;
                             data->last_hb = ticks;
                         } else {
+                            data->peer_version_ok = true;
                             uint32_t peerticks = serial_read_uint32(&ser);
 
                             // a heartbeat from the peer, bounce it back with our tick and our prediction of the peer's
@@ -633,8 +1132,8 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
                                 serial_write_uint32(&ser, ticks);
                                 serial_write_uint32(&ser, peerticks + data->tick_offset);
                                 packet = enet_packet_create(ser.data, serial_len(&ser), ENET_PACKET_FLAG_UNSEQUENCED);
-                                enet_peer_send(peer, 0, packet);
-                                enet_host_flush(host);
+                                net_sim_send(&data->sim, peer, 0, packet);
+                                net_sim_flush(&data->sim, host);
                             }
                         }
                     } break;
@@ -642,7 +1141,8 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
                         uint32_t peer_proposal = serial_read_uint32(&ser);
                         uint32_t local_proposal = serial_read_uint32(&ser);
                         uint32_t seed = serial_read_uint32(&ser);
-                        if(peer_proposal + data->tick_offset > ticks && data->peer_proposal == 0) {
+                        if(peer_proposal + data->tick_offset > ticks && data->peer_proposal == 0 &&
+                           data->peer_version_ok) {
                             DEBUG("got peer proposal to start @ %" PRIu32 " (currently %" PRIu32 "), seed %" PRIu32,
                                   peer_proposal, ticks, seed);
                             data->local_proposal = peer_proposal;
@@ -660,8 +1160,8 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
 
                             start_packet = enet_packet_create(start_ser.data, serial_len(&start_ser),
                                                               ENET_PACKET_FLAG_UNSEQUENCED);
-                            enet_peer_send(peer, 0, start_packet);
-                            enet_host_flush(host);
+                            net_sim_send(&data->sim, peer, 0, start_packet);
+                            net_sim_flush(&data->sim, host);
                             serial_free(&start_ser);
                             // enet_packet_destroy(start_packet);
                         }
@@ -687,10 +1187,9 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
                 data->disconnected = 1;
                 event.peer->data = NULL;
                 data->synchronized = false;
-                if(data->gs_bak) {
-                    game_state_clone_free(data->gs_bak);
-                    omf_free(data->gs_bak);
-                }
+                set_stalled(data, ctrl->gs, false);
+                state_snapshot_ring_clear(&data->snapshots);
+                data->checkpoint = NULL;
                 controller_close(ctrl, ev);
                 return 1; // bail the fuck out
                 break;
@@ -713,12 +1212,13 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
 
             serial_write_int8(&ser, EVENT_TYPE_HB);
             serial_write_int8(&ser, data->id);
+            serial_write_int8(&ser, NET_PROTOCOL_VERSION);
             serial_write_uint32(&ser, ticks);
 
             packet = enet_packet_create(ser.data, serial_len(&ser), ENET_PACKET_FLAG_UNSEQUENCED);
             serial_free(&ser);
-            enet_peer_send(peer, 0, packet);
-            enet_host_flush(host);
+            net_sim_send(&data->sim, peer, 0, packet);
+            net_sim_flush(&data->sim, host);
         } else {
             DEBUG("peer is null~");
             data->disconnected = 1;
@@ -732,6 +1232,56 @@ int net_controller_tick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
     return 0;
 }
 
+// With input delay, inputs of both players are applied here once they are due, instead of when they are made.
+int net_controller_dyntick(controller *ctrl, uint32_t ticks0, ctrl_event **ev) {
+    wtf *data = ctrl->data;
+    game_state *gs = ctrl->gs;
+    if(data->input_delay == 0 || !data->synchronized || data->checkpoint == NULL) {
+        return 0;
+    }
+
+    // Inputs of this tick are missing if the peer has not made them final yet. If they turn out to be late, the
+    // rollback replays everything since the checkpoint, so wait instead if that would be too many ticks.
+    uint32_t max_rollback = max2(settings_get()->net.net_max_rollback, 0);
+    bool stall = gs->int_tick - data->local_proposal >= data->peer_final_tick &&
+                 gs->int_tick + 1 - data->checkpoint->int_tick > max_rollback;
+    if(stall && !data->stalled) {
+        // the peer may be stalled as well, and needs to know how far our inputs are final to continue
+        send_events(data);
+    }
+    set_stalled(data, gs, stall);
+    if(stall) {
+        return 0;
+    }
+
+    // The delay is only changed when a round starts
+    if(is_arena(gs->sc->id) && arena_get_state(gs->sc) == ARENA_STATE_FIGHTING) {
+        assert(data->input_delay == data->round_input_delay);
+    }
+
+    // A rollback has already applied the inputs up to here
+    if(gs->int_tick <= data->last_applied_tick) {
+        return 0;
+    }
+    data->last_applied_tick = gs->int_tick;
+
+    state_snapshot_ring_save(&data->snapshots, gs);
+    if(save_checkpoint(data, gs)) {
+        trim_transcript(data, data->checkpoint->int_tick - data->local_proposal);
+    }
+    tick_events *tev = net_transcript_get(&data->transcript, gs->int_tick - data->local_proposal);
+    if(tev) {
+        apply_inputs(data, gs, tev);
+        // the arena never sees delayed inputs, so they are recorded here, where they are applied
+        for(int i = 0; i < 2; i++) {
+            if(tev->events[i]) {
+                write_rec_move(gs->sc, game_state_get_player(gs, i), tev->events[i]);
+            }
+        }
+    }
+    return 0;
+}
+
 void controller_hook(controller *ctrl, int action) {
     wtf *data = ctrl->data;
     ENetPeer *peer = data->peer;
@@ -746,8 +1296,10 @@ void controller_hook(controller *ctrl, int action) {
         if(data->last_action == action && har->state == data->last_har_state) {
             return;
         }
-        int arena_state = arena_get_state(game_state_get_scene(ctrl->gs));
-        if(arena_state != ARENA_STATE_FIGHTING) {
+        // The arena feeds HAR inputs in every state, eg. for scrap and destruction while ending, so they go into
+        // the transcript in every state too; the HAR itself ignores the ones it has no use for. Until the match
+        // has a checkpoint there is no tick to put them on.
+        if(!data->synchronized || data->checkpoint == NULL) {
             return;
         }
         data->last_har_state = har->state;
@@ -756,9 +1308,10 @@ void controller_hook(controller *ctrl, int action) {
 
     if(peer) {
         // DEBUG("Local event %d at %d", action, data->last_tick - data->local_proposal);
-        if(data->synchronized && data->gs_bak) {
-            DEBUG("inserting event %d at tick %" PRIu32, action, ctrl->gs->int_tick - data->local_proposal);
-            insert_event(data, ctrl->gs->int_tick - data->local_proposal, action, data->id);
+        if(data->synchronized && data->checkpoint) {
+            uint32_t tick = local_input_tick(data, ctrl->gs->int_tick - data->local_proposal);
+            DEBUG("inserting event %d at tick %" PRIu32, action, tick);
+            insert_event(data, tick, action, data->id);
             // print_transcript(&data->transcript);
             // send_events(data);
             // rewind_and_replay(data, ctrl->gs);
@@ -766,19 +1319,18 @@ void controller_hook(controller *ctrl, int action) {
             serial ser;
             ENetPacket *packet;
             serial_create(&ser);
-            serial_write_int8(&ser, EVENT_TYPE_ACTION);
-            serial_write_uint32(&ser, 0);
-            serial_write_uint32(&ser, 0);
-            serial_write_uint32(&ser, 0);
-            serial_write_int16(&ser, action);
+            write_action_header(&ser, 0, 0, 0, 0);
             serial_write_uint32(&ser, udist(data->last_tick, data->local_proposal));
+            serial_write_varint(&ser, 1);
+            serial_write_varint(&ser, 0);
+            serial_write_int8(&ser, action);
             DEBUG("controller hook fired with %d", action);
             /*sprintf(buf, "k%d", action);*/
             // non gameplay events are not repeated, so they need to be reliable
             packet = enet_packet_create(ser.data, serial_len(&ser), ENET_PACKET_FLAG_RELIABLE);
             serial_free(&ser);
-            enet_peer_send(peer, 1, packet);
-            enet_host_flush(host);
+            net_sim_send(&data->sim, peer, 1, packet);
+            net_sim_flush(&data->sim, host);
         }
     } else {
         DEBUG("peer is null~");
@@ -797,8 +1349,8 @@ void net_controller_har_hook(int action, void *cb_data) {
     data->last_action = action;
     if(peer) {
         DEBUG("har hook!");
-        if(data->synchronized && data->gs_bak) {
-            insert_event(data, data->last_tick - data->local_proposal, action, data->id);
+        if(data->synchronized && data->checkpoint) {
+            insert_event(data, local_input_tick(data, data->last_tick - data->local_proposal), action, data->id);
             send_events(data);
             // print_transcript(&data->transcript);
         }
@@ -826,12 +1378,15 @@ void net_controller_create(controller *ctrl, ENetHost *host, ENetPeer *peer, ENe
     data->confirmed = false;
     data->last_tick = 0;
     data->last_sent = 0;
-    data->gs_bak = NULL;
+    state_snapshot_ring_create(&data->snapshots);
+    state_snapshot_create(&data->checkpoint_store);
+    data->checkpoint = NULL;
     data->last_received_tick = 0;
     data->last_acked_tick = 0;
     data->last_har_state = -1;
     data->trace_file = NULL;
     data->last_traced_tick = 0;
+    update_input_delay(data);
     char *trace_file = settings_get()->net.trace_file;
     if(trace_file) {
         data->trace_file = SDL_RWFromFile(trace_file, "w");
@@ -839,10 +1394,28 @@ void net_controller_create(controller *ctrl, ENetHost *host, ENetPeer *peer, ENe
             DEBUG("failed to open trace file");
         }
     }
-    list_create(&data->transcript);
+    net_transcript_create(&data->transcript);
+    settings_network *net = &settings_get()->net;
+    net_sim_create(&data->sim, net->net_sim_delay, net->net_sim_jitter, net->net_sim_loss);
+    if(id == ROLE_SERVER && net->net_spectate_relay) {
+        data->relay_host = enet_host_create(NULL, 1, SPECTATOR_STREAM_CHANNELS, 0, 0);
+        ENetAddress address;
+        if(data->relay_host && enet_address_set_host(&address, net->net_spectate_relay) == 0) {
+            address.port = net->net_spectate_relay_port;
+            data->relay = enet_host_connect(data->relay_host, &address, SPECTATOR_STREAM_CHANNELS, 0);
+        }
+        if(data->relay == NULL) {
+            PERROR("Unable to connect to spectator relay %s", net->net_spectate_relay);
+            if(data->relay_host) {
+                enet_host_destroy(data->relay_host);
+                data->relay_host = NULL;
+            }
+        }
+    }
     ctrl->data = data;
     ctrl->type = CTRL_TYPE_NETWORK;
     ctrl->tick_fun = &net_controller_tick;
+    ctrl->dyntick_fun = &net_controller_dyntick;
     ctrl->controller_hook = &controller_hook;
     ctrl->free_fun = &net_controller_free;
 }
@@ -5,6 +5,18 @@
 #include <SDL.h>
 #include <enet/enet.h>
 
+typedef struct net_controller_stats {
+    int input_delay;          // Ticks local inputs are delayed by
+    uint32_t rollbacks;       // Times the game state was rewound and replayed
+    uint32_t rollback_ticks;  // Ticks replayed over all rollbacks
+    uint32_t max_rollback;    // Most ticks replayed in a single rollback
+    uint32_t deep_rollbacks;  // Rollbacks that replayed more ticks than the net_max_rollback setting; only happens
+                              // without input delay, as the game is stalled instead
+    uint32_t stalls;          // Times the game was stalled to keep rollbacks within net_max_rollback
+    uint32_t packets_sent;    // Packets sent to the peer
+    uint32_t packets_dropped; // Packets dropped by the simulated packet loss
+} net_controller_stats;
+
 void net_controller_create(controller *ctrl, ENetHost *host, ENetPeer *peer, ENetPeer *lobby, int id);
 void net_controller_free(controller *ctrl);
 int net_controller_get_rtt(controller *ctrl);
@@ -13,6 +25,33 @@ void net_controller_har_hook(int action, void *cb_data);
 bool net_controller_ready(controller *ctrl);
 int net_controller_tick_offset(controller *ctrl);
 
+/**
+ * Get the number of ticks local inputs are delayed by. When this is above zero, the network controller applies
+ * the local player's inputs once they are due, and they must not be applied as they are made.
+ *
+ * @param ctrl Network controller
+ * @return Input delay in ticks, or 0 if local inputs are applied immediately.
+ */
+int net_controller_input_delay(controller *ctrl);
+
+void net_controller_get_stats(controller *ctrl, net_controller_stats *stats);
+
+/**
+ * Get the arena tick of the newest game state hash that was sent to the peer.
+ */
+uint32_t net_controller_last_hash_tick(controller *ctrl);
+
+/**
+ * Get the game state hash of an arena tick, if it is one of the recently sent hashes. Both peers hash the same
+ * ticks, so this can be used to compare their game states from outside.
+ *
+ * @param ctrl Network controller
+ * @param tick Arena tick, counted from the start of the match
+ * @param hash Filled with the hash, if found
+ * @return true if the hash was found
+ */
+bool net_controller_get_hash(controller *ctrl, uint32_t tick, uint64_t *hash);
+
 ENetPeer *net_controller_get_lobby_connection(controller *ctrl);
 
 ENetHost *net_controller_get_host(controller *ctrl);
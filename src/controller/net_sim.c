@@ -0,0 +1,89 @@
+#include "controller/net_sim.h"
+#include "utils/log.h"
+#include <SDL.h>
+
+typedef struct queued_packet {
+    uint64_t release; // SDL_GetTicks64() at which the packet may be sent
+    ENetPeer *peer;
+    uint8_t channel;
+    ENetPacket *packet;
+} queued_packet;
+
+static void send_now(net_sim *sim, ENetPeer *peer, uint8_t channel, ENetPacket *packet) {
+    if(enet_peer_send(peer, channel, packet) < 0) {
+        // The peer went away while the packet was queued
+        enet_packet_destroy(packet);
+        return;
+    }
+    sim->sent++;
+}
+
+void net_sim_create(net_sim *sim, int delay, int jitter, int loss) {
+    sim->delay = delay > 0 ? delay : 0;
+    sim->jitter = jitter > 0 ? jitter : 0;
+    sim->loss = loss > 0 ? loss : 0;
+    sim->last_reliable = 0;
+    sim->sent = 0;
+    sim->dropped = 0;
+    random_seed(&sim->rand, SDL_GetTicks());
+    vector_create(&sim->queue, sizeof(queued_packet));
+    if(sim->delay || sim->jitter || sim->loss) {
+        INFO("simulating network conditions: %d ms delay, %d ms jitter, %d%% loss", sim->delay, sim->jitter,
+             sim->loss);
+    }
+}
+
+void net_sim_free(net_sim *sim) {
+    iterator it;
+    queued_packet *qp;
+    vector_iter_begin(&sim->queue, &it);
+    while((qp = iter_next(&it)) != NULL) {
+        enet_packet_destroy(qp->packet);
+    }
+    vector_free(&sim->queue);
+}
+
+void net_sim_send(net_sim *sim, ENetPeer *peer, uint8_t channel, ENetPacket *packet) {
+    if(!sim->delay && !sim->jitter && !sim->loss) {
+        send_now(sim, peer, channel, packet);
+        return;
+    }
+
+    bool reliable = packet->flags & ENET_PACKET_FLAG_RELIABLE;
+    if(!reliable && sim->loss && (int)random_int(&sim->rand, 100) < sim->loss) {
+        enet_packet_destroy(packet);
+        sim->dropped++;
+        return;
+    }
+
+    queued_packet qp;
+    qp.release = SDL_GetTicks64() + sim->delay;
+    if(sim->jitter) {
+        qp.release += random_int(&sim->rand, sim->jitter + 1);
+    }
+    if(reliable) {
+        // Keep reliable packets in order
+        if(qp.release < sim->last_reliable) {
+            qp.release = sim->last_reliable;
+        }
+        sim->last_reliable = qp.release;
+    }
+    qp.peer = peer;
+    qp.channel = channel;
+    qp.packet = packet;
+    vector_append(&sim->queue, &qp);
+}
+
+void net_sim_flush(net_sim *sim, ENetHost *host) {
+    uint64_t now = SDL_GetTicks64();
+    iterator it;
+    queued_packet *qp;
+    vector_iter_begin(&sim->queue, &it);
+    while((qp = iter_next(&it)) != NULL) {
+        if(qp->release <= now) {
+            send_now(sim, qp->peer, qp->channel, qp->packet);
+            vector_delete(&sim->queue, &it);
+        }
+    }
+    enet_host_flush(host);
+}
@@ -0,0 +1,53 @@
+#ifndef NET_SIM_H
+#define NET_SIM_H
+
+#include "utils/random.h"
+#include "utils/vector.h"
+#include <enet/enet.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Simulated network conditions for testing netplay. Outgoing packets are held back by a fixed delay plus
+ * random jitter, which also reorders unsequenced packets, and a percentage of the unreliable ones is dropped.
+ * Reliable packets are never dropped or reordered, since ENet would not do that either.
+ *
+ * When all the settings are zero, packets are sent right away and nothing is queued.
+ */
+typedef struct net_sim {
+    int delay;  ///< Milliseconds every packet is held back by
+    int jitter; ///< Up to this many milliseconds of extra delay per packet
+    int loss;   ///< Percentage of unreliable packets to drop
+    struct random_t rand;
+    uint64_t last_reliable; ///< Release time of the newest queued reliable packet
+    uint32_t sent;          ///< Packets handed to ENet
+    uint32_t dropped;       ///< Packets dropped on purpose
+    vector queue;
+} net_sim;
+
+void net_sim_create(net_sim *sim, int delay, int jitter, int loss);
+
+/**
+ * Free the simulator. Packets still in the queue are destroyed without sending them.
+ */
+void net_sim_free(net_sim *sim);
+
+/**
+ * Send a packet to a peer, or queue it to be sent later. Takes ownership of the packet, like enet_peer_send.
+ *
+ * @param sim Network simulator
+ * @param peer Peer to send to
+ * @param channel ENet channel
+ * @param packet Packet to send
+ */
+void net_sim_send(net_sim *sim, ENetPeer *peer, uint8_t channel, ENetPacket *packet);
+
+/**
+ * Send the queued packets that are due, and flush the host. Call this regularly, eg. on every tick.
+ *
+ * @param sim Network simulator
+ * @param host Host the packets are sent from
+ */
+void net_sim_flush(net_sim *sim, ENetHost *host);
+
+#endif // NET_SIM_H
@@ -0,0 +1,147 @@
+#include "controller/net_transcript.h"
+#include "utils/allocator.h"
+#include "utils/log.h"
+#include <inttypes.h>
+#include <string.h>
+
+static inline tick_events *slot_for(net_transcript *transcript, uint32_t tick) {
+    return &transcript->slots[tick & (transcript->capacity - 1)];
+}
+
+static inline bool in_window(const net_transcript *transcript, uint32_t tick) {
+    return tick >= transcript->base_tick && tick - transcript->base_tick < transcript->capacity;
+}
+
+// A player has "seen" a tick once they have sent any input for that tick or a later one.
+static inline void update_seen_peer(const net_transcript *transcript, tick_events *ev) {
+    ev->seen_peer = 0;
+    for(int i = 0; i < 2; i++) {
+        if(ev->tick < transcript->seen_until[i]) {
+            ev->seen_peer |= 1 << i;
+        }
+    }
+}
+
+// Grow the ring so that it can hold the given tick. The stored ticks move to their slots in the new ring.
+static bool grow(net_transcript *transcript, uint32_t tick) {
+    uint32_t capacity = transcript->capacity;
+    while(tick - transcript->base_tick >= capacity) {
+        if(capacity >= NET_TRANSCRIPT_MAX_CAPACITY) {
+            return false;
+        }
+        capacity *= 2;
+    }
+    tick_events *old_slots = transcript->slots;
+    uint32_t old_capacity = transcript->capacity;
+    transcript->slots = omf_calloc(capacity, sizeof(tick_events));
+    transcript->capacity = capacity;
+    for(uint32_t t = transcript->base_tick; t < transcript->end_tick; t++) {
+        const tick_events *ev = &old_slots[t & (old_capacity - 1)];
+        if(ev->present) {
+            *slot_for(transcript, t) = *ev;
+        }
+    }
+    omf_free(old_slots);
+    DEBUG("transcript grown to %" PRIu32 " ticks", capacity);
+    return true;
+}
+
+void net_transcript_create(net_transcript *transcript) {
+    transcript->capacity = NET_TRANSCRIPT_INITIAL_CAPACITY;
+    transcript->slots = omf_calloc(transcript->capacity, sizeof(tick_events));
+    net_transcript_clear(transcript);
+}
+
+void net_transcript_free(net_transcript *transcript) {
+    omf_free(transcript->slots);
+    transcript->capacity = 0;
+}
+
+void net_transcript_clear(net_transcript *transcript) {
+    memset(transcript->slots, 0, transcript->capacity * sizeof(tick_events));
+    transcript->base_tick = 0;
+    transcript->end_tick = 0;
+    transcript->seen_until[0] = 0;
+    transcript->seen_until[1] = 0;
+}
+
+bool net_transcript_insert(net_transcript *transcript, uint32_t tick, uint16_t action, int id) {
+    if(tick < transcript->base_tick) {
+        // Already agreed on and trimmed; this is a resend of something we have processed.
+        DEBUG("dropping input for tick %" PRIu32 ", transcript starts at %" PRIu32, tick, transcript->base_tick);
+        return false;
+    }
+    if(!in_window(transcript, tick) && !grow(transcript, tick)) {
+        PERROR("Input for tick %" PRIu32 " is too far ahead of the transcript start %" PRIu32, tick,
+               transcript->base_tick);
+        return false;
+    }
+    tick_events *ev = slot_for(transcript, tick);
+    if(!ev->present) {
+        ev->tick = tick;
+        ev->events[0] = 0;
+        ev->events[1] = 0;
+        ev->present = 1;
+    }
+    ev->events[id] |= action;
+    if(tick + 1 > transcript->seen_until[id]) {
+        transcript->seen_until[id] = tick + 1;
+    }
+    if(tick + 1 > transcript->end_tick) {
+        transcript->end_tick = tick + 1;
+    }
+    return true;
+}
+
+tick_events *net_transcript_get(net_transcript *transcript, uint32_t tick) {
+    if(!in_window(transcript, tick)) {
+        return NULL;
+    }
+    tick_events *ev = slot_for(transcript, tick);
+    if(!ev->present) {
+        return NULL;
+    }
+    update_seen_peer(transcript, ev);
+    return ev;
+}
+
+void net_transcript_trim(net_transcript *transcript, uint32_t tick) {
+    if(tick <= transcript->base_tick) {
+        return;
+    }
+    // Only the slots up to the newest event can be in use
+    uint32_t end = tick < transcript->end_tick ? tick : transcript->end_tick;
+    for(uint32_t t = transcript->base_tick; t < end; t++) {
+        slot_for(transcript, t)->present = 0;
+    }
+    transcript->base_tick = tick;
+    if(transcript->end_tick < tick) {
+        transcript->end_tick = tick;
+    }
+}
+
+static void *net_transcript_iter_next(iterator *iter) {
+    net_transcript *transcript = (net_transcript *)iter->data;
+    uint32_t tick = (uint32_t)iter->inow;
+    while(tick < transcript->end_tick) {
+        tick_events *ev = slot_for(transcript, tick);
+        tick++;
+        if(ev->present) {
+            iter->inow = tick;
+            update_seen_peer(transcript, ev);
+            return ev;
+        }
+    }
+    iter->inow = tick;
+    iter->ended = 1;
+    return NULL;
+}
+
+void net_transcript_iter_begin(net_transcript *transcript, iterator *iter, uint32_t from_tick) {
+    iter->data = transcript;
+    iter->vnow = NULL;
+    iter->inow = from_tick < transcript->base_tick ? transcript->base_tick : from_tick;
+    iter->ended = 0;
+    iter->next = net_transcript_iter_next;
+    iter->prev = NULL;
+}
@@ -0,0 +1,82 @@
+#ifndef NET_TRANSCRIPT_H
+#define NET_TRANSCRIPT_H
+
+#include "utils/iterator.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Must be powers of two. At 10ms per tick the ring starts out with a bit over 10 seconds of unacknowledged
+// input, and grows up to about 11 minutes when the peer stalls.
+#define NET_TRANSCRIPT_INITIAL_CAPACITY 1024
+#define NET_TRANSCRIPT_MAX_CAPACITY 65536
+
+typedef struct tick_events {
+    uint32_t tick;
+    uint16_t events[2];
+    uint8_t seen_peer; ///< Bit N is set if player N is known to have sent inputs for this tick or later.
+    uint8_t present;
+} tick_events;
+
+/**
+ * Netplay input transcript. Inputs are stored in a ring indexed by tick, so that inserting and looking up
+ * a tick is O(1), and no memory is allocated per event.
+ *
+ * Only ticks between base_tick and base_tick + capacity can be stored; older ticks are dropped with
+ * net_transcript_trim once both sides agree on them. If the ticks do not fit, the ring is doubled in size,
+ * up to NET_TRANSCRIPT_MAX_CAPACITY.
+ */
+typedef struct net_transcript {
+    uint32_t base_tick;
+    uint32_t end_tick;      ///< One past the newest tick with events, at least base_tick.
+    uint32_t seen_until[2]; ///< One past the newest tick each player has inputs on, 0 if none.
+    uint32_t capacity;      ///< Number of slots, a power of two.
+    tick_events *slots;
+} net_transcript;
+
+void net_transcript_create(net_transcript *transcript);
+void net_transcript_free(net_transcript *transcript);
+
+/**
+ * Remove all events, and reset the base tick to 0. The ring keeps its size.
+ */
+void net_transcript_clear(net_transcript *transcript);
+
+/**
+ * Add an action for a player to the given tick. Actions on the same tick are OR'd together.
+ *
+ * @param transcript Transcript to modify
+ * @param tick Tick number
+ * @param action Action bitmask (ACT_*)
+ * @param id Player id (0 or 1)
+ * @return True if stored, false if the tick has already been trimmed, or is too far ahead to store.
+ */
+bool net_transcript_insert(net_transcript *transcript, uint32_t tick, uint16_t action, int id);
+
+/**
+ * Find the events for a tick.
+ *
+ * @param transcript Transcript to search
+ * @param tick Tick number
+ * @return Events for the tick, or NULL if there are none.
+ */
+tick_events *net_transcript_get(net_transcript *transcript, uint32_t tick);
+
+/**
+ * Drop all events before the given tick, and move the window start there.
+ *
+ * @param transcript Transcript to modify
+ * @param tick First tick to keep
+ */
+void net_transcript_trim(net_transcript *transcript, uint32_t tick);
+
+/**
+ * Iterate ticks that have events, in tick order, starting from the given tick.
+ * Use iter_next to fetch tick_events pointers.
+ *
+ * @param transcript Transcript to iterate
+ * @param iter Iterator to initialize
+ * @param from_tick First tick to visit
+ */
+void net_transcript_iter_begin(net_transcript *transcript, iterator *iter, uint32_t from_tick);
+
+#endif // NET_TRANSCRIPT_H
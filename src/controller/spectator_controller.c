@@ -0,0 +1,259 @@
+#include <inttypes.h>
+
+#include "controller/spectator_controller.h"
+#include "game/game_state.h"
+#include "game/protos/scene.h"
+#include "game/scenes/arena.h"
+#include "game/utils/serial.h"
+#include "game/utils/settings.h"
+#include "resources/ids.h"
+#include "utils/allocator.h"
+#include "utils/log.h"
+#include "utils/miscmath.h"
+#include <enet/enet.h>
+
+// How long to wait for the relay to send the setup of a match, in milliseconds
+#define SETUP_TIMEOUT 10000
+
+typedef struct {
+    ENetHost *host;
+    ENetPeer *peer;
+    spectator_setup setup;
+    bool has_setup;
+    vector inputs;  // spectator_input, in tick order
+    unsigned next;  // Index of the next input to apply
+    uint32_t final; // Inputs before this match tick have been received
+    uint32_t ticks; // Ticks simulated since entering the arena, or since tick 0 of the match once started
+    bool ended;     // No more inputs are coming
+    bool started;   // The arena has been reset to tick 0 of the match
+    bool stalled;   // Holding the game to wait for inputs
+    bool closed;    // Playback is over and the controller has been closed
+    int delay;      // Ticks to stay behind the newest inputs
+} wtf;
+
+// Handle a packet from the relay. One packet can hold several messages, eg. when catching up.
+static void handle_packet(wtf *data, ENetPacket *packet) {
+    serial ser;
+    serial_create_from(&ser, (const char *)packet->data, packet->dataLength);
+    while(ser.rpos < ser.wpos && !data->ended) {
+        switch(serial_read_int8(&ser)) {
+            case EVENT_TYPE_SPECTATE_SETUP:
+                if(data->has_setup) {
+                    // the players have moved on to another match; this one is over
+                    data->ended = true;
+                    break;
+                }
+                if(!spectator_setup_read(&ser, &data->setup)) {
+                    PERROR("Unsupported spectator stream");
+                    data->ended = true;
+                    break;
+                }
+                data->has_setup = true;
+                break;
+            case EVENT_TYPE_SPECTATE_INPUTS:
+                if(!data->has_setup || !spectator_inputs_read(&ser, data->final, &data->final, &data->inputs)) {
+                    PERROR("Invalid spectator inputs");
+                    data->ended = true;
+                }
+                break;
+            case EVENT_TYPE_SPECTATE_END:
+                DEBUG("match ended at tick %" PRIu32, data->final);
+                data->ended = true;
+                break;
+            default:
+                DEBUG("unknown spectator message");
+                data->ended = true;
+                break;
+        }
+    }
+    serial_free(&ser);
+}
+
+static void service(wtf *data, int timeout) {
+    ENetEvent event;
+    while(enet_host_service(data->host, &event, timeout) > 0) {
+        switch(event.type) {
+            case ENET_EVENT_TYPE_RECEIVE:
+                if(event.channelID == SPECTATOR_STREAM_CHANNEL) {
+                    handle_packet(data, event.packet);
+                }
+                enet_packet_destroy(event.packet);
+                break;
+            case ENET_EVENT_TYPE_DISCONNECT:
+                DEBUG("spectator relay disconnected");
+                data->peer = NULL;
+                data->ended = true;
+                break;
+            default:
+                break;
+        }
+        if(timeout > 0 && (data->has_setup || data->ended)) {
+            break;
+        }
+    }
+}
+
+// Feed the inputs of both players on a tick to their HARs, the same way the network controller does.
+static void apply_inputs(game_state *gs, const spectator_input *input) {
+    for(int i = 0; i < 2; i++) {
+        int action = input->actions[i];
+        if(action == 0) {
+            continue;
+        }
+        object *har = game_state_find_object(gs, game_player_get_har_obj_id(game_state_get_player(gs, i)));
+        if(((action & ~ACT_KICK) & ~ACT_PUNCH) != 0) {
+            object_act(har, (action & ~ACT_KICK) & ~ACT_PUNCH);
+        }
+        if(action & ACT_PUNCH) {
+            object_act(har, ACT_PUNCH);
+        } else if(action & ACT_KICK) {
+            object_act(har, ACT_KICK);
+        }
+    }
+}
+
+static int spectator_controller_tick(controller *ctrl, uint32_t ticks, ctrl_event **ev) {
+    wtf *data = ctrl->data;
+    if(data->peer) {
+        service(data, 0);
+    }
+    return 0;
+}
+
+// Hold the game while waiting for inputs. This is separate from the pause menu, so that closing the menu can not
+// let the game run ahead of the inputs.
+static void set_stalled(wtf *data, game_state *gs, bool stalled) {
+    data->stalled = stalled;
+    game_state_set_stalled(gs, stalled);
+}
+
+/**
+ * The players number the ticks of the match by gs->int_tick, which only stops when the game is stalled, along
+ * with the rest of the tick. Here the game can also be paused from the menu, which stops the simulation but not
+ * gs->int_tick, so neither gs->int_tick nor gs->tick counts the same ticks. Instead, the controller counts the
+ * dynamic ticks that the game actually simulates, which are the same ones the players simulated.
+ */
+static int spectator_controller_dyntick(controller *ctrl, uint32_t ticks, ctrl_event **ev) {
+    wtf *data = ctrl->data;
+    game_state *gs = ctrl->gs;
+    if(data->closed || !is_arena(game_state_get_scene(gs)->id)) {
+        return 0;
+    }
+
+    if(!data->started) {
+        if(game_state_is_paused(gs)) {
+            return 0;
+        }
+        // The players reset the arena after it has run for a while, and the match starts from there
+        if(data->ticks < data->setup.warmup) {
+            data->ticks++;
+            return 0;
+        }
+        arena_reset(gs->sc);
+        gs->rand.seed = data->setup.seed;
+        data->started = true;
+        data->ticks = 0;
+    }
+
+    uint32_t tick = data->ticks;
+    if(tick >= data->final) {
+        if(data->ended) {
+            DEBUG("spectated match is over at tick %" PRIu32, tick);
+            set_stalled(data, gs, false);
+            gs->warp_speed = 0;
+            data->closed = true;
+            controller_close(ctrl, ev);
+            return 0;
+        }
+        if(!data->stalled) {
+            DEBUG("waiting for inputs at tick %" PRIu32, tick);
+            set_stalled(data, gs, true);
+        }
+    } else if(data->stalled && (data->ended || data->final - tick >= (uint32_t)data->delay)) {
+        set_stalled(data, gs, false);
+    }
+
+    // Nothing happens on this tick
+    if(game_state_is_paused(gs)) {
+        return 0;
+    }
+
+    // Run at warp speed until caught up with a match that was joined late
+    uint32_t behind = data->final - tick;
+    if(behind > 2 * (uint32_t)data->delay) {
+        gs->warp_speed = 1;
+    } else if(behind <= (uint32_t)data->delay) {
+        gs->warp_speed = 0;
+    }
+
+    for(; data->next < vector_size(&data->inputs); data->next++) {
+        spectator_input *input = vector_get(&data->inputs, data->next);
+        if(input->tick > tick) {
+            break;
+        }
+        apply_inputs(gs, input);
+    }
+    data->ticks++;
+    return 0;
+}
+
+static void spectator_controller_free(controller *ctrl) {
+    wtf *data = ctrl->data;
+    if(data->peer) {
+        enet_peer_disconnect_now(data->peer, 0);
+    }
+    if(data->host) {
+        enet_host_destroy(data->host);
+    }
+    vector_free(&data->inputs);
+    omf_free(ctrl->data);
+}
+
+int spectator_controller_create(controller *ctrl, const char *host, int port) {
+    wtf *data = omf_calloc(1, sizeof(wtf));
+    vector_create(&data->inputs, sizeof(spectator_input));
+    data->delay = max2(settings_get()->net.net_spectate_delay, 1);
+
+    ENetAddress address;
+    data->host = enet_host_create(NULL, 1, SPECTATOR_STREAM_CHANNELS, 0, 0);
+    if(data->host == NULL) {
+        PERROR("Failed to initialize ENet client");
+        goto error_0;
+    }
+    if(enet_address_set_host(&address, host) != 0) {
+        PERROR("Unable to resolve spectator relay %s", host);
+        goto error_0;
+    }
+    address.port = port;
+    data->peer = enet_host_connect(data->host, &address, SPECTATOR_STREAM_CHANNELS, 0);
+    if(data->peer == NULL) {
+        PERROR("Unable to connect to spectator relay %s:%d", host, port);
+        goto error_0;
+    }
+
+    INFO("Waiting for a match from spectator relay %s:%d", host, port);
+    service(data, SETUP_TIMEOUT);
+    if(!data->has_setup) {
+        PERROR("No match to spectate from %s:%d", host, port);
+        goto error_0;
+    }
+    DEBUG("spectating arena %d, %" PRIu32 " ticks in", data->setup.arena, data->final);
+
+    ctrl->data = data;
+    ctrl->type = CTRL_TYPE_SPECTATOR;
+    ctrl->tick_fun = &spectator_controller_tick;
+    ctrl->dyntick_fun = &spectator_controller_dyntick;
+    ctrl->free_fun = &spectator_controller_free;
+    return 0;
+
+error_0:
+    ctrl->data = data;
+    spectator_controller_free(ctrl);
+    ctrl->data = NULL;
+    return 1;
+}
+
+const spectator_setup *spectator_controller_get_setup(controller *ctrl) {
+    wtf *data = ctrl->data;
+    return &data->setup;
+}
@@ -0,0 +1,26 @@
+#ifndef SPECTATOR_CONTROLLER_H
+#define SPECTATOR_CONTROLLER_H
+
+#include "controller/controller.h"
+#include "controller/spectator_stream.h"
+
+/**
+ * Watch a netplay match from a spectator relay. The match is simulated locally from the confirmed inputs of both
+ * players, which the controller feeds to both HARs, so it belongs to player 2 and player 1 only watches.
+ *
+ * Playback stays net_spectate_delay ticks behind the newest inputs, and stalls the game if they run out. When joining a
+ * match that is already going, the game runs at warp speed until it has caught up.
+ *
+ * @param ctrl Controller to set up
+ * @param host Spectator relay host name
+ * @param port Spectator relay port
+ * @return 0 once the setup of a match has been received, 1 on error
+ */
+int spectator_controller_create(controller *ctrl, const char *host, int port);
+
+/**
+ * Get the setup of the match being watched, for creating the arena.
+ */
+const spectator_setup *spectator_controller_get_setup(controller *ctrl);
+
+#endif // SPECTATOR_CONTROLLER_H
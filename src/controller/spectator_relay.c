@@ -0,0 +1,105 @@
+#include "controller/spectator_relay.h"
+#include "controller/controller.h"
+#include "controller/spectator_stream.h"
+#include "utils/log.h"
+
+typedef struct relay_spectator {
+    ENetPeer *peer;
+    unsigned next; // Index of the next message to send
+} relay_spectator;
+
+void spectator_relay_create(spectator_relay *relay) {
+    serial_create(&relay->log);
+    vector_create(&relay->messages, sizeof(size_t));
+    vector_create(&relay->audience, sizeof(relay_spectator));
+    relay->source = NULL;
+}
+
+void spectator_relay_free(spectator_relay *relay) {
+    serial_free(&relay->log);
+    vector_free(&relay->messages);
+    vector_free(&relay->audience);
+}
+
+void spectator_relay_add(spectator_relay *relay, ENetPeer *peer) {
+    relay_spectator spectator;
+    spectator.peer = peer;
+    spectator.next = 0;
+    vector_append(&relay->audience, &spectator);
+    DEBUG("spectator joined, %u watching", vector_size(&relay->audience));
+}
+
+void spectator_relay_remove(spectator_relay *relay, ENetPeer *peer) {
+    if(relay->source == peer) {
+        relay->source = NULL;
+    }
+    iterator it;
+    relay_spectator *spectator;
+    vector_iter_begin(&relay->audience, &it);
+    while((spectator = iter_next(&it)) != NULL) {
+        if(spectator->peer == peer) {
+            vector_delete(&relay->audience, &it);
+        }
+    }
+}
+
+bool spectator_relay_receive(spectator_relay *relay, ENetPeer *peer, const char *data, size_t len) {
+    if(len == 0) {
+        return false;
+    }
+    if(relay->source == NULL && data[0] == EVENT_TYPE_SPECTATE_SETUP) {
+        // the source is not a spectator
+        spectator_relay_remove(relay, peer);
+        relay->source = peer;
+        DEBUG("match source connected");
+    }
+    if(peer != relay->source) {
+        return false;
+    }
+    switch(data[0]) {
+        case EVENT_TYPE_SPECTATE_SETUP: {
+            // a new match; everyone starts over from its setup
+            serial_write_reset(&relay->log);
+            vector_clear(&relay->messages);
+            iterator it;
+            relay_spectator *spectator;
+            vector_iter_begin(&relay->audience, &it);
+            while((spectator = iter_next(&it)) != NULL) {
+                spectator->next = 0;
+            }
+        } break;
+        case EVENT_TYPE_SPECTATE_INPUTS:
+        case EVENT_TYPE_SPECTATE_END:
+            break;
+        default:
+            return false;
+    }
+    serial_write(&relay->log, data, len);
+    size_t end = serial_len(&relay->log);
+    vector_append(&relay->messages, &end);
+    return true;
+}
+
+void spectator_relay_service(spectator_relay *relay) {
+    unsigned count = vector_size(&relay->messages);
+    iterator it;
+    relay_spectator *spectator;
+    vector_iter_begin(&relay->audience, &it);
+    while((spectator = iter_next(&it)) != NULL) {
+        if(spectator->next >= count) {
+            continue;
+        }
+        unsigned last = spectator->next + SPECTATOR_RELAY_BATCH;
+        if(last > count) {
+            last = count;
+        }
+        size_t start = spectator->next > 0 ? *(size_t *)vector_get(&relay->messages, spectator->next - 1) : 0;
+        size_t end = *(size_t *)vector_get(&relay->messages, last - 1);
+        ENetPacket *packet = enet_packet_create(relay->log.data + start, end - start, ENET_PACKET_FLAG_RELIABLE);
+        if(enet_peer_send(spectator->peer, SPECTATOR_STREAM_CHANNEL, packet) < 0) {
+            enet_packet_destroy(packet);
+            continue;
+        }
+        spectator->next = last;
+    }
+}
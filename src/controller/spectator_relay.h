@@ -0,0 +1,55 @@
+#ifndef SPECTATOR_RELAY_H
+#define SPECTATOR_RELAY_H
+
+#include "game/utils/serial.h"
+#include "utils/vector.h"
+#include <enet/enet.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Most messages sent to a spectator in one packet while it is catching up
+#define SPECTATOR_RELAY_BATCH 64
+
+/**
+ * Fans a spectator stream out to any number of spectators. One of the players sends the stream to the relay once,
+ * and the relay keeps every message of the match, so that spectators who join late are sent the backlog first.
+ * The first peer to send a setup message becomes the source, and the stream is only taken from it until it
+ * disconnects; anything other peers send is dropped.
+ * The backlog goes out in batches of several messages per packet, and the spectator fast forwards through it
+ * until it is live. See spectator_stream.h for the messages.
+ */
+typedef struct spectator_relay {
+    serial log;       ///< Messages of the current match, back to back
+    vector messages;  ///< End offset of each message in the log
+    vector audience;  ///< Spectators and how far they have been sent the log
+    ENetPeer *source; ///< Peer the stream comes from, once it has sent a setup
+} spectator_relay;
+
+void spectator_relay_create(spectator_relay *relay);
+void spectator_relay_free(spectator_relay *relay);
+
+void spectator_relay_add(spectator_relay *relay, ENetPeer *peer);
+
+/**
+ * Forget a peer, eg. once it has disconnected. Works for both the source and spectators.
+ */
+void spectator_relay_remove(spectator_relay *relay, ENetPeer *peer);
+
+/**
+ * Handle a packet received by the relay. A setup message starts a new match and drops the old one.
+ *
+ * @param relay Relay
+ * @param peer Peer the packet came from. If there is no source yet, a setup message makes this the source.
+ * @param data Packet data, one message
+ * @param len Packet length
+ * @return true if the packet was a spectator stream message from the source
+ */
+bool spectator_relay_receive(spectator_relay *relay, ENetPeer *peer, const char *data, size_t len);
+
+/**
+ * Send every spectator the messages it has not got yet, at most SPECTATOR_RELAY_BATCH at a time.
+ * Call this regularly; the host is not flushed.
+ */
+void spectator_relay_service(spectator_relay *relay);
+
+#endif // SPECTATOR_RELAY_H
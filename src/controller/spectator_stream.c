@@ -0,0 +1,95 @@
+#include "controller/spectator_stream.h"
+#include "controller/controller.h"
+
+#define SETUP_LEN (3 + 2 * 4 + 2 * (5 + 9))
+
+static size_t remaining(const serial *ser) {
+    return ser->wpos - ser->rpos;
+}
+
+void spectator_setup_write(serial *ser, const spectator_setup *setup) {
+    serial_write_int8(ser, EVENT_TYPE_SPECTATE_SETUP);
+    serial_write_int8(ser, SPECTATOR_STREAM_VERSION);
+    serial_write_int8(ser, setup->arena);
+    serial_write_int8(ser, setup->speed);
+    serial_write_uint32(ser, setup->warmup);
+    serial_write_uint32(ser, setup->seed);
+    for(int i = 0; i < 2; i++) {
+        const spectator_player *player = &setup->players[i];
+        serial_write_int8(ser, player->har_id);
+        serial_write_int8(ser, player->pilot_id);
+        serial_write(ser, (const char *)player->colors, sizeof(player->colors));
+        serial_write(ser, (const char *)player->stats, sizeof(player->stats));
+    }
+}
+
+bool spectator_setup_read(serial *ser, spectator_setup *setup) {
+    if(remaining(ser) < SETUP_LEN) {
+        return false;
+    }
+    if((uint8_t)serial_read_int8(ser) != SPECTATOR_STREAM_VERSION) {
+        return false;
+    }
+    setup->arena = serial_read_int8(ser);
+    setup->speed = serial_read_int8(ser);
+    setup->warmup = serial_read_uint32(ser);
+    setup->seed = serial_read_uint32(ser);
+    for(int i = 0; i < 2; i++) {
+        spectator_player *player = &setup->players[i];
+        player->har_id = serial_read_int8(ser);
+        player->pilot_id = serial_read_int8(ser);
+        serial_read(ser, (char *)player->colors, sizeof(player->colors));
+        serial_read(ser, (char *)player->stats, sizeof(player->stats));
+    }
+    return true;
+}
+
+void spectator_inputs_write(serial *ser, net_transcript *transcript, uint32_t from, uint32_t to) {
+    iterator it;
+    tick_events *ev;
+
+    // Count first, so that the inputs can be written right after the count
+    uint32_t count = 0;
+    net_transcript_iter_begin(transcript, &it, from);
+    while((ev = iter_next(&it)) != NULL && ev->tick < to) {
+        if(ev->events[0] || ev->events[1]) {
+            count++;
+        }
+    }
+
+    serial_write_int8(ser, EVENT_TYPE_SPECTATE_INPUTS);
+    serial_write_varint(ser, to - from);
+    serial_write_varint(ser, count);
+    uint32_t prev = from;
+    net_transcript_iter_begin(transcript, &it, from);
+    while((ev = iter_next(&it)) != NULL && ev->tick < to) {
+        if(ev->events[0] || ev->events[1]) {
+            serial_write_varint(ser, ev->tick - prev);
+            serial_write_int8(ser, ev->events[0]);
+            serial_write_int8(ser, ev->events[1]);
+            prev = ev->tick;
+        }
+    }
+}
+
+bool spectator_inputs_read(serial *ser, uint32_t from, uint32_t *to, vector *inputs) {
+    uint32_t span = serial_read_varint(ser);
+    uint32_t count = serial_read_varint(ser);
+    // Every input takes at least three bytes
+    if(count > remaining(ser) / 3) {
+        return false;
+    }
+    spectator_input input;
+    input.tick = from;
+    for(uint32_t i = 0; i < count; i++) {
+        input.tick += serial_read_varint(ser);
+        if(remaining(ser) < 2 || input.tick - from >= span) {
+            return false;
+        }
+        input.actions[0] = serial_read_int8(ser);
+        input.actions[1] = serial_read_int8(ser);
+        vector_append(inputs, &input);
+    }
+    *to = from + span;
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef SPECTATOR_STREAM_H
+#define SPECTATOR_STREAM_H
+
+#include "controller/net_transcript.h"
+#include "game/utils/serial.h"
+#include "utils/vector.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Spectators watch a match by simulating it locally from the same inputs as the players. They get a setup message
+ * when the match starts, followed by the confirmed inputs of both players, and an end message once the players
+ * leave the arena. All messages are self-delimiting, so that several can be sent in one packet.
+ *
+ *   setup:  uint8 type, uint8 version, uint8 arena, uint8 speed, uint32 warmup, uint32 seed, 2 * player
+ *   player: uint8 har_id, uint8 pilot_id, uint8 colors[3], uint8 stats[9]
+ *   inputs: uint8 type, varint span, varint count, count * (varint delta, uint8 player 1, uint8 player 2)
+ *   end:    uint8 type
+ *
+ * Inputs messages cover consecutive ranges of ticks, starting from tick 0 of the match. The span tells how many
+ * ticks the message covers; input ticks are deltas from the start of the range or from the previous input.
+ */
+#define SPECTATOR_STREAM_VERSION 1
+
+// The stream only travels on its own ENet channel, apart from the netplay traffic.
+#define SPECTATOR_STREAM_CHANNEL 2
+#define SPECTATOR_STREAM_CHANNELS (SPECTATOR_STREAM_CHANNEL + 1) // Channels to open for the stream
+
+typedef struct spectator_player {
+    uint8_t har_id;
+    uint8_t pilot_id;
+    uint8_t colors[3];
+    uint8_t stats[9]; ///< Arm and leg power and speed, armor, stun resistance, power, agility, endurance
+} spectator_player;
+
+typedef struct spectator_setup {
+    uint8_t arena;   ///< Arena scene id
+    uint8_t speed;   ///< Game speed
+    uint32_t warmup; ///< Dynamic ticks from entering the arena to tick 0 of the match
+    uint32_t seed;   ///< Random generator state on tick 0 of the match
+    spectator_player players[2];
+} spectator_setup;
+
+/**
+ * Inputs of both players on one tick of the match.
+ */
+typedef struct spectator_input {
+    uint32_t tick;
+    uint8_t actions[2];
+} spectator_input;
+
+void spectator_setup_write(serial *ser, const spectator_setup *setup);
+
+/**
+ * Read the rest of a setup message, after the type byte.
+ *
+ * @return true if the message is complete and of the same stream version
+ */
+bool spectator_setup_read(serial *ser, spectator_setup *setup);
+
+/**
+ * Write the inputs in a range of match ticks from a netplay transcript.
+ *
+ * @param ser Buffer to write to
+ * @param transcript Transcript to read the inputs from
+ * @param from First tick of the range
+ * @param to One past the last tick of the range
+ */
+void spectator_inputs_write(serial *ser, net_transcript *transcript, uint32_t from, uint32_t to);
+
+/**
+ * Read the rest of an inputs message, after the type byte, and append the inputs to a vector of spectator_input.
+ *
+ * @param ser Buffer to read from
+ * @param from First tick of the range, ie. the end of the previous range
+ * @param to Filled with one past the last tick of the range
+ * @param inputs Vector to append to
+ * @return true if the message is complete
+ */
+bool spectator_inputs_read(serial *ser, uint32_t from, uint32_t *to, vector *inputs);
+
+#endif // SPECTATOR_STREAM_H
@@ -6,13 +6,16 @@
 #include "game/game_player.h"
 #include "game/game_state.h"
 #include "game/gui/text_render.h"
+#include "game/utils/script_cache.h"
 #include "game/utils/settings.h"
 #include "resources/languages.h"
 #include "resources/sounds_loader.h"
 #include "utils/allocator.h"
 #include "utils/log.h"
 #include "utils/png_writer.h"
+#include "utils/pool.h"
 #include "utils/time_fmt.h"
+#include "video/frame_recorder.h"
 #include "video/vga_state.h"
 #include "video/video.h"
 #include <SDL.h>
@@ -20,14 +23,30 @@
 
 #define STATIC_TICKS 10
 #define MAX_TICKS_PER_FRAME 10
+#define HEADLESS_FRAME_MS 16 // Emulated frame length when the loop is not paced by the wall clock
 
 static int run = 0;
 static int start_timeout = 30;
 static int enable_screen_updates = 1;
 static int debug_palette_number = 0;
+static bool headless = false;
 
-int engine_init(void) {
+// Screenshots are encoded and written on a background thread, one at a time.
+typedef struct screenshot_job {
+    char filename[256];
+    SDL_Rect rect;
+    unsigned char *data;
+    bool flip;
+    bool success;
+} screenshot_job;
+
+static SDL_Thread *screenshot_thread = NULL;
+static screenshot_job *screenshot_running = NULL;
+static SDL_atomic_t screenshot_done;
+
+int engine_init(engine_init_flags *init_flags) {
     settings *setting = settings_get();
+    headless = init_flags->headless;
 
     int w = setting->video.screen_w;
     int h = setting->video.screen_h;
@@ -40,10 +59,20 @@ int engine_init(void) {
     float sound_volume = setting->sound.sound_vol / 10.0;
 
     // Initialize everything.
-    if(video_init(w, h, fs, vsync))
+    video_renderer_type renderer_type = VIDEO_RENDERER_OPENGL;
+    if(headless) {
+        renderer_type = VIDEO_RENDERER_NULL;
+    } else if(init_flags->software) {
+        renderer_type = VIDEO_RENDERER_SOFTWARE;
+    }
+    if(video_init(renderer_type, w, h, fs, vsync))
         goto exit_0;
-    if(!audio_init(frequency, mono, resampler, music_volume, sound_volume))
+    if(headless) {
+        if(!audio_init_null())
+            goto exit_1;
+    } else if(!audio_init(frequency, mono, resampler, music_volume, sound_volume)) {
         goto exit_1;
+    }
     if(sounds_loader_init())
         goto exit_2;
     if(lang_init())
@@ -55,6 +84,11 @@ int engine_init(void) {
     if(console_init())
         goto exit_6;
     vga_state_init();
+    script_cache_init();
+    if(init_flags->video_file[0] != 0) {
+        // Not fatal; the game runs fine without the recording.
+        frame_recorder_start(init_flags->video_file);
+    }
 
     // Return successfully
     run = 1;
@@ -78,17 +112,53 @@ exit_0:
     return 1;
 }
 
-void save_screenshot(const SDL_Rect *r, unsigned char *data, bool flip) {
-    char *time = format_time();
-    char *filename = omf_malloc(256);
-    snprintf(filename, 256, "screenshot_%s.png", time);
-    if(png_write_rgb(filename, r->w, r->h, data, false, flip)) {
-        DEBUG("Got a screenshot: %s", filename);
+static int screenshot_write(void *userdata) {
+    screenshot_job *job = userdata;
+    job->success = png_write_rgb(job->filename, job->rect.w, job->rect.h, job->data, false, job->flip);
+    SDL_AtomicSet(&screenshot_done, 1);
+    return 0;
+}
+
+// Report and free the finished screenshot job. If wait is set, waits for a running job to finish first.
+static void screenshot_reap(bool wait) {
+    if(screenshot_running == NULL) {
+        return;
+    }
+    if(screenshot_thread != NULL) {
+        if(!wait && !SDL_AtomicGet(&screenshot_done)) {
+            return;
+        }
+        SDL_WaitThread(screenshot_thread, NULL);
+        screenshot_thread = NULL;
+    }
+    if(screenshot_running->success) {
+        DEBUG("Got a screenshot: %s", screenshot_running->filename);
     } else {
-        PERROR("Screenshot write operation failed (%s)", filename);
+        PERROR("Screenshot write operation failed (%s)", screenshot_running->filename);
     }
-    omf_free(filename);
+    omf_free(screenshot_running->data);
+    omf_free(screenshot_running);
+}
+
+void save_screenshot(const SDL_Rect *r, unsigned char *data, bool flip) {
+    screenshot_reap(true);
+
+    screenshot_job *job = omf_calloc(1, sizeof(screenshot_job));
+    char *time = format_time();
+    snprintf(job->filename, sizeof(job->filename), "screenshot_%s.png", time);
     omf_free(time);
+    job->rect = *r;
+    job->data = data;
+    job->flip = flip;
+    screenshot_running = job;
+
+    SDL_AtomicSet(&screenshot_done, 0);
+    screenshot_thread = SDL_CreateThread(screenshot_write, "screenshot", job);
+    if(screenshot_thread == NULL) {
+        DEBUG("Unable to start screenshot thread: %s", SDL_GetError());
+        screenshot_write(job);
+        screenshot_reap(true);
+    }
 }
 
 void save_palette_shot(void) {
@@ -101,6 +171,59 @@ void save_palette_shot(void) {
     omf_free(time);
 }
 
+game_state *engine_swap_state(game_state *gs) {
+    if(gs->new_state) {
+        // one of the controllers wants to replace the game state
+        game_state *old_gs = gs;
+        gs = gs->new_state;
+        DEBUG("replacing game state! %d %d", old_gs, gs);
+        // old_gs->new_state = NULL;
+        game_state_clone_free(old_gs);
+        omf_free(old_gs);
+    }
+    return gs;
+}
+
+void engine_tick(game_state *gs, engine_clock *clock, int frame_dt) {
+    clock->dynamic_wait += frame_dt;
+    clock->static_wait += frame_dt;
+
+    // In warp mode, allow more ticks to happen per vsync period.
+    bool has_dynamic = true;
+    bool has_static = true;
+    int tick_limit = MAX_TICKS_PER_FRAME;
+    do {
+        // Tick static features. This is a fixed with-rate tick, and is meant for running things
+        // that are not dependent on game speed (such as menus).
+        has_static = clock->static_wait > STATIC_TICKS;
+        if(has_static) {
+            game_state_static_tick(gs, false);
+            console_tick();
+            clock->static_wait -= STATIC_TICKS;
+        }
+
+        // A controller has replaced the game state, so the remaining ticks are left for the new one
+        if(gs->new_state != NULL) {
+            break;
+        }
+
+        // Tick dynamic features. This is a dynamically changing tick, and it depends on things such as
+        // hit-pause, hit slowdown and game-speed slider. It is meant for ticking everything that has to do
+        // with the actual gameplay stuff.
+        has_dynamic = clock->dynamic_wait > game_state_ms_per_dyntick(gs);
+        if(has_dynamic) {
+            game_state_dynamic_tick(gs, false);
+            clock->dynamic_wait -= game_state_ms_per_dyntick(gs);
+        }
+
+        // Ensure any pending palette changes are handled after any ticks are made.
+        if(has_dynamic || has_static) {
+            game_state_palette_transform(gs);
+            vga_state_render();
+        }
+    } while(tick_limit-- && (has_dynamic || has_static));
+}
+
 void engine_run(engine_init_flags *init_flags) {
     SDL_Event e;
     int visual_debugger = 0;
@@ -115,7 +238,7 @@ void engine_run(engine_init_flags *init_flags) {
     // Game start timeout.
     // Wait a moment so that people are mentally prepared
     // (with the recording software on) for the game to start :)
-    if(!settings_get()->video.crossfade_on) {
+    if(!settings_get()->video.crossfade_on || headless) {
         start_timeout = 0;
     }
     while(start_timeout > 0) {
@@ -141,9 +264,10 @@ void engine_run(engine_init_flags *init_flags) {
 
     // Game loop
     uint64_t frame_start = SDL_GetTicks64(); // Set game tick timer
-    int dynamic_wait = 0;
-    int static_wait = 0;
+    engine_clock clock = {0, 0};
     while(run && game_state_is_running(gs)) {
+        screenshot_reap(false);
+
         // Handle events
         int check_fs;
         while(SDL_PollEvent(&e)) {
@@ -180,6 +304,7 @@ void engine_run(engine_init_flags *init_flags) {
                     SDL_ShowCursor(1);
                     break;
                 case SDL_WINDOWEVENT:
+                    video_invalidate();
                     switch(e.window.event) {
                         case SDL_WINDOWEVENT_MINIMIZED:
                             DEBUG("MINIMIZED");
@@ -233,7 +358,7 @@ void engine_run(engine_init_flags *init_flags) {
         }
 
         // hide mouse after n ticks
-        if(mouse_visible_ticks > 0) {
+        if(mouse_visible_ticks > 0 && !headless) {
             mouse_visible_ticks -= SDL_GetTicks64() - frame_start;
             if(mouse_visible_ticks <= 0) {
                 SDL_ShowCursor(0);
@@ -241,60 +366,26 @@ void engine_run(engine_init_flags *init_flags) {
         }
 
         // check if we need to replace the game state
-        if(gs->new_state) {
-            // one of the controllers wants to replace the game state
-            game_state *old_gs = gs;
-            gs = gs->new_state;
-            DEBUG("replacing game state! %d %d", old_gs, gs);
-            // old_gs->new_state = NULL;
-            game_state_clone_free(old_gs);
-            omf_free(old_gs);
-        }
+        gs = engine_swap_state(gs);
 
         // Render scene
-        uint64_t frame_dt = SDL_GetTicks64() - frame_start;
-        frame_start = SDL_GetTicks64();
-        if(!visual_debugger) {
-            dynamic_wait += frame_dt;
-            static_wait += frame_dt;
-        } else if(debugger_proceed) {
-            dynamic_wait += 20;
-            static_wait += 20;
+        uint64_t frame_dt;
+        if(headless) {
+            // Nobody is watching, so don't wait for the clock. Every iteration is treated as one full
+            // frame; the tick loop below stays exactly the same as in the windowed mode.
+            frame_dt = HEADLESS_FRAME_MS;
+        } else {
+            frame_dt = SDL_GetTicks64() - frame_start;
+            frame_start = SDL_GetTicks64();
+        }
+        if(visual_debugger) {
+            frame_dt = debugger_proceed ? 20 : 0;
             debugger_proceed = 0;
         }
-
-        // In warp mode, allow more ticks to happen per vsync period.
-        bool has_dynamic = true;
-        bool has_static = true;
-        int tick_limit = MAX_TICKS_PER_FRAME;
-        do {
-            // Tick static features. This is a fixed with-rate tick, and is meant for running things
-            // that are not dependent on game speed (such as menus).
-            has_static = static_wait > STATIC_TICKS;
-            if(has_static) {
-                game_state_static_tick(gs, false);
-                console_tick();
-                static_wait -= STATIC_TICKS;
-            }
-
-            // Tick dynamic features. This is a dynamically changing tick, and it depends on things such as
-            // hit-pause, hit slowdown and game-speed slider. It is meant for ticking everything that has to do
-            // with the actual gameplay stuff.
-            has_dynamic = dynamic_wait > game_state_ms_per_dyntick(gs);
-            if(has_dynamic) {
-                game_state_dynamic_tick(gs, false);
-                dynamic_wait -= game_state_ms_per_dyntick(gs);
-            }
-
-            // Ensure any pending palette changes are handled after any ticks are made.
-            if(has_dynamic || has_static) {
-                game_state_palette_transform(gs);
-                vga_state_render();
-            }
-        } while(tick_limit-- && (has_dynamic || has_static));
+        engine_tick(gs, &clock, frame_dt);
 
         // Do the actual video rendering jobs
-        if(enable_screen_updates) {
+        if(enable_screen_updates || headless) {
             video_render_prepare();
             game_state_render(gs);
             if(debugger_render) {
@@ -315,6 +406,7 @@ void engine_run(engine_init_flags *init_flags) {
 }
 
 void engine_close(void) {
+    frame_recorder_stop();
     console_close();
     altpals_close();
     fonts_close();
@@ -322,6 +414,9 @@ void engine_close(void) {
     sounds_loader_close();
     audio_close();
     video_close();
+    screenshot_reap(true);
     vga_state_close();
+    script_cache_close();
+    pool_close_all();
     INFO("Engine deinit successful.");
 }
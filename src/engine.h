@@ -4,11 +4,25 @@
 typedef struct engine_init_flags_t {
     unsigned int net_mode;
     unsigned int record;
+    unsigned int headless; // No window, GL context or audio device; run the loop unpaced.
+    unsigned int software; // Draw on the CPU instead of with OpenGL.
     char rec_file[255];
+    char video_file[255]; // Record the rendered frames here, if set.
 } engine_init_flags;
 
-int engine_init(void);                          // Init window, audiodevice, etc.
+typedef struct game_state_t game_state;
+
+// Time owed to the static and dynamic ticks, in milliseconds.
+typedef struct engine_clock_t {
+    int static_wait;
+    int dynamic_wait;
+} engine_clock;
+
+int engine_init(engine_init_flags *init_flags); // Init window, audiodevice, etc.
 void engine_run(engine_init_flags *init_flags); // Run game
 void engine_close(void);                        // Kill window, audiodev
 
+game_state *engine_swap_state(game_state *gs);                   // Switch to the state a controller replaced gs with
+void engine_tick(game_state *gs, engine_clock *clock, int frame_dt); // Run the ticks that are due after a frame
+
 #endif // ENGINE_H
@@ -4,6 +4,7 @@
 #include "utils/allocator.h"
 #include "utils/str.h"
 #include <ctype.h>
+#include <limits.h>
 #include <string.h>
 
 #define INVALID_TAG_COUNT 5
@@ -21,20 +22,132 @@ int sd_script_create(sd_script *script) {
 void sd_script_frame_create(sd_script_frame *frame, int tick_len, int sprite) {
     vector_create(&frame->tags, sizeof(sd_script_tag));
     frame->tick_len = tick_len;
+    frame->tick_pos = 0;
     frame->sprite = sprite;
+    memset(frame->tag_mask, 0, sizeof(frame->tag_mask));
+    frame->tag_values = NULL;
 }
 
-int sd_script_frame_clone(sd_script_frame *src, sd_script_frame *dst) {
+static inline bool frame_has_tag_id(const sd_script_frame *frame, int id) {
+    return (frame->tag_mask[id >> 5] >> (id & 31)) & 1;
+}
+
+static inline int count_bits(uint32_t word) {
+    word = word - ((word >> 1) & 0x55555555u);
+    word = (word & 0x33333333u) + ((word >> 2) & 0x33333333u);
+    return (((word + (word >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+}
+
+static int frame_tag_count(const sd_script_frame *frame) {
+    int count = 0;
+    for(int i = 0; i < SD_TAG_MASK_WORDS; i++) {
+        count += count_bits(frame->tag_mask[i]);
+    }
+    return count;
+}
+
+// Position of the tag's value in tag_values, ie. the number of set tags with a smaller id.
+static int frame_tag_rank(const sd_script_frame *frame, int id) {
+    int rank = 0;
+    for(int i = 0; i < (id >> 5); i++) {
+        rank += count_bits(frame->tag_mask[i]);
+    }
+    return rank + count_bits(frame->tag_mask[id >> 5] & ((1u << (id & 31)) - 1));
+}
+
+// Add a tag to the compiled tables. If a tag appears several times, the first one wins, just like in
+// sd_script_get_tag().
+static void frame_compile_tag(sd_script_frame *frame, const sd_script_tag *tag) {
+    if(tag->id < 0 || frame_has_tag_id(frame, tag->id)) {
+        return;
+    }
+    int count = frame_tag_count(frame);
+    int rank = frame_tag_rank(frame, tag->id);
+    frame->tag_values = omf_realloc(frame->tag_values, (count + 1) * sizeof(int));
+    memmove(&frame->tag_values[rank + 1], &frame->tag_values[rank], (count - rank) * sizeof(int));
+    frame->tag_values[rank] = tag->value;
+    frame->tag_mask[tag->id >> 5] |= 1u << (tag->id & 31);
+}
+
+void sd_script_frame_compile(sd_script_frame *frame) {
+    iterator it;
+    sd_script_tag *tag;
+    memset(frame->tag_mask, 0, sizeof(frame->tag_mask));
+    omf_free(frame->tag_values);
+    vector_iter_begin(&frame->tags, &it);
+    while((tag = iter_next(&it)) != NULL) {
+        frame_compile_tag(frame, tag);
+    }
+}
+
+int sd_script_frame_clone(const sd_script_frame *src, sd_script_frame *dst) {
     iterator it;
     sd_script_tag *tag;
     vector_iter_begin(&src->tags, &it);
     while((tag = iter_next(&it)) != NULL) {
         vector_append(&dst->tags, tag);
     }
+    int count = frame_tag_count(src);
+    memcpy(dst->tag_mask, src->tag_mask, sizeof(dst->tag_mask));
+    omf_free(dst->tag_values);
+    if(count > 0) {
+        dst->tag_values = omf_malloc(count * sizeof(int));
+        memcpy(dst->tag_values, src->tag_values, count * sizeof(int));
+    }
     return SD_SUCCESS;
 }
 
-int sd_script_clone(sd_script *src, sd_script *dst) {
+// Append a frame, and set its start position to the current end of the script.
+static void append_frame(sd_script *script, sd_script_frame *frame) {
+    frame->tick_pos = sd_script_get_total_ticks(script);
+    vector_append(&script->frames, frame);
+}
+
+// Recalculate frame start positions from the given frame onwards, eg. after its length has changed.
+static void update_tick_positions(sd_script *script, int from) {
+    int pos = sd_script_get_tick_pos_at_frame(script, from);
+    for(unsigned i = from; i < vector_size(&script->frames); i++) {
+        sd_script_frame *frame = vector_get(&script->frames, i);
+        frame->tick_pos = pos;
+        pos += frame->tick_len;
+    }
+}
+
+// Binary search for the frame containing the given tick. Returns -1 if the tick is outside the script.
+static int find_frame_index(const sd_script *script, int ticks) {
+    int count = vector_size(&script->frames);
+    if(ticks < 0 || count == 0) {
+        return -1;
+    }
+
+    // Find the last frame starting at or before the tick. Zero-length frames share their start position
+    // with the next frame, so they are never picked unless they are at the very end.
+    int lo = 0, hi = count - 1;
+    while(lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        const sd_script_frame *frame = vector_get(&script->frames, mid);
+        if(frame->tick_pos <= ticks) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    const sd_script_frame *frame = vector_get(&script->frames, lo);
+    if(frame->tick_pos <= ticks && ticks < frame->tick_pos + frame->tick_len) {
+        return lo;
+    }
+    return -1;
+}
+
+static inline bool frame_contains(const sd_script *script, int index, int ticks) {
+    if(index < 0 || index >= (int)vector_size(&script->frames)) {
+        return false;
+    }
+    const sd_script_frame *frame = vector_get(&script->frames, index);
+    return frame->tick_pos <= ticks && ticks < frame->tick_pos + frame->tick_len;
+}
+
+int sd_script_clone(const sd_script *src, sd_script *dst) {
     sd_script_create(dst);
     iterator it;
     sd_script_frame *frame;
@@ -43,7 +156,7 @@ int sd_script_clone(sd_script *src, sd_script *dst) {
         sd_script_frame new_frame;
         sd_script_frame_create(&new_frame, frame->tick_len, frame->sprite);
         sd_script_frame_clone(frame, &new_frame);
-        vector_append(&dst->frames, &new_frame);
+        append_frame(dst, &new_frame);
     }
     return SD_SUCCESS;
 }
@@ -52,22 +165,38 @@ void sd_script_frame_free(sd_script_frame *frame) {
     if(frame == NULL)
         return;
     vector_free(&frame->tags);
+    omf_free(frame->tag_values);
 }
 
 static void sd_script_tag_create(sd_script_tag *tag) {
     memset(tag, 0, sizeof(sd_script_tag));
+    tag->id = SD_TAG_INVALID;
+}
+
+// Fill in tag information from the taglist. Returns false if the tag does not exist.
+static bool sd_script_tag_lookup(sd_script_tag *tag, const char *key) {
+    sd_tag_id id = sd_tag_find(key);
+    if(id == SD_TAG_INVALID) {
+        return false;
+    }
+    tag->id = id;
+    tag->key = sd_taglist[id].tag;
+    tag->desc = sd_taglist[id].description;
+    tag->has_param = sd_taglist[id].has_param;
+    return true;
 }
 
 bool sd_script_frame_add_tag(sd_script_frame *frame, const char *key, int value) {
     sd_script_tag tag;
     sd_script_tag_create(&tag);
-    if(sd_tag_info(key, &tag.has_param, &tag.key, &tag.desc) != 0) {
+    if(!sd_script_tag_lookup(&tag, key)) {
         return false;
     }
     if(tag.has_param) {
         tag.value = value;
     }
     vector_append(&frame->tags, &tag);
+    frame_compile_tag(frame, &tag);
     return true;
 }
 
@@ -90,7 +219,7 @@ int sd_script_append_frame(sd_script *script, int tick_len, int sprite_id) {
 
     sd_script_frame frame;
     sd_script_frame_create(&frame, tick_len, sprite_id);
-    vector_append(&script->frames, &frame);
+    append_frame(script, &frame);
     return SD_SUCCESS;
 }
 
@@ -105,6 +234,7 @@ int sd_script_clear_tags(sd_script *script, int frame_id) {
     }
 
     vector_clear(&frame->tags);
+    sd_script_frame_compile(frame);
     return SD_SUCCESS;
 }
 
@@ -119,6 +249,7 @@ int sd_script_set_tick_len_at_frame(sd_script *script, int frame_id, int duratio
     }
 
     frame->tick_len = duration;
+    update_tick_positions(script, frame_id);
     return SD_SUCCESS;
 }
 
@@ -141,17 +272,19 @@ unsigned sd_script_get_total_ticks(const sd_script *script) {
 }
 
 int sd_script_get_tick_pos_at_frame(const sd_script *script, int frame_id) {
-    if(script == NULL) {
+    if(script == NULL || frame_id <= 0) {
         return 0;
     }
-    int len = 0;
-    sd_script_frame *frame;
-    for(int i = 0; i < frame_id; i++) {
-        if((frame = vector_get(&script->frames, i)) != NULL) {
-            len += frame->tick_len;
+    int count = vector_size(&script->frames);
+    if(frame_id >= count) {
+        if(count == 0) {
+            return 0;
         }
+        const sd_script_frame *last = vector_get(&script->frames, count - 1);
+        return last->tick_pos + last->tick_len;
     }
-    return len;
+    const sd_script_frame *frame = vector_get(&script->frames, frame_id);
+    return frame->tick_pos;
 }
 
 int sd_script_get_tick_len_at_frame(const sd_script *script, int frame_id) {
@@ -225,7 +358,7 @@ static int read_int(const str *src, int *original) {
 static bool test_tag_slice(const str *test, sd_script_tag *new, str *src, int *now) {
     const int len = str_size(test);
     const int jmp = *now + len;
-    if(sd_tag_info(str_c(test), &new->has_param, &new->key, &new->desc) == 0) {
+    if(sd_script_tag_lookup(new, str_c(test))) {
         // Ensure that tag has no value, if value is not desired.
         if(!new->has_param && find_numeric_span(src, jmp) > jmp) {
             return false;
@@ -339,12 +472,13 @@ int sd_script_decode(sd_script *script, const char *input, int *invalid_pos) {
     int now = 0;
     while(now < (int)str_size(&src)) {
         if(parse_frame(&frame, &src, &now)) {
-            vector_append(&script->frames, &frame);
+            append_frame(script, &frame);
             sd_script_frame_create(&frame, 0, 0);
             continue;
         }
         if(parse_tag(&tag, &src, &now)) {
             vector_append(&frame.tags, &tag);
+            frame_compile_tag(&frame, &tag);
             sd_script_tag_create(&tag);
             continue;
         }
@@ -360,7 +494,7 @@ int sd_script_decode(sd_script *script, const char *input, int *invalid_pos) {
         }
         // There are a couple of cases where uppercase frame letter is lowercase. Try to fix.
         if(try_parse_bad_frame(&frame, &src, &now)) {
-            vector_append(&script->frames, &frame);
+            append_frame(script, &frame);
             sd_script_frame_create(&frame, 0, 0);
             continue;
         }
@@ -427,22 +561,10 @@ int sd_script_encode_frame(const sd_script_frame *frame, str *dst) {
 const sd_script_frame *sd_script_get_frame_at(const sd_script *script, int ticks) {
     if(script == NULL)
         return NULL;
-    if(ticks < 0)
+    int index = find_frame_index(script, ticks);
+    if(index < 0)
         return NULL;
-
-    iterator it;
-    sd_script_frame *frame;
-    int next, pos = 0;
-
-    vector_iter_begin(&script->frames, &it);
-    while((frame = iter_next(&it)) != NULL) {
-        next = pos + frame->tick_len;
-        if(pos <= ticks && ticks < next) {
-            return frame;
-        }
-        pos = next;
-    }
-    return NULL;
+    return vector_get(&script->frames, index);
 }
 
 const sd_script_frame *sd_script_get_frame(const sd_script *script, int frame_number) {
@@ -474,19 +596,22 @@ int sd_script_get_frame_index(const sd_script *script, const sd_script_frame *fr
 }
 
 int sd_script_get_frame_index_at(const sd_script *script, unsigned ticks) {
-    if(script == NULL)
+    if(script == NULL || ticks > INT_MAX)
         return -1;
+    return find_frame_index(script, (int)ticks);
+}
 
-    unsigned next, pos = 0;
-    for(unsigned i = 0; i < vector_size(&script->frames); i++) {
-        sd_script_frame *now = vector_get(&script->frames, i);
-        next = pos + now->tick_len;
-        if(pos <= ticks && ticks < next) {
-            return (int)i;
-        }
-        pos = next;
-    }
-    return -1;
+int sd_script_get_frame_index_near(const sd_script *script, int ticks, int hint) {
+    if(script == NULL)
+        return -1;
+    // Playback usually stays on the same frame, or moves to a neighbour.
+    if(frame_contains(script, hint, ticks))
+        return hint;
+    if(frame_contains(script, hint + 1, ticks))
+        return hint + 1;
+    if(frame_contains(script, hint - 1, ticks))
+        return hint - 1;
+    return find_frame_index(script, ticks);
 }
 
 int sd_script_is_last_frame(const sd_script *script, const sd_script_frame *frame) {
@@ -538,6 +663,20 @@ int sd_script_get(const sd_script_frame *frame, const char *tag) {
     return stag->value;
 }
 
+int sd_script_isset_id(const sd_script_frame *frame, sd_tag_id tag) {
+    if(frame == NULL || tag < 0 || tag >= SD_TAG_COUNT) {
+        return 0;
+    }
+    return frame_has_tag_id(frame, tag);
+}
+
+int sd_script_get_id(const sd_script_frame *frame, sd_tag_id tag) {
+    if(frame == NULL || tag < 0 || tag >= SD_TAG_COUNT || !frame_has_tag_id(frame, tag)) {
+        return 0;
+    }
+    return frame->tag_values[frame_tag_rank(frame, tag)];
+}
+
 int sd_script_next_frame_with_sprite(const sd_script *script, int sprite_id, unsigned current_tick) {
     if(script == NULL)
         return -1;
@@ -580,6 +719,26 @@ int sd_script_next_frame_with_tag(const sd_script *script, const char *tag, uint
     return -1;
 }
 
+int sd_script_next_frame_with_tag_id(const sd_script *script, sd_tag_id tag, uint32_t current_tick) {
+    if(script == NULL)
+        return -1;
+    if(current_tick > sd_script_get_total_ticks(script))
+        return -1;
+
+    unsigned next, pos = 0;
+    sd_script_frame *frame;
+    for(unsigned i = 0; i < vector_size(&script->frames); i++) {
+        frame = vector_get(&script->frames, i);
+        next = pos + frame->tick_len;
+        if(current_tick < pos && sd_script_isset_id(frame, tag)) {
+            return (int)i;
+        }
+        pos = next;
+    }
+
+    return -1;
+}
+
 int sd_script_delete_tag(sd_script *script, int frame_id, const char *tag) {
     if(script == NULL || tag == NULL || frame_id < 0)
         return SD_INVALID_INPUT;
@@ -595,6 +754,7 @@ int sd_script_delete_tag(sd_script *script, int frame_id, const char *tag) {
     while((now = iter_next(&it)) != NULL) {
         if(strcmp(now->key, tag) == 0) {
             vector_delete(&frame->tags, &it);
+            sd_script_frame_compile(frame);
             return SD_SUCCESS;
         }
     }
@@ -613,7 +773,8 @@ int sd_script_set_tag(sd_script *script, int frame_id, const char *tag, int valu
 
     // Get tag information
     sd_script_tag new;
-    if(sd_tag_info(tag, &new.has_param, &new.key, &new.desc) != SD_SUCCESS) {
+    sd_script_tag_create(&new);
+    if(!sd_script_tag_lookup(&new, tag)) {
         return SD_INVALID_INPUT;
     }
     if(new.has_param) {
@@ -623,6 +784,7 @@ int sd_script_set_tag(sd_script *script, int frame_id, const char *tag, int valu
     // Delete old tag (if exists), then add new.
     sd_script_delete_tag(script, frame_id, tag);
     vector_append(&frame->tags, &new);
+    sd_script_frame_compile(frame);
     return SD_SUCCESS;
 }
 
@@ -25,16 +25,27 @@ typedef struct sd_script_tag {
     const char *desc; ///< Tag description
     int has_param;    ///< Tells if the tag has a parameter
     int value;        ///< Tag parameter value. Only valid if has_param = 1.
+    int id;           ///< Tag identifier (sd_tag_id), SD_TAG_INVALID for tags not in the taglist.
 } sd_script_tag;
 
+#define SD_TAG_MASK_WORDS ((SD_TAG_COUNT + 31) / 32)
+
 /*! \brief Animation frame
  *
  * Describes a single frame in animation string.
+ *
+ * In addition to the tag list, the tags are kept compiled into a presence bitmask and the values of the
+ * set tags, so that the game can query tags in constant time. Frames only have a few tags, so the values
+ * are stored sparsely: the value of a tag is found by counting the mask bits below it. The compiled form
+ * is kept up to date by all sd_script functions that modify tags.
  */
 typedef struct sd_script_frame {
-    int sprite;   ///< Sprite ID that the frame relates to
-    int tick_len; ///< Length of the frame in ticks
-    vector tags;  ///< A list of tags in this frame
+    int sprite;                           ///< Sprite ID that the frame relates to
+    int tick_len;                         ///< Length of the frame in ticks
+    int tick_pos;                         ///< Tick position at the start of the frame
+    vector tags;                          ///< A list of tags in this frame
+    uint32_t tag_mask[SD_TAG_MASK_WORDS]; ///< Bit N is set if the tag with sd_tag_id N is in this frame
+    int *tag_values;                      ///< Parameter value of each set tag, in sd_tag_id order
 } sd_script_frame;
 
 /*! \brief Animation script
@@ -57,7 +68,7 @@ typedef struct sd_script {
  */
 int sd_script_create(sd_script *script);
 
-int sd_script_clone(sd_script *src, sd_script *dst);
+int sd_script_clone(const sd_script *src, sd_script *dst);
 
 /*! \brief Free script parser
  *
@@ -234,6 +245,19 @@ int sd_script_get_frame_index(const sd_script *script, const sd_script_frame *fr
  */
 int sd_script_get_frame_index_at(const sd_script *script, unsigned ticks);
 
+/*! \brief Returns the array index of frame at given tick position, starting from a known frame
+ *
+ * Same as sd_script_get_frame_index_at(), but checks the hinted frame and its neighbours before
+ * searching the whole script. Callers that play the animation can keep the previous result as the
+ * hint, which makes the lookup constant time for both forward and reverse playback.
+ *
+ * \param script The script structure to inspect
+ * \param ticks Tick position to find
+ * \param hint Index of a frame close to the tick position. May be out of range.
+ * \return Index of the frame, or -1 if the tick is outside the animation range
+ */
+int sd_script_get_frame_index_near(const sd_script *script, int ticks, int hint);
+
 /*! \brief Tells if the frame is the last frame in animation.
  *
  * Tells if the given frame pointer is the last frame in the given animation.
@@ -305,6 +329,28 @@ int sd_script_isset(const sd_script_frame *frame, const char *tag);
  */
 int sd_script_get(const sd_script_frame *frame, const char *tag);
 
+/*! \brief Tells if the tag is set in frame
+ *
+ * Same as sd_script_isset(), but takes a tag identifier instead of a name. This is a constant time
+ * lookup, and should be preferred in code that runs every tick.
+ *
+ * \param frame The frame structure to inspect. May be NULL.
+ * \param tag Tag identifier
+ * \return 1 or 0
+ */
+int sd_script_isset_id(const sd_script_frame *frame, sd_tag_id tag);
+
+/*! \brief Returns the tag value in frame
+ *
+ * Same as sd_script_get(), but takes a tag identifier instead of a name. This is a constant time
+ * lookup, and should be preferred in code that runs every tick.
+ *
+ * \param frame The frame structure to inspect. May be NULL.
+ * \param tag Tag identifier
+ * \return Tag parameter value or 0.
+ */
+int sd_script_get_id(const sd_script_frame *frame, sd_tag_id tag);
+
 /*! \brief Returns the next frame number with a given sprite ID
  *
  * Returns the next frame number with the given sprite number. Sprite numbers start from 0 and go to
@@ -341,6 +387,17 @@ int sd_script_next_frame_with_sprite(const sd_script *script, int sprite_id, uns
  */
 int sd_script_next_frame_with_tag(const sd_script *script, const char *tag, uint32_t current_tick);
 
+/*! \brief Returns the next frame number with a given tag
+ *
+ * Same as sd_script_next_frame_with_tag(), but takes a tag identifier instead of a name.
+ *
+ * \param script Script structure to search through
+ * \param tag Tag identifier to search for
+ * \param current_tick Current tick time
+ * \return Frame ID or -1 on error
+ */
+int sd_script_next_frame_with_tag_id(const sd_script *script, sd_tag_id tag, uint32_t current_tick);
+
 /*! \brief Sets a tag for the given frame
  *
  * Sets the tag for the given frame. If the tag has not been set previously, a new tag
@@ -450,6 +507,14 @@ void sd_script_frame_create(sd_script_frame *frame, int tick_len, int sprite);
  */
 void sd_script_frame_free(sd_script_frame *frame);
 
+/** Rebuild the compiled tag bitmask and values of a frame from its tag list.
+ *
+ * Only needed if the tag list has been filled in without the sd_script functions.
+ *
+ * @param frame Frame to compile
+ */
+void sd_script_frame_compile(sd_script_frame *frame);
+
 /** Add a tag to a frame.
  *
  * @param frame Frame to add into
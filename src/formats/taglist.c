@@ -1,4 +1,5 @@
 #include "formats/taglist.h"
+#include <assert.h>
 #include <stdlib.h>
 
 // This file is generated automatically
@@ -158,4 +159,6 @@ const sd_tag sd_taglist[] = {
     {"zz",  0, "Invulnerable to any attacks"                                                                          },
 };
 
-const int sd_taglist_size = 152;
+static_assert(sizeof(sd_taglist) / sizeof(sd_taglist[0]) == SD_TAG_COUNT, "sd_taglist and sd_tag_id are out of sync");
+
+const int sd_taglist_size = SD_TAG_COUNT;
@@ -10,6 +10,169 @@
 #ifndef SD_TAGLIST_H
 #define SD_TAGLIST_H
 
+/*! \brief Tag identifiers
+ *
+ * One identifier per entry in sd_taglist, in the same order, so that the identifier can be used to
+ * index the taglist and per-frame tag tables directly. Must be regenerated together with sd_taglist.
+ */
+typedef enum sd_tag_id
+{
+    SD_TAG_INVALID = -1, ///< Tags that are not in the taglist, eg. the junk "u" tags in some strings
+    SD_TAG_AA = 0,       ///< "aa"
+    SD_TAG_AB,           ///< "ab"
+    SD_TAG_AC,           ///< "ac"
+    SD_TAG_AD,           ///< "ad"
+    SD_TAG_AE,           ///< "ae"
+    SD_TAG_AF,           ///< "af"
+    SD_TAG_AG,           ///< "ag"
+    SD_TAG_AI,           ///< "ai"
+    SD_TAG_AM,           ///< "am"
+    SD_TAG_AO,           ///< "ao"
+    SD_TAG_AS,           ///< "as"
+    SD_TAG_AT,           ///< "at"
+    SD_TAG_AW,           ///< "aw"
+    SD_TAG_AX,           ///< "ax"
+    SD_TAG_AR,           ///< "ar"
+    SD_TAG_AL,           ///< "al"
+    SD_TAG_B,            ///< "b"
+    SD_TAG_B1,           ///< "b1"
+    SD_TAG_B2,           ///< "b2"
+    SD_TAG_BB,           ///< "bb"
+    SD_TAG_BE,           ///< "be"
+    SD_TAG_BF,           ///< "bf"
+    SD_TAG_BH,           ///< "bh"
+    SD_TAG_BL,           ///< "bl"
+    SD_TAG_BM,           ///< "bm"
+    SD_TAG_BJ,           ///< "bj"
+    SD_TAG_BS,           ///< "bs"
+    SD_TAG_BU,           ///< "bu"
+    SD_TAG_BW,           ///< "bw"
+    SD_TAG_BX,           ///< "bx"
+    SD_TAG_BPD,          ///< "bpd"
+    SD_TAG_BPS,          ///< "bps"
+    SD_TAG_BPN,          ///< "bpn"
+    SD_TAG_BPF,          ///< "bpf"
+    SD_TAG_BPP,          ///< "bpp"
+    SD_TAG_BPB,          ///< "bpb"
+    SD_TAG_BPO,          ///< "bpo"
+    SD_TAG_BZ,           ///< "bz"
+    SD_TAG_BA,           ///< "ba"
+    SD_TAG_BC,           ///< "bc"
+    SD_TAG_BD,           ///< "bd"
+    SD_TAG_BG,           ///< "bg"
+    SD_TAG_BI,           ///< "bi"
+    SD_TAG_BK,           ///< "bk"
+    SD_TAG_BN,           ///< "bn"
+    SD_TAG_BO,           ///< "bo"
+    SD_TAG_BR,           ///< "br"
+    SD_TAG_BT,           ///< "bt"
+    SD_TAG_BY,           ///< "by"
+    SD_TAG_CF,           ///< "cf"
+    SD_TAG_CG,           ///< "cg"
+    SD_TAG_CL,           ///< "cl"
+    SD_TAG_CP,           ///< "cp"
+    SD_TAG_CW,           ///< "cw"
+    SD_TAG_CX,           ///< "cx"
+    SD_TAG_CY,           ///< "cy"
+    SD_TAG_D,            ///< "d"
+    SD_TAG_E,            ///< "e"
+    SD_TAG_F,            ///< "f"
+    SD_TAG_G,            ///< "g"
+    SD_TAG_H,            ///< "h"
+    SD_TAG_I,            ///< "i"
+    SD_TAG_JF2,          ///< "jf2"
+    SD_TAG_JF,           ///< "jf"
+    SD_TAG_JG,           ///< "jg"
+    SD_TAG_JH,           ///< "jh"
+    SD_TAG_JJ,           ///< "jj"
+    SD_TAG_JL,           ///< "jl"
+    SD_TAG_JM,           ///< "jm"
+    SD_TAG_JP,           ///< "jp"
+    SD_TAG_JZ,           ///< "jz"
+    SD_TAG_JN,           ///< "jn"
+    SD_TAG_K,            ///< "k"
+    SD_TAG_L,            ///< "l"
+    SD_TAG_MA,           ///< "ma"
+    SD_TAG_MC,           ///< "mc"
+    SD_TAG_MD,           ///< "md"
+    SD_TAG_MG,           ///< "mg"
+    SD_TAG_MI,           ///< "mi"
+    SD_TAG_MM,           ///< "mm"
+    SD_TAG_MN,           ///< "mn"
+    SD_TAG_MO,           ///< "mo"
+    SD_TAG_MP,           ///< "mp"
+    SD_TAG_MRX,          ///< "mrx"
+    SD_TAG_MRY,          ///< "mry"
+    SD_TAG_MS,           ///< "ms"
+    SD_TAG_MU,           ///< "mu"
+    SD_TAG_MX,           ///< "mx"
+    SD_TAG_MY,           ///< "my"
+    SD_TAG_M,            ///< "m"
+    SD_TAG_N,            ///< "n"
+    SD_TAG_OX,           ///< "ox"
+    SD_TAG_OY,           ///< "oy"
+    SD_TAG_PA,           ///< "pa"
+    SD_TAG_PB,           ///< "pb"
+    SD_TAG_PC,           ///< "pc"
+    SD_TAG_PD,           ///< "pd"
+    SD_TAG_PE,           ///< "pe"
+    SD_TAG_PH,           ///< "ph"
+    SD_TAG_PP,           ///< "pp"
+    SD_TAG_PS,           ///< "ps"
+    SD_TAG_PTD,          ///< "ptd"
+    SD_TAG_PTP,          ///< "ptp"
+    SD_TAG_PTR,          ///< "ptr"
+    SD_TAG_Q,            ///< "q"
+    SD_TAG_R,            ///< "r"
+    SD_TAG_S,            ///< "s"
+    SD_TAG_SA,           ///< "sa"
+    SD_TAG_SB,           ///< "sb"
+    SD_TAG_SC,           ///< "sc"
+    SD_TAG_SD,           ///< "sd"
+    SD_TAG_SE,           ///< "se"
+    SD_TAG_SF,           ///< "sf"
+    SD_TAG_SL,           ///< "sl"
+    SD_TAG_SMF,          ///< "smf"
+    SD_TAG_SMO,          ///< "smo"
+    SD_TAG_SP,           ///< "sp"
+    SD_TAG_SW,           ///< "sw"
+    SD_TAG_T,            ///< "t"
+    SD_TAG_UA,           ///< "ua"
+    SD_TAG_UB,           ///< "ub"
+    SD_TAG_UC,           ///< "uc"
+    SD_TAG_UD,           ///< "ud"
+    SD_TAG_UE,           ///< "ue"
+    SD_TAG_UF,           ///< "uf"
+    SD_TAG_UG,           ///< "ug"
+    SD_TAG_UH,           ///< "uh"
+    SD_TAG_UJ,           ///< "uj"
+    SD_TAG_UL,           ///< "ul"
+    SD_TAG_UN,           ///< "un"
+    SD_TAG_UR,           ///< "ur"
+    SD_TAG_US,           ///< "us"
+    SD_TAG_UZ,           ///< "uz"
+    SD_TAG_V,            ///< "v"
+    SD_TAG_VSX,          ///< "vsx"
+    SD_TAG_VSY,          ///< "vsy"
+    SD_TAG_W,            ///< "w"
+    SD_TAG_X_MINUS,      ///< "x-"
+    SD_TAG_X_PLUS,       ///< "x+"
+    SD_TAG_X_EQ,         ///< "x="
+    SD_TAG_X,            ///< "x"
+    SD_TAG_Y_MINUS,      ///< "y-"
+    SD_TAG_Y_PLUS,       ///< "y+"
+    SD_TAG_Y_EQ,         ///< "y="
+    SD_TAG_Y,            ///< "y"
+    SD_TAG_ZG,           ///< "zg"
+    SD_TAG_ZH,           ///< "zh"
+    SD_TAG_ZJ,           ///< "zj"
+    SD_TAG_ZL,           ///< "zl"
+    SD_TAG_ZM,           ///< "zm"
+    SD_TAG_ZP,           ///< "zp"
+    SD_TAG_ZZ,           ///< "zz"
+    SD_TAG_COUNT
+} sd_tag_id;
+
 /*! \brief Tag information entry
  *
  * Contains information about a single animation tag.
@@ -39,4 +202,11 @@ extern const int sd_taglist_size; ///< Taglist size
  */
 int sd_tag_info(const char *search_tag, int *req_param, const char **tag, const char **desc);
 
+/*! \brief Find the identifier of a tag
+ *
+ * \param search_tag A Tag to look for
+ * \return Tag identifier, or SD_TAG_INVALID if the tag does not exist.
+ */
+sd_tag_id sd_tag_find(const char *search_tag);
+
 #endif // SD_TAGLIST_H
@@ -17,3 +17,12 @@ int sd_tag_info(const char *search_tag, int *req_param, const char **tag, const
     }
     return SD_INVALID_INPUT;
 }
+
+sd_tag_id sd_tag_find(const char *search_tag) {
+    for(int i = 0; i < sd_taglist_size; i++) {
+        if(strcmp(search_tag, sd_taglist[i].tag) == 0) {
+            return (sd_tag_id)i;
+        }
+    }
+    return SD_TAG_INVALID;
+}
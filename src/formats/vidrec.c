@@ -0,0 +1,217 @@
+#include <string.h>
+
+#include "formats/error.h"
+#include "formats/vidrec.h"
+
+#define VIDREC_MAGIC "OMFV"
+#define VIDREC_VERSION 1
+
+// Encoded frame tokens. The low bits of the token are the run length minus one.
+#define TOKEN_SKIP 0x00    // 1-128 pixels are the same as in the previous frame
+#define TOKEN_FILL 0x80    // 1-64 pixels of the color in the next byte
+#define TOKEN_LITERAL 0xC0 // 1-64 pixels follow as they are
+#define MAX_SKIP 128
+#define MAX_RUN 64
+
+static size_t unchanged_run(const uint8_t *prev, const uint8_t *cur, size_t at, size_t max) {
+    size_t end = at + max < SD_VIDREC_PIXELS ? at + max : SD_VIDREC_PIXELS;
+    size_t i = at;
+    while(i < end && prev[i] == cur[i]) {
+        i++;
+    }
+    return i - at;
+}
+
+static size_t fill_run(const uint8_t *cur, size_t at, size_t max) {
+    size_t end = at + max < SD_VIDREC_PIXELS ? at + max : SD_VIDREC_PIXELS;
+    size_t i = at + 1;
+    while(i < end && cur[i] == cur[at]) {
+        i++;
+    }
+    return i - at;
+}
+
+size_t sd_vidrec_encode(uint8_t *out, const uint8_t *prev, const uint8_t *cur) {
+    size_t pos = 0;
+    size_t i = 0;
+    while(i < SD_VIDREC_PIXELS) {
+        size_t run = unchanged_run(prev, cur, i, MAX_SKIP);
+        if(run > 0) {
+            out[pos++] = TOKEN_SKIP | (run - 1);
+            i += run;
+            continue;
+        }
+        run = fill_run(cur, i, MAX_RUN);
+        if(run >= 3) {
+            out[pos++] = TOKEN_FILL | (run - 1);
+            out[pos++] = cur[i];
+            i += run;
+            continue;
+        }
+
+        // Gather literals until a skip or a fill would be cheaper.
+        size_t start = i;
+        do {
+            i++;
+        } while(i < SD_VIDREC_PIXELS && i - start < MAX_RUN && unchanged_run(prev, cur, i, 2) < 2 &&
+                fill_run(cur, i, 3) < 3);
+        out[pos++] = TOKEN_LITERAL | (i - start - 1);
+        memcpy(out + pos, cur + start, i - start);
+        pos += i - start;
+    }
+    return pos;
+}
+
+int sd_vidrec_decode(uint8_t *frame, const uint8_t *data, size_t len) {
+    size_t pos = 0;
+    size_t i = 0;
+    while(pos < len) {
+        uint8_t token = data[pos++];
+        size_t run;
+        if(token < TOKEN_FILL) {
+            run = token + 1;
+            if(i + run > SD_VIDREC_PIXELS) {
+                return SD_FILE_PARSE_ERROR;
+            }
+        } else if(token < TOKEN_LITERAL) {
+            run = (token & 0x3F) + 1;
+            if(pos >= len || i + run > SD_VIDREC_PIXELS) {
+                return SD_FILE_PARSE_ERROR;
+            }
+            memset(frame + i, data[pos++], run);
+        } else {
+            run = (token & 0x3F) + 1;
+            if(pos + run > len || i + run > SD_VIDREC_PIXELS) {
+                return SD_FILE_PARSE_ERROR;
+            }
+            memcpy(frame + i, data + pos, run);
+            pos += run;
+        }
+        i += run;
+    }
+    return i == SD_VIDREC_PIXELS ? SD_SUCCESS : SD_FILE_PARSE_ERROR;
+}
+
+static void stream_init(sd_vidrec_stream *stream) {
+    stream->w = NULL;
+    stream->r = NULL;
+    stream->frames = 0;
+    stream->time = 0;
+    memset(stream->pixels, 0, sizeof(stream->pixels));
+    vga_palette_init(&stream->palette);
+}
+
+int sd_vidrec_create(sd_vidrec_stream *stream, const char *file) {
+    if(stream == NULL || file == NULL) {
+        return SD_INVALID_INPUT;
+    }
+    stream_init(stream);
+    if(!(stream->w = sd_writer_open(file))) {
+        return SD_FILE_OPEN_ERROR;
+    }
+    sd_write_buf(stream->w, VIDREC_MAGIC, 4);
+    sd_write_uword(stream->w, VIDREC_VERSION);
+    sd_write_uword(stream->w, SD_VIDREC_WIDTH);
+    sd_write_uword(stream->w, SD_VIDREC_HEIGHT);
+    return SD_SUCCESS;
+}
+
+int sd_vidrec_write_frame(sd_vidrec_stream *stream, uint32_t time, const uint8_t *pixels,
+                          const vga_palette *palette) {
+    // Find the range of palette entries that changed.
+    int first = 0;
+    int last = 255;
+    while(first < 256 && memcmp(&stream->palette.colors[first], &palette->colors[first], sizeof(vga_color)) == 0) {
+        first++;
+    }
+    while(last > first && memcmp(&stream->palette.colors[last], &palette->colors[last], sizeof(vga_color)) == 0) {
+        last--;
+    }
+    int count = first < 256 ? last - first + 1 : 0;
+
+    size_t len = sd_vidrec_encode(stream->buffer, stream->pixels, pixels);
+
+    sd_write_udword(stream->w, time);
+    sd_write_ubyte(stream->w, count > 0 ? first : 0);
+    sd_write_uword(stream->w, count);
+    if(count > 0) {
+        // Colors are stored as they are; faded palettes do not fit in the 6 bits of the game files.
+        sd_write_buf(stream->w, (const char *)&palette->colors[first], count * sizeof(vga_color));
+        memcpy(&stream->palette.colors[first], &palette->colors[first], count * sizeof(vga_color));
+    }
+    sd_write_udword(stream->w, len);
+    sd_write_buf(stream->w, (const char *)stream->buffer, len);
+    if(sd_writer_errno(stream->w)) {
+        return SD_FILE_WRITE_ERROR;
+    }
+
+    memcpy(stream->pixels, pixels, SD_VIDREC_PIXELS);
+    stream->time = time;
+    stream->frames++;
+    return SD_SUCCESS;
+}
+
+int sd_vidrec_open(sd_vidrec_stream *stream, const char *file) {
+    if(stream == NULL || file == NULL) {
+        return SD_INVALID_INPUT;
+    }
+    stream_init(stream);
+    if(!(stream->r = sd_reader_open(file))) {
+        return SD_FILE_OPEN_ERROR;
+    }
+    int ret = SD_FILE_INVALID_TYPE;
+    char magic[4];
+    if(!sd_read_buf(stream->r, magic, 4) || memcmp(magic, VIDREC_MAGIC, 4) != 0) {
+        goto error_0;
+    }
+    uint16_t version = sd_read_uword(stream->r);
+    uint16_t w = sd_read_uword(stream->r);
+    uint16_t h = sd_read_uword(stream->r);
+    if(version != VIDREC_VERSION || w != SD_VIDREC_WIDTH || h != SD_VIDREC_HEIGHT) {
+        ret = SD_FORMAT_NOT_SUPPORTED;
+        goto error_0;
+    }
+    return SD_SUCCESS;
+
+error_0:
+    sd_reader_close(stream->r);
+    stream->r = NULL;
+    return ret;
+}
+
+int sd_vidrec_read_frame(sd_vidrec_stream *stream) {
+    if(sd_reader_pos(stream->r) >= sd_reader_filesize(stream->r)) {
+        return SD_FILE_READ_ERROR;
+    }
+    uint32_t time = sd_read_udword(stream->r);
+    uint8_t first = sd_read_ubyte(stream->r);
+    uint16_t count = sd_read_uword(stream->r);
+    if(first + count > 256) {
+        return SD_FILE_PARSE_ERROR;
+    }
+    if(count > 0 && !sd_read_buf(stream->r, (char *)&stream->palette.colors[first], count * sizeof(vga_color))) {
+        return SD_FILE_PARSE_ERROR;
+    }
+    uint32_t len = sd_read_udword(stream->r);
+    if(len > SD_VIDREC_MAX_ENCODED || !sd_read_buf(stream->r, (char *)stream->buffer, len)) {
+        return SD_FILE_PARSE_ERROR;
+    }
+    int ret = sd_vidrec_decode(stream->pixels, stream->buffer, len);
+    if(ret != SD_SUCCESS) {
+        return ret;
+    }
+    stream->time = time;
+    stream->frames++;
+    return SD_SUCCESS;
+}
+
+void sd_vidrec_close(sd_vidrec_stream *stream) {
+    if(stream->w != NULL) {
+        sd_writer_close(stream->w);
+        stream->w = NULL;
+    }
+    if(stream->r != NULL) {
+        sd_reader_close(stream->r);
+        stream->r = NULL;
+    }
+}
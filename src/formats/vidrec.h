@@ -0,0 +1,115 @@
+/*! \file
+ * \brief Indexed video recording handling.
+ * \details Functions and structs for reading and writing recordings of the rendered 320x200 indexed frames.
+ * \copyright MIT license.
+ */
+
+#ifndef SD_VIDREC_H
+#define SD_VIDREC_H
+
+#include "formats/internal/reader.h"
+#include "formats/internal/writer.h"
+#include "video/vga_palette.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define SD_VIDREC_WIDTH 320
+#define SD_VIDREC_HEIGHT 200
+#define SD_VIDREC_PIXELS (SD_VIDREC_WIDTH * SD_VIDREC_HEIGHT)
+
+/*! \brief Largest possible size of one encoded frame. */
+#define SD_VIDREC_MAX_ENCODED (SD_VIDREC_PIXELS + SD_VIDREC_PIXELS / 64 + 1)
+
+/*! \brief Video recording stream
+ *
+ * State of a recording that is being written or read. Frames are stored as changes to the previous
+ * frame, so the stream keeps the last frame and palette around.
+ */
+typedef struct {
+    sd_writer *w;                          ///< Writer, if the stream is open for writing
+    sd_reader *r;                          ///< Reader, if the stream is open for reading
+    uint32_t frames;                       ///< Frames written or read so far
+    uint32_t time;                         ///< Timestamp of the current frame, in milliseconds
+    uint8_t pixels[SD_VIDREC_PIXELS];      ///< Current frame, top row first
+    vga_palette palette;                   ///< Current palette
+    uint8_t buffer[SD_VIDREC_MAX_ENCODED]; ///< Encoding scratch buffer
+} sd_vidrec_stream;
+
+/*! \brief Encode a frame as changes to the previous frame.
+ *
+ * The frame is run-length encoded as unchanged pixel runs, single color runs and literal pixels.
+ *
+ * \param out Output buffer, at least SD_VIDREC_MAX_ENCODED bytes long
+ * \param prev Previous frame
+ * \param cur Frame to encode
+ * \return Encoded size in bytes
+ */
+size_t sd_vidrec_encode(uint8_t *out, const uint8_t *prev, const uint8_t *cur);
+
+/*! \brief Apply an encoded frame on top of the previous frame.
+ *
+ * \retval SD_FILE_PARSE_ERROR Encoded data does not cover exactly one frame.
+ * \retval SD_SUCCESS Success.
+ *
+ * \param frame Previous frame; updated in place
+ * \param data Encoded frame
+ * \param len Encoded frame size in bytes
+ */
+int sd_vidrec_decode(uint8_t *frame, const uint8_t *data, size_t len);
+
+/*! \brief Create a new recording file.
+ *
+ * \retval SD_INVALID_INPUT Stream or filename was NULL.
+ * \retval SD_FILE_OPEN_ERROR File could not be opened for writing.
+ * \retval SD_SUCCESS Success.
+ *
+ * \param stream Stream to initialize
+ * \param file Filename to write to
+ */
+int sd_vidrec_create(sd_vidrec_stream *stream, const char *file);
+
+/*! \brief Append a frame to the recording.
+ *
+ * Only the palette entries that changed since the previous frame are stored.
+ *
+ * \retval SD_FILE_WRITE_ERROR Frame could not be written.
+ * \retval SD_SUCCESS Success.
+ *
+ * \param stream Stream opened with sd_vidrec_create
+ * \param time Timestamp of the frame, in milliseconds
+ * \param pixels Frame pixels, top row first
+ * \param palette Palette of the frame
+ */
+int sd_vidrec_write_frame(sd_vidrec_stream *stream, uint32_t time, const uint8_t *pixels,
+                          const vga_palette *palette);
+
+/*! \brief Open a recording file for reading.
+ *
+ * \retval SD_INVALID_INPUT Stream or filename was NULL.
+ * \retval SD_FILE_OPEN_ERROR File could not be opened for reading.
+ * \retval SD_FILE_INVALID_TYPE File is not a video recording.
+ * \retval SD_FORMAT_NOT_SUPPORTED Recording is from an unknown version.
+ * \retval SD_SUCCESS Success.
+ *
+ * \param stream Stream to initialize
+ * \param file Filename to read from
+ */
+int sd_vidrec_open(sd_vidrec_stream *stream, const char *file);
+
+/*! \brief Read the next frame of the recording into stream->pixels, stream->palette and stream->time.
+ *
+ * \retval SD_FILE_READ_ERROR There are no more frames.
+ * \retval SD_FILE_PARSE_ERROR Frame data is broken.
+ * \retval SD_SUCCESS Success.
+ *
+ * \param stream Stream opened with sd_vidrec_open
+ */
+int sd_vidrec_read_frame(sd_vidrec_stream *stream);
+
+/*! \brief Close a recording stream.
+ *
+ * \param stream Stream to close
+ */
+void sd_vidrec_close(sd_vidrec_stream *stream);
+
+#endif // SD_VIDREC_H
@@ -90,6 +90,36 @@ void game_player_clone(game_player *src, game_player *dst) {
     har_screencaps_clone(&src->screencaps, &dst->screencaps);
 }
 
+void game_player_serialize(game_player *gp, serial *ser) {
+    serial_write(ser, (const char *)gp, sizeof(game_player));
+    chr_score_serialize(&gp->score, ser);
+    har_screencaps_serialize(&gp->screencaps, ser);
+}
+
+void game_player_unserialize(game_player *gp, serial *ser) {
+    serial_read(ser, (char *)gp, sizeof(game_player));
+    chr_score_unserialize(&gp->score, ser);
+    har_screencaps_unserialize(&gp->screencaps, ser);
+}
+
+// Hash the simulation state of the player for desync detection; see object_hash. The HAR link is hashed by
+// game_state_hash, which knows where the HAR is in the object list.
+void game_player_hash(const game_player *gp, hash64_state *h) {
+    const chr_score *score = &gp->score;
+    hash64_update_u32(h, gp->god);
+    hash64_update_u32(h, score->score);
+    hash64_update_u32(h, score->done);
+    hash64_update_u32(h, score->rounds);
+    hash64_update_u32(h, score->wins);
+    hash64_update_u32(h, score->health);
+    hash64_update_u32(h, score->consecutive_hits);
+    hash64_update_u32(h, score->consecutive_hit_score);
+    hash64_update_u32(h, score->combo_hits);
+    hash64_update_u32(h, score->combo_hit_score);
+    hash64_update_u32(h, score->scrap);
+    hash64_update_u32(h, score->destruction);
+}
+
 int game_player_clone_free(game_player *gp) {
     chr_score_free(&gp->score);
     har_screencaps_free(&gp->screencaps);
@@ -44,5 +44,8 @@ void game_player_set_pilot(game_player *gp, sd_pilot *new_pilot);
 chr_score *game_player_get_score(game_player *gp);
 void game_player_clone(game_player *src, game_player *dst);
 int game_player_clone_free(game_player *gp);
+void game_player_serialize(game_player *gp, serial *ser);
+void game_player_unserialize(game_player *gp, serial *ser);
+void game_player_hash(const game_player *gp, hash64_state *h);
 
 #endif // GAME_PLAYER_H
@@ -3,10 +3,12 @@
 #include "controller/joystick.h"
 #include "controller/keyboard.h"
 #include "controller/rec_controller.h"
+#include "controller/spectator_controller.h"
 #include "formats/error.h"
 #include "formats/pilot.h"
 #include "formats/rec.h"
 #include "game/common_defines.h"
+#include "game/protos/intersect.h"
 #include "game/protos/object.h"
 #include "game/protos/scene.h"
 #include "game/scenes/arena.h"
@@ -21,9 +23,11 @@
 #include "game/scenes/openomf.h"
 #include "game/scenes/scoreboard.h"
 #include "game/scenes/vs.h"
+#include "game/utils/script_cache.h"
 #include "game/utils/serial.h"
 #include "game/utils/settings.h"
 #include "game/utils/ticktimer.h"
+#include "resources/ids.h"
 #include "resources/pilots.h"
 #include "utils/allocator.h"
 #include "utils/log.h"
@@ -45,6 +49,7 @@ enum
 };
 
 static void _setup_rec_controller(game_state *gs, int player_id, sd_rec_file *rec);
+static const spectator_setup *_setup_spectator_controller(game_state *gs);
 
 // How long the scene waits after order to move to another scene
 // Used for crossfades
@@ -60,6 +65,7 @@ typedef struct {
 int game_state_create(game_state *gs, engine_init_flags *init_flags) {
     gs->run = 1;
     gs->paused = 0;
+    gs->stalled = 0;
     gs->tick = 0;
     gs->int_tick = 0;
     gs->role = ROLE_CLIENT;
@@ -68,6 +74,8 @@ int game_state_create(game_state *gs, engine_init_flags *init_flags) {
     gs->init_flags = init_flags;
     gs->new_state = NULL;
     vector_create(&gs->objects, sizeof(render_obj));
+    object_index_create(&gs->object_index);
+    gs->hash_refs = NULL;
 
     // For screen shake
     gs->screen_shake_horizontal = 0;
@@ -123,6 +131,43 @@ int game_state_create(game_state *gs, engine_init_flags *init_flags) {
         // XXX use playback controller once it exista
         _setup_rec_controller(gs, 0, &rec);
         _setup_rec_controller(gs, 1, &rec);
+        if(arena_create(gs->sc)) {
+            PERROR("Error while creating arena scene.");
+            goto error_1;
+        }
+    } else if(init_flags->net_mode == NET_MODE_SPECTATE) {
+        const spectator_setup *setup = _setup_spectator_controller(gs);
+        if(setup == NULL) {
+            goto error_0;
+        }
+
+        nscene = setup->arena;
+        if(!is_arena(nscene) || scene_create(gs->sc, gs, nscene)) {
+            PERROR("Error while loading scene %d.", nscene);
+            goto error_0;
+        }
+
+        // the players' HARs and pilots, as they were set up in the melee
+        for(int i = 0; i < 2; i++) {
+            const spectator_player *player = &setup->players[i];
+            sd_pilot *pilot = gs->players[i]->pilot;
+            sd_pilot_set_player_color(pilot, PRIMARY, player->colors[2]);
+            sd_pilot_set_player_color(pilot, SECONDARY, player->colors[1]);
+            sd_pilot_set_player_color(pilot, TERTIARY, player->colors[0]);
+            pilot->har_id = player->har_id;
+            pilot->pilot_id = player->pilot_id;
+            pilot->arm_power = player->stats[0];
+            pilot->leg_power = player->stats[1];
+            pilot->arm_speed = player->stats[2];
+            pilot->leg_speed = player->stats[3];
+            pilot->armor = player->stats[4];
+            pilot->stun_resistance = player->stats[5];
+            pilot->power = player->stats[6];
+            pilot->agility = player->stats[7];
+            pilot->endurance = player->stats[8];
+        }
+        gs->speed = setup->speed;
+
         if(arena_create(gs->sc)) {
             PERROR("Error while creating arena scene.");
             goto error_1;
@@ -163,6 +208,7 @@ error_1:
 error_0:
     omf_free(gs->sc);
     vector_free(&gs->objects);
+    object_index_free(&gs->object_index);
     return 1;
 }
 
@@ -192,6 +238,7 @@ int game_state_add_object(game_state *gs, object *obj, int layer, int singleton,
         }
     }
     vector_append(&gs->objects, &o);
+    object_index_insert(&gs->object_index, obj);
 
 #ifdef DEBUGMODE_STFU
     animation *ani = object_get_animation(obj);
@@ -228,7 +275,8 @@ void game_state_del_animation(game_state *gs, int anim_id) {
         animation *ani = object_get_animation(robj->obj);
         if(ani != NULL && ani->id == anim_id) {
             object_free(robj->obj);
-            omf_free(robj->obj);
+            object_index_remove(&gs->object_index, robj->obj);
+            object_release(robj->obj);
             vector_delete(&gs->objects, &it);
             DEBUG("Deleted animation %i from game_state.", anim_id);
             return;
@@ -244,7 +292,8 @@ void game_state_del_object(game_state *gs, object *target) {
     while((robj = iter_next(&it)) != NULL) {
         if(target == robj->obj) {
             object_free(robj->obj);
-            omf_free(robj->obj);
+            object_index_remove(&gs->object_index, robj->obj);
+            object_release(robj->obj);
             vector_delete(&gs->objects, &it);
             return;
         }
@@ -258,7 +307,8 @@ void game_state_del_object_by_id(game_state *gs, uint32_t target) {
     while((robj = iter_next(&it)) != NULL) {
         if(target == robj->obj->id) {
             object_free(robj->obj);
-            omf_free(robj->obj);
+            object_index_remove(&gs->object_index, robj->obj);
+            object_release(robj->obj);
             vector_delete(&gs->objects, &it);
             return;
         }
@@ -283,7 +333,8 @@ void game_state_clear_hazards_projectiles(game_state *gs) {
     while((robj = iter_next(&it)) != NULL) {
         if(object_get_group(robj->obj) == GROUP_PROJECTILE) {
             object_free(robj->obj);
-            omf_free(robj->obj);
+            object_index_remove(&gs->object_index, robj->obj);
+            object_release(robj->obj);
             vector_delete(&gs->objects, &it);
         }
     }
@@ -305,14 +356,19 @@ unsigned int game_state_is_running(game_state *gs) {
     return gs->run;
 }
 
+// The game does not advance while paused from the menu, or while stalled by a controller
 unsigned int game_state_is_paused(game_state *gs) {
-    return gs->paused;
+    return gs->paused || gs->stalled;
 }
 
 void game_state_set_paused(game_state *gs, unsigned int paused) {
     gs->paused = paused;
 }
 
+void game_state_set_stalled(game_state *gs, unsigned int stalled) {
+    gs->stalled = stalled;
+}
+
 // Return 0 if event was handled here
 int game_state_handle_event(game_state *gs, SDL_Event *event) {
     if(scene_event(gs->sc, event) == 0) {
@@ -447,12 +503,16 @@ int game_load_new(game_state *gs, int scene_id) {
     while((robj = iter_next(&it)) != NULL) {
         if(!robj->persistent) {
             object_free(robj->obj);
-            omf_free(robj->obj);
+            object_index_remove(&gs->object_index, robj->obj);
+            object_release(robj->obj);
             vector_delete(&gs->objects, &it);
         }
     }
 
-    // Free texture items, we are going to create new ones.
+    // Drop the decoded animation strings that only the old scene used.
+    script_cache_prune();
+
+    // The old scene's surfaces are gone. Their pixels stay in the atlas for the new scene to reuse.
     video_reset_atlas();
 
     // Initialize new scene with BK data etc.
@@ -558,20 +618,64 @@ error_0:
     return 1;
 }
 
+// Collision candidates are kept on the stack unless the scene is unusually busy.
+#define COLLIDE_STACK_OBJECTS 64
+
 void game_state_call_collide(game_state *gs) {
-    object *a, *b;
     unsigned int size = vector_size(&gs->objects);
+    object *stack_candidates[COLLIDE_STACK_OBJECTS];
+    object **candidates = stack_candidates;
+    object *a, *b;
+
+    // Only objects with a collide callback do anything here, so anything that does not share a layer
+    // with one of them (scrap, oil, ...) can be skipped entirely.
+    uint8_t layers = 0;
     for(unsigned i = 0; i < size; i++) {
         a = ((render_obj *)vector_get(&gs->objects, i))->obj;
-        for(unsigned k = i + 1; k < size; k++) {
-            b = ((render_obj *)vector_get(&gs->objects, k))->obj;
+        if(a->collide != NULL) {
+            layers |= a->layers;
+        }
+    }
+    if(layers == 0) {
+        return;
+    }
+
+    if(size > COLLIDE_STACK_OBJECTS) {
+        candidates = omf_calloc(size, sizeof(object *));
+    }
+    unsigned count = 0;
+    for(unsigned i = 0; i < size; i++) {
+        a = ((render_obj *)vector_get(&gs->objects, i))->obj;
+        if(a->layers & layers) {
+            candidates[count++] = a;
+        }
+    }
+
+    // Candidates are still in object order, so callbacks run in the same order as a full pairwise check.
+    // Objects may be re-animated or moved by earlier callbacks, so reach is checked per pair instead of
+    // being sorted up front.
+    for(unsigned i = 0; i < count; i++) {
+        a = candidates[i];
+        if(a->collide == NULL) {
+            continue;
+        }
+        for(unsigned k = i + 1; k < count; k++) {
+            b = candidates[k];
             if(a->group != b->group || a->group == OBJECT_NO_GROUP || b->group == OBJECT_NO_GROUP) {
                 if(a->layers & b->layers) {
+                    // Two objects with callbacks (HARs) may react to each other at any distance.
+                    if(b->collide == NULL && !intersect_reach_overlap(a, b)) {
+                        continue;
+                    }
                     object_collide(a, b);
                 }
             }
         }
     }
+
+    if(candidates != stack_candidates) {
+        omf_free(candidates);
+    }
 }
 
 void game_state_cleanup(game_state *gs) {
@@ -582,7 +686,8 @@ void game_state_cleanup(game_state *gs) {
         if(object_finished(robj->obj)) {
             /*DEBUG("Animation object %d is finished, removing.", robj->obj->cur_animation->id);*/
             object_free(robj->obj);
-            omf_free(robj->obj);
+            object_index_remove(&gs->object_index, robj->obj);
+            object_release(robj->obj);
             vector_delete(&gs->objects, &it);
         }
     }
@@ -687,12 +792,25 @@ void game_state_static_tick(game_state *gs, bool replay) {
 
 // This function is called when the game speed requires it
 void game_state_dynamic_tick(game_state *gs, bool replay) {
+    // Controllers may feed in inputs here, so do this before anything else changes the state. Rollbacks feed
+    // in the inputs at the same point, between two ticks.
+    if(!replay) {
+        game_state_dyntick_controllers(gs);
+    }
+
+    // A controller waiting for inputs holds the whole tick, so that nothing, not even the tick counters, runs
+    // ahead of the inputs. The pause menu pauses only the simulation instead.
+    if(gs->stalled && !replay) {
+        game_state_ctrl_events_free(gs);
+        return;
+    }
+
     // Change the screen shake value downwards
-    if(gs->screen_shake_horizontal > 0 && !gs->paused) {
+    if(gs->screen_shake_horizontal > 0 && !game_state_is_paused(gs)) {
         gs->screen_shake_horizontal--;
     }
 
-    if(gs->screen_shake_vertical > 0 && !gs->paused) {
+    if(gs->screen_shake_vertical > 0 && !game_state_is_paused(gs)) {
         gs->screen_shake_vertical--;
     }
 
@@ -717,10 +835,6 @@ void game_state_dynamic_tick(game_state *gs, bool replay) {
         }
     }
 
-    if(!replay) {
-        game_state_dyntick_controllers(gs);
-    }
-
     // Tick scene
     scene_dynamic_tick(gs->sc, game_state_is_paused(gs));
 
@@ -851,6 +965,20 @@ static void _setup_rec_controller(game_state *gs, int player_id, sd_rec_file *re
     game_player_set_ctrl(player, ctrl);
 }
 
+// Player 2 gets the spectator controller, which plays the match for both HARs. The setup lives as long as it.
+static const spectator_setup *_setup_spectator_controller(game_state *gs) {
+    controller *ctrl = omf_calloc(1, sizeof(controller));
+    settings_network *net = &settings_get()->net;
+    controller_init(ctrl, gs);
+
+    if(spectator_controller_create(ctrl, net->net_connect_ip, net->net_connect_port)) {
+        omf_free(ctrl);
+        return NULL;
+    }
+    game_player_set_ctrl(game_state_get_player(gs, 1), ctrl);
+    return spectator_controller_get_setup(ctrl);
+}
+
 void reconfigure_controller(game_state *gs) {
     settings_keyboard *k = &settings_get()->keys;
     if(k->ctrl_type1 == CTRL_TYPE_KEYBOARD) {
@@ -899,10 +1027,11 @@ void game_state_clone_free(game_state *gs) {
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         object_clone_free(robj->obj);
-        omf_free(robj->obj);
+        object_release(robj->obj);
         vector_delete(&gs->objects, &it);
     }
     vector_free(&gs->objects);
+    object_index_free(&gs->object_index);
 
     // Free scene
     scene_clone_free(gs->sc);
@@ -927,10 +1056,11 @@ void game_state_free(game_state **_gs) {
     vector_iter_begin(&gs->objects, &it);
     while((robj = iter_next(&it)) != NULL) {
         object_free(robj->obj);
-        omf_free(robj->obj);
+        object_release(robj->obj);
         vector_delete(&gs->objects, &it);
     }
     vector_free(&gs->objects);
+    object_index_free(&gs->object_index);
 
     // Free scene
     scene_free(gs->sc);
@@ -966,20 +1096,12 @@ int game_state_ms_per_dyntick(game_state *gs) {
 
 int render_obj_clone(render_obj *src, render_obj *dst, game_state *gs) {
     memcpy(dst, src, sizeof(render_obj));
-    dst->obj = omf_calloc(1, sizeof(object));
+    dst->obj = object_alloc();
     return object_clone(src->obj, dst->obj, gs);
 }
 
 object *game_state_find_object(game_state *gs, uint32_t object_id) {
-    iterator it;
-    vector_iter_begin(&gs->objects, &it);
-    render_obj *robj;
-    while((robj = iter_next(&it)) != NULL) {
-        if(robj->obj->id == object_id) {
-            return robj->obj;
-        }
-    }
-    return NULL;
+    return object_index_get(&gs->object_index, object_id);
 }
 
 int game_state_clone(game_state *src, game_state *dst) {
@@ -987,6 +1109,7 @@ int game_state_clone(game_state *src, game_state *dst) {
     memcpy(dst, src, sizeof(game_state));
     // fix any pointers to volatile data
     vector_create(&dst->objects, sizeof(render_obj));
+    object_index_create(&dst->object_index);
 
     dst->next_wait_ticks = 0;
     dst->this_wait_ticks = 0;
@@ -1000,6 +1123,7 @@ int game_state_clone(game_state *src, game_state *dst) {
         render_obj_clone(robj, &d, dst);
         DEBUG("cloned object %d", d.obj->id);
         vector_append(&dst->objects, &d);
+        object_index_insert(&dst->object_index, d.obj);
         i++;
     }
     DEBUG("cloned %d objects into new game state", i);
@@ -1016,3 +1140,174 @@ int game_state_clone(game_state *src, game_state *dst) {
 
     return 0;
 }
+
+/**
+ * Write the full simulation state into a flat buffer. The result can be turned back into a live game state
+ * with game_state_unserialize, which produces the same thing as game_state_clone would have at this point.
+ */
+void game_state_serialize(game_state *gs, serial *ser) {
+    serial_write(ser, (const char *)gs, sizeof(game_state));
+
+    uint32_t count = vector_size(&gs->objects);
+    serial_write(ser, (const char *)&count, sizeof(count));
+    iterator it;
+    vector_iter_begin(&gs->objects, &it);
+    render_obj *robj;
+    while((robj = iter_next(&it)) != NULL) {
+        serial_write(ser, (const char *)robj, sizeof(render_obj));
+        object_serialize(robj->obj, ser);
+    }
+
+    for(int i = 0; i < 2; i++) {
+        game_player_serialize(gs->players[i], ser);
+    }
+    scene_serialize(gs->sc, ser);
+}
+
+/**
+ * Rebuild a game state written by game_state_serialize. Release with game_state_clone_free.
+ *
+ * @param dst Game state to fill. Old contents are overwritten, not freed.
+ * @param ser Buffer to read from. Reading starts from the current read position.
+ */
+int game_state_unserialize(game_state *dst, serial *ser) {
+    serial_read(ser, (char *)dst, sizeof(game_state));
+    dst->next_wait_ticks = 0;
+    dst->this_wait_ticks = 0;
+    dst->new_state = NULL;
+    dst->hash_refs = NULL;
+
+    uint32_t count;
+    serial_read(ser, (char *)&count, sizeof(count));
+    vector_create_with_size(&dst->objects, sizeof(render_obj), count);
+    object_index_create(&dst->object_index);
+    for(uint32_t i = 0; i < count; i++) {
+        render_obj robj;
+        serial_read(ser, (char *)&robj, sizeof(render_obj));
+        robj.obj = object_alloc();
+        object_unserialize(robj.obj, ser, dst);
+        vector_append(&dst->objects, &robj);
+        object_index_insert(&dst->object_index, robj.obj);
+    }
+
+    // Objects need to exist before the scene is restored, since scenes may hook into them.
+    for(int i = 0; i < 2; i++) {
+        dst->players[i] = omf_calloc(1, sizeof(game_player));
+        game_player_unserialize(dst->players[i], ser);
+    }
+    dst->sc = omf_calloc(1, sizeof(scene));
+    scene_unserialize(dst->sc, ser, dst);
+    return 0;
+}
+
+typedef struct {
+    uint32_t id;
+    uint32_t position;
+} object_ref;
+
+static int object_ref_compare(const void *a, const void *b) {
+    uint32_t ida = ((const object_ref *)a)->id;
+    uint32_t idb = ((const object_ref *)b)->id;
+    return (ida > idb) - (ida < idb);
+}
+
+/**
+ * Hash a reference to another object for desync detection. Object ids come from a process wide counter, so
+ * they differ between peers; the referenced object is hashed by its position in the object list instead,
+ * which is the same on every peer that runs the same simulation.
+ *
+ * While game_state_hash runs, positions are looked up from the table it builds. Otherwise the object list
+ * is searched.
+ *
+ * @param gs Game state the object belongs to
+ * @param h Hash to update
+ * @param object_id Referenced object id, or 0 for none
+ */
+void game_state_hash_object_ref(const game_state *gs, hash64_state *h, uint32_t object_id) {
+    uint32_t position = UINT32_MAX;
+    if(object_id != 0 && gs->hash_refs != NULL) {
+        object_ref key = {.id = object_id};
+        const object_ref *ref = NULL;
+        if(vector_size(gs->hash_refs) > 0) {
+            ref = bsearch(&key, vector_get(gs->hash_refs, 0), vector_size(gs->hash_refs), sizeof(object_ref),
+                          object_ref_compare);
+        }
+        if(ref != NULL) {
+            position = ref->position;
+        }
+    } else if(object_id != 0) {
+        for(unsigned i = 0; i < vector_size(&gs->objects); i++) {
+            const render_obj *robj = vector_get(&gs->objects, i);
+            if(robj->obj->id == object_id) {
+                position = i;
+                break;
+            }
+        }
+    }
+    hash64_update_u32(h, position);
+}
+
+/**
+ * Hash the simulation state for desync detection, one part per player, scene and object. Ticks, speed and
+ * other values that are allowed to differ between peers are left out, and so are object ids; objects are
+ * keyed by their position in the object list.
+ *
+ * @param gs Game state to hash
+ * @param tick Tick to label the hash with
+ * @param out Hash to fill
+ */
+void game_state_hash(game_state *gs, uint32_t tick, state_hash *out) {
+    hash64_state h;
+    state_hash_begin(out, tick);
+
+    // Objects refer to each other by id; look up all of their positions with one sorted table.
+    vector refs;
+    vector_create_with_size(&refs, sizeof(object_ref), vector_size(&gs->objects));
+    for(unsigned i = 0; i < vector_size(&gs->objects); i++) {
+        const render_obj *robj = vector_get(&gs->objects, i);
+        object_ref ref = {.id = robj->obj->id, .position = i};
+        vector_append(&refs, &ref);
+    }
+    vector_sort(&refs, object_ref_compare);
+    gs->hash_refs = &refs;
+
+    hash64_reset(&h, 0);
+    hash64_update_u32(&h, gs->this_id);
+    hash64_update_u32(&h, gs->next_id);
+    hash64_update_u32(&h, gs->rand.seed);
+    hash64_update_u32(&h, gs->screen_shake_horizontal);
+    hash64_update_u32(&h, gs->screen_shake_vertical);
+    hash64_update_u32(&h, gs->speed_slowdown_previous);
+    hash64_update_u32(&h, gs->speed_slowdown_time);
+    hash64_update_u32(&h, gs->fight_stats.winner);
+    for(int i = 0; i < 2; i++) {
+        hash64_update_u32(&h, gs->fight_stats.hits_landed[i]);
+        hash64_update_float(&h, gs->fight_stats.average_damage[i]);
+        hash64_update_u32(&h, gs->fight_stats.total_attacks[i]);
+        hash64_update_u32(&h, gs->fight_stats.hit_miss_ratio[i]);
+    }
+    state_hash_add(out, STATE_HASH_GAME, 0, &h);
+
+    for(int i = 0; i < 2; i++) {
+        hash64_reset(&h, 0);
+        game_player_hash(gs->players[i], &h);
+        game_state_hash_object_ref(gs, &h, gs->players[i]->har_obj_id);
+        state_hash_add(out, STATE_HASH_PLAYER, i, &h);
+    }
+
+    hash64_reset(&h, 0);
+    scene_hash(gs->sc, &h);
+    state_hash_add(out, STATE_HASH_SCENE, gs->sc->id, &h);
+
+    for(unsigned i = 0; i < vector_size(&gs->objects); i++) {
+        const render_obj *robj = vector_get(&gs->objects, i);
+        hash64_reset(&h, 0);
+        hash64_update_u32(&h, robj->layer);
+        object_hash(robj->obj, &h);
+        state_hash_add(out, STATE_HASH_OBJECT, i, &h);
+    }
+    state_hash_finish(out);
+
+    gs->hash_refs = NULL;
+    vector_free(&refs);
+}
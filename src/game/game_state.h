@@ -3,6 +3,7 @@
 
 #include "game/game_state_type.h"
 #include "game/utils/serial.h"
+#include "game/utils/state_hash.h"
 #include "utils/random.h"
 #include "utils/vector.h"
 #include <SDL.h>
@@ -26,6 +27,7 @@ scene *game_state_get_scene(game_state *gs);
 unsigned int game_state_is_running(game_state *gs);
 unsigned int game_state_is_paused(game_state *gs);
 void game_state_set_paused(game_state *gs, unsigned int paused);
+void game_state_set_stalled(game_state *gs, unsigned int stalled);
 void game_state_set_next(game_state *gs, unsigned int next_scene_id);
 game_player *game_state_get_player(const game_state *gs, int player_id);
 int game_state_num_players(game_state *gs);
@@ -37,6 +39,10 @@ object *game_state_find_object(game_state *gs, uint32_t object_id);
 
 int game_state_clone(game_state *src, game_state *dst);
 void game_state_clone_free(game_state *gs);
+void game_state_serialize(game_state *gs, serial *ser);
+int game_state_unserialize(game_state *dst, serial *ser);
+void game_state_hash(game_state *gs, uint32_t tick, state_hash *out);
+void game_state_hash_object_ref(const game_state *gs, hash64_state *h, uint32_t object_id);
 
 void _setup_keyboard(game_state *gs, int player_id);
 void _setup_ai(game_state *gs, int player_id);
@@ -3,6 +3,7 @@
 
 #include "engine.h"
 #include "game/protos/fight_stats.h"
+#include "game/utils/object_index.h"
 #include "utils/random.h"
 #include "utils/vector.h"
 
@@ -24,7 +25,8 @@ enum
     NET_MODE_NONE,
     NET_MODE_SERVER,
     NET_MODE_CLIENT,
-    NET_MODE_LOBBY
+    NET_MODE_LOBBY,
+    NET_MODE_SPECTATE
 };
 
 typedef struct scene_t scene;
@@ -34,6 +36,7 @@ typedef struct ticktimer_t ticktimer;
 typedef struct game_state_t {
     unsigned int run;
     unsigned int paused;
+    unsigned int stalled; // Held by a controller waiting for inputs; the pause menu leaves this alone
     unsigned int this_id;
     unsigned int next_id;
     unsigned int next_next_id;
@@ -61,9 +64,11 @@ typedef struct game_state_t {
     // For debugging, sets fastest possible mode :)
     int warp_speed;
 
-    int net_mode; // NET_MODE_NONE, NET_MODE_CLIENT, NET_MODE_SERVER
+    int net_mode; // NET_MODE_NONE, NET_MODE_CLIENT, NET_MODE_SERVER, NET_MODE_SPECTATE
     scene *sc;
     vector objects;
+    object_index object_index; // object id -> object, for everything in objects
+    vector *hash_refs;         // object id -> position in objects, only set while game_state_hash runs
     game_player *players[2];
 
     fight_stats fight_stats;
@@ -22,6 +22,7 @@
 #include "utils/allocator.h"
 #include "utils/log.h"
 #include "utils/miscmath.h"
+#include "utils/pool.h"
 #include "utils/random.h"
 #include "video/damage_tracker.h"
 #include "video/vga_state.h"
@@ -29,6 +30,9 @@
 
 #define IS_ZERO(n) (n < 0.8 && n > -0.8)
 
+// HAR state of both players, and of their copies in rollback snapshots
+static pool har_pool = POOL_INIT("har", har, 4);
+
 void har_finished(object *obj);
 int har_act(object *obj, int act_type);
 void har_spawn_scrap(object *obj, vec2i pos, int amount);
@@ -40,7 +44,7 @@ void har_free(object *obj) {
 #ifdef DEBUGMODE
     surface_free(&h->cd_debug);
 #endif
-    omf_free(h);
+    pool_release(&har_pool, h);
     object_set_userdata(obj, NULL);
 }
 
@@ -339,34 +343,34 @@ int har_is_blocking(har *h, af_move *move) {
 }
 
 int har_is_invincible(object *obj, af_move *move) {
-    if(player_frame_isset(obj, "zz")) {
+    if(player_frame_isset(obj, SD_TAG_ZZ)) {
         // blocks everything
         return 1;
     }
     switch(move->category) {
         // XX 'zg' is not handled here, but the game doesn't use it...
         case CAT_LOW:
-            if(player_frame_isset(obj, "zl")) {
+            if(player_frame_isset(obj, SD_TAG_ZL)) {
                 return 1;
             }
             break;
         case CAT_MEDIUM:
-            if(player_frame_isset(obj, "zm")) {
+            if(player_frame_isset(obj, SD_TAG_ZM)) {
                 return 1;
             }
             break;
         case CAT_HIGH:
-            if(player_frame_isset(obj, "zh")) {
+            if(player_frame_isset(obj, SD_TAG_ZH)) {
                 return 1;
             }
             break;
         case CAT_JUMPING:
-            if(player_frame_isset(obj, "zj")) {
+            if(player_frame_isset(obj, SD_TAG_ZJ)) {
                 return 1;
             }
             break;
         case CAT_PROJECTILE:
-            if(player_frame_isset(obj, "zp")) {
+            if(player_frame_isset(obj, SD_TAG_ZP)) {
                 return 1;
             }
             break;
@@ -397,7 +401,7 @@ void cb_har_spawn_object(object *parent, int id, vec2i pos, vec2f vel, uint8_t m
     // ... otherwise expect it is a projectile
     af_move *move = af_get_move(h->af_data, id);
     if(move != NULL) {
-        object *obj = omf_calloc(1, sizeof(object));
+        object *obj = object_alloc();
         object_create(obj, parent->gs, pos, vel);
         object_set_stl(obj, object_get_stl(parent));
         object_set_animation(obj, &move->ani);
@@ -439,11 +443,11 @@ void cb_har_spawn_object(object *parent, int id, vec2i pos, vec2f vel, uint8_t m
 }
 
 void har_floor_landing_effects(object *obj) {
-    int amount = rand_int(2) + 1;
+    int amount = random_int(&obj->gs->rand, 2) + 1;
     for(int i = 0; i < amount; i++) {
-        int variance = rand_int(20) - 10;
+        int variance = random_int(&obj->gs->rand, 20) - 10;
         vec2i coord = vec2i_create(obj->pos.x + variance + i * 10, obj->pos.y);
-        object *dust = omf_calloc(1, sizeof(object));
+        object *dust = object_alloc();
         object_create(dust, obj->gs, coord, vec2f_create(0, 0));
         object_set_stl(dust, object_get_stl(obj));
         object_set_animation(dust, &bk_get_info(game_state_get_scene(obj->gs)->bk_data, 26)->ani);
@@ -465,7 +469,7 @@ void har_move(object *obj) {
     // Check for wall hits
     if(obj->pos.x <= ARENA_LEFT_WALL || obj->pos.x >= ARENA_RIGHT_WALL) {
         h->is_wallhugging = 1;
-        if(player_frame_isset(obj, "cw") && player_frame_isset(obj, "d")) {
+        if(player_frame_isset(obj, SD_TAG_CW) && player_frame_isset(obj, SD_TAG_D)) {
             DEBUG("disabling d tag on animation because of wall hit");
             obj->animation_state.disable_d = 1;
         }
@@ -677,8 +681,8 @@ void har_take_damage(object *obj, const str *string, float damage, float stun) {
 
         // XXX hack - if the first frame has the 'k' tag, treat it as some vertical knockback
         // we can't do this in player.c because it breaks the jaguar leap, which also uses the 'k' tag.
-        const sd_script_frame *frame = sd_script_get_frame(&obj->animation_state.parser, 0);
-        if(frame != NULL && sd_script_isset(frame, "k")) {
+        const sd_script_frame *frame = sd_script_get_frame(obj->animation_state.parser, 0);
+        if(frame != NULL && sd_script_isset_id(frame, SD_TAG_K)) {
             obj->vel.y -= 7;
         }
     }
@@ -690,7 +694,7 @@ void har_spawn_oil(object *obj, vec2i pos, int amount, float gravity, int layer)
     // burning oil
     for(int i = 0; i < amount; i++) {
         // Calculate velocity etc.
-        float rv = rand_int(100) / 100.0f - 0.5;
+        float rv = random_int(&obj->gs->rand, 100) / 100.0f - 0.5;
         float velx = (5 * cosf(90 + i - (amount) / 2 + rv)) * object_get_direction(obj);
         float vely = -12 * sinf(i / amount + rv);
 
@@ -700,7 +704,7 @@ void har_spawn_oil(object *obj, vec2i pos, int amount, float gravity, int layer)
             vely += 0.21;
 
         // Create the object
-        object *scrap = omf_calloc(1, sizeof(object));
+        object *scrap = object_alloc();
         int anim_no = ANIM_BURNING_OIL;
         object_create(scrap, obj->gs, pos, vec2f_create(velx, vely));
         object_set_animation(scrap, &af_get_move(h->af_data, anim_no)->ani);
@@ -743,7 +747,7 @@ void har_spawn_scrap(object *obj, vec2i pos, int amount) {
     }
     for(int i = 0; i < scrap_amount; i++) {
         // Calculate velocity etc.
-        float rv = rand_int(100) / 100.0f - 0.5;
+        float rv = random_int(&obj->gs->rand, 100) / 100.0f - 0.5;
         float velx = (5 * cosf(90 + i - (scrap_amount) / 2 + rv)) * object_get_direction(obj);
         float vely = -12 * sinf(i / scrap_amount + rv);
 
@@ -759,8 +763,8 @@ void har_spawn_scrap(object *obj, vec2i pos, int amount) {
             vely += 0.21;
 
         // Create the object
-        object *scrap = omf_calloc(1, sizeof(object));
-        int anim_no = rand_int(3) + ANIM_SCRAP_METAL;
+        object *scrap = object_alloc();
+        int anim_no = random_int(&obj->gs->rand, 3) + ANIM_SCRAP_METAL;
         object_create(scrap, obj->gs, pos, vec2f_create(velx, vely));
         object_set_animation(scrap, &af_get_move(h->af_data, anim_no)->ani);
         object_set_stl(scrap, object_get_stl(obj));
@@ -791,7 +795,7 @@ void har_block(object *obj, vec2i hit_coord) {
         // don't make another scrape
         return;
     }
-    object *scrape = omf_calloc(1, sizeof(object));
+    object *scrape = object_alloc();
     object_create(scrape, obj->gs, hit_coord, vec2f_create(0, 0));
     object_set_animation(scrape, &af_get_move(h->af_data, ANIM_BLOCKING_SCRAPE)->ani);
     object_set_stl(scrape, object_get_stl(obj));
@@ -1024,11 +1028,11 @@ void har_collide_with_har(object *obj_a, object *obj_b, int loop) {
     }
     if(a->damage_done == 0 &&
        (intersect_sprite_hitpoint(obj_a, obj_b, level, &hit_coord) || move->category == CAT_CLOSE ||
-        (player_frame_isset(obj_a, "ue") && b->state != STATE_JUMPING))) {
+        (player_frame_isset(obj_a, SD_TAG_UE) && b->state != STATE_JUMPING))) {
 
         if(har_is_blocking(b, move) &&
            // earthquake smash is unblockable
-           !player_frame_isset(obj_a, "ue")) {
+           !player_frame_isset(obj_a, SD_TAG_UE)) {
             har_event_enemy_block(a, move, false, ctrl_a);
             har_event_block(b, move, false, ctrl_b);
             har_block(obj_b, hit_coord);
@@ -1181,11 +1185,11 @@ void har_collide_with_projectile(object *o_har, object *o_pjt) {
         h->damage_received = 1;
 
         // Exception case for chronos' time freeze
-        if(player_frame_isset(o_pjt, "af")) {
+        if(player_frame_isset(o_pjt, SD_TAG_AF)) {
             h->in_stasis_ticks = 75;
         }
 
-        if(player_frame_isset(o_pjt, "uz")) {
+        if(player_frame_isset(o_pjt, SD_TAG_UZ)) {
             // associate this with the enemy HAR
             h->linked_obj = o_pjt->id;
             projectile_link_object(o_pjt, o_har);
@@ -1222,7 +1226,7 @@ void har_collide_with_hazard(object *o_har, object *o_hzd) {
     }
 
     // Check if collisions are switched off for the hazard
-    if(player_frame_isset(o_hzd, "n")) {
+    if(player_frame_isset(o_hzd, SD_TAG_N)) {
         return;
     }
 
@@ -1348,13 +1352,13 @@ void har_tick(object *obj) {
 
     // See if we are being grabbed. We detect this by checking the
     // "e" tag -- force to enemy position.
-    h->is_grabbed = player_frame_isset(obj, "e");
+    h->is_grabbed = player_frame_isset(obj, SD_TAG_E);
 
     // Make sure HAR doesn't walk through walls
     // TODO: Roof!
     vec2i pos = object_get_pos(obj);
     if(h->state != STATE_DEFEAT) {
-        int wall_flag = player_frame_isset(obj, "aw");
+        int wall_flag = player_frame_isset(obj, SD_TAG_AW);
         int wall = 0;
         int hit = 0;
         if(pos.x < ARENA_LEFT_WALL) {
@@ -1381,13 +1385,13 @@ void har_tick(object *obj) {
     }
 
     // Check for HAR specific palette tricks
-    if(player_frame_isset(obj, "ptr")) {
-        h->p_pal_ref = player_frame_isset(obj, "pd") ? player_frame_get(obj, "pd") : 0;
-        h->p_har_switch = player_frame_isset(obj, "pe");
-        h->p_color_ref = player_frame_get(obj, "ptr");
-        h->p_ticks_length = player_frame_isset(obj, "pp") ? player_frame_get(obj, "pp") : 0;
+    if(player_frame_isset(obj, SD_TAG_PTR)) {
+        h->p_pal_ref = player_frame_isset(obj, SD_TAG_PD) ? player_frame_get(obj, SD_TAG_PD) : 0;
+        h->p_har_switch = player_frame_isset(obj, SD_TAG_PE);
+        h->p_color_ref = player_frame_get(obj, SD_TAG_PTR);
+        h->p_ticks_length = player_frame_isset(obj, SD_TAG_PP) ? player_frame_get(obj, SD_TAG_PP) : 0;
         h->p_ticks_left = h->p_ticks_length;
-        h->p_color_fn = player_frame_isset(obj, "pa");
+        h->p_color_fn = player_frame_isset(obj, SD_TAG_PA);
     }
 
     // Object took walldamage, but has now landed
@@ -1457,7 +1461,7 @@ void har_tick(object *obj) {
         sprite *cur_sprite = animation_get_sprite(obj->cur_animation, obj->cur_sprite_id);
         sprite *nsp = sprite_copy(cur_sprite);
         surface_flatten_to_mask(nsp->data, 1);
-        object *nobj = omf_calloc(1, sizeof(object));
+        object *nobj = object_alloc();
         object_create(nobj, obj->gs, object_get_pos(obj), vec2f_create(0, 0));
         object_set_stl(nobj, object_get_stl(obj));
         object_set_animation(nobj, create_animation_from_single(nsp, obj->cur_animation->start_pos));
@@ -1482,19 +1486,21 @@ void har_tick(object *obj) {
     }
 }
 
-void add_input_to_buffer(char *buf, char c) {
-    // only add it if it is not the current head of the array
-    if(buf[0] == c) {
+void add_input_to_buffer(input_history *buf, char c) {
+    // only add it if it is not the current head of the history
+    if(buf->count > 0 && buf->keys[buf->head] == c) {
         return;
     }
 
-    // use memmove to move everything over one spot in the array, leaving the first slot free
-    memmove((buf) + 1, buf, 9);
-    // write the new first element
-    buf[0] = c;
+    // step the head back over the oldest input, and write the new one there
+    buf->head = (buf->head + HAR_INPUT_HISTORY - 1) % HAR_INPUT_HISTORY;
+    buf->keys[buf->head] = c;
+    if(buf->count < HAR_INPUT_HISTORY) {
+        buf->count++;
+    }
 }
 
-void add_input(char *buf, int act_type, int direction) {
+void add_input(input_history *buf, int act_type, int direction) {
     // for the reason behind the numbers, look at a numpad sometime
     switch(act_type) {
         case ACT_UP:
@@ -1557,118 +1563,122 @@ void add_input(char *buf, int act_type, int direction) {
     }
 }
 
-af_move *match_move(object *obj, char *inputs) {
+af_move *match_move(object *obj, const input_history *inputs) {
     har *h = object_get_userdata(obj);
     af_move *move = NULL;
-    size_t len;
-    for(int i = 0; i < 70; i++) {
-        if((move = af_get_move(h->af_data, i))) {
-            len = move->move_string.len;
-            if(!strncmp(str_c(&move->move_string), inputs, len)) {
-                if(move->category == CAT_CLOSE && h->close != 1) {
-                    // not standing close enough
-                    continue;
-                }
-                if(move->category == CAT_JUMPING && h->state != STATE_JUMPING) {
-                    // not jumping
-                    continue;
-                }
-                if(move->category != CAT_JUMPING && h->state == STATE_JUMPING) {
-                    // jumping but this move is not a jumping move
-                    continue;
-                }
-                if(move->category == CAT_SCRAP && h->state != STATE_VICTORY) {
-                    continue;
-                }
 
-                if(move->category == CAT_DESTRUCTION && h->state != STATE_SCRAP) {
-                    continue;
-                }
+    // Unroll the history newest input first, which is the order move strings are written in.
+    char keys[HAR_INPUT_HISTORY];
+    for(int k = 0; k < inputs->count; k++) {
+        keys[k] = inputs->keys[(inputs->head + k) % HAR_INPUT_HISTORY];
+    }
 
-                if(move->category == CAT_FIRE_ICE) {
-                    continue;
-                }
+    // Only the moves whose string matches the inputs need to be checked against the HAR state.
+    uint8_t candidates[AF_MOVE_COUNT];
+    int candidate_count = af_match_moves(h->af_data, keys, inputs->count, candidates);
+    for(int c = 0; c < candidate_count; c++) {
+        int i = candidates[c];
+        move = af_get_move(h->af_data, i);
+        if(move->category == CAT_CLOSE && h->close != 1) {
+            // not standing close enough
+            continue;
+        }
+        if(move->category == CAT_JUMPING && h->state != STATE_JUMPING) {
+            // not jumping
+            continue;
+        }
+        if(move->category != CAT_JUMPING && h->state == STATE_JUMPING) {
+            // jumping but this move is not a jumping move
+            continue;
+        }
+        if(move->category == CAT_SCRAP && h->state != STATE_VICTORY) {
+            continue;
+        }
 
-                if(h->state != STATE_JUMPING && move->pos_constraints & 0x2) {
-                    DEBUG("Position contraint prevents move when not jumping!");
-                    // required to be jumping
-                    continue;
-                }
-                if(h->is_wallhugging != 1 && move->pos_constraints & 0x1) {
-                    DEBUG("Position contraint prevents move when not wallhugging!");
-                    // required to be wall hugging
-                    continue;
-                }
+        if(move->category == CAT_DESTRUCTION && h->state != STATE_SCRAP) {
+            continue;
+        }
 
-                if(h->executing_move && !h->enqueued) {
-                    // check if the current frame allows chaining
-                    int allowed = 0;
-                    if(player_frame_isset(obj, "jn") && i == player_frame_get(obj, "jn")) {
-                        allowed = 1;
-                    } else {
-                        switch(move->category) {
-                            case CAT_LOW:
-                                if(player_frame_isset(obj, "jl")) {
-                                    allowed = 1;
-                                }
-                                break;
-                            case CAT_MEDIUM:
-                                if(player_frame_isset(obj, "jm")) {
-                                    allowed = 1;
-                                }
-                                break;
-                            case CAT_HIGH:
-                                if(player_frame_isset(obj, "jh")) {
-                                    allowed = 1;
-                                }
-                                break;
-                            case CAT_SCRAP:
-                                if(player_frame_isset(obj, "jf")) {
-                                    allowed = 1;
-                                }
-                                break;
-                            case CAT_DESTRUCTION:
-                                if(player_frame_isset(obj, "jf2")) {
-                                    allowed = 1;
-                                }
-                                break;
-                        }
-                    }
-                    if(player_get_current_tick(obj) >= player_get_len_ticks(obj)) {
-                        DEBUG("enqueueing %d %s", i, str_c(&move->move_string));
-                        h->enqueued = i;
-                        return NULL;
-                    }
+        if(move->category == CAT_FIRE_ICE) {
+            continue;
+        }
 
-                    if(!allowed) {
-                        // not allowed
-                        continue;
-                    }
-                    DEBUG("CHAINING");
+        if(h->state != STATE_JUMPING && move->pos_constraints & 0x2) {
+            DEBUG("Position contraint prevents move when not jumping!");
+            // required to be jumping
+            continue;
+        }
+        if(h->is_wallhugging != 1 && move->pos_constraints & 0x1) {
+            DEBUG("Position contraint prevents move when not wallhugging!");
+            // required to be wall hugging
+            continue;
+        }
+
+        if(h->executing_move && !h->enqueued) {
+            // check if the current frame allows chaining
+            int allowed = 0;
+            if(player_frame_isset(obj, SD_TAG_JN) && i == player_frame_get(obj, SD_TAG_JN)) {
+                allowed = 1;
+            } else {
+                switch(move->category) {
+                    case CAT_LOW:
+                        if(player_frame_isset(obj, SD_TAG_JL)) {
+                            allowed = 1;
+                        }
+                        break;
+                    case CAT_MEDIUM:
+                        if(player_frame_isset(obj, SD_TAG_JM)) {
+                            allowed = 1;
+                        }
+                        break;
+                    case CAT_HIGH:
+                        if(player_frame_isset(obj, SD_TAG_JH)) {
+                            allowed = 1;
+                        }
+                        break;
+                    case CAT_SCRAP:
+                        if(player_frame_isset(obj, SD_TAG_JF)) {
+                            allowed = 1;
+                        }
+                        break;
+                    case CAT_DESTRUCTION:
+                        if(player_frame_isset(obj, SD_TAG_JF2)) {
+                            allowed = 1;
+                        }
+                        break;
                 }
+            }
+            if(player_get_current_tick(obj) >= player_get_len_ticks(obj)) {
+                DEBUG("enqueueing %d %s", i, str_c(&move->move_string));
+                h->enqueued = i;
+                return NULL;
+            }
 
-                DEBUG("matched move %d with string %s", i, str_c(&move->move_string));
-                /*DEBUG("input was %s", h->inputs);*/
-                return move;
+            if(!allowed) {
+                // not allowed
+                continue;
             }
+            DEBUG("CHAINING");
         }
+
+        DEBUG("matched move %d with string %s", i, str_c(&move->move_string));
+        /*DEBUG("input was %s", h->inputs);*/
+        return move;
     }
     return NULL;
 }
 
-af_move *scrap_destruction_cheat(object *obj, char *inputs) {
+af_move *scrap_destruction_cheat(object *obj, const input_history *inputs) {
     har *h = object_get_userdata(obj);
-    for(int i = 0; i < 70; i++) {
-        af_move *move;
-        if((move = af_get_move(h->af_data, i))) {
-            if(move->category == CAT_SCRAP && h->state == STATE_VICTORY && inputs[0] == 'K') {
-                return move;
-            }
-
-            if(move->category == CAT_DESTRUCTION && h->state == STATE_SCRAP && inputs[0] == 'P') {
-                return move;
-            }
-        }
+    if(inputs->count == 0) {
+        return NULL;
+    }
+    char newest = inputs->keys[inputs->head];
+    if(h->state == STATE_VICTORY && newest == 'K') {
+        return af_get_first_move_in_category(h->af_data, CAT_SCRAP);
+    }
+    if(h->state == STATE_SCRAP && newest == 'P') {
+        return af_get_first_move_in_category(h->af_data, CAT_DESTRUCTION);
     }
     return NULL;
 }
@@ -1733,7 +1743,7 @@ int har_act(object *obj, int act_type) {
 
     int direction = object_get_direction(obj);
     // always queue input, I guess
-    add_input(h->inputs, act_type, direction);
+    add_input(&h->inputs, act_type, direction);
 
     if(!(h->state == STATE_STANDING || har_is_walking(h) || har_is_crouching(h) || h->state == STATE_JUMPING ||
          h->state == STATE_VICTORY || h->state == STATE_SCRAP) ||
@@ -1755,11 +1765,11 @@ int har_act(object *obj, int act_type) {
 
     int oldstate = h->state;
 
-    af_move *move = match_move(obj, h->inputs);
+    af_move *move = match_move(obj, &h->inputs);
 
     if(game_state_get_player(obj->gs, h->player_id)->ez_destruct && move == NULL &&
        (h->state == STATE_VICTORY || h->state == STATE_SCRAP)) {
-        move = scrap_destruction_cheat(obj, h->inputs);
+        move = scrap_destruction_cheat(obj, &h->inputs);
     }
 
     if(move) {
@@ -1828,7 +1838,7 @@ int har_act(object *obj, int act_type) {
         // Set correct animation etc.
         // executing_move = 1 prevents new moves while old one is running.
         har_set_ani(obj, move->id, 0);
-        h->inputs[0] = '\0';
+        h->inputs.count = 0;
         h->executing_move = 1;
 
         // Move flag is on -- make the HAR move backwards to avoid overlap.
@@ -1888,7 +1898,7 @@ int har_act(object *obj, int act_type) {
     if(h->executing_move) {
         if(obj->pos.y < ARENA_FLOOR) {
             // XXX I think 'i' is for 'not interruptable'
-            if(h->state < STATE_JUMPING && !player_frame_isset(obj, "i")) {
+            if(h->state < STATE_JUMPING && !player_frame_isset(obj, SD_TAG_I)) {
                 DEBUG("standing move led to airborne one");
                 h->state = STATE_JUMPING;
             } else if(h->state != STATE_JUMPING) {
@@ -2087,7 +2097,7 @@ void har_install_hook(har *h, har_hook_cb hook, void *data) {
 }
 
 int har_clone(object *src, object *dst) {
-    har *local = omf_calloc(1, sizeof(har));
+    har *local = pool_alloc(&har_pool);
     memcpy(local, object_get_userdata(src), sizeof(har));
     list_create(&local->har_hooks);
     object_set_userdata(dst, local);
@@ -2098,14 +2108,64 @@ int har_clone(object *src, object *dst) {
 int har_clone_free(object *obj) {
     har *har = object_get_userdata(obj);
     list_free(&har->har_hooks);
-    omf_free(har);
+    pool_release(&har_pool, har);
     object_set_userdata(obj, NULL);
     return 0;
 }
 
+int har_serialize(object *obj, serial *ser) {
+    serial_write(ser, (const char *)object_get_userdata(obj), sizeof(har));
+    return 0;
+}
+
+int har_unserialize(object *obj, serial *ser) {
+    har *local = pool_alloc(&har_pool);
+    serial_read(ser, (char *)local, sizeof(har));
+    list_create(&local->har_hooks);
+    object_set_userdata(obj, local);
+    object_set_spawn_cb(obj, cb_har_spawn_object, local);
+    return 0;
+}
+
+void har_hash(const object *obj, hash64_state *h) {
+    const har *har = obj->userdata;
+    hash64_update_u32(h, har->state);
+    hash64_update_u32(h, har->executing_move);
+    hash64_update_u32(h, har->flinching);
+    hash64_update_u32(h, har->close);
+    hash64_update_u32(h, har->hard_close);
+    hash64_update_u32(h, har->enqueued);
+    hash64_update_u32(h, har->damage_done);
+    hash64_update_u32(h, har->damage_received);
+    hash64_update_u32(h, har->air_attacked);
+    hash64_update_u32(h, har->is_wallhugging);
+    hash64_update_u32(h, har->is_grabbed);
+    hash64_update_float(h, har->last_damage_value);
+    hash64_update_u32(h, har->in_stasis_ticks);
+    hash64_update_u32(h, har->health);
+    hash64_update_u32(h, har->health_max);
+    hash64_update_float(h, har->endurance);
+    hash64_update_float(h, har->endurance_max);
+    hash64_update_u32(h, har->stun_timer);
+    hash64_update_u32(h, har->delay);
+    game_state_hash_object_ref(obj->gs, h, har->linked_obj);
+    hash64_update(h, har->inputs.keys, sizeof(har->inputs.keys));
+    hash64_update_u32(h, har->inputs.head);
+    hash64_update_u32(h, har->inputs.count);
+    for(int i = 0; i < OBJECT_EVENT_BUFFER_SIZE; i++) {
+        const action_buffer *buf = &har->act_buf[i];
+        hash64_update(h, buf->actions, buf->count < sizeof(buf->actions) ? buf->count : sizeof(buf->actions));
+        hash64_update_u32(h, buf->count);
+        hash64_update_u32(h, buf->age);
+    }
+}
+
 void har_bootstrap(object *obj) {
     obj->clone = har_clone;
     obj->clone_free = har_clone_free;
+    obj->serialize = har_serialize;
+    obj->unserialize = har_unserialize;
+    obj->hash = har_hash;
 }
 
 void har_copy_actions(object *new, object *old) {
@@ -2116,7 +2176,7 @@ void har_copy_actions(object *new, object *old) {
 
 int har_create(object *obj, af *af_data, int dir, int har_id, int pilot_id, int player_id) {
     // Create local data
-    har *local = omf_calloc(1, sizeof(har));
+    har *local = pool_alloc(&har_pool);
     object_set_userdata(obj, local);
     har_bootstrap(obj);
 
@@ -2214,8 +2274,9 @@ int har_create(object *obj, af *af_data, int dir, int har_id, int pilot_id, int
     object_set_stride(obj, local->stride);
 
     // fill the input buffer with 'pauses'
-    memset(local->inputs, '5', 10);
-    local->inputs[10] = '\0';
+    memset(local->inputs.keys, '5', HAR_INPUT_HISTORY);
+    local->inputs.head = 0;
+    local->inputs.count = HAR_INPUT_HISTORY;
 
     // Callbacks and userdata
     object_set_free_cb(obj, har_free);
@@ -2327,7 +2388,6 @@ void har_reset(object *obj) {
     h->air_attacked = 0;
     h->is_wallhugging = 0;
     h->is_grabbed = 0;
-    h->inputs[10] = '\0';
     h->health = h->health_max;
     h->endurance = h->endurance_max;
 
@@ -118,6 +118,15 @@ typedef struct action_buffer_t {
     uint32_t age;
 } action_buffer;
 
+#define HAR_INPUT_HISTORY 10
+
+// Latest inputs as numpad directions, K and P. Kept as a ring, newest input at head.
+typedef struct input_history_t {
+    char keys[HAR_INPUT_HISTORY];
+    uint8_t head;
+    uint8_t count;
+} input_history;
+
 typedef struct game_player_t game_player;
 
 typedef struct har_t {
@@ -148,7 +157,7 @@ typedef struct har_t {
     uint8_t stride;
     int16_t health_max, health;
     float endurance_max, endurance;
-    char inputs[11];
+    input_history inputs;
     uint8_t hard_close;
 
     uint8_t stun_timer;
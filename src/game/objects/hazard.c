@@ -34,7 +34,8 @@ void hazard_tick(object *obj) {
             float mag;
             int limit = 10;
             do {
-                obj->orbit_dest = vec2f_create(rand_float() * 320.0f, rand_float() * 200.0f);
+                float x = random_float(&obj->gs->rand) * 320.0f;
+                obj->orbit_dest = vec2f_create(x, random_float(&obj->gs->rand) * 200.0f);
                 obj->orbit_dest_dir = vec2f_sub(obj->orbit_dest, obj->orbit_pos);
                 mag = sqrtf(obj->orbit_dest_dir.x * obj->orbit_dest_dir.x +
                             obj->orbit_dest_dir.y * obj->orbit_dest_dir.y);
@@ -53,7 +54,7 @@ void hazard_spawn_cb(object *parent, int id, vec2i pos, vec2f vel, uint8_t mp_fl
     // Get next animation
     bk_info *info = bk_get_info(sc->bk_data, id);
     if(info != NULL) {
-        object *obj = omf_calloc(1, sizeof(object));
+        object *obj = object_alloc();
         object_create(obj, parent->gs, vec2i_add(pos, info->ani.start_pos), vec2f_create(0, 0));
         object_set_stl(obj, object_get_stl(parent));
         object_set_animation(obj, &info->ani);
@@ -75,10 +76,15 @@ void hazard_spawn_cb(object *parent, int id, vec2i pos, vec2f vel, uint8_t mp_fl
     }
 }
 
-vec2f generate_destination(vec2f old) {
-    vec2f new = vec2f_create((rand_float() * 280.0f) + 20.0f, (rand_float() * 160.0f) + 20.0f);
+static vec2f random_destination(game_state *gs) {
+    float x = (random_float(&gs->rand) * 280.0f) + 20.0f;
+    return vec2f_create(x, (random_float(&gs->rand) * 160.0f) + 20.0f);
+}
+
+vec2f generate_destination(game_state *gs, vec2f old) {
+    vec2f new = random_destination(gs);
     while(vec2f_dist(old, new) < 100) {
-        new = vec2f_create((rand_float() * 280.0f) + 20.0f, (rand_float() * 160.0f) + 20.0f);
+        new = random_destination(gs);
     }
     return new;
 }
@@ -121,7 +127,7 @@ void hazard_move(object *obj) {
            (dist(obj->pos.y, obj->orbit_pos.y) >= dist(obj->orbit_dest.y, obj->orbit_pos.y))) {
             obj->orbit_pos.x = obj->pos.x;
             obj->orbit_pos.y = obj->pos.y;
-            obj->orbit_dest = generate_destination(obj->orbit_dest);
+            obj->orbit_dest = generate_destination(obj->gs, obj->orbit_dest);
             DEBUG("new position is %f, %f", obj->orbit_dest.x, obj->orbit_dest.y);
         }
 
@@ -182,7 +188,7 @@ int hazard_create(object *obj, scene *scene) {
 
     obj->orbit_pos.x = obj->pos.x;
     obj->orbit_pos.y = obj->pos.y;
-    obj->orbit_dest = vec2f_create((rand_float() * 280.0f) + 20.0f, (rand_float() * 160.0f) + 20.0f);
+    obj->orbit_dest = random_destination(obj->gs);
     DEBUG("new position is %f, %f", obj->orbit_dest.x, obj->orbit_dest.y);
 
     return 0;
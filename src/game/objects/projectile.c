@@ -4,6 +4,7 @@
 #include "game/objects/arena_constraints.h"
 #include "utils/allocator.h"
 #include "utils/log.h"
+#include "utils/pool.h"
 #include <stdlib.h>
 
 #define IS_ZERO(n) (n < 0.1 && n > -0.1)
@@ -18,6 +19,8 @@ typedef struct projectile_local_t {
     uint32_t linked_obj;
 } projectile_local;
 
+static pool projectile_pool = POOL_INIT("projectile", projectile_local, 32);
+
 void projectile_tick(object *obj) {
     projectile_local *local = object_get_userdata(obj);
 
@@ -40,7 +43,7 @@ void projectile_tick(object *obj) {
 
 void projectile_free(object *obj) {
     projectile_local *local = object_get_userdata(obj);
-    omf_free(local);
+    pool_release(&projectile_pool, local);
     object_set_userdata(obj, NULL);
 }
 
@@ -90,7 +93,7 @@ void projectile_move(object *obj) {
 }
 
 int projectile_clone(object *src, object *dst) {
-    projectile_local *local = omf_calloc(1, sizeof(projectile_local));
+    projectile_local *local = pool_alloc(&projectile_pool);
     memcpy(local, object_get_userdata(src), sizeof(projectile_local));
     object_set_userdata(dst, local);
     return 0;
@@ -98,14 +101,36 @@ int projectile_clone(object *src, object *dst) {
 
 int projectile_clone_free(object *obj) {
     projectile_local *local = object_get_userdata(obj);
-    omf_free(local);
+    pool_release(&projectile_pool, local);
     object_set_userdata(obj, NULL);
     return 0;
 }
 
+int projectile_serialize(object *obj, serial *ser) {
+    serial_write(ser, (const char *)object_get_userdata(obj), sizeof(projectile_local));
+    return 0;
+}
+
+int projectile_unserialize(object *obj, serial *ser) {
+    projectile_local *local = pool_alloc(&projectile_pool);
+    serial_read(ser, (char *)local, sizeof(projectile_local));
+    object_set_userdata(obj, local);
+    return 0;
+}
+
+void projectile_hash(const object *obj, hash64_state *h) {
+    const projectile_local *local = obj->userdata;
+    hash64_update_u32(h, local->player_id);
+    hash64_update_u32(h, local->wall_bounce);
+    hash64_update_u32(h, local->ground_freeze);
+    hash64_update_u32(h, local->invincible);
+    hash64_update_u32(h, local->has_hit);
+    game_state_hash_object_ref(obj->gs, h, local->linked_obj);
+}
+
 int projectile_create(object *obj, har *har) {
     // strore the HAR in local userdata instead
-    projectile_local *local = omf_calloc(1, sizeof(projectile_local));
+    projectile_local *local = pool_alloc(&projectile_pool);
     local->player_id = har->player_id;
     local->wall_bounce = 0;
     local->ground_freeze = 0;
@@ -119,6 +144,9 @@ int projectile_create(object *obj, har *har) {
     object_set_move_cb(obj, projectile_move);
     obj->clone = projectile_clone;
     obj->clone_free = projectile_clone_free;
+    obj->serialize = projectile_serialize;
+    obj->unserialize = projectile_unserialize;
+    obj->hash = projectile_hash;
     return 0;
 }
 
@@ -1,6 +1,8 @@
 #include <assert.h>
+#include <stdlib.h>
 
 #include "game/protos/intersect.h"
+#include "utils/miscmath.h"
 
 /**
  * \brief Checks if objects hitboxes intersect.
@@ -85,14 +87,14 @@ int intersect_sprite_hitpoint(object *obj, object *target, int level, vec2i *poi
     vec2i size_a = object_get_size(obj);
     vec2i size_b = object_get_size(target);
 
-    if((object_get_direction(obj) == OBJECT_FACE_LEFT && !player_frame_isset(obj, "r")) ||
-       (object_get_direction(obj) == OBJECT_FACE_RIGHT && player_frame_isset(obj, "r"))) {
+    if((object_get_direction(obj) == OBJECT_FACE_LEFT && !player_frame_isset(obj, SD_TAG_R)) ||
+       (object_get_direction(obj) == OBJECT_FACE_RIGHT && player_frame_isset(obj, SD_TAG_R))) {
         object_dir = OBJECT_FACE_LEFT;
         pos_a.x = object_get_pos(obj).x + ((cur_sprite->pos.x * -1) - size_a.x);
     }
 
-    if((object_get_direction(target) == OBJECT_FACE_LEFT && !player_frame_isset(target, "r")) ||
-       (object_get_direction(target) == OBJECT_FACE_RIGHT && player_frame_isset(target, "r"))) {
+    if((object_get_direction(target) == OBJECT_FACE_LEFT && !player_frame_isset(target, SD_TAG_R)) ||
+       (object_get_direction(target) == OBJECT_FACE_RIGHT && player_frame_isset(target, SD_TAG_R))) {
         target_dir = OBJECT_FACE_LEFT;
         pos_b.x = object_get_pos(target).x + ((target_sprite->pos.x * -1) - size_b.x);
     }
@@ -149,3 +151,62 @@ int intersect_sprite_hitpoint(object *obj, object *target, int level, vec2i *poi
 
     return 0;
 }
+
+/**
+ * \brief Finds the horizontal range an object can touch on its current frame.
+ *
+ * The range covers the current sprite in both facings (R tag flips the facing, so we do not try
+ * to guess it here) and every hitpoint of the current frame. Anything that
+ * intersect_sprite_hitpoint can report between two objects lies within both of their ranges,
+ * so objects whose ranges do not overlap can never hit each other.
+ *
+ * \param obj Object to check
+ * \param left Leftmost reachable x coordinate
+ * \param right Rightmost reachable x coordinate
+ * \return 1 if the object has a sprite, 0 if it cannot touch anything.
+ */
+int intersect_object_reach(object *obj, int *left, int *right) {
+    if(obj->cur_sprite_id < 0) {
+        return 0;
+    }
+    sprite *cur_sprite = animation_get_sprite(obj->cur_animation, obj->cur_sprite_id);
+    if(cur_sprite == NULL) {
+        return 0;
+    }
+    int pos_x = object_get_pos(obj).x;
+    int size_x = object_get_size(obj).x;
+    int right_x = pos_x + cur_sprite->pos.x;
+    int left_x = pos_x - cur_sprite->pos.x - size_x;
+    *left = min2(right_x, left_x);
+    *right = max2(right_x, left_x) + size_x;
+
+    // Hitpoints end up at pos.x +- hitpoint x, depending on facing.
+    iterator it;
+    collision_coord *cc;
+    vector_iter_begin(&obj->cur_animation->collision_coords, &it);
+    while((cc = iter_next(&it)) != NULL) {
+        if(cc->frame_index != obj->cur_sprite_id)
+            continue;
+        int reach = abs(cc->pos.x);
+        *left = min2(*left, pos_x - reach);
+        *right = max2(*right, pos_x + reach);
+    }
+    return 1;
+}
+
+/**
+ * \brief Checks if the horizontal reach of two objects overlaps.
+ *
+ * This is a cheap rejection test for collision handling; see intersect_object_reach.
+ *
+ * \param a Object 1 to check
+ * \param b Object 2 to check
+ * \return 1 if the objects might collide, 0 if they cannot.
+ */
+int intersect_reach_overlap(object *a, object *b) {
+    int a_left, a_right, b_left, b_right;
+    if(!intersect_object_reach(a, &a_left, &a_right) || !intersect_object_reach(b, &b_left, &b_right)) {
+        return 0;
+    }
+    return a_left <= b_right && b_left <= a_right;
+}
@@ -10,5 +10,7 @@
 int intersect_object_object(object *a, object *b);
 int intersect_object_point(object *obj, vec2i point);
 int intersect_sprite_hitpoint(object *obj, object *target, int level, vec2i *point);
+int intersect_object_reach(object *obj, int *left, int *right);
+int intersect_reach_overlap(object *a, object *b);
 
 #endif // INTERSECT_H
@@ -6,6 +6,7 @@
 #include "utils/compat.h"
 #include "utils/log.h"
 #include "utils/miscmath.h"
+#include "utils/pool.h"
 #include "video/vga_state.h"
 #include "video/video.h"
 #include <stdlib.h>
@@ -15,6 +16,27 @@
 
 static uint32_t object_id = 1;
 
+// Objects that get spawned and thrown away during gameplay (projectiles, scrap, rollback copies, ...)
+static pool object_pool = POOL_INIT("object", object, 64);
+
+/** \brief Allocates a zeroed object from the object pool.
+ * Pooled objects must be given back with object_release, not omf_free.
+ */
+object *object_alloc(void) {
+    return pool_alloc(&object_pool);
+}
+
+/** \brief Releases the memory of an object. Works for both pooled and omf_calloc'd objects.
+ * \param obj Object handle. Must already be freed with object_free or object_clone_free.
+ */
+void object_release(object *obj) {
+    if(pool_owns(&object_pool, obj)) {
+        pool_release(&object_pool, obj);
+    } else {
+        omf_free(obj);
+    }
+}
+
 /** \brief Creates a new, empty object.
  * \param obj Object handle
  * \param gs Game state handle
@@ -73,7 +95,8 @@ void object_create(object *obj, game_state *gs, vec2i pos, vec2f vel) {
 
     obj->custom_str = NULL;
 
-    random_seed(&obj->rand_state, rand_intmax());
+    // Drawn from the game state, so that the peers of a network game and replays give objects the same seeds
+    random_seed(&obj->rand_state, random_intmax(&gs->rand));
 
     // For enabling hit on the current and the next n-1 frames
     obj->hit_frames = 0;
@@ -92,6 +115,9 @@ void object_create(object *obj, game_state *gs, vec2i pos, vec2f vel) {
     obj->debug = NULL;
     obj->clone = NULL;
     obj->clone_free = NULL;
+    obj->serialize = NULL;
+    obj->unserialize = NULL;
+    obj->hash = NULL;
 }
 
 int object_clone(object *src, object *dst, game_state *gs) {
@@ -114,6 +140,166 @@ int object_clone(object *src, object *dst, game_state *gs) {
     return 0;
 }
 
+/**
+ * Object owned animations (eg. shadow trails) get freed with the object, so snapshots need their own copy.
+ * The index of the sprite holding cur_surface is stored too, so that the pointer can be fixed up on restore.
+ */
+static void serialize_owned_animation(object *obj, serial *ser) {
+    int32_t cur_surface_index = -1;
+    for(int i = 0; i < animation_get_sprite_count(obj->cur_animation); i++) {
+        if(animation_get_sprite(obj->cur_animation, i)->data == obj->cur_surface) {
+            cur_surface_index = i;
+            break;
+        }
+    }
+    animation_serialize(obj->cur_animation, ser);
+    serial_write(ser, (const char *)&cur_surface_index, sizeof(cur_surface_index));
+}
+
+static void unserialize_owned_animation(object *obj, serial *ser) {
+    int32_t cur_surface_index;
+    obj->cur_animation = omf_calloc(1, sizeof(animation));
+    animation_unserialize(obj->cur_animation, ser);
+    serial_read(ser, (char *)&cur_surface_index, sizeof(cur_surface_index));
+    if(cur_surface_index >= 0) {
+        obj->cur_surface = animation_get_sprite(obj->cur_animation, cur_surface_index)->data;
+    }
+}
+
+/**
+ * Write the full object state to a flat buffer. Compared to object_clone this does no allocations
+ * (besides growing the buffer), so it is cheap enough to do on every rollback checkpoint.
+ *
+ * Userdata is written by the serialize callback, if one is set. Objects without one keep sharing the
+ * userdata pointer, just like object_clone does.
+ */
+int object_serialize(object *obj, serial *ser) {
+    serial_write(ser, (const char *)obj, sizeof(object));
+    player_serialize(obj, ser);
+
+    uint32_t len = obj->custom_str ? strlen(obj->custom_str) + 1 : 0;
+    serial_write(ser, (const char *)&len, sizeof(len));
+    if(len > 0) {
+        serial_write(ser, obj->custom_str, len);
+    }
+
+    if(obj->cur_animation_own == OWNER_OBJECT) {
+        serialize_owned_animation(obj, ser);
+    }
+
+    if(obj->serialize) {
+        obj->serialize(obj, ser);
+    }
+    return 0;
+}
+
+/**
+ * Rebuild an object written by object_serialize.
+ *
+ * \param obj Object to fill. Old contents are overwritten, not freed.
+ * \param ser Buffer to read from
+ * \param gs Game state the object will belong to
+ */
+int object_unserialize(object *obj, serial *ser, game_state *gs) {
+    serial_read(ser, (char *)obj, sizeof(object));
+    obj->gs = gs;
+    player_unserialize(obj, ser);
+
+    uint32_t len;
+    serial_read(ser, (char *)&len, sizeof(len));
+    obj->custom_str = NULL;
+    if(len > 0) {
+        obj->custom_str = omf_calloc(len, 1);
+        serial_read(ser, obj->custom_str, len);
+    }
+
+    if(obj->cur_animation_own == OWNER_OBJECT) {
+        unserialize_owned_animation(obj, ser);
+    }
+
+    if(obj->unserialize) {
+        obj->unserialize(obj, ser);
+    }
+    return 0;
+}
+
+static void hash_vec2f(hash64_state *h, vec2f v) {
+    hash64_update_float(h, v.x);
+    hash64_update_float(h, v.y);
+}
+
+/**
+ * Hash the simulation state of the object for desync detection. Unlike object_serialize, only values are
+ * hashed and never pointers, so the result is the same on every machine that runs the same simulation.
+ * Object ids differ between machines, so the object's own id is left out and references to other objects
+ * are hashed with game_state_hash_object_ref. Rendering only state (video effects, surfaces, palette
+ * transforms) is left out.
+ *
+ * Userdata is hashed by the hash callback, if one is set.
+ */
+void object_hash(const object *obj, hash64_state *h) {
+    hash_vec2f(h, obj->start);
+    hash_vec2f(h, obj->pos);
+    hash_vec2f(h, obj->vel);
+    hash64_update_float(h, obj->vertical_velocity_modifier);
+    hash64_update_float(h, obj->horizontal_velocity_modifier);
+    hash64_update_u32(h, obj->direction);
+    hash64_update_u32(h, obj->group);
+    hash64_update_u32(h, obj->hit_frames);
+    hash64_update_u32(h, obj->can_hit);
+    hash64_update_u32(h, obj->orbit);
+    hash64_update_float(h, obj->orbit_tick);
+    hash_vec2f(h, obj->orbit_dest);
+    hash_vec2f(h, obj->orbit_dest_dir);
+    hash_vec2f(h, obj->orbit_pos);
+    hash_vec2f(h, obj->orbit_pos_vary);
+    hash64_update_u32(h, obj->rand_state.seed);
+    hash64_update_float(h, obj->x_percent);
+    hash64_update_float(h, obj->y_percent);
+    hash64_update_float(h, obj->gravity);
+    hash64_update_u32(h, obj->cur_animation ? obj->cur_animation->id : -1);
+    hash64_update_u32(h, obj->cur_sprite_id);
+    hash64_update_u32(h, obj->sprite_override);
+    game_state_hash_object_ref(obj->gs, h, obj->attached_to_id);
+    hash64_update_u32(h, obj->halt);
+    hash64_update_u32(h, obj->halt_ticks);
+    hash64_update_u32(h, obj->stride);
+    hash64_update_u32(h, obj->age);
+
+    const player_sprite_state *sprite = &obj->sprite_state;
+    hash64_update_u32(h, sprite->timer);
+    hash64_update_u32(h, sprite->duration);
+    hash64_update_u32(h, sprite->o_correction.x);
+    hash64_update_u32(h, sprite->o_correction.y);
+    hash64_update_u32(h, sprite->dir_correction);
+    hash64_update_u32(h, sprite->disable_gravity);
+    hash_vec2f(h, obj->slide_state.vel);
+    hash64_update_u32(h, obj->slide_state.timer);
+    hash64_update_u32(h, obj->enemy_slide_state.dest.x);
+    hash64_update_u32(h, obj->enemy_slide_state.dest.y);
+    hash64_update_u32(h, obj->enemy_slide_state.timer);
+    hash64_update_u32(h, obj->enemy_slide_state.duration);
+
+    // Animation cursor
+    const player_animation_state *anim = &obj->animation_state;
+    hash64_update_u32(h, anim->previous_tick);
+    hash64_update_u32(h, anim->current_tick);
+    hash64_update_u32(h, anim->previous);
+    hash64_update_u32(h, anim->entered_frame);
+    hash64_update_u32(h, anim->repeat);
+    hash64_update_u32(h, anim->reverse);
+    hash64_update_u32(h, anim->finished);
+    hash64_update_u32(h, anim->disable_d);
+    game_state_hash_object_ref(obj->gs, h, anim->enemy_obj_id);
+
+    if(obj->custom_str) {
+        hash64_update(h, obj->custom_str, strlen(obj->custom_str));
+    }
+    if(obj->hash) {
+        obj->hash(obj, h);
+    }
+}
+
 // FIXME: This was removed in HEAD, not sure why or what is the replacement
 // TODO: GET RID
 void object_create_static(object *obj, game_state *gs) {
@@ -5,6 +5,7 @@
 #include "game/utils/serial.h"
 #include "resources/animation.h"
 #include "resources/sprite.h"
+#include "utils/hash64.h"
 #include "utils/hashmap.h"
 #include "utils/random.h"
 #include "utils/vec.h"
@@ -59,6 +60,9 @@ typedef void (*object_finish_cb)(object *obj);
 typedef void (*object_debug_cb)(object *obj);
 typedef int (*object_clone_cb)(object *src, object *dst);
 typedef int (*object_clone_free_cb)(object *obj);
+typedef int (*object_serialize_cb)(object *obj, serial *ser);
+typedef int (*object_unserialize_cb)(object *obj, serial *ser);
+typedef void (*object_hash_cb)(const object *obj, hash64_state *h);
 
 struct object_t {
     uint32_t id;
@@ -136,8 +140,13 @@ struct object_t {
     object_debug_cb debug;
     object_clone_cb clone;
     object_clone_free_cb clone_free;
+    object_serialize_cb serialize;
+    object_unserialize_cb unserialize;
+    object_hash_cb hash;
 };
 
+object *object_alloc(void);
+void object_release(object *obj);
 void object_create(object *obj, game_state *gs, vec2i pos, vec2f vel);
 void object_create_static(object *obj, game_state *gs);
 void object_render(object *obj);
@@ -155,6 +164,9 @@ void object_free(object *obj);
 
 int object_clone(object *src, object *dst, game_state *gs);
 int object_clone_free(object *obj);
+int object_serialize(object *obj, serial *ser);
+int object_unserialize(object *obj, serial *ser, game_state *gs);
+void object_hash(const object *obj, hash64_state *h);
 
 void object_attach_to(object *obj, const object *attach_to);
 
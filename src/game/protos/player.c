@@ -2,14 +2,15 @@
 #include <math.h>
 
 #include "audio/audio.h"
-#include "formats/error.h"
 #include "formats/script.h"
 #include "game/game_player.h"
 #include "game/game_state.h"
 #include "game/protos/object.h"
 #include "game/protos/player.h"
+#include "game/utils/script_cache.h"
 #include "game/utils/settings.h"
 #include "resources/ids.h"
+#include "utils/allocator.h"
 #include "utils/log.h"
 #include "utils/miscmath.h"
 #include "utils/random.h"
@@ -31,28 +32,128 @@ static void player_clear_frame(object *obj) {
 void player_create(object *obj) {
     memset(&obj->animation_state, 0, sizeof(player_animation_state));
     obj->animation_state.previous_tick = -1;
-    sd_script_create(&obj->animation_state.parser);
+    obj->animation_state.parser = script_cache_acquire("");
+    obj->animation_state.own_parser = NULL;
     player_clear_frame(obj);
 }
 
 void player_clone(object *src, object *dst) {
-    sd_script_clone(&src->animation_state.parser, &dst->animation_state.parser);
+    if(src->animation_state.own_parser) {
+        dst->animation_state.own_parser = omf_calloc(1, sizeof(sd_script));
+        sd_script_clone(src->animation_state.own_parser, dst->animation_state.own_parser);
+        dst->animation_state.parser = dst->animation_state.own_parser;
+    } else {
+        script_cache_retain(src->animation_state.parser);
+    }
+}
+
+static void player_release_script(object *obj) {
+    if(obj->animation_state.own_parser) {
+        sd_script_free(obj->animation_state.own_parser);
+        omf_free(obj->animation_state.own_parser);
+    } else if(obj->animation_state.parser) {
+        script_cache_release(obj->animation_state.parser);
+    }
+    obj->animation_state.parser = NULL;
+}
+
+/**
+ * Cached scripts are shared, so before the script can be modified the object needs a copy of its own.
+ */
+static sd_script *player_get_own_script(object *obj) {
+    if(obj->animation_state.own_parser == NULL) {
+        sd_script *script = omf_calloc(1, sizeof(sd_script));
+        sd_script_clone(obj->animation_state.parser, script);
+        script_cache_release(obj->animation_state.parser);
+        obj->animation_state.own_parser = script;
+        obj->animation_state.parser = script;
+    }
+    return obj->animation_state.own_parser;
+}
+
+/**
+ * Shared scripts are written as the animation string they were decoded from; restoring them is just a
+ * cache lookup. Modified scripts are written as a flat run of frames and tags. Tag keys and descriptions
+ * point to the static taglist, so the tag structs can be stored as-is.
+ */
+void player_serialize(const object *obj, serial *ser) {
+    const sd_script *script = obj->animation_state.parser;
+    uint8_t own = obj->animation_state.own_parser != NULL;
+    serial_write(ser, (const char *)&own, sizeof(own));
+    if(!own) {
+        const char *str = script_cache_get_str(script);
+        uint32_t len = strlen(str) + 1;
+        serial_write(ser, (const char *)&len, sizeof(len));
+        serial_write(ser, str, len);
+        return;
+    }
+
+    uint32_t frame_count = vector_size(&script->frames);
+    serial_write(ser, (const char *)&frame_count, sizeof(frame_count));
+    for(uint32_t i = 0; i < frame_count; i++) {
+        const sd_script_frame *frame = vector_get(&script->frames, i);
+        uint32_t tag_count = vector_size(&frame->tags);
+        serial_write(ser, (const char *)&frame->sprite, sizeof(frame->sprite));
+        serial_write(ser, (const char *)&frame->tick_len, sizeof(frame->tick_len));
+        serial_write(ser, (const char *)&tag_count, sizeof(tag_count));
+        if(tag_count > 0) {
+            serial_write(ser, vector_get(&frame->tags, 0), tag_count * sizeof(sd_script_tag));
+        }
+    }
+}
+
+/**
+ * Rebuild the animation script written by player_serialize. Any old contents of the script pointers
+ * are considered stale (eg. copied over from a snapshot), and are not freed.
+ */
+void player_unserialize(object *obj, serial *ser) {
+    uint8_t own;
+    serial_read(ser, (char *)&own, sizeof(own));
+    obj->animation_state.own_parser = NULL;
+    if(!own) {
+        uint32_t len;
+        serial_read(ser, (char *)&len, sizeof(len));
+        char *str = omf_calloc(len, 1);
+        serial_read(ser, str, len);
+        obj->animation_state.parser = script_cache_acquire(str);
+        omf_free(str);
+        return;
+    }
+
+    sd_script *script = omf_calloc(1, sizeof(sd_script));
+    uint32_t frame_count;
+    serial_read(ser, (char *)&frame_count, sizeof(frame_count));
+    sd_script_create(script);
+    for(uint32_t i = 0; i < frame_count; i++) {
+        int sprite, tick_len;
+        uint32_t tag_count;
+        serial_read(ser, (char *)&sprite, sizeof(sprite));
+        serial_read(ser, (char *)&tick_len, sizeof(tick_len));
+        serial_read(ser, (char *)&tag_count, sizeof(tag_count));
+
+        sd_script_append_frame(script, tick_len, sprite);
+        sd_script_frame *frame = vector_get(&script->frames, i);
+        for(uint32_t k = 0; k < tag_count; k++) {
+            sd_script_tag tag;
+            serial_read(ser, (char *)&tag, sizeof(tag));
+            vector_append(&frame->tags, &tag);
+        }
+        sd_script_frame_compile(frame);
+    }
+    obj->animation_state.own_parser = script;
+    obj->animation_state.parser = script;
 }
 
 void player_free(object *obj) {
-    sd_script_free(&obj->animation_state.parser);
+    player_release_script(obj);
 }
 
 void player_reload_with_str(object *obj, const char *custom_str) {
-    // Free and reload parser
-    sd_script_free(&obj->animation_state.parser);
-    sd_script_create(&obj->animation_state.parser);
-    int ret;
-    int err_pos;
-    ret = sd_script_decode(&obj->animation_state.parser, custom_str, &err_pos);
-    if(ret != SD_SUCCESS) {
-        PERROR("Decoder error %s at position %d in string \"%s\"", sd_get_error(ret), err_pos, custom_str);
-    }
+    // Swap to the decoded script of the new string. Acquire first, in case it is the same script.
+    const sd_script *script = script_cache_acquire(custom_str);
+    player_release_script(obj);
+    obj->animation_state.parser = script;
+    obj->animation_state.frame_cursor = 0;
 
     // Set player state
     player_reset(obj);
@@ -78,16 +179,30 @@ void player_reset(object *obj) {
     obj->animation_state.disable_d = 0;
 }
 
-int player_frame_isset(const object *obj, const char *tag) {
-    const sd_script_frame *frame =
-        sd_script_get_frame_at(&obj->animation_state.parser, obj->animation_state.current_tick);
-    return sd_script_isset(frame, tag);
+// Index of the frame at the current tick. The frame cursor is used as a hint, but not moved.
+static int player_current_frame_index(const player_animation_state *state) {
+    return sd_script_get_frame_index_near(state->parser, state->current_tick, state->frame_cursor);
 }
 
-int player_frame_get(const object *obj, const char *tag) {
-    const sd_script_frame *frame =
-        sd_script_get_frame_at(&obj->animation_state.parser, obj->animation_state.current_tick);
-    return sd_script_get(frame, tag);
+// Find the frame at the current tick, and move the frame cursor to it.
+static const sd_script_frame *player_update_cursor(player_animation_state *state) {
+    int index = player_current_frame_index(state);
+    if(index >= 0) {
+        state->frame_cursor = index;
+    }
+    return sd_script_get_frame(state->parser, index);
+}
+
+int player_frame_isset(const object *obj, sd_tag_id tag) {
+    const player_animation_state *state = &obj->animation_state;
+    const sd_script_frame *frame = sd_script_get_frame(state->parser, player_current_frame_index(state));
+    return sd_script_isset_id(frame, tag);
+}
+
+int player_frame_get(const object *obj, sd_tag_id tag) {
+    const player_animation_state *state = &obj->animation_state;
+    const sd_script_frame *frame = sd_script_get_frame(state->parser, player_current_frame_index(state));
+    return sd_script_get_id(frame, tag);
 }
 
 /*
@@ -95,7 +210,7 @@ int player_frame_get(const object *obj, const char *tag) {
  */
 void player_set_delay(object *obj, int delay) {
     // find the first frame that spawns a projectile, if any
-    int r = sd_script_next_frame_with_tag(&obj->animation_state.parser, "m", 0);
+    int r = sd_script_next_frame_with_tag_id(obj->animation_state.parser, SD_TAG_M, 0);
     int frames = (r >= 0) ? r : 99;
 
     // find the first frame with hit coordinates
@@ -103,7 +218,7 @@ void player_set_delay(object *obj, int delay) {
     collision_coord *cc;
     vector_iter_begin(&obj->cur_animation->collision_coords, &it);
     while((cc = iter_next(&it)) != NULL) {
-        r = sd_script_next_frame_with_sprite(&obj->animation_state.parser, cc->frame_index, 0);
+        r = sd_script_next_frame_with_sprite(obj->animation_state.parser, cc->frame_index, 0);
         frames = (r >= 0 && r < frames) ? r : frames;
     }
 
@@ -117,7 +232,7 @@ void player_set_delay(object *obj, int delay) {
     int delay_per_frame = delay / frames;
     int rem = delay % frames;
     for(int i = 0; i < frames; i++) {
-        int duration = sd_script_get_tick_len_at_frame(&obj->animation_state.parser, i);
+        int duration = sd_script_get_tick_len_at_frame(obj->animation_state.parser, i);
         int old_dur = duration;
         int new_duration = duration + delay_per_frame;
         if(rem) {
@@ -125,8 +240,8 @@ void player_set_delay(object *obj, int delay) {
             rem--;
         }
 
-        sd_script_set_tick_len_at_frame(&obj->animation_state.parser, i, new_duration);
-        duration = sd_script_get_tick_len_at_frame(&obj->animation_state.parser, i);
+        sd_script_set_tick_len_at_frame(player_get_own_script(obj), i, new_duration);
+        duration = sd_script_get_tick_len_at_frame(obj->animation_state.parser, i);
         DEBUG("changed duration of frame %d from %d to %d", i, old_dur, duration);
     }
 }
@@ -161,7 +276,7 @@ void player_describe_object(object *obj) {
 
 void player_describe_mp_flags(const sd_script_frame *frame, int mp) {
     if(mp != 0) {
-        DEBUG("mp flags set for new animation %d:", sd_script_get(frame, "m"));
+        DEBUG("mp flags set for new animation %d:", sd_script_get_id(frame, SD_TAG_M));
         if(mp & 0x1)
             DEBUG(" * 0x01: NON-HAR Sprite");
         if(mp & 0x2)
@@ -191,13 +306,13 @@ void player_run(object *obj) {
     if(state->finished)
         return;
 
-    const sd_script_frame *frame = sd_script_get_frame_at(&state->parser, state->current_tick);
+    const sd_script_frame *frame = player_update_cursor(state);
 
     // Animation has ended ?
     if(frame == NULL) {
         if(state->repeat) {
             player_reset(obj);
-            frame = sd_script_get_frame_at(&state->parser, state->current_tick);
+            frame = player_update_cursor(state);
         } else if(obj->finish != NULL) {
             obj->cur_sprite_id = -1;
             state->finished = 1;
@@ -214,23 +329,26 @@ void player_run(object *obj) {
     assert(frame != NULL);
 
     // Get MP flag content, set to 0 if not set.
-    uint8_t mp = sd_script_isset(frame, "mp") ? sd_script_get(frame, "mp") & 0xFF : 0;
+    uint8_t mp = sd_script_isset_id(frame, SD_TAG_MP) ? sd_script_get_id(frame, SD_TAG_MP) & 0xFF : 0;
 
     // See if x+/- or y+/- are set and save values
     int trans_x = 0, trans_y = 0;
-    if(sd_script_isset(frame, "y-")) {
-        trans_y = sd_script_get(frame, "y-") * -1;
-    } else if(sd_script_isset(frame, "y+")) {
-        trans_y = sd_script_get(frame, "y+");
+    if(sd_script_isset_id(frame, SD_TAG_Y_MINUS)) {
+        trans_y = sd_script_get_id(frame, SD_TAG_Y_MINUS) * -1;
+    } else if(sd_script_isset_id(frame, SD_TAG_Y_PLUS)) {
+        trans_y = sd_script_get_id(frame, SD_TAG_Y_PLUS);
     }
-    if(sd_script_isset(frame, "x-")) {
-        trans_x = sd_script_get(frame, "x-") * -1 * object_get_direction(obj);
-    } else if(sd_script_isset(frame, "x+")) {
-        trans_x = sd_script_get(frame, "x+") * object_get_direction(obj);
+    if(sd_script_isset_id(frame, SD_TAG_X_MINUS)) {
+        trans_x = sd_script_get_id(frame, SD_TAG_X_MINUS) * -1 * object_get_direction(obj);
+    } else if(sd_script_isset_id(frame, SD_TAG_X_PLUS)) {
+        trans_x = sd_script_get_id(frame, SD_TAG_X_PLUS) * object_get_direction(obj);
     }
 
     // Check if frame changed from the previous tick
-    state->entered_frame = sd_script_frame_changed(&state->parser, state->previous_tick, state->current_tick);
+    // The previous tick is normally on the current frame or a neighbour, so the cursor makes this cheap.
+    state->entered_frame =
+        state->previous_tick != state->current_tick &&
+        sd_script_get_frame_index_near(state->parser, state->previous_tick, state->frame_cursor) != state->frame_cursor;
     if(state->entered_frame) {
 #ifdef DEBUGMODE
         // player_describe_frame(frame);
@@ -239,11 +357,11 @@ void player_run(object *obj) {
 #endif
         player_clear_frame(obj);
 
-        if(sd_script_isset(frame, "ar")) {
+        if(sd_script_isset_id(frame, SD_TAG_AR)) {
             rstate->dir_correction = -1;
         }
 
-        if(sd_script_isset(frame, "cf")) {
+        if(sd_script_isset_id(frame, SD_TAG_CF)) {
             // shadow's scrap, position is in the corner behind shadow
             if(object_get_direction(obj) == OBJECT_FACE_RIGHT) {
                 obj->pos.x = 0;
@@ -254,7 +372,7 @@ void player_run(object *obj) {
             obj->animation_state.shadow_corner_hack = 1;
         }
 
-        if(sd_script_isset(frame, "ac")) {
+        if(sd_script_isset_id(frame, SD_TAG_AC)) {
             // force the har to face the center of the arena
             if(obj->pos.x > 160) {
                 object_set_direction(obj, OBJECT_FACE_LEFT);
@@ -263,8 +381,8 @@ void player_run(object *obj) {
             }
         }
 
-        /*if (sd_script_isset(frame, "bm")) {
-            if (sd_script_isset(frame, "am") && sd_script_isset(frame, "e")) {
+        /*if (sd_script_isset_id(frame, SD_TAG_BM)) {
+            if (sd_script_isset_id(frame, SD_TAG_AM) && sd_script_isset_id(frame, SD_TAG_E)) {
                 // destination is the enemy's position
                 DEBUG("BE tag with x/y offsets: %d %d %d %d", trans_x, trans_y, object_get_direction(obj),
         object_get_direction(state->enemy)); DEBUG("enemy x %d modified trans_x: %d (%d * %d * %d)",
@@ -276,7 +394,7 @@ void player_run(object *obj) {
                 // hack because we don't have 'walk to other HAR' implemented
                 obj->pos.x = state->enemy->pos.x + (trans_x * object_get_direction(obj) *
         object_get_direction(state->enemy)); obj->pos.y = state->enemy->pos.y + trans_y; } else if
-        (sd_script_isset(frame, "cf")) {
+        (sd_script_isset_id(frame, SD_TAG_CF)) {
                 // shadow's scrap, position is in the corner behind shadow
                 if (object_get_direction(obj) == OBJECT_FACE_RIGHT) {
                     obj->pos.x = 0;
@@ -292,7 +410,7 @@ void player_run(object *obj) {
         }*/
     }
 
-    if(sd_script_isset(frame, "e") && enemy) {
+    if(sd_script_isset_id(frame, SD_TAG_E) && enemy) {
 
         DEBUG("my position %f, %f, their position %f %f", obj->pos.x, obj->pos.y, enemy->pos.x, enemy->pos.y);
         // Set speed to 0, since we're being controlled by animation tag system
@@ -307,18 +425,18 @@ void player_run(object *obj) {
     }
 
     // Set to ground
-    if(sd_script_isset(frame, "g")) {
+    if(sd_script_isset_id(frame, SD_TAG_G)) {
         obj->vel.y = 0;
         obj->pos.y = ARENA_FLOOR;
     }
 
-    if(sd_script_isset(frame, "h")) {
+    if(sd_script_isset_id(frame, SD_TAG_H)) {
         // Hover, reset all velocities to 0 on every frame
         obj->vel.x = 0;
         obj->vel.y = 0;
     }
 
-    if(sd_script_isset(frame, "at") && enemy) {
+    if(sd_script_isset_id(frame, SD_TAG_AT) && enemy) {
 
         DEBUG("my position %f, %f, their position %f %f", obj->pos.x, obj->pos.y, enemy->pos.x, enemy->pos.y);
         // set the object's X position to be behind the opponent
@@ -333,7 +451,7 @@ void player_run(object *obj) {
 
     // Handle vx+/-, vy+/-, x+/-. y+/-
     if(trans_x || trans_y) {
-        if(sd_script_isset(frame, "v")) {
+        if(sd_script_isset_id(frame, SD_TAG_V)) {
             obj->vel.x = (trans_x * (mp & 0x20 ? -1 : 1)) * obj->horizontal_velocity_modifier;
             obj->vel.y = trans_y * obj->vertical_velocity_modifier;
             // DEBUG("vel x+%d, y+%d to x=%f, y=%f", trans_x * (mp & 0x20 ? -1 : 1), trans_y, obj->vel.x, obj->vel.y);
@@ -364,13 +482,13 @@ void player_run(object *obj) {
     // If frame changed, do something
     if(state->entered_frame) {
         // Animation creation command
-        if(sd_script_isset(frame, "m") && state->spawn != NULL) {
+        if(sd_script_isset_id(frame, SD_TAG_M) && state->spawn != NULL) {
             int mx = 0;
             int my = 0;
             float vx = 0;
             float vy = 0;
 
-            if(obj->animation_state.shadow_corner_hack && sd_script_get(frame, "m") == 65 && enemy) {
+            if(obj->animation_state.shadow_corner_hack && sd_script_get_id(frame, SD_TAG_M) == 65 && enemy) {
 
                 DEBUG("my position %f, %f, their position %f %f", obj->pos.x, obj->pos.y, enemy->pos.x, enemy->pos.y);
                 mx = enemy->pos.x;
@@ -378,107 +496,107 @@ void player_run(object *obj) {
             }
 
             // Staring X coordinate for new animation
-            if(sd_script_isset(frame, "mrx")) {
-                int mrx = sd_script_get(frame, "mrx");
-                int mm = sd_script_isset(frame, "mm") ? sd_script_get(frame, "mm") : mrx;
+            if(sd_script_isset_id(frame, SD_TAG_MRX)) {
+                int mrx = sd_script_get_id(frame, SD_TAG_MRX);
+                int mm = sd_script_isset_id(frame, SD_TAG_MM) ? sd_script_get_id(frame, SD_TAG_MM) : mrx;
                 mx = random_int(&obj->rand_state, 320 - 2 * mm) + mrx;
                 DEBUG("randomized mx as %d", mx);
-            } else if(sd_script_isset(frame, "mx")) {
-                mx = obj->start.x + (sd_script_get(frame, "mx") * object_get_direction(obj));
+            } else if(sd_script_isset_id(frame, SD_TAG_MX)) {
+                mx = obj->start.x + (sd_script_get_id(frame, SD_TAG_MX) * object_get_direction(obj));
             }
 
             // Staring Y coordinate for new animation
-            if(sd_script_isset(frame, "mry")) {
-                int mry = sd_script_get(frame, "mry");
-                int mm = sd_script_isset(frame, "mm") ? sd_script_get(frame, "mm") : mry;
+            if(sd_script_isset_id(frame, SD_TAG_MRY)) {
+                int mry = sd_script_get_id(frame, SD_TAG_MRY);
+                int mm = sd_script_isset_id(frame, SD_TAG_MM) ? sd_script_get_id(frame, SD_TAG_MM) : mry;
                 my = random_int(&obj->rand_state, 320 - 2 * mm) + mry;
                 DEBUG("randomized my as %d", my);
-            } else if(sd_script_isset(frame, "my")) {
-                my = obj->start.y + sd_script_get(frame, "my");
+            } else if(sd_script_isset_id(frame, SD_TAG_MY)) {
+                my = obj->start.y + sd_script_get_id(frame, SD_TAG_MY);
             }
 
             // Angle/speed for new animation
-            if(sd_script_isset(frame, "ma")) {
-                int ma = sd_script_get(frame, "ma");
+            if(sd_script_isset_id(frame, SD_TAG_MA)) {
+                int ma = sd_script_get_id(frame, SD_TAG_MA);
                 vx = cosf(ma);
                 vy = sinf(ma);
                 DEBUG("MA is set! angle = %d, vx = %f, vy = %f", ma, vx, vy);
             }
 
             // Special positioning for certain desert arena sprites
-            int ms = sd_script_isset(frame, "ms");
+            int ms = sd_script_isset_id(frame, SD_TAG_MS);
 
             // Gravity for new object
-            int mg = sd_script_isset(frame, "mg") ? sd_script_get(frame, "mg") : 0;
+            int mg = sd_script_isset_id(frame, SD_TAG_MG) ? sd_script_get_id(frame, SD_TAG_MG) : 0;
 
-            state->spawn(obj, sd_script_get(frame, "m"), vec2i_create(mx, my), vec2f_create(vx, vy), mp, ms, mg,
+            state->spawn(obj, sd_script_get_id(frame, SD_TAG_M), vec2i_create(mx, my), vec2f_create(vx, vy), mp, ms, mg,
                          state->spawn_userdata);
         }
 
         // Animation deletion
-        if(sd_script_isset(frame, "md") && state->destroy != NULL) {
-            state->destroy(obj, sd_script_get(frame, "md"), state->destroy_userdata);
+        if(sd_script_isset_id(frame, SD_TAG_MD) && state->destroy != NULL) {
+            state->destroy(obj, sd_script_get_id(frame, SD_TAG_MD), state->destroy_userdata);
         }
 
         // Music playback
-        if(sd_script_isset(frame, "smo")) {
-            if(sd_script_get(frame, "smo") == 0) {
+        if(sd_script_isset_id(frame, SD_TAG_SMO)) {
+            if(sd_script_get_id(frame, SD_TAG_SMO) == 0) {
                 audio_stop_music();
                 return;
             }
-            audio_play_music(PSM_END + (sd_script_get(frame, "smo") - 1));
+            audio_play_music(PSM_END + (sd_script_get_id(frame, SD_TAG_SMO) - 1));
         }
-        if(sd_script_isset(frame, "smf")) {
+        if(sd_script_isset_id(frame, SD_TAG_SMF)) {
             audio_stop_music();
         }
 
         // Sound playback
-        if(sd_script_isset(frame, "s")) {
+        if(sd_script_isset_id(frame, SD_TAG_S)) {
             float pitch = PITCH_DEFAULT;
             float volume = VOLUME_DEFAULT * (settings_get()->sound.sound_vol / 10.0f);
             float panning = PANNING_DEFAULT;
-            if(sd_script_isset(frame, "sf")) {
-                int p = clamp(sd_script_get(frame, "sf"), -16, 239);
+            if(sd_script_isset_id(frame, SD_TAG_SF)) {
+                int p = clamp(sd_script_get_id(frame, SD_TAG_SF), -16, 239);
                 pitch = clampf((p / 239.0f) * 3.0f + 1.0f, PITCH_MIN, PITCH_MAX);
             }
-            if(sd_script_isset(frame, "l")) {
-                int v = clamp(sd_script_get(frame, "l"), 0, 100);
+            if(sd_script_isset_id(frame, SD_TAG_L)) {
+                int v = clamp(sd_script_get_id(frame, SD_TAG_L), 0, 100);
                 volume = (v / 100.0f) * (settings_get()->sound.sound_vol / 10.0f);
             }
-            if(sd_script_isset(frame, "sb")) {
-                panning = clamp(sd_script_get(frame, "sb"), -100, 100) / 100.0f;
+            if(sd_script_isset_id(frame, SD_TAG_SB)) {
+                panning = clamp(sd_script_get_id(frame, SD_TAG_SB), -100, 100) / 100.0f;
             }
             if(obj->sound_translation_table) {
-                int sound_id = obj->sound_translation_table[sd_script_get(frame, "s")] - 1;
+                int sound_id = obj->sound_translation_table[sd_script_get_id(frame, SD_TAG_S)] - 1;
                 audio_play_sound(sound_id, volume, panning, pitch);
             }
         }
 
         // Blend mode stuff
-        if(sd_script_isset(frame, "bb")) {
-            rstate->screen_shake_vertical = sd_script_get(frame, "bb");
+        if(sd_script_isset_id(frame, SD_TAG_BB)) {
+            rstate->screen_shake_vertical = sd_script_get_id(frame, SD_TAG_BB);
         }
-        if(sd_script_isset(frame, "bf")) {
-            rstate->blend_finish = sd_script_get(frame, "bf");
+        if(sd_script_isset_id(frame, SD_TAG_BF)) {
+            rstate->blend_finish = sd_script_get_id(frame, SD_TAG_BF);
         }
-        if(sd_script_isset(frame, "bl")) {
-            rstate->screen_shake_horizontal = sd_script_get(frame, "bl");
+        if(sd_script_isset_id(frame, SD_TAG_BL)) {
+            rstate->screen_shake_horizontal = sd_script_get_id(frame, SD_TAG_BL);
         }
-        if(sd_script_isset(frame, "bs")) {
-            rstate->blend_start = sd_script_get(frame, "bs");
+        if(sd_script_isset_id(frame, SD_TAG_BS)) {
+            rstate->blend_start = sd_script_get_id(frame, SD_TAG_BS);
         }
 
         // Palette tricks
-        if(sd_script_isset(frame, "bpd")) {
-            rstate->pal_ref_index = sd_script_get(frame, "bpd");
+        if(sd_script_isset_id(frame, SD_TAG_BPD)) {
+            rstate->pal_ref_index = sd_script_get_id(frame, SD_TAG_BPD);
         }
-        if(sd_script_isset(frame, "bpn")) {
-            rstate->pal_entry_count = sd_script_get(frame, "bpn");
+        if(sd_script_isset_id(frame, SD_TAG_BPN)) {
+            rstate->pal_entry_count = sd_script_get_id(frame, SD_TAG_BPN);
         }
-        if(sd_script_isset(frame, "bps")) {
-            rstate->pal_start_index = sd_script_get(frame, "bps");
+        if(sd_script_isset_id(frame, SD_TAG_BPS)) {
+            rstate->pal_start_index = sd_script_get_id(frame, SD_TAG_BPS);
         }
-        if(sd_script_isset(frame, "bpf")) {
+        if(sd_script_isset_id(frame, SD_TAG_BPF)) {
             // Exact values come from master.dat
             if(game_state_get_player(obj->gs, 0)->har_obj_id == obj->id) {
                 rstate->pal_start_index = 1;
@@ -488,45 +606,45 @@ void player_run(object *obj) {
                 rstate->pal_entry_count = 48;
             }
         }
-        if(sd_script_isset(frame, "bpp")) {
-            rstate->pal_end = COLOR_6TO8(sd_script_get(frame, "bpp"));
-            rstate->pal_begin = COLOR_6TO8(sd_script_get(frame, "bpp"));
+        if(sd_script_isset_id(frame, SD_TAG_BPP)) {
+            rstate->pal_end = COLOR_6TO8(sd_script_get_id(frame, SD_TAG_BPP));
+            rstate->pal_begin = COLOR_6TO8(sd_script_get_id(frame, SD_TAG_BPP));
         }
-        if(sd_script_isset(frame, "bpb")) {
-            rstate->pal_begin = COLOR_6TO8(sd_script_get(frame, "bpb"));
+        if(sd_script_isset_id(frame, SD_TAG_BPB)) {
+            rstate->pal_begin = COLOR_6TO8(sd_script_get_id(frame, SD_TAG_BPB));
         }
-        if(sd_script_isset(frame, "bz")) {
+        if(sd_script_isset_id(frame, SD_TAG_BZ)) {
             rstate->pal_tint = 1;
         }
 
         // CREDITS palette copy tricks
-        rstate->pal_tricks_off = sd_script_isset(frame, "bpo") ? 1 : 0; // Disable the standard palette tricks
-        rstate->bd_flag =
-            sd_script_isset(frame, "bd"); // Read palette from the last frame of animation (we emulate this internally)
+        rstate->pal_tricks_off = sd_script_isset_id(frame, SD_TAG_BPO) ? 1 : 0; // Disable the standard palette tricks
+        // Read palette from the last frame of animation (we emulate this internally)
+        rstate->bd_flag = sd_script_isset_id(frame, SD_TAG_BD);
 
         // These are animation-global instead of per-frame.
-        if(sd_script_isset(frame, "ba")) {
-            state->pal_copy_count = sd_script_get(frame, "ba");   // Number of copies to make after bi + bc
-            state->pal_copy_start = sd_script_get(frame, "bi");   // Start offset for copying
-            state->pal_copy_entries = sd_script_get(frame, "bc"); // Number of indexes to copy
+        if(sd_script_isset_id(frame, SD_TAG_BA)) {
+            state->pal_copy_count = sd_script_get_id(frame, SD_TAG_BA);   // Number of copies to make after bi + bc
+            state->pal_copy_start = sd_script_get_id(frame, SD_TAG_BI);   // Start offset for copying
+            state->pal_copy_entries = sd_script_get_id(frame, SD_TAG_BC); // Number of indexes to copy
         }
 
         // Handle position correction
-        if(sd_script_isset(frame, "ox")) {
-            DEBUG("O_CORRECTION: X = %d", sd_script_get(frame, "ox"));
-            rstate->o_correction.x = sd_script_get(frame, "ox");
+        if(sd_script_isset_id(frame, SD_TAG_OX)) {
+            DEBUG("O_CORRECTION: X = %d", sd_script_get_id(frame, SD_TAG_OX));
+            rstate->o_correction.x = sd_script_get_id(frame, SD_TAG_OX);
         } else {
             rstate->o_correction.x = 0;
         }
-        if(sd_script_isset(frame, "oy")) {
-            DEBUG("O_CORRECTION: Y = %d", sd_script_get(frame, "oy"));
-            rstate->o_correction.y = sd_script_get(frame, "oy");
+        if(sd_script_isset_id(frame, SD_TAG_OY)) {
+            DEBUG("O_CORRECTION: Y = %d", sd_script_get_id(frame, SD_TAG_OY));
+            rstate->o_correction.y = sd_script_get_id(frame, SD_TAG_OY);
         } else {
             rstate->o_correction.y = 0;
         }
 
         // If UA is set, force other HAR to damage animation
-        if(sd_script_isset(frame, "ua") && enemy && enemy->cur_animation->id != 9) {
+        if(sd_script_isset_id(frame, SD_TAG_UA) && enemy && enemy->cur_animation->id != 9) {
 
             DEBUG("my position %f, %f, their position %f %f", obj->pos.x, obj->pos.y, enemy->pos.x, enemy->pos.y);
             har_set_ani(enemy, 9, 0);
@@ -535,13 +653,13 @@ void player_run(object *obj) {
         // XXX BJ tag invalidates frame, and probably doesn't do what it's supposed to.
 #if 0
         // BJ sets new animation for our HAR
-        if(sd_script_isset(frame, "bj")) {
-            int new_ani = sd_script_get(frame, "bj");
+        if(sd_script_isset_id(frame, SD_TAG_BJ)) {
+            int new_ani = sd_script_get_id(frame, SD_TAG_BJ);
             har_set_ani(obj, new_ani, 0);
         }
 #endif
 
-        if(sd_script_isset(frame, "bu") && obj->vel.y < 0.0f) {
+        if(sd_script_isset_id(frame, SD_TAG_BU) && obj->vel.y < 0.0f) {
             float x_dist = dist(obj->pos.x, 160);
             // assume that bu is used in conjunction with 'vy-X' and that we want to land in the center of the arena
             obj->slide_state.vel.x = x_dist / (obj->vel.y * -2);
@@ -549,25 +667,25 @@ void player_run(object *obj) {
         }
 
         // handle scaling on the Y axis
-        if(sd_script_isset(frame, "y")) {
-            obj->y_percent = sd_script_get(frame, "y") / 100.0f;
+        if(sd_script_isset_id(frame, SD_TAG_Y)) {
+            obj->y_percent = sd_script_get_id(frame, SD_TAG_Y) / 100.0f;
         }
 
         // Handle slides
-        if(sd_script_isset(frame, "x=") || sd_script_isset(frame, "y=")) {
+        if(sd_script_isset_id(frame, SD_TAG_X_EQ) || sd_script_isset_id(frame, SD_TAG_Y_EQ)) {
             obj->slide_state.vel = vec2f_create(0, 0);
         }
-        if(sd_script_isset(frame, "x=")) {
-            obj->pos.x = obj->start.x + (sd_script_get(frame, "x=") * object_get_direction(obj));
+        if(sd_script_isset_id(frame, SD_TAG_X_EQ)) {
+            obj->pos.x = obj->start.x + (sd_script_get_id(frame, SD_TAG_X_EQ) * object_get_direction(obj));
 
             // Find frame ID by tick
-            int frame_id = sd_script_next_frame_with_tag(&state->parser, "x=", state->current_tick);
+            int frame_id = sd_script_next_frame_with_tag_id(state->parser, SD_TAG_X_EQ, state->current_tick);
 
             // Handle it!
             if(frame_id >= 0) {
-                int mr = sd_script_get_tick_pos_at_frame(&state->parser, frame_id);
+                int mr = sd_script_get_tick_pos_at_frame(state->parser, frame_id);
                 int r = mr - state->current_tick - frame->tick_len;
-                int next_x = sd_script_get(sd_script_get_frame(&state->parser, frame_id), "x=");
+                int next_x = sd_script_get_id(sd_script_get_frame(state->parser, frame_id), SD_TAG_X_EQ);
                 int slide = obj->start.x + (next_x * object_get_direction(obj));
                 if(slide != obj->pos.x) {
                     obj->slide_state.vel.x = dist(obj->pos.x, slide) / (float)(frame->tick_len + r);
@@ -581,17 +699,17 @@ void player_run(object *obj) {
                 }
             }
         }
-        if(sd_script_isset(frame, "y=")) {
-            obj->pos.y = obj->start.y + sd_script_get(frame, "y=");
+        if(sd_script_isset_id(frame, SD_TAG_Y_EQ)) {
+            obj->pos.y = obj->start.y + sd_script_get_id(frame, SD_TAG_Y_EQ);
 
             // Find frame ID by tick
-            int frame_id = sd_script_next_frame_with_tag(&state->parser, "y=", state->current_tick);
+            int frame_id = sd_script_next_frame_with_tag_id(state->parser, SD_TAG_Y_EQ, state->current_tick);
 
             // handle it!
             if(frame_id >= 0) {
-                int mr = sd_script_get_tick_pos_at_frame(&state->parser, frame_id);
+                int mr = sd_script_get_tick_pos_at_frame(state->parser, frame_id);
                 int r = mr - state->current_tick - frame->tick_len;
-                int next_y = sd_script_get(sd_script_get_frame(&state->parser, frame_id), "y=");
+                int next_y = sd_script_get_id(sd_script_get_frame(state->parser, frame_id), SD_TAG_Y_EQ);
                 int slide = next_y + obj->start.y;
                 if(slide != obj->pos.y) {
                     obj->slide_state.vel.y = dist(obj->pos.y, slide) / (float)(frame->tick_len + r);
@@ -605,15 +723,15 @@ void player_run(object *obj) {
                 }
             }
         }
-        if(sd_script_isset(frame, "as")) {
+        if(sd_script_isset_id(frame, SD_TAG_AS)) {
             // make the object move around the screen in a circular motion until end of frame
             obj->orbit = 1;
         } else {
             obj->orbit = 0;
         }
-        if(sd_script_isset(frame, "q")) {
+        if(sd_script_isset_id(frame, SD_TAG_Q)) {
             // Enable hit on the current and the next n-1 frames.
-            obj->hit_frames = sd_script_get(frame, "q");
+            obj->hit_frames = sd_script_get_id(frame, SD_TAG_Q);
         }
         if(obj->hit_frames > 0) {
             obj->can_hit = 1;
@@ -622,13 +740,13 @@ void player_run(object *obj) {
 
         // Set video effects now.
         int effects = EFFECT_NONE;
-        if(player_frame_isset(obj, "bt"))
+        if(player_frame_isset(obj, SD_TAG_BT))
             effects |= EFFECT_DARK_TINT;
-        if(player_frame_isset(obj, "br"))
+        if(player_frame_isset(obj, SD_TAG_BR))
             effects |= EFFECT_GLOW;
-        if(player_frame_isset(obj, "ub"))
+        if(player_frame_isset(obj, SD_TAG_UB))
             effects |= EFFECT_TRAIL;
-        if(player_frame_isset(obj, "bg"))
+        if(player_frame_isset(obj, SD_TAG_BG))
             effects |= EFFECT_ADD;
         object_set_frame_effects(obj, effects);
 
@@ -636,19 +754,19 @@ void player_run(object *obj) {
         object_select_sprite(obj, frame->sprite);
         if(obj->cur_sprite_id >= 0) {
             rstate->duration = frame->tick_len;
-            if(sd_script_isset(frame, "r") || obj->animation_state.shadow_corner_hack) {
+            if(sd_script_isset_id(frame, SD_TAG_R) || obj->animation_state.shadow_corner_hack) {
                 rstate->flipmode ^= FLIP_HORIZONTAL;
             }
-            if(sd_script_isset(frame, "f")) {
+            if(sd_script_isset_id(frame, SD_TAG_F)) {
                 rstate->flipmode ^= FLIP_VERTICAL;
             }
         }
     }
 
     // Tick management
-    if(sd_script_isset(frame, "d") && !obj->animation_state.disable_d) {
+    if(sd_script_isset_id(frame, SD_TAG_D) && !obj->animation_state.disable_d) {
         state->previous_tick = state->current_tick;
-        state->current_tick = sd_script_get(frame, "d") + 1;
+        state->current_tick = sd_script_get_id(frame, SD_TAG_D) + 1;
         return;
     }
 
@@ -675,7 +793,7 @@ void player_jump_to_tick(object *obj, int tick) {
 
 unsigned int player_get_len_ticks(const object *obj) {
     const player_animation_state *state = &obj->animation_state;
-    return sd_script_get_total_ticks(&state->parser);
+    return sd_script_get_total_ticks(state->parser);
 }
 
 void player_set_repeat(object *obj, int repeat) {
@@ -688,14 +806,14 @@ int player_get_repeat(const object *obj) {
 
 void player_next_frame(object *obj) {
     player_animation_state *state = &obj->animation_state;
-    int current_index = sd_script_get_frame_index_at(&state->parser, state->current_tick);
-    state->current_tick = sd_script_get_tick_pos_at_frame(&state->parser, current_index + 1);
+    int current_index = player_current_frame_index(state);
+    state->current_tick = sd_script_get_tick_pos_at_frame(state->parser, current_index + 1);
     state->previous_tick = state->current_tick - 1;
 }
 
 void player_goto_frame(object *obj, int frame_id) {
     player_animation_state *state = &obj->animation_state;
-    state->current_tick = sd_script_get_tick_pos_at_frame(&state->parser, frame_id);
+    state->current_tick = sd_script_get_tick_pos_at_frame(state->parser, frame_id);
     state->previous_tick = state->current_tick - 1;
 }
 
@@ -704,8 +822,7 @@ uint32_t player_get_current_tick(const object *obj) {
 }
 
 int player_get_frame(const object *obj) {
-    const player_animation_state *state = &obj->animation_state;
-    return sd_script_get_frame_index_at(&state->parser, state->current_tick);
+    return player_current_frame_index(&obj->animation_state);
 }
 
 char player_get_frame_letter(const object *obj) {
@@ -714,5 +831,6 @@ char player_get_frame_letter(const object *obj) {
 
 int player_is_last_frame(const object *obj) {
     const player_animation_state *state = &obj->animation_state;
-    return sd_script_is_last_frame_at(&state->parser, state->current_tick);
+    const sd_script_frame *frame = sd_script_get_frame(state->parser, player_current_frame_index(state));
+    return sd_script_is_last_frame(state->parser, frame);
 }
@@ -3,6 +3,7 @@
 
 #include "formats/script.h"
 #include "game/game_state.h"
+#include "game/utils/serial.h"
 #include "utils/vec.h"
 #include <stdint.h>
 
@@ -53,7 +54,9 @@ typedef struct player_animation_state_t {
     uint32_t current_tick;
     int previous;
     int entered_frame;
-    sd_script parser;
+    const sd_script *parser; // Decoded animation string; shared through the script cache, or own_parser
+    sd_script *own_parser;   // Private copy of the script if this object has modified it, otherwise NULL
+    int frame_cursor;        // Index of the frame at current_tick as of the last lookup; only used as a search hint
     uint8_t repeat;
     uint8_t reverse;
     uint8_t finished;
@@ -73,12 +76,14 @@ typedef struct player_animation_state_t {
 
 void player_create(object *obj);
 void player_clone(object *src, object *dst);
+void player_serialize(const object *obj, serial *ser);
+void player_unserialize(object *obj, serial *ser);
 void player_free(object *obj);
 void player_reload(object *obj);
 void player_reload_with_str(object *obj, const char *str);
 void player_reset(object *obj);
-int player_frame_isset(const object *obj, const char *tag);
-int player_frame_get(const object *obj, const char *tag);
+int player_frame_isset(const object *obj, sd_tag_id tag);
+int player_frame_get(const object *obj, sd_tag_id tag);
 void player_run(object *obj);
 void player_set_repeat(object *obj, int repeat);
 int player_get_repeat(const object *obj);
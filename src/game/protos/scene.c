@@ -46,6 +46,9 @@ int scene_create(scene *scene, game_state *gs, int scene_id) {
     scene->input_poll = NULL;
     scene->startup = NULL;
     scene->prio_override = NULL;
+    scene->serialize = NULL;
+    scene->unserialize = NULL;
+    scene->hash = NULL;
 
     // Set base palette
     vga_state_set_base_palette_from(bk_get_palette(scene->bk_data, 0));
@@ -132,6 +135,30 @@ int scene_clone_free(scene *sc) {
     return 0;
 }
 
+void scene_serialize(scene *sc, serial *ser) {
+    serial_write(ser, (const char *)sc, sizeof(scene));
+    if(sc->serialize) {
+        sc->serialize(sc, ser);
+    }
+}
+
+// Same semantics as scene_clone; scenes without an unserialize callback keep sharing their userdata.
+void scene_unserialize(scene *sc, serial *ser, game_state *gs) {
+    serial_read(ser, (char *)sc, sizeof(scene));
+    sc->gs = gs;
+    if(sc->unserialize) {
+        sc->unserialize(sc, ser);
+    }
+}
+
+// Hash the simulation state of the scene for desync detection; see object_hash.
+void scene_hash(const scene *sc, hash64_state *h) {
+    hash64_update_u32(h, sc->id);
+    if(sc->hash) {
+        sc->hash(sc, h);
+    }
+}
+
 void scene_set_userdata(scene *scene, void *userdata) {
     scene->userdata = userdata;
 }
@@ -266,7 +293,7 @@ void cb_scene_spawn_object(object *parent, int id, vec2i pos, vec2f vel, uint8_t
     // Get next animation
     bk_info *info = bk_get_info(sc->bk_data, id);
     if(info != NULL) {
-        object *obj = omf_calloc(1, sizeof(object));
+        object *obj = object_alloc();
         object_create(obj, parent->gs, vec2i_add(pos, info->ani.start_pos), vel);
         object_set_stl(obj, object_get_stl(parent));
         object_set_animation(obj, &info->ani);
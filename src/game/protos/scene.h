@@ -26,6 +26,9 @@ typedef void (*scene_startup_cb)(scene *scene, int anim_id, int *m_load, int *m_
 typedef int (*scene_anim_prio_override_cb)(scene *scene, int anim_id);
 typedef void (*scene_clone_cb)(scene *src, scene *dst);
 typedef void (*scene_clone_free_cb)(scene *scene);
+typedef void (*scene_serialize_cb)(scene *scene, serial *ser);
+typedef void (*scene_unserialize_cb)(scene *scene, serial *ser);
+typedef void (*scene_hash_cb)(const scene *scene, hash64_state *h);
 
 struct scene_t {
     game_state *gs;
@@ -46,6 +49,9 @@ struct scene_t {
     scene_anim_prio_override_cb prio_override;
     scene_clone_cb clone;
     scene_clone_free_cb clone_free;
+    scene_serialize_cb serialize;
+    scene_unserialize_cb unserialize;
+    scene_hash_cb hash;
     ticktimer tick_timer;
 };
 
@@ -64,6 +70,9 @@ int scene_anim_prio_override(scene *scene, int anim_id);
 
 int scene_clone(scene *src, scene *dst, game_state *gs);
 int scene_clone_free(scene *sc);
+void scene_serialize(scene *sc, serial *ser);
+void scene_unserialize(scene *sc, serial *ser, game_state *gs);
+void scene_hash(const scene *sc, hash64_state *h);
 
 void scene_set_userdata(scene *scene, void *userdata);
 void *scene_get_userdata(const scene *scene);
@@ -64,8 +64,6 @@ typedef struct arena_local_t {
     sd_action rec_last[2];
 } arena_local;
 
-void write_rec_move(scene *scene, game_player *player, int action);
-
 // -------- Local callbacks --------
 
 void game_menu_quit(component *c, void *userdata) {
@@ -312,6 +310,9 @@ void arena_end(scene *sc) {
             PERROR("Failed to save pilot %s", p1->chr->pilot.name);
         }
         game_state_set_next(gs, SCENE_NEWSROOM);
+    } else if(gs->net_mode == NET_MODE_SPECTATE) {
+        // the match was all there was to watch
+        game_state_set_next(gs, SCENE_NONE);
     } else if(is_twoplayer(sc)) {
         game_state_set_next(gs, SCENE_MELEE);
     } else if(gs->net_mode == NET_MODE_LOBBY) {
@@ -499,14 +500,14 @@ void arena_har_hit_wall_hook(int player_id, int wall, scene *scene) {
         // DEBUG("hit dusty wall %d", wall);
         h->state = STATE_WALLDAMAGE;
 
-        int amount = rand_int(2) + 3;
+        int amount = random_int(&scene->gs->rand, 2) + 3;
         for(int i = 0; i < amount; i++) {
-            int variance = rand_int(20) - 10;
-            int anim_no = rand_int(2) + 24;
+            int variance = random_int(&scene->gs->rand, 20) - 10;
+            int anim_no = random_int(&scene->gs->rand, 2) + 24;
             // DEBUG("XXX anim = %d, variance = %d", anim_no, variance);
             int pos_y = o_har->pos.y - object_get_size(o_har).y + variance + i * 25;
             vec2i coord = vec2i_create(o_har->pos.x, pos_y);
-            object *dust = omf_calloc(1, sizeof(object));
+            object *dust = object_alloc();
             object_create(dust, scene->gs, coord, vec2f_create(0, 0));
             object_set_stl(dust, scene->bk_data->sound_translation_table);
             object_set_animation(dust, &bk_get_info(scene->bk_data, anim_no)->ani);
@@ -748,30 +749,6 @@ void maybe_install_har_hooks(scene *scene) {
     har_install_hook(har2, &arena_har_hook, scene);
 }
 
-// djb hash
-uint32_t arena_state_hash(game_state *gs) {
-    uint32_t hash = 5381;
-    for(int i = 0; i < 2; i++) {
-        object *obj_har = game_state_find_object(gs, game_player_get_har_obj_id(game_state_get_player(gs, i)));
-        har *har = obj_har->userdata;
-        vec2i pos = object_get_pos(obj_har);
-        vec2f vel = object_get_vel(obj_har);
-        uint32_t x = (uint32_t)pos.x;
-        uint32_t y = (uint32_t)pos.y;
-        uint32_t health = (uint32_t)har->health;
-        uint32_t endurance = (uint32_t)har->endurance;
-        hash = ((hash << 5) + hash) + x;
-        hash = ((hash << 5) + hash) + y;
-        hash = ((hash << 5) + hash) + health;
-        hash = ((hash << 5) + hash) + endurance;
-        hash = ((hash << 5) + hash) + (uint32_t)vel.x;
-        // hash = ((hash << 5) + hash) + (uint32_t)vel.y;
-        hash = ((hash << 5) + hash) + har->state;
-        hash = ((hash << 5) + hash) + har->executing_move;
-    }
-    return hash;
-}
-
 void arena_state_dump(game_state *gs) {
     for(int i = 0; i < 2; i++) {
         object *obj_har = game_state_find_object(gs, game_player_get_har_obj_id(game_state_get_player(gs, i)));
@@ -873,6 +850,20 @@ void write_rec_move(scene *scene, game_player *player, int action) {
     }
 }
 
+// In a network game with input delay, the network controller applies local inputs once they are due.
+static bool local_input_delayed(scene *scene, game_player *player) {
+    if(player->ctrl->type == CTRL_TYPE_NETWORK) {
+        return false;
+    }
+    for(int i = 0; i < 2; i++) {
+        controller *ctrl = game_player_get_ctrl(game_state_get_player(scene->gs, i));
+        if(ctrl && ctrl->type == CTRL_TYPE_NETWORK && net_controller_input_delay(ctrl) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 int arena_handle_events(scene *scene, game_player *player, ctrl_event *i) {
     int need_sync = 0;
     arena_local *local = scene_get_userdata(scene);
@@ -894,12 +885,16 @@ int arena_handle_events(scene *scene, game_player *player, ctrl_event *i) {
                 DEBUG("menu event %d", i->event_data.action);
                 // menu events
                 guiframe_action(local->game_menu, i->event_data.action);
+            } else if(i->type == EVENT_TYPE_ACTION && local_input_delayed(scene, player)) {
+                // the network controller applies and records it once it is due
+            } else if(i->type == EVENT_TYPE_ACTION && scene->gs->net_mode == NET_MODE_SPECTATE) {
+                // spectators only watch, the spectator controller moves both HARs
             } else if(i->type == EVENT_TYPE_ACTION) {
                 need_sync += object_act(game_state_find_object(scene->gs, game_player_get_har_obj_id(player)),
                                         i->event_data.action);
                 write_rec_move(scene, player, i->event_data.action);
             } else if(i->type == EVENT_TYPE_CLOSE) {
-                if(player->ctrl->type == CTRL_TYPE_REC) {
+                if(player->ctrl->type == CTRL_TYPE_REC || player->ctrl->type == CTRL_TYPE_SPECTATOR) {
                     game_state_set_next(scene->gs, SCENE_NONE);
                 } else {
                     if(scene->gs->net_mode == NET_MODE_LOBBY) {
@@ -924,7 +919,7 @@ void arena_spawn_hazard(scene *scene) {
         if(info->probability > 1) {
             if(random_int(&scene->gs->rand, info->probability) == 1) {
                 // TODO don't spawn it if we already have this animation running
-                object *obj = omf_calloc(1, sizeof(object));
+                object *obj = object_alloc();
                 object_create(obj, scene->gs, info->ani.start_pos, vec2f_create(0, 0));
                 object_set_stl(obj, scene->bk_data->sound_translation_table);
                 object_set_animation(obj, &info->ani);
@@ -955,7 +950,7 @@ void arena_spawn_hazard(scene *scene) {
                     DEBUG("Arena tick: Hazard with probability %d started.", info->probability, info->ani.id);
                 } else {
                     object_free(obj);
-                    omf_free(obj);
+                    object_release(obj);
                 }
             }
         }
@@ -1007,8 +1002,8 @@ void arena_dynamic_tick(scene *scene, int paused) {
         if(local->state == ARENA_STATE_ENDING) {
             chr_score *s1 = game_player_get_score(game_state_get_player(scene->gs, 0));
             chr_score *s2 = game_player_get_score(game_state_get_player(scene->gs, 1));
-            if(player_frame_isset(obj_har[0], "be") || player_frame_isset(obj_har[1], "be") || chr_score_onscreen(s1) ||
-               chr_score_onscreen(s2)) {
+            if(player_frame_isset(obj_har[0], SD_TAG_BE) || player_frame_isset(obj_har[1], SD_TAG_BE) ||
+               chr_score_onscreen(s1) || chr_score_onscreen(s2)) {
             } else {
                 local->ending_ticks++;
             }
@@ -1027,13 +1022,13 @@ void arena_dynamic_tick(scene *scene, int paused) {
 
         // Pour some rein!
         if(local->rein_enabled) {
-            if(rand_float() > 0.65f) {
-                vec2i pos = vec2i_create(rand_int(NATIVE_W), -10);
+            if(random_float(&gs->rand) > 0.65f) {
+                vec2i pos = vec2i_create(random_int(&gs->rand, NATIVE_W), -10);
                 for(int harnum = 0; harnum < game_state_num_players(gs); harnum++) {
                     object *h_obj = game_state_find_object(gs, game_state_get_player(gs, harnum)->har_obj_id);
                     har *h = object_get_userdata(h_obj);
                     // Calculate velocity etc.
-                    float rv = rand_float() - 0.5f;
+                    float rv = random_float(&gs->rand) - 0.5f;
                     float velx = rv;
                     float vely = -12 * sinf(0 / 2 + rv);
 
@@ -1043,8 +1038,8 @@ void arena_dynamic_tick(scene *scene, int paused) {
                         vely += 0.21;
 
                     // Create the object
-                    object *scrap = omf_calloc(1, sizeof(object));
-                    int anim_no = rand_int(3) + ANIM_SCRAP_METAL;
+                    object *scrap = object_alloc();
+                    int anim_no = random_int(&gs->rand, 3) + ANIM_SCRAP_METAL;
                     object_create(scrap, gs, pos, vec2f_create(velx, vely));
                     object_set_animation(scrap, &af_get_move(h->af_data, anim_no)->ani);
                     object_set_gravity(scrap, 0.4f);
@@ -1207,6 +1202,32 @@ void arena_clone(scene *src, scene *dst) {
     maybe_install_har_hooks(dst);
 }
 
+void arena_serialize(scene *scene, serial *ser) {
+    serial_write(ser, (const char *)scene_get_userdata(scene), sizeof(arena_local));
+}
+
+void arena_unserialize(scene *scene, serial *ser) {
+    arena_local *local = omf_calloc(1, sizeof(arena_local));
+    serial_read(ser, (char *)local, sizeof(arena_local));
+    scene->userdata = local;
+    maybe_install_har_hooks(scene);
+}
+
+void arena_hash(const scene *scene, hash64_state *h) {
+    const arena_local *local = scene_get_userdata(scene);
+    hash64_update_u32(h, local->state);
+    hash64_update_u32(h, local->ending_ticks);
+    hash64_update_u32(h, local->round);
+    hash64_update_u32(h, local->rounds);
+    hash64_update_u32(h, local->over);
+    hash64_update_u32(h, local->rein_enabled);
+    for(int i = 0; i < 2; i++) {
+        for(int j = 0; j < 4; j++) {
+            hash64_update_u32(h, local->player_rounds[i][j]);
+        }
+    }
+}
+
 void arena_startup(scene *scene, int id, int *m_load, int *m_repeat) {
     if(scene->bk_data->file_id == 64) {
         // Start up & repeat torches on arena startup
@@ -1429,7 +1450,7 @@ int arena_create(scene *scene) {
     component *speed_slider = textslider_create_bind(
         &tconf, "SPEED", "Change the speed of the game when in the arena. Press left or right to change", 10, 0,
         arena_speed_slide, scene, &setting->gameplay.speed);
-    if(is_netplay(scene)) {
+    if(is_netplay(scene) || scene->gs->net_mode == NET_MODE_SPECTATE) {
         component_disable(speed_slider, 1);
     }
     menu_attach(menu, speed_slider);
@@ -1525,6 +1546,9 @@ int arena_create(scene *scene) {
     scene_set_input_poll_cb(scene, arena_input_tick);
     scene_set_render_overlay_cb(scene, arena_render_overlay);
     scene->clone = arena_clone;
+    scene->serialize = arena_serialize;
+    scene->unserialize = arena_unserialize;
+    scene->hash = arena_hash;
 
     // initialize recording, if enabled
     if(scene->gs->init_flags->record == 1) {
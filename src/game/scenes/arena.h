@@ -16,8 +16,8 @@ void arena_set_state(scene *scene, int state);
 vga_palette *arena_get_player_palette(scene *scene, int player);
 void arena_toggle_rein(scene *scene);
 void maybe_install_har_hooks(scene *scene);
-uint32_t arena_state_hash(game_state *gs);
 void arena_state_dump(game_state *gs);
 void arena_reset(scene *sc);
+void write_rec_move(scene *scene, game_player *player, int action);
 
 #endif // ARENA_H
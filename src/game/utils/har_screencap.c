@@ -31,6 +31,25 @@ int har_screencaps_clone(har_screencaps *src, har_screencaps *dst) {
     return 1;
 }
 
+void har_screencaps_serialize(har_screencaps *caps, serial *ser) {
+    for(int i = 0; i < 2; i++) {
+        if(caps->ok[i]) {
+            serial_write(ser, (const char *)caps->cap[i].data, caps->cap[i].w * caps->cap[i].h);
+        }
+    }
+}
+
+// Expects the ok flags and surface headers to be already restored (as part of the owning game_player).
+void har_screencaps_unserialize(har_screencaps *caps, serial *ser) {
+    for(int i = 0; i < 2; i++) {
+        if(caps->ok[i]) {
+            surface tmp = caps->cap[i];
+            surface_create(&caps->cap[i], tmp.w, tmp.h, tmp.transparent);
+            serial_read(ser, (char *)caps->cap[i].data, tmp.w * tmp.h);
+        }
+    }
+}
+
 static vec2i camera_position_for(object *obj) {
     vec2i size = object_get_size(obj);
     vec2i pos = object_get_pos(obj);
@@ -20,6 +20,8 @@ void har_screencaps_create(har_screencaps *caps);
 void har_screencaps_free(har_screencaps *caps);
 void har_screencaps_reset(har_screencaps *caps);
 int har_screencaps_clone(har_screencaps *src, har_screencaps *dst);
+void har_screencaps_serialize(har_screencaps *caps, serial *ser);
+void har_screencaps_unserialize(har_screencaps *caps, serial *ser);
 void har_screencaps_capture(har_screencaps *caps, object *obj, object *obj2, int id);
 void har_screencaps_compress(har_screencaps *caps, const vga_palette *pal, int id);
 
@@ -0,0 +1,104 @@
+#include "game/utils/object_index.h"
+#include "game/protos/object.h"
+#include "utils/allocator.h"
+
+// Starting amount of slots. Grows when the index gets half full.
+#define OBJECT_INDEX_INITIAL_CAPACITY 64
+
+void object_index_create(object_index *index) {
+    index->capacity = OBJECT_INDEX_INITIAL_CAPACITY;
+    index->count = 0;
+    index->slots = omf_calloc(index->capacity, sizeof(object_index_slot));
+}
+
+void object_index_free(object_index *index) {
+    omf_free(index->slots);
+    index->capacity = 0;
+    index->count = 0;
+}
+
+// Ids are handed out sequentially, so the low bits alone spread the objects evenly.
+static inline uint32_t home_slot(const object_index *index, uint32_t id) {
+    return id & (index->capacity - 1);
+}
+
+static void place(object_index *index, uint32_t id, object *obj) {
+    uint32_t mask = index->capacity - 1;
+    uint32_t i = home_slot(index, id);
+    while(index->slots[i].id != 0 && index->slots[i].id != id) {
+        i = (i + 1) & mask;
+    }
+    if(index->slots[i].id == 0) {
+        index->count++;
+    }
+    index->slots[i].id = id;
+    index->slots[i].obj = obj;
+}
+
+static void grow(object_index *index) {
+    object_index_slot *old_slots = index->slots;
+    uint32_t old_capacity = index->capacity;
+    index->capacity *= 2;
+    index->count = 0;
+    index->slots = omf_calloc(index->capacity, sizeof(object_index_slot));
+    for(uint32_t i = 0; i < old_capacity; i++) {
+        if(old_slots[i].id != 0) {
+            place(index, old_slots[i].id, old_slots[i].obj);
+        }
+    }
+    omf_free(old_slots);
+}
+
+void object_index_insert(object_index *index, object *obj) {
+    if(obj->id == 0) {
+        return;
+    }
+    if((index->count + 1) * 2 > index->capacity) {
+        grow(index);
+    }
+    place(index, obj->id, obj);
+}
+
+void object_index_remove(object_index *index, const object *obj) {
+    uint32_t mask = index->capacity - 1;
+    uint32_t i = home_slot(index, obj->id);
+    while(index->slots[i].id != obj->id) {
+        if(index->slots[i].id == 0) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    if(index->slots[i].obj != obj) {
+        return;
+    }
+
+    // Shift the following entries of the probe run back, so that lookups never need tombstones.
+    uint32_t hole = i;
+    uint32_t next = (i + 1) & mask;
+    while(index->slots[next].id != 0) {
+        uint32_t home = home_slot(index, index->slots[next].id);
+        if(((next - home) & mask) >= ((next - hole) & mask)) {
+            index->slots[hole] = index->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index->slots[hole].id = 0;
+    index->slots[hole].obj = NULL;
+    index->count--;
+}
+
+object *object_index_get(const object_index *index, uint32_t id) {
+    if(id == 0) {
+        return NULL;
+    }
+    uint32_t mask = index->capacity - 1;
+    uint32_t i = home_slot(index, id);
+    while(index->slots[i].id != 0) {
+        if(index->slots[i].id == id) {
+            return index->slots[i].obj;
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
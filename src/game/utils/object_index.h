@@ -0,0 +1,48 @@
+#ifndef OBJECT_INDEX_H
+#define OBJECT_INDEX_H
+
+#include <stdint.h>
+
+typedef struct object_t object;
+
+/**
+ * Maps object ids to the objects living in a game state.
+ *
+ * Object ids are never reused, so an id works as a generational handle: its low bits pick the slot,
+ * and the full id stored in the slot tells whether the slot still holds that same object. Looking up
+ * an id whose object has been removed gives NULL, never some other object that got the slot later.
+ */
+typedef struct object_index_slot {
+    uint32_t id; ///< 0 if the slot is empty
+    object *obj;
+} object_index_slot;
+
+typedef struct object_index {
+    object_index_slot *slots;
+    uint32_t capacity; ///< Always a power of two
+    uint32_t count;
+} object_index;
+
+void object_index_create(object_index *index);
+void object_index_free(object_index *index);
+
+/**
+ * Add an object to the index. If an object with the same id is already indexed, it is replaced.
+ */
+void object_index_insert(object_index *index, object *obj);
+
+/**
+ * Remove an object from the index. Nothing happens if the id now belongs to some other object.
+ */
+void object_index_remove(object_index *index, const object *obj);
+
+/**
+ * Find an object by id.
+ *
+ * @param index Index to search
+ * @param id Object id
+ * @return Object, or NULL if no object with this id is indexed.
+ */
+object *object_index_get(const object_index *index, uint32_t id);
+
+#endif // OBJECT_INDEX_H
@@ -291,3 +291,33 @@ int chr_score_clone(chr_score *src, chr_score *dst) {
     }
     return 0;
 }
+
+void chr_score_serialize(chr_score *score, serial *ser) {
+    iterator it;
+    score_text *t;
+    uint32_t count = list_size(&score->texts);
+    serial_write(ser, (const char *)&count, sizeof(count));
+    list_iter_begin(&score->texts, &it);
+    while((t = iter_next(&it)) != NULL) {
+        uint32_t len = strlen(t->text) + 1;
+        serial_write(ser, (const char *)t, sizeof(score_text));
+        serial_write(ser, (const char *)&len, sizeof(len));
+        serial_write(ser, t->text, len);
+    }
+}
+
+// The score struct itself is expected to be restored by the caller; only the texts list is rebuilt here.
+void chr_score_unserialize(chr_score *score, serial *ser) {
+    uint32_t count;
+    list_create(&score->texts);
+    serial_read(ser, (char *)&count, sizeof(count));
+    for(uint32_t i = 0; i < count; i++) {
+        score_text t;
+        uint32_t len;
+        serial_read(ser, (char *)&t, sizeof(score_text));
+        serial_read(ser, (char *)&len, sizeof(len));
+        t.text = omf_calloc(len, 1);
+        serial_read(ser, t.text, len);
+        list_append(&score->texts, &t, sizeof(score_text));
+    }
+}
@@ -56,5 +56,7 @@ int chr_score_end_combo(chr_score *score, vec2i pos);
 int chr_score_interrupt(chr_score *score, vec2i pos);
 
 int chr_score_clone(chr_score *src, chr_score *dst);
+void chr_score_serialize(chr_score *score, serial *ser);
+void chr_score_unserialize(chr_score *score, serial *ser);
 
 #endif // SCORE_H
@@ -0,0 +1,91 @@
+#include "game/utils/script_cache.h"
+#include "formats/error.h"
+#include "utils/allocator.h"
+#include "utils/hashmap.h"
+#include "utils/log.h"
+#include <assert.h>
+#include <string.h>
+
+typedef struct script_cache_entry {
+    sd_script script; // Must be first, scripts are cast back to their entries.
+    unsigned int refs;
+    char *str;
+} script_cache_entry;
+
+static hashmap cache;
+
+static void entry_free(script_cache_entry *entry) {
+    sd_script_free(&entry->script);
+    omf_free(entry->str);
+    omf_free(entry);
+}
+
+void script_cache_init(void) {
+    hashmap_create(&cache);
+}
+
+void script_cache_close(void) {
+    iterator it;
+    hashmap_pair *pair;
+    hashmap_iter_begin(&cache, &it);
+    while((pair = iter_next(&it)) != NULL) {
+        script_cache_entry *entry = *(script_cache_entry **)pair->value;
+        if(entry->refs > 0) {
+            DEBUG("Script \"%s\" still has %u references at shutdown", entry->str, entry->refs);
+        }
+        entry_free(entry);
+    }
+    hashmap_free(&cache);
+}
+
+const sd_script *script_cache_acquire(const char *str) {
+    script_cache_entry **found;
+    if(hashmap_sget(&cache, str, (void **)&found, NULL) == 0) {
+        (*found)->refs++;
+        return &(*found)->script;
+    }
+
+    script_cache_entry *entry = omf_calloc(1, sizeof(script_cache_entry));
+    size_t len = strlen(str) + 1;
+    entry->str = omf_calloc(len, 1);
+    memcpy(entry->str, str, len);
+    entry->refs = 1;
+
+    int ret;
+    int err_pos;
+    sd_script_create(&entry->script);
+    ret = sd_script_decode(&entry->script, str, &err_pos);
+    if(ret != SD_SUCCESS) {
+        PERROR("Decoder error %s at position %d in string \"%s\"", sd_get_error(ret), err_pos, str);
+    }
+
+    hashmap_sput(&cache, str, &entry, sizeof(script_cache_entry *));
+    return &entry->script;
+}
+
+void script_cache_retain(const sd_script *script) {
+    ((script_cache_entry *)script)->refs++;
+}
+
+void script_cache_release(const sd_script *script) {
+    script_cache_entry *entry = (script_cache_entry *)script;
+    assert(entry->refs > 0);
+    entry->refs--;
+}
+
+const char *script_cache_get_str(const sd_script *script) {
+    return ((const script_cache_entry *)script)->str;
+}
+
+void script_cache_prune(void) {
+    iterator it;
+    hashmap_pair *pair;
+    hashmap_iter_begin(&cache, &it);
+    while((pair = iter_next(&it)) != NULL) {
+        script_cache_entry *entry = *(script_cache_entry **)pair->value;
+        if(entry->refs == 0) {
+            entry_free(entry);
+            hashmap_delete(&cache, &it);
+        }
+    }
+}
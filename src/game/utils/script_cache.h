@@ -0,0 +1,46 @@
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include "formats/script.h"
+
+/**
+ * Decoded animation strings, shared between all objects playing the same string.
+ *
+ * Scripts handed out by the cache are immutable and reference counted. Unreferenced scripts are kept
+ * around until script_cache_prune(), so that objects that change back and forth between the same
+ * animations (and rollback resimulation) do not need to decode them again.
+ */
+
+void script_cache_init(void);
+void script_cache_close(void);
+
+/**
+ * Get the decoded script for an animation string, decoding it if it is not cached yet.
+ * The returned script must be released with script_cache_release().
+ *
+ * @param str Animation string
+ * @return Decoded script. Never NULL; a string that fails to decode gives the frames parsed before the error.
+ */
+const sd_script *script_cache_acquire(const char *str);
+
+/**
+ * Take another reference to a script returned by script_cache_acquire().
+ */
+void script_cache_retain(const sd_script *script);
+
+/**
+ * Drop a reference to a script returned by script_cache_acquire().
+ */
+void script_cache_release(const sd_script *script);
+
+/**
+ * Returns the animation string a cached script was decoded from.
+ */
+const char *script_cache_get_str(const sd_script *script);
+
+/**
+ * Free all scripts that are not referenced by any object. Called when scenes change.
+ */
+void script_cache_prune(void);
+
+#endif // SCRIPT_CACHE_H
@@ -34,6 +34,13 @@ void serial_create(serial *s) {
     s->data = omf_calloc(s->len, 1);
 }
 
+void serial_create_with_size(serial *s, size_t len) {
+    s->len = len;
+    s->wpos = 0;
+    s->rpos = 0;
+    s->data = omf_calloc(s->len, 1);
+}
+
 void serial_create_from(serial *s, const char *buf, size_t len) {
     s->len = len + SERIAL_BUF_RESIZE_INC;
     s->wpos = len;
@@ -58,7 +65,11 @@ serial *serial_calloc_copy(const serial *src) {
 
 void serial_write(serial *s, const char *buf, size_t len) {
     if(s->len < (s->wpos + len)) {
-        size_t new_len = s->len + len + SERIAL_BUF_RESIZE_INC;
+        // Grow geometrically, so that large snapshots don't end up reallocating on every write.
+        size_t new_len = s->len * 2;
+        if(new_len < s->wpos + len + SERIAL_BUF_RESIZE_INC) {
+            new_len = s->wpos + len + SERIAL_BUF_RESIZE_INC;
+        }
         s->data = omf_realloc(s->data, new_len);
         s->len = new_len;
     }
@@ -86,11 +97,24 @@ void serial_write_uint32(serial *s, uint32_t v) {
     serial_write(s, (char *)&t, sizeof(t));
 }
 
+void serial_write_uint64(serial *s, uint64_t v) {
+    serial_write_uint32(s, v >> 32);
+    serial_write_uint32(s, v & 0xFFFFFFFF);
+}
+
 void serial_write_float(serial *s, float v) {
     uint32_t t = serial_htonf(v);
     serial_write(s, (char *)&t, sizeof(t));
 }
 
+void serial_write_varint(serial *s, uint32_t v) {
+    while(v >= 0x80) {
+        serial_write_int8(s, (v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    serial_write_int8(s, v);
+}
+
 void serial_free(serial *s) {
     omf_free(s->data);
     s->len = 0;
@@ -106,6 +130,12 @@ void serial_read_reset(serial *s) {
     s->rpos = 0;
 }
 
+// Rewind for reuse; keeps the already allocated buffer.
+void serial_write_reset(serial *s) {
+    s->wpos = 0;
+    s->rpos = 0;
+}
+
 void serial_read(serial *s, char *buf, size_t len) {
     if(len + s->rpos > s->wpos) {
         len = s->wpos - s->rpos;
@@ -144,8 +174,26 @@ uint32_t serial_read_uint32(serial *s) {
     return ntohl(v);
 }
 
+uint64_t serial_read_uint64(serial *s) {
+    uint64_t high = serial_read_uint32(s);
+    return (high << 32) | serial_read_uint32(s);
+}
+
 float serial_read_float(serial *s) {
     uint32_t v;
     serial_read(s, (char *)&v, sizeof(v));
     return serial_ntohf(v);
 }
+
+uint32_t serial_read_varint(serial *s) {
+    uint32_t v = 0;
+    // A 32 bit value takes at most 5 bytes; stop there, or at the end of data, on broken input
+    for(int shift = 0; shift < 35 && s->rpos < s->wpos; shift += 7) {
+        uint8_t b = s->data[s->rpos++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) {
+            break;
+        }
+    }
+    return v;
+}
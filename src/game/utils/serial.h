@@ -12,24 +12,35 @@ typedef struct serial_t {
 } serial;
 
 void serial_create(serial *s);
+void serial_create_with_size(serial *s, size_t len);
 void serial_create_from(serial *s, const char *buf, size_t len);
 void serial_write(serial *s, const char *buf, size_t len);
 void serial_write_int8(serial *s, int8_t v);
 void serial_write_int16(serial *s, int16_t v);
 void serial_write_int32(serial *s, int32_t v);
 void serial_write_uint32(serial *s, uint32_t v);
+void serial_write_uint64(serial *s, uint64_t v);
 void serial_write_float(serial *s, float v);
+
+/**
+ * Write an unsigned integer in 7 bits per byte, low bits first, with the top bit set on all but the last byte.
+ * Small values take a single byte.
+ */
+void serial_write_varint(serial *s, uint32_t v);
 size_t serial_len(serial *s);
 void serial_read(serial *s, char *buf, size_t len);
 void serial_free(serial *s);
 void serial_read_reset(serial *s);
+void serial_write_reset(serial *s);
 int8_t serial_read_int8(serial *s);
 int16_t serial_read_int16(serial *s);
 uint16_t serial_read_uint16(serial *s);
 int32_t serial_read_int32(serial *s);
 uint32_t serial_read_uint32(serial *s);
+uint64_t serial_read_uint64(serial *s);
 long serial_read_long(serial *s);
 float serial_read_float(serial *s);
+uint32_t serial_read_varint(serial *s);
 void serial_copy(serial *dst, const serial *src);
 serial *serial_calloc_copy(const serial *src);
 
@@ -145,7 +145,15 @@ const field f_net[] = {
     F_INT(settings_network, net_ext_port_start, 0),
     F_INT(settings_network, net_ext_port_end, 0),
     F_BOOL(settings_network, net_use_pmp, 1),
-    F_BOOL(settings_network, net_use_upnp, 1)
+    F_BOOL(settings_network, net_use_upnp, 1),
+    F_INT(settings_network, net_input_delay, -1),
+    F_INT(settings_network, net_max_rollback, 6),
+    F_INT(settings_network, net_sim_delay, 0),
+    F_INT(settings_network, net_sim_jitter, 0),
+    F_INT(settings_network, net_sim_loss, 0),
+    F_STRING(settings_network, net_spectate_relay, NULL),
+    F_INT(settings_network, net_spectate_relay_port, 2099),
+    F_INT(settings_network, net_spectate_delay, 100)
 };
 
 // Map struct to field
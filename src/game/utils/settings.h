@@ -118,6 +118,14 @@ typedef struct {
     int net_ext_port_end;
     int net_use_upnp;
     int net_use_pmp;
+    int net_input_delay;         // Ticks to delay local inputs by; -1 picks it from the measured latency
+    int net_max_rollback;        // Most ticks to roll back with input delay; beyond that the game waits for the peer
+    int net_sim_delay;           // Testing: hold outgoing packets back by this many milliseconds
+    int net_sim_jitter;          // Testing: add up to this many milliseconds of random delay per packet
+    int net_sim_loss;            // Testing: drop this percentage of unreliable outgoing packets
+    char *net_spectate_relay;    // Spectator relay to stream hosted matches to, if any
+    int net_spectate_relay_port; // Port of the spectator relay
+    int net_spectate_delay;      // Ticks spectators stay behind the confirmed inputs, to play smoothly
 } settings_network;
 
 typedef struct {
@@ -0,0 +1,118 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "game/utils/state_hash.h"
+
+void state_hash_begin(state_hash *hash, uint32_t tick) {
+    hash->tick = tick;
+    hash->total = 0;
+    hash->count = 0;
+}
+
+void state_hash_add(state_hash *hash, state_hash_kind kind, uint32_t id, const hash64_state *h) {
+    uint64_t digest = hash64_digest(h);
+    if(hash->count < STATE_HASH_MAX_PARTS - 1) {
+        state_hash_part *part = &hash->parts[hash->count++];
+        part->kind = kind;
+        part->id = id;
+        part->hash = digest;
+        return;
+    }
+
+    // Out of room; keep mixing the rest into the last part.
+    state_hash_part *overflow = &hash->parts[STATE_HASH_MAX_PARTS - 1];
+    hash64_state mix;
+    hash64_reset(&mix, 0);
+    if(hash->count == STATE_HASH_MAX_PARTS) {
+        hash64_update_u64(&mix, overflow->hash);
+    }
+    hash64_update_u32(&mix, kind);
+    hash64_update_u32(&mix, id);
+    hash64_update_u64(&mix, digest);
+    overflow->kind = STATE_HASH_OVERFLOW;
+    overflow->id = 0;
+    overflow->hash = hash64_digest(&mix);
+    hash->count = STATE_HASH_MAX_PARTS;
+}
+
+void state_hash_finish(state_hash *hash) {
+    hash64_state h;
+    hash64_reset(&h, 0);
+    for(int i = 0; i < hash->count; i++) {
+        hash64_update_u32(&h, hash->parts[i].kind);
+        hash64_update_u32(&h, hash->parts[i].id);
+        hash64_update_u64(&h, hash->parts[i].hash);
+    }
+    hash->total = hash64_digest(&h);
+}
+
+static const state_hash_part *find_part(const state_hash *hash, const state_hash_part *part) {
+    for(int i = 0; i < hash->count; i++) {
+        if(hash->parts[i].kind == part->kind && hash->parts[i].id == part->id) {
+            return &hash->parts[i];
+        }
+    }
+    return NULL;
+}
+
+bool state_hash_find_difference(const state_hash *a, const state_hash *b, state_hash_part *part) {
+    for(int i = 0; i < a->count; i++) {
+        const state_hash_part *other = find_part(b, &a->parts[i]);
+        if(other == NULL || other->hash != a->parts[i].hash) {
+            *part = a->parts[i];
+            return true;
+        }
+    }
+    for(int i = 0; i < b->count; i++) {
+        if(find_part(a, &b->parts[i]) == NULL) {
+            *part = b->parts[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+void state_hash_part_name(const state_hash_part *part, char *buf, size_t len) {
+    switch(part->kind) {
+        case STATE_HASH_GAME:
+            snprintf(buf, len, "game state");
+            break;
+        case STATE_HASH_PLAYER:
+            snprintf(buf, len, "player %" PRIu32, part->id + 1);
+            break;
+        case STATE_HASH_SCENE:
+            snprintf(buf, len, "scene %" PRIu32, part->id);
+            break;
+        case STATE_HASH_OBJECT:
+            snprintf(buf, len, "object #%" PRIu32, part->id);
+            break;
+        default:
+            snprintf(buf, len, "remaining objects");
+            break;
+    }
+}
+
+void state_hash_serialize(const state_hash *hash, serial *ser) {
+    serial_write_uint32(ser, hash->tick);
+    serial_write_uint64(ser, hash->total);
+    serial_write_int8(ser, hash->count);
+    for(int i = 0; i < hash->count; i++) {
+        serial_write_int8(ser, hash->parts[i].kind);
+        serial_write_uint32(ser, hash->parts[i].id);
+        serial_write_uint64(ser, hash->parts[i].hash);
+    }
+}
+
+void state_hash_unserialize(state_hash *hash, serial *ser) {
+    hash->tick = serial_read_uint32(ser);
+    hash->total = serial_read_uint64(ser);
+    hash->count = (uint8_t)serial_read_int8(ser);
+    if(hash->count > STATE_HASH_MAX_PARTS) {
+        hash->count = STATE_HASH_MAX_PARTS;
+    }
+    for(int i = 0; i < hash->count; i++) {
+        hash->parts[i].kind = serial_read_int8(ser);
+        hash->parts[i].id = serial_read_uint32(ser);
+        hash->parts[i].hash = serial_read_uint64(ser);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+#include "game/utils/serial.h"
+#include "utils/hash64.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Parts past this many are mixed into a single overflow part.
+#define STATE_HASH_MAX_PARTS 64
+
+typedef enum
+{
+    STATE_HASH_GAME,     // Game state globals: RNG, screen shake, slowdown, fight stats
+    STATE_HASH_PLAYER,   // Player score and HAR link; id is the player index
+    STATE_HASH_SCENE,    // Scene locals
+    STATE_HASH_OBJECT,   // One game object; id is its position in the object list
+    STATE_HASH_OVERFLOW, // Objects that did not fit in their own part
+} state_hash_kind;
+
+typedef struct state_hash_part {
+    uint8_t kind;
+    uint32_t id;
+    uint64_t hash;
+} state_hash_part;
+
+/**
+ * Hash of the full simulation state, broken down into parts. Peers that run the same simulation get the same
+ * parts in the same order, so on a desync the first differing part tells which object went wrong first.
+ */
+typedef struct state_hash {
+    uint32_t tick;
+    uint64_t total;
+    int count;
+    state_hash_part parts[STATE_HASH_MAX_PARTS];
+} state_hash;
+
+/**
+ * Start building a hash. Parts are then added with state_hash_add, and state_hash_finish computes the total.
+ * See game_state_hash.
+ */
+void state_hash_begin(state_hash *hash, uint32_t tick);
+
+/**
+ * Add a part to the hash. Once the part array is full, the rest are mixed into a single overflow part.
+ */
+void state_hash_add(state_hash *hash, state_hash_kind kind, uint32_t id, const hash64_state *h);
+
+void state_hash_finish(state_hash *hash);
+
+/**
+ * Find the first part that differs between two hashes. Parts are matched by kind and id, so an object
+ * that exists on only one side counts as a difference too.
+ *
+ * @param a Local hash
+ * @param b Hash to compare against
+ * @param part Filled with the first differing part; taken from a, unless it is missing there
+ * @return true if the hashes differ
+ */
+bool state_hash_find_difference(const state_hash *a, const state_hash *b, state_hash_part *part);
+
+/**
+ * Describe a part in a human readable way, eg. "object #12" or "player 1".
+ */
+void state_hash_part_name(const state_hash_part *part, char *buf, size_t len);
+
+void state_hash_serialize(const state_hash *hash, serial *ser);
+void state_hash_unserialize(state_hash *hash, serial *ser);
+
+#endif // STATE_HASH_H
@@ -0,0 +1,71 @@
+#include "game/utils/state_snapshot.h"
+#include "utils/log.h"
+
+// Initial buffer size for a single snapshot; buffers grow as needed and never shrink.
+#define STATE_SNAPSHOT_INITIAL_SIZE (128 * 1024)
+
+void state_snapshot_create(state_snapshot *snapshot) {
+    snapshot->valid = false;
+    snapshot->int_tick = 0;
+    serial_create_with_size(&snapshot->data, STATE_SNAPSHOT_INITIAL_SIZE);
+}
+
+void state_snapshot_free(state_snapshot *snapshot) {
+    snapshot->valid = false;
+    serial_free(&snapshot->data);
+}
+
+void state_snapshot_save(state_snapshot *snapshot, game_state *gs) {
+    serial_write_reset(&snapshot->data);
+    game_state_serialize(gs, &snapshot->data);
+    snapshot->int_tick = gs->int_tick;
+    snapshot->valid = true;
+}
+
+void state_snapshot_ring_create(state_snapshot_ring *ring) {
+    for(int i = 0; i < STATE_SNAPSHOT_RING_SIZE; i++) {
+        state_snapshot_create(&ring->slots[i]);
+    }
+}
+
+void state_snapshot_ring_free(state_snapshot_ring *ring) {
+    for(int i = 0; i < STATE_SNAPSHOT_RING_SIZE; i++) {
+        state_snapshot_free(&ring->slots[i]);
+    }
+}
+
+void state_snapshot_ring_clear(state_snapshot_ring *ring) {
+    for(int i = 0; i < STATE_SNAPSHOT_RING_SIZE; i++) {
+        ring->slots[i].valid = false;
+        serial_write_reset(&ring->slots[i].data);
+    }
+}
+
+state_snapshot *state_snapshot_ring_save(state_snapshot_ring *ring, game_state *gs) {
+    state_snapshot *snapshot = &ring->slots[gs->int_tick % STATE_SNAPSHOT_RING_SIZE];
+    state_snapshot_save(snapshot, gs);
+    return snapshot;
+}
+
+state_snapshot *state_snapshot_ring_find(state_snapshot_ring *ring, uint32_t int_tick) {
+    state_snapshot *found = NULL;
+    for(int i = 0; i < STATE_SNAPSHOT_RING_SIZE; i++) {
+        state_snapshot *snapshot = &ring->slots[i];
+        if(!snapshot->valid || snapshot->int_tick > int_tick) {
+            continue;
+        }
+        if(found == NULL || snapshot->int_tick > found->int_tick) {
+            found = snapshot;
+        }
+    }
+    return found;
+}
+
+int state_snapshot_restore(state_snapshot *snapshot, game_state *dst) {
+    if(!snapshot->valid) {
+        PERROR("Attempted to restore an empty state snapshot");
+        return 1;
+    }
+    serial_read_reset(&snapshot->data);
+    return game_state_unserialize(dst, &snapshot->data);
+}
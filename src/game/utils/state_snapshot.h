@@ -0,0 +1,76 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include "game/game_state.h"
+#include "game/utils/serial.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STATE_SNAPSHOT_RING_SIZE 8
+
+/**
+ * A game state written out into a single flat buffer. The buffer is kept allocated between saves,
+ * so taking a snapshot is mostly just copying memory.
+ */
+typedef struct state_snapshot {
+    bool valid;
+    uint32_t int_tick;
+    serial data;
+} state_snapshot;
+
+/**
+ * Fixed amount of snapshots, indexed by the game tick they were taken on. Saving a snapshot on every tick keeps
+ * the last STATE_SNAPSHOT_RING_SIZE ticks around.
+ */
+typedef struct state_snapshot_ring {
+    state_snapshot slots[STATE_SNAPSHOT_RING_SIZE];
+} state_snapshot_ring;
+
+void state_snapshot_create(state_snapshot *snapshot);
+void state_snapshot_free(state_snapshot *snapshot);
+
+/**
+ * Snapshot the game state, replacing the old contents.
+ *
+ * @param snapshot Snapshot to write
+ * @param gs Game state to save
+ */
+void state_snapshot_save(state_snapshot *snapshot, game_state *gs);
+
+void state_snapshot_ring_create(state_snapshot_ring *ring);
+void state_snapshot_ring_free(state_snapshot_ring *ring);
+
+/**
+ * Invalidate all snapshots. Buffers are kept for reuse.
+ */
+void state_snapshot_ring_clear(state_snapshot_ring *ring);
+
+/**
+ * Snapshot the game state into the ring slot for its current tick, replacing whatever was there.
+ *
+ * @param ring Snapshot ring
+ * @param gs Game state to save
+ * @return Snapshot that was written
+ */
+state_snapshot *state_snapshot_ring_save(state_snapshot_ring *ring, game_state *gs);
+
+/**
+ * Find the newest snapshot that was taken on or before the given tick.
+ *
+ * @param ring Snapshot ring
+ * @param int_tick Game state int_tick
+ * @return Snapshot, or NULL if none is old enough.
+ */
+state_snapshot *state_snapshot_ring_find(state_snapshot_ring *ring, uint32_t int_tick);
+
+/**
+ * Rebuild a live game state from a snapshot. The result must be freed with game_state_clone_free,
+ * just like a game_state_clone result.
+ *
+ * @param snapshot Snapshot to read
+ * @param dst Game state to fill
+ * @return 0 on success
+ */
+int state_snapshot_restore(state_snapshot *snapshot, game_state *dst);
+
+#endif // STATE_SNAPSHOT_H
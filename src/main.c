@@ -62,7 +62,10 @@ int main(int argc, char *argv[]) {
     engine_init_flags init_flags;
     init_flags.net_mode = NET_MODE_NONE;
     init_flags.record = 0;
+    init_flags.headless = 0;
+    init_flags.software = 0;
     memset(init_flags.rec_file, 0, 255);
+    memset(init_flags.video_file, 0, 255);
     int ret = 0;
 
     // Path manager
@@ -76,12 +79,16 @@ int main(int argc, char *argv[]) {
     struct arg_lit *vers = arg_lit0("v", "version", "print version information and exit");
     struct arg_lit *listen = arg_lit0("l", "listen", "Start a network game server");
     struct arg_str *connect = arg_str0("c", "connect", "<host>", "Connect to a remote game");
+    struct arg_str *spectate = arg_str0(NULL, "spectate", "<host>", "Watch a game from a spectator relay (port 2099)");
     struct arg_str *trace = arg_str0("t", "trace", "<file>", "Trace netplay events to file");
     struct arg_int *port = arg_int0("p", "port", "<port>", "Port to connect or listen (default: 2097)");
     struct arg_file *play = arg_file0("P", "play", "<file>", "Play an existing recfile");
     struct arg_file *rec = arg_file0("R", "rec", "<file>", "Record a new recfile");
+    struct arg_lit *headless = arg_lit0(NULL, "headless", "Run without window, graphics or audio output");
+    struct arg_lit *software = arg_lit0(NULL, "software", "Render on the CPU instead of with OpenGL");
+    struct arg_file *video = arg_file0(NULL, "record-video", "<file>", "Record the rendered frames to a video file");
     struct arg_end *end = arg_end(30);
-    void *argtable[] = {help, vers, listen, connect, trace, port, play, rec, end};
+    void *argtable[] = {help, vers, listen, connect, spectate, trace, port, play, rec, headless, software, video, end};
     const char *progname = "openomf";
 
     // Make sure everything got allocated
@@ -124,6 +131,13 @@ int main(int argc, char *argv[]) {
         if(port->count > 0) {
             connect_port = port->ival[0] & 0xFFFF;
         }
+    } else if(spectate->count > 0) {
+        init_flags.net_mode = NET_MODE_SPECTATE;
+        connect_port = 2099;
+        ip = strdup(spectate->sval[0]);
+        if(port->count > 0) {
+            connect_port = port->ival[0] & 0xFFFF;
+        }
     } else if(listen->count > 0) {
         init_flags.net_mode = NET_MODE_SERVER;
         listen_port = 2097;
@@ -142,6 +156,16 @@ int main(int argc, char *argv[]) {
         trace_file = strdup(trace->sval[0]);
     }
 
+    if(headless->count > 0) {
+        init_flags.headless = 1;
+    }
+    if(software->count > 0) {
+        init_flags.software = 1;
+    }
+    if(video->count > 0) {
+        strncpy(init_flags.video_file, video->filename[0], 254);
+    }
+
     // Init log
 #if defined(DEBUGMODE)
     if(log_init(0)) {
@@ -204,8 +228,9 @@ int main(int argc, char *argv[]) {
         settings_get()->net.net_listen_port_end = listen_port;
     }
 
-    // Init SDL2
-    if(SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO)) {
+    // Init SDL2. Headless runs have no display to talk to, so only bring up the event queue.
+    Uint32 sdl_flags = init_flags.headless ? (SDL_INIT_TIMER | SDL_INIT_EVENTS) : (SDL_INIT_TIMER | SDL_INIT_VIDEO);
+    if(SDL_Init(sdl_flags)) {
         err_msgbox("SDL2 Initialization failed: %s", SDL_GetError());
         goto exit_2;
     }
@@ -230,7 +255,7 @@ int main(int argc, char *argv[]) {
     }
 
     // Initialize engine
-    if(engine_init()) {
+    if(engine_init(&init_flags)) {
         err_msgbox("Failed to initialize game engine.");
         goto exit_4;
     }
@@ -1,8 +1,61 @@
 #include "formats/af.h"
 #include "resources/af.h"
 #include "resources/sprite.h"
+#include "utils/log.h"
 #include <string.h>
 
+static int input_symbol(char c) {
+    if(c >= '1' && c <= '9') {
+        return c - '1';
+    }
+    if(c == 'K') {
+        return 9;
+    }
+    if(c == 'P') {
+        return 10;
+    }
+    return -1;
+}
+
+static void add_move_node(af *a) {
+    af_move_node node;
+    memset(node.next, 0, sizeof(node.next));
+    node.first_move = -1;
+    vector_append(&a->move_nodes, &node);
+}
+
+// Add a move string to the trie. Moves are added in id order, so the per-node move lists stay sorted.
+static void add_move_string(af *a, const af_move *move) {
+    const char *s = str_c(&move->move_string);
+    int node = 0;
+    for(size_t i = 0; i < str_size(&move->move_string); i++) {
+        int symbol = input_symbol(s[i]);
+        if(symbol < 0) {
+            // Inputs can never contain this, so the move would never match anyway.
+            DEBUG("Move %d has unknown input '%c' in move string \"%s\"", move->id, s[i], s);
+            return;
+        }
+        af_move_node *n = vector_get(&a->move_nodes, node);
+        if(n->next[symbol] == 0) {
+            n->next[symbol] = vector_size(&a->move_nodes);
+            add_move_node(a);
+            n = vector_get(&a->move_nodes, node);
+        }
+        node = n->next[symbol];
+    }
+
+    af_move_node *n = vector_get(&a->move_nodes, node);
+    if(n->first_move < 0) {
+        n->first_move = move->id;
+        return;
+    }
+    int last = n->first_move;
+    while(a->next_move_at_node[last] >= 0) {
+        last = a->next_move_at_node[last];
+    }
+    a->next_move_at_node[last] = move->id;
+}
+
 void af_create(af *a, void *src) {
     sd_af_file *sdaf = (sd_af_file *)src;
 
@@ -26,13 +79,21 @@ void af_create(af *a, void *src) {
 
     array_create(&a->moves);
     array_create(&a->sprites);
+    vector_create(&a->move_nodes, sizeof(af_move_node));
+    add_move_node(a);
+    memset(a->next_move_at_node, -1, sizeof(a->next_move_at_node));
+    memset(a->first_move_in_category, -1, sizeof(a->first_move_in_category));
 
     // Moves
-    for(int i = 0; i < 70; i++) {
+    for(int i = 0; i < AF_MOVE_COUNT; i++) {
         if(sdaf->moves[i] != NULL) {
             af_move *move = omf_calloc(1, sizeof(af_move));
             af_move_create(move, &a->sprites, (void *)sdaf->moves[i], i);
             array_set(&a->moves, i, move);
+            add_move_string(a, move);
+            if(move->category < AF_MOVE_CATEGORIES && a->first_move_in_category[move->category] < 0) {
+                a->first_move_in_category[move->category] = i;
+            }
         }
     }
 }
@@ -41,6 +102,39 @@ af_move *af_get_move(const af *a, int id) {
     return array_get(&a->moves, id);
 }
 
+int af_match_moves(const af *a, const char *inputs, int len, uint8_t *moves) {
+    int count = 0;
+    int node = 0;
+    for(int depth = 0;; depth++) {
+        // Collect the moves ending here, keeping the result sorted by move id.
+        const af_move_node *n = vector_get(&a->move_nodes, node);
+        for(int id = n->first_move; id >= 0; id = a->next_move_at_node[id]) {
+            int k = count++;
+            while(k > 0 && moves[k - 1] > id) {
+                moves[k] = moves[k - 1];
+                k--;
+            }
+            moves[k] = id;
+        }
+        if(depth >= len) {
+            break;
+        }
+        int symbol = input_symbol(inputs[depth]);
+        if(symbol < 0 || n->next[symbol] == 0) {
+            break;
+        }
+        node = n->next[symbol];
+    }
+    return count;
+}
+
+af_move *af_get_first_move_in_category(const af *a, uint8_t category) {
+    if(category >= AF_MOVE_CATEGORIES || a->first_move_in_category[category] < 0) {
+        return NULL;
+    }
+    return af_get_move(a, a->first_move_in_category[category]);
+}
+
 void af_free(af *a) {
     iterator it;
     af_move *move = NULL;
@@ -51,4 +145,5 @@ void af_free(af *a) {
     }
     array_free(&a->moves);
     array_free(&a->sprites);
+    vector_free(&a->move_nodes);
 }
@@ -4,6 +4,21 @@
 #include "resources/af_move.h"
 #include "utils/allocator.h"
 #include "utils/array.h"
+#include "utils/vector.h"
+#include <stdint.h>
+
+#define AF_MOVE_COUNT 70
+#define AF_MOVE_CATEGORIES 16
+#define AF_INPUT_SYMBOLS 11 // Numpad directions 1-9, K and P
+
+/**
+ * Node in the move string trie. Move strings list the newest input first, so walking the trie with the
+ * input history (newest input first) visits the end of every move string that matches the latest inputs.
+ */
+typedef struct af_move_node {
+    int16_t next[AF_INPUT_SYMBOLS]; // Child node for each input symbol, 0 if none. Node 0 is the root.
+    int8_t first_move;              // Lowest move id whose string ends at this node, -1 if none
+} af_move_node;
 
 typedef struct af_t {
     unsigned int id;
@@ -16,10 +31,30 @@ typedef struct af_t {
     array sprites;
     array moves;
     char sound_translation_table[30];
+
+    vector move_nodes;                                 // Move string trie, see af_match_moves()
+    int8_t next_move_at_node[AF_MOVE_COUNT];           // Next move id ending at the same trie node, -1 if none
+    int8_t first_move_in_category[AF_MOVE_CATEGORIES]; // Lowest move id of each category, -1 if none
 } af;
 
 void af_create(af *a, void *src);
 af_move *af_get_move(const af *a, int id);
+
+/**
+ * Find the moves whose move string matches the latest inputs.
+ *
+ * @param a AF data
+ * @param inputs Input history, newest input first
+ * @param len Number of inputs in the history
+ * @param moves Filled with the ids of the matching moves in ascending order. Must fit AF_MOVE_COUNT entries.
+ * @return Number of matching moves
+ */
+int af_match_moves(const af *a, const char *inputs, int len, uint8_t *moves);
+
+/**
+ * Returns the move with the lowest id in the given category, or NULL if there is none.
+ */
+af_move *af_get_first_move_in_category(const af *a, uint8_t category);
 void af_free(af *a);
 
 #endif // AF_H
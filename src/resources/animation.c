@@ -106,6 +106,89 @@ int animation_clone(animation *src, animation *dst) {
     return 0;
 }
 
+static void serialize_str(const str *src, serial *ser) {
+    uint32_t len = str_size(src);
+    serial_write(ser, (const char *)&len, sizeof(len));
+    serial_write(ser, str_c(src), len);
+}
+
+static void unserialize_str(str *dst, serial *ser) {
+    uint32_t len;
+    serial_read(ser, (char *)&len, sizeof(len));
+    str_from_buf(dst, ser->data + ser->rpos, len);
+    ser->rpos += len;
+}
+
+/**
+ * Write a deep copy of the animation to a flat buffer. Same contents as animation_clone would produce.
+ */
+void animation_serialize(const animation *ani, serial *ser) {
+    serial_write(ser, (const char *)ani, sizeof(animation));
+    serialize_str(&ani->animation_string, ser);
+
+    uint32_t count = vector_size(&ani->collision_coords);
+    serial_write(ser, (const char *)&count, sizeof(count));
+    if(count > 0) {
+        serial_write(ser, vector_get(&ani->collision_coords, 0), count * sizeof(collision_coord));
+    }
+
+    count = vector_size(&ani->extra_strings);
+    serial_write(ser, (const char *)&count, sizeof(count));
+    for(uint32_t i = 0; i < count; i++) {
+        serialize_str(vector_get(&ani->extra_strings, i), ser);
+    }
+
+    count = vector_size(&ani->sprites);
+    serial_write(ser, (const char *)&count, sizeof(count));
+    for(uint32_t i = 0; i < count; i++) {
+        const sprite_reference *spr = vector_get(&ani->sprites, i);
+        const surface *sur = spr->sprite->data;
+        serial_write(ser, (const char *)spr->sprite, sizeof(sprite));
+        serial_write(ser, (const char *)sur, sizeof(surface));
+        serial_write(ser, (const char *)sur->data, sur->w * sur->h);
+    }
+}
+
+/**
+ * Rebuild an animation written by animation_serialize. All sprites of the result own their surfaces.
+ */
+void animation_unserialize(animation *ani, serial *ser) {
+    serial_read(ser, (char *)ani, sizeof(animation));
+    unserialize_str(&ani->animation_string, ser);
+
+    uint32_t count;
+    serial_read(ser, (char *)&count, sizeof(count));
+    vector_create_with_size(&ani->collision_coords, sizeof(collision_coord), count);
+    for(uint32_t i = 0; i < count; i++) {
+        collision_coord coord;
+        serial_read(ser, (char *)&coord, sizeof(coord));
+        vector_append(&ani->collision_coords, &coord);
+    }
+
+    serial_read(ser, (char *)&count, sizeof(count));
+    vector_create_with_size(&ani->extra_strings, sizeof(str), count);
+    for(uint32_t i = 0; i < count; i++) {
+        str extra;
+        unserialize_str(&extra, ser);
+        vector_append(&ani->extra_strings, &extra);
+    }
+
+    serial_read(ser, (char *)&count, sizeof(count));
+    vector_create_with_size(&ani->sprites, sizeof(sprite_reference), count);
+    for(uint32_t i = 0; i < count; i++) {
+        surface sur;
+        sprite_reference spr;
+        spr.sprite = omf_calloc(1, sizeof(sprite));
+        serial_read(ser, (char *)spr.sprite, sizeof(sprite));
+        serial_read(ser, (char *)&sur, sizeof(surface));
+        spr.sprite->data = omf_calloc(1, sizeof(surface));
+        spr.sprite->owned = true;
+        surface_create(spr.sprite->data, sur.w, sur.h, sur.transparent);
+        serial_read(ser, (char *)spr.sprite->data->data, sur.w * sur.h);
+        vector_append(&ani->sprites, &spr);
+    }
+}
+
 void animation_fixup_coordinates(animation *ani, int fix_x, int fix_y) {
     iterator it;
     sprite_reference *spr;
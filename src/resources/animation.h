@@ -1,6 +1,7 @@
 #ifndef ANIMATION_H
 #define ANIMATION_H
 
+#include "game/utils/serial.h"
 #include "resources/sprite.h"
 #include "utils/array.h"
 #include "utils/str.h"
@@ -56,5 +57,7 @@ animation *create_animation_from_single(sprite *sp, vec2i pos);
 void animation_fixup_coordinates(animation *ani, int fix_x, int fix_y);
 
 int animation_clone(animation *src, animation *dst);
+void animation_serialize(const animation *ani, serial *ser);
+void animation_unserialize(animation *ani, serial *ser);
 
 #endif // ANIMATION_H
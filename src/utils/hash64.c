@@ -0,0 +1,145 @@
+#include <string.h>
+
+#include "utils/hash64.h"
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline uint32_t read32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t merge_round(uint64_t acc, uint64_t lane) {
+    acc ^= round64(0, lane);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+static inline void consume_stripe(uint64_t *lanes, const uint8_t *p) {
+    lanes[0] = round64(lanes[0], read64(p));
+    lanes[1] = round64(lanes[1], read64(p + 8));
+    lanes[2] = round64(lanes[2], read64(p + 16));
+    lanes[3] = round64(lanes[3], read64(p + 24));
+}
+
+void hash64_reset(hash64_state *h, uint64_t seed) {
+    h->lanes[0] = seed + PRIME64_1 + PRIME64_2;
+    h->lanes[1] = seed + PRIME64_2;
+    h->lanes[2] = seed;
+    h->lanes[3] = seed - PRIME64_1;
+    h->seed = seed;
+    h->total_len = 0;
+    h->buf_len = 0;
+}
+
+void hash64_update(hash64_state *h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    h->total_len += len;
+
+    // Top up a partial stripe left over from the previous update first.
+    if(h->buf_len > 0) {
+        size_t n = sizeof(h->buf) - h->buf_len;
+        if(n > len) {
+            n = len;
+        }
+        memcpy(h->buf + h->buf_len, p, n);
+        h->buf_len += n;
+        p += n;
+        len -= n;
+        if(h->buf_len < sizeof(h->buf)) {
+            return;
+        }
+        consume_stripe(h->lanes, h->buf);
+        h->buf_len = 0;
+    }
+    while(len >= 32) {
+        consume_stripe(h->lanes, p);
+        p += 32;
+        len -= 32;
+    }
+    memcpy(h->buf, p, len);
+    h->buf_len = len;
+}
+
+uint64_t hash64_digest(const hash64_state *h) {
+    uint64_t acc;
+    if(h->total_len >= 32) {
+        acc = rotl64(h->lanes[0], 1) + rotl64(h->lanes[1], 7) + rotl64(h->lanes[2], 12) + rotl64(h->lanes[3], 18);
+        for(int i = 0; i < 4; i++) {
+            acc = merge_round(acc, h->lanes[i]);
+        }
+    } else {
+        acc = h->seed + PRIME64_5;
+    }
+    acc += h->total_len;
+
+    const uint8_t *p = h->buf;
+    uint32_t len = h->buf_len;
+    for(; len >= 8; p += 8, len -= 8) {
+        acc ^= round64(0, read64(p));
+        acc = rotl64(acc, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if(len >= 4) {
+        acc ^= (uint64_t)read32(p) * PRIME64_1;
+        acc = rotl64(acc, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+        len -= 4;
+    }
+    for(; len > 0; p++, len--) {
+        acc ^= *p * PRIME64_5;
+        acc = rotl64(acc, 11) * PRIME64_1;
+    }
+
+    acc ^= acc >> 33;
+    acc *= PRIME64_2;
+    acc ^= acc >> 29;
+    acc *= PRIME64_3;
+    acc ^= acc >> 32;
+    return acc;
+}
+
+void hash64_update_u32(hash64_state *h, uint32_t value) {
+    uint8_t bytes[4];
+    for(int i = 0; i < 4; i++) {
+        bytes[i] = value >> (i * 8);
+    }
+    hash64_update(h, bytes, sizeof(bytes));
+}
+
+void hash64_update_u64(hash64_state *h, uint64_t value) {
+    uint8_t bytes[8];
+    for(int i = 0; i < 8; i++) {
+        bytes[i] = value >> (i * 8);
+    }
+    hash64_update(h, bytes, sizeof(bytes));
+}
+
+void hash64_update_float(hash64_state *h, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    hash64_update_u32(h, bits);
+}
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed) {
+    hash64_state h;
+    hash64_reset(&h, seed);
+    hash64_update(&h, data, len);
+    return hash64_digest(&h);
+}
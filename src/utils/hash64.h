@@ -0,0 +1,33 @@
+#ifndef HASH64_H
+#define HASH64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Streaming 64-bit hash. This is the XXH64 algorithm, so results match other xxHash implementations.
+ * The input is consumed 32 bytes at a time in four independent lanes, which keeps it fast on long inputs.
+ */
+typedef struct hash64_state {
+    uint64_t lanes[4];
+    uint64_t seed;
+    uint64_t total_len;
+    uint8_t buf[32];
+    uint32_t buf_len;
+} hash64_state;
+
+void hash64_reset(hash64_state *h, uint64_t seed);
+void hash64_update(hash64_state *h, const void *data, size_t len);
+uint64_t hash64_digest(const hash64_state *h);
+
+/**
+ * Hash values in little endian byte order, so that the result is the same on every platform.
+ * Signed values are sign extended; floats are hashed by their bit pattern.
+ */
+void hash64_update_u32(hash64_state *h, uint32_t value);
+void hash64_update_u64(hash64_state *h, uint64_t value);
+void hash64_update_float(hash64_state *h, float value);
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed);
+
+#endif // HASH64_H
@@ -0,0 +1,92 @@
+#include "utils/pool.h"
+#include "utils/allocator.h"
+#include "utils/log.h"
+#include <stdint.h>
+#include <string.h>
+
+// Pools that have slabs allocated.
+static pool *pools = NULL;
+
+// Released items store the free list link in their first bytes, and must stay aligned for any type.
+static size_t item_stride(const pool *p) {
+    size_t align = sizeof(max_align_t);
+    size_t size = p->item_size < sizeof(void *) ? sizeof(void *) : p->item_size;
+    return (size + align - 1) / align * align;
+}
+
+static void add_slab(pool *p) {
+    size_t stride = item_stride(p);
+    char *slab = omf_malloc(stride * p->items_per_slab);
+    p->slabs = omf_realloc(p->slabs, (p->slab_count + 1) * sizeof(char *));
+    p->slabs[p->slab_count++] = slab;
+    if(p->slab_count == 1) {
+        p->next = pools;
+        pools = p;
+    }
+
+    // Thread the new items to the free list, first item first.
+    for(unsigned i = p->items_per_slab; i > 0; i--) {
+        void *item = slab + (i - 1) * stride;
+        *(void **)item = p->free_items;
+        p->free_items = item;
+    }
+}
+
+void *pool_alloc(pool *p) {
+    if(p->free_items == NULL) {
+        add_slab(p);
+    }
+    void *item = p->free_items;
+    p->free_items = *(void **)item;
+    memset(item, 0, p->item_size);
+    p->in_use++;
+    if(p->in_use > p->high_water) {
+        p->high_water = p->in_use;
+    }
+    return item;
+}
+
+void pool_release(pool *p, void *ptr) {
+    if(ptr == NULL) {
+        return;
+    }
+    *(void **)ptr = p->free_items;
+    p->free_items = ptr;
+    p->in_use--;
+}
+
+bool pool_owns(const pool *p, const void *ptr) {
+    uintptr_t addr = (uintptr_t)ptr;
+    uintptr_t slab_size = item_stride(p) * p->items_per_slab;
+    for(unsigned i = 0; i < p->slab_count; i++) {
+        uintptr_t start = (uintptr_t)p->slabs[i];
+        if(addr >= start && addr < start + slab_size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned pool_high_water(const pool *p) {
+    return p->high_water;
+}
+
+void pool_close_all(void) {
+    while(pools != NULL) {
+        pool *p = pools;
+        pools = p->next;
+        INFO("Pool '%s': %u items at most in use, %u slabs of %u items", p->name, p->high_water, p->slab_count,
+             p->items_per_slab);
+        if(p->in_use > 0) {
+            DEBUG("Pool '%s' closed with %u items still in use", p->name, p->in_use);
+        }
+        for(unsigned i = 0; i < p->slab_count; i++) {
+            omf_free(p->slabs[i]);
+        }
+        omf_free(p->slabs);
+        p->slab_count = 0;
+        p->free_items = NULL;
+        p->in_use = 0;
+        p->next = NULL;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Fixed size item allocator. Items are carved out of larger slabs, and released items go to a free list
+ * to be handed out again, so steady churn never reaches the system allocator. Slabs are only returned
+ * by pool_close_all().
+ *
+ * Pools are meant to be static, and are initialized with POOL_INIT:
+ *
+ *     static pool object_pool = POOL_INIT("object", object, 64);
+ */
+typedef struct pool_t {
+    const char *name;
+    size_t item_size;
+    unsigned items_per_slab;
+    char **slabs;
+    unsigned slab_count;
+    void *free_items;
+    unsigned in_use;
+    unsigned high_water;
+    struct pool_t *next; ///< Next pool that has allocated memory, for pool_close_all
+} pool;
+
+#define POOL_INIT(name, type, items_per_slab) {(name), sizeof(type), (items_per_slab), NULL, 0, NULL, 0, 0, NULL}
+
+/**
+ * Take an item from the pool. The item is zeroed, like with omf_calloc.
+ */
+void *pool_alloc(pool *p);
+
+/**
+ * Give an item back to the pool. The item must have been allocated from this pool.
+ */
+void pool_release(pool *p, void *ptr);
+
+/**
+ * Check if a pointer points to an item of this pool.
+ */
+bool pool_owns(const pool *p, const void *ptr);
+
+/**
+ * Largest amount of items that have been in use at the same time.
+ */
+unsigned pool_high_water(const pool *p);
+
+/**
+ * Free the memory of every pool, and log their high-water marks. Nothing may be left in use.
+ */
+void pool_close_all(void);
+
+#endif // POOL_H
@@ -0,0 +1,147 @@
+#include <SDL.h>
+#include <string.h>
+
+#include "formats/error.h"
+#include "formats/vidrec.h"
+#include "utils/allocator.h"
+#include "utils/log.h"
+#include "video/frame_recorder.h"
+#include "video/video.h"
+
+// Frames waiting for the writer thread. If the writer falls this far behind, new frames are dropped.
+#define QUEUE_SIZE 8
+
+typedef struct queued_frame {
+    uint32_t time;
+    vga_palette palette;
+    uint8_t pixels[NATIVE_W * NATIVE_H];
+} queued_frame;
+
+typedef struct frame_recorder {
+    char filename[256];
+    sd_vidrec_stream *stream; // Only touched by the writer thread while it runs
+    uint64_t start_ticks;
+    unsigned int dropped;
+
+    SDL_Thread *thread;
+    SDL_mutex *lock;
+    SDL_cond *cond;
+
+    // Protected by the lock
+    queued_frame *queue;
+    int head;
+    int count;
+    bool quit;
+    bool failed;
+} frame_recorder;
+
+static frame_recorder *recorder = NULL;
+
+static int recorder_write(void *userdata) {
+    frame_recorder *rec = userdata;
+    SDL_LockMutex(rec->lock);
+    while(true) {
+        while(rec->count == 0 && !rec->quit) {
+            SDL_CondWait(rec->cond, rec->lock);
+        }
+        if(rec->count == 0) {
+            break;
+        }
+
+        // The head slot is left alone by the main thread until it is released, so encode it unlocked.
+        queued_frame *frame = &rec->queue[rec->head];
+        SDL_UnlockMutex(rec->lock);
+        int ret = sd_vidrec_write_frame(rec->stream, frame->time, frame->pixels, &frame->palette);
+        SDL_LockMutex(rec->lock);
+
+        rec->failed |= ret != SD_SUCCESS;
+        rec->head = (rec->head + 1) % QUEUE_SIZE;
+        rec->count--;
+    }
+    SDL_UnlockMutex(rec->lock);
+    return 0;
+}
+
+static void recorder_push(const unsigned char *pixels, const vga_palette *palette, void *userdata) {
+    frame_recorder *rec = userdata;
+    uint32_t time = SDL_GetTicks64() - rec->start_ticks;
+    SDL_LockMutex(rec->lock);
+    if(rec->failed) {
+        // Nothing more can be written; the error is reported when recording stops.
+    } else if(rec->count == QUEUE_SIZE) {
+        rec->dropped++;
+    } else {
+        queued_frame *frame = &rec->queue[(rec->head + rec->count) % QUEUE_SIZE];
+        frame->time = time;
+        frame->palette = *palette;
+        memcpy(frame->pixels, pixels, sizeof(frame->pixels));
+        rec->count++;
+        SDL_CondSignal(rec->cond);
+    }
+    SDL_UnlockMutex(rec->lock);
+}
+
+bool frame_recorder_start(const char *filename) {
+    frame_recorder_stop();
+
+    frame_recorder *rec = omf_calloc(1, sizeof(frame_recorder));
+    strncpy(rec->filename, filename, sizeof(rec->filename) - 1);
+    rec->stream = omf_calloc(1, sizeof(sd_vidrec_stream));
+    int ret = sd_vidrec_create(rec->stream, filename);
+    if(ret != SD_SUCCESS) {
+        PERROR("Unable to create video recording %s: %s", filename, sd_get_error(ret));
+        goto error_0;
+    }
+    rec->queue = omf_calloc(QUEUE_SIZE, sizeof(queued_frame));
+    rec->lock = SDL_CreateMutex();
+    rec->cond = SDL_CreateCond();
+    rec->thread = SDL_CreateThread(recorder_write, "frame recorder", rec);
+    if(rec->thread == NULL) {
+        PERROR("Unable to start frame recorder thread: %s", SDL_GetError());
+        goto error_1;
+    }
+
+    rec->start_ticks = SDL_GetTicks64();
+    recorder = rec;
+    video_record_frames(recorder_push, rec);
+    INFO("Recording video to %s", filename);
+    return true;
+
+error_1:
+    SDL_DestroyCond(rec->cond);
+    SDL_DestroyMutex(rec->lock);
+    omf_free(rec->queue);
+    sd_vidrec_close(rec->stream);
+
+error_0:
+    omf_free(rec->stream);
+    omf_free(rec);
+    return false;
+}
+
+void frame_recorder_stop(void) {
+    if(recorder == NULL) {
+        return;
+    }
+    frame_recorder *rec = recorder;
+    video_record_frames(NULL, NULL);
+
+    SDL_LockMutex(rec->lock);
+    rec->quit = true;
+    SDL_CondSignal(rec->cond);
+    SDL_UnlockMutex(rec->lock);
+    SDL_WaitThread(rec->thread, NULL);
+
+    if(rec->failed) {
+        PERROR("Video recording %s failed after %u frames", rec->filename, rec->stream->frames);
+    } else {
+        INFO("Video recording %s finished: %u frames, %u dropped.", rec->filename, rec->stream->frames,
+             rec->dropped);
+    }
+    sd_vidrec_close(rec->stream);
+    SDL_DestroyCond(rec->cond);
+    SDL_DestroyMutex(rec->lock);
+    omf_free(rec->queue);
+    omf_free(rec->stream);
+    omf_free(recorder);
+}
@@ -0,0 +1,20 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <stdbool.h>
+
+/**
+ * Start recording the rendered frames to a video recording file (see formats/vidrec.h). The frames are stored as
+ * palette indexes, and compressed and written on a background thread.
+ *
+ * @param filename File to record to
+ * @return true if recording started
+ */
+bool frame_recorder_start(const char *filename);
+
+/**
+ * Stop recording, and finish writing the frames that are still queued. Does nothing if not recording.
+ */
+void frame_recorder_stop(void);
+
+#endif // FRAME_RECORDER_H
@@ -0,0 +1,100 @@
+#include "video/null/null_renderer.h"
+#include "formats/transparent.h"
+#include "utils/allocator.h"
+#include "utils/log.h"
+#include "video/vga_state.h"
+
+typedef struct null_context {
+    int screen_w;
+    int screen_h;
+} null_context;
+
+static void null_create(renderer *renderer) {
+    renderer->ctx = omf_calloc(1, sizeof(null_context));
+}
+
+static bool null_setup_context(void *userdata, int window_w, int window_h, bool fullscreen, bool vsync) {
+    null_context *ctx = userdata;
+    ctx->screen_w = window_w;
+    ctx->screen_h = window_h;
+    INFO("Null renderer initialized!");
+    return true;
+}
+
+static bool null_reset_context(void *userdata, int window_w, int window_h, bool fullscreen, bool vsync) {
+    null_context *ctx = userdata;
+    ctx->screen_w = window_w;
+    ctx->screen_h = window_h;
+    return true;
+}
+
+static void null_close_context(void *userdata) {
+    null_context *ctx = userdata;
+    omf_free(ctx);
+    INFO("Video renderer closed.");
+}
+
+static void null_reset_atlas(void *userdata) {
+}
+
+static void null_draw_atlas(void *userdata, bool draw_atlas) {
+}
+
+static void null_move_target(void *userdata, int x, int y) {
+}
+
+static void null_invalidate(void *userdata) {
+}
+
+static void null_render_prepare(void *userdata) {
+}
+
+static void null_render_finish_offscreen(void *userdata) {
+}
+
+static void null_render_finish(void *userdata) {
+    // Nothing to upload to, but keep the VGA state dirty flags in the same shape as a real renderer would.
+    vga_index range_start, range_end;
+    vga_palette *palette;
+    if(vga_state_is_palette_dirty(&palette, &range_start, &range_end)) {
+        vga_state_mark_palette_flushed();
+    }
+    vga_remap_tables *tables;
+    if(vga_state_is_remap_dirty(&tables)) {
+        vga_state_mark_remaps_flushed();
+    }
+}
+
+static void null_render_area_capture(void *userdata, surface *sur, int x, int y, int w, int h) {
+    // Callers expect a valid surface back, so hand out an empty one.
+    surface_create(sur, w, h, BACKGROUND_TRANSPARENT_INDEX);
+}
+
+static void null_schedule_screenshot(void *userdata, video_screenshot_signal callback) {
+}
+
+static void null_record_frames(void *userdata, video_frame_signal callback, void *callback_data) {
+}
+
+static void null_draw_surface(void *userdata, const surface *src_surface, SDL_Rect *dst, int remap_offset,
+                              int remap_rounds, int palette_offset, int palette_limit, int opacity,
+                              unsigned int flip_mode, unsigned int options) {
+}
+
+void null_renderer_set_callbacks(renderer *renderer) {
+    renderer->create = null_create;
+    renderer->setup_context = null_setup_context;
+    renderer->reset_context = null_reset_context;
+    renderer->close_context = null_close_context;
+    renderer->reset_atlas = null_reset_atlas;
+    renderer->draw_atlas = null_draw_atlas;
+    renderer->move_target = null_move_target;
+    renderer->invalidate = null_invalidate;
+    renderer->render_prepare = null_render_prepare;
+    renderer->render_finish_offscreen = null_render_finish_offscreen;
+    renderer->render_finish = null_render_finish;
+    renderer->render_area_capture = null_render_area_capture;
+    renderer->schedule_screenshot = null_schedule_screenshot;
+    renderer->record_frames = null_record_frames;
+    renderer->draw_surface = null_draw_surface;
+}
@@ -0,0 +1,12 @@
+#ifndef NULL_RENDERER_H
+#define NULL_RENDERER_H
+
+#include "video/renderer.h"
+
+/**
+ * Renderer that accepts and discards everything. Used when running without a display or GPU,
+ * eg. for headless recording playback and AI matches.
+ */
+void null_renderer_set_callbacks(renderer *renderer);
+
+#endif // NULL_RENDERER_H
@@ -4,6 +4,8 @@
 
 static GLuint bound_ubo = 0;
 static GLuint bound_vbo = 0;
+static GLuint bound_pbo = 0;
+static GLuint bound_pack_pbo = 0;
 static GLuint bound_vao = 0;
 static GLuint bound_tex[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 static GLuint bound_fbo = 0;
@@ -44,6 +46,34 @@ void bindings_unbind_vbo(GLuint id) {
     }
 }
 
+void bindings_bind_pbo(GLuint id) {
+    if(bound_pbo != id) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, id);
+        bound_pbo = id;
+    }
+}
+
+void bindings_unbind_pbo(GLuint id) {
+    if(bound_pbo == id) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        bound_pbo = 0;
+    }
+}
+
+void bindings_bind_pack_pbo(GLuint id) {
+    if(bound_pack_pbo != id) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, id);
+        bound_pack_pbo = id;
+    }
+}
+
+void bindings_unbind_pack_pbo(GLuint id) {
+    if(bound_pack_pbo == id) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        bound_pack_pbo = 0;
+    }
+}
+
 void bindings_bind_ubo(GLuint id) {
     if(bound_ubo != id) {
         glBindBuffer(GL_UNIFORM_BUFFER, id);
@@ -76,6 +106,24 @@ void bindings_unbind_tex(GLuint unit, GLuint id) {
     }
 }
 
+void bindings_bind_tex_array(GLuint unit, GLuint id) {
+    assert(unit < 16);
+    binding_active_tex(unit);
+    if(bound_tex[unit] != id) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+        bound_tex[unit] = id;
+    }
+}
+
+void bindings_unbind_tex_array(GLuint unit, GLuint id) {
+    assert(unit < 16);
+    binding_active_tex(unit);
+    if(bound_tex[unit] == id) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        bound_tex[unit] = 0;
+    }
+}
+
 void bindings_bind_fbo(GLuint id) {
     if(bound_fbo != id) {
         glBindFramebuffer(GL_FRAMEBUFFER, id);
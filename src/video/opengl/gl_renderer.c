@@ -0,0 +1,574 @@
+#include <SDL.h>
+#include <epoxy/gl.h>
+#include <string.h>
+
+#include "formats/transparent.h"
+#include "utils/allocator.h"
+#include "utils/log.h"
+#include "video/opengl/bindings.h"
+#include "video/opengl/gl_renderer.h"
+#include "video/opengl/object_array.h"
+#include "video/opengl/remaps.h"
+#include "video/opengl/render_target.h"
+#include "video/opengl/shaders.h"
+#include "video/opengl/shared.h"
+#include "video/opengl/texture_atlas.h"
+#include "video/sdl_window.h"
+#include "video/vga_state.h"
+
+#define FRAME_READBACKS 3
+
+// One recorded frame on its way back from the GPU.
+typedef struct gl_frame_readback {
+    GLuint pbo;
+    GLsync fence;
+    vga_palette palette;
+} gl_frame_readback;
+
+typedef struct gl_context {
+    SDL_Window *window;
+    SDL_GLContext *gl_context;
+    texture_atlas *atlas;
+    object_array *objects;
+    shared *shared;
+    render_target *target;
+    remaps *remaps;
+
+    GLuint palette_prog_id;
+    GLuint rgba_prog_id;
+
+    object_array_blend_mode current_blend_mode;
+
+    int viewport_w;
+    int viewport_h;
+
+    int screen_w;
+    int screen_h;
+    bool fullscreen;
+    bool vsync;
+
+    bool draw_atlas;
+    int target_move_x;
+    int target_move_y;
+
+    video_screenshot_signal screenshot_cb;
+
+    // Screenshot readback in flight
+    GLuint screenshot_pbo;
+    GLsync screenshot_fence;
+    SDL_Rect screenshot_rect;
+    video_screenshot_signal screenshot_ready_cb;
+
+    // Frame recording. Frames are resolved to palette indexes on the GPU, and read back a few frames later.
+    vga_palette palette; // Copy of the palette in the uniform block
+    video_frame_signal frame_cb;
+    void *frame_cb_data;
+    render_target *frame_target;
+    gl_frame_readback frames[FRAME_READBACKS];
+    int frame_read;    // Oldest readback in flight
+    int frame_pending; // Number of readbacks in flight
+    unsigned char *frame_pixels;
+
+    // Change tracking. The render target keeps its contents between frames, so a frame with the same sprites
+    // does not need to be drawn again, and if the screen would not change either, it is not presented at all.
+    bool target_dirty;  // Target must be redrawn even if the sprites did not change
+    bool target_drawn;  // Target was redrawn since the last present
+    bool screen_dirty;  // Screen must be presented even if nothing changed
+    int presented_move_x;
+    int presented_move_y;
+    bool presented_draw_atlas;
+    uint64_t last_frame; // SDL_GetTicks64() at the end of the last frame
+    int frame_interval;  // Display refresh interval in milliseconds
+    unsigned frames_finished;
+    unsigned frames_drawn;
+    unsigned frames_presented;
+} gl_context;
+
+#define TEX_UNIT_ATLAS 0
+#define TEX_UNIT_FBO 1
+#define TEX_UNIT_REMAPS 2
+#define TEX_UNIT_FRAME 3
+
+#define PAL_BLOCK_BINDING 0
+
+static void gl_create(renderer *renderer) {
+    renderer->ctx = omf_calloc(1, sizeof(gl_context));
+}
+
+static void update_frame_interval(gl_context *ctx) {
+    SDL_DisplayMode mode;
+    int rate = 60;
+    if(SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(ctx->window), &mode) == 0 && mode.refresh_rate > 0) {
+        rate = mode.refresh_rate;
+    }
+    ctx->frame_interval = 1000 / rate;
+}
+
+static bool gl_setup_context(void *userdata, int window_w, int window_h, bool fullscreen, bool vsync) {
+    gl_context *ctx = userdata;
+    ctx->screen_w = window_w;
+    ctx->screen_h = window_h;
+    ctx->fullscreen = fullscreen;
+    ctx->vsync = vsync;
+    ctx->target_move_x = 0;
+    ctx->target_move_y = 0;
+    ctx->current_blend_mode = MODE_SET;
+
+    if(!create_window(&ctx->window, window_w, window_h, fullscreen, true)) {
+        goto error_0;
+    }
+    if(!create_gl_context(&ctx->gl_context, ctx->window)) {
+        goto error_1;
+    }
+    if(!set_vsync(ctx->vsync)) {
+        goto error_2;
+    }
+    if(!create_program(&ctx->palette_prog_id, "palette.vert", "palette.frag")) {
+        goto error_2;
+    }
+    if(!create_program(&ctx->rgba_prog_id, "rgba.vert", "rgba.frag")) {
+        goto error_3;
+    }
+
+    // Fetch viewport size which may be different from window size.
+    SDL_GL_GetDrawableSize(ctx->window, &ctx->viewport_w, &ctx->viewport_h);
+    update_frame_interval(ctx);
+    ctx->target_dirty = true;
+    ctx->screen_dirty = true;
+
+    // Reset background color to black.
+    glClearColor(0.0, 0.0, 0.0, 1.0);
+
+    // Create the rest of the graphics objects
+    ctx->atlas = atlas_create(TEX_UNIT_ATLAS, 2048, 2048);
+    ctx->objects = object_array_create(2048.0f, 2048.0f);
+    ctx->shared = shared_create();
+    ctx->target = render_target_create(TEX_UNIT_FBO, NATIVE_W, NATIVE_H, GL_RGBA8, GL_RGBA);
+    ctx->remaps = remaps_create(TEX_UNIT_REMAPS);
+    glGenBuffers(1, &ctx->screenshot_pbo);
+
+    // Create orthographic projection matrix for 2d stuff.
+    GLfloat projection_matrix[16];
+    ortho2d(projection_matrix, 0.0f, NATIVE_W, NATIVE_H, 0.0f);
+
+    // Activate palette program, and bind its variables now
+    activate_program(ctx->palette_prog_id);
+    bind_uniform_4fv(ctx->palette_prog_id, "projection", projection_matrix);
+    bind_uniform_1i(ctx->palette_prog_id, "atlas", TEX_UNIT_ATLAS);
+    bind_uniform_1i(ctx->palette_prog_id, "remaps", TEX_UNIT_REMAPS);
+
+    // Activate RGBA conversion program, and bind palette etc.
+    activate_program(ctx->rgba_prog_id);
+    bind_uniform_4fv(ctx->rgba_prog_id, "projection", projection_matrix);
+    GLuint pal_ubo_id = shared_get_block(ctx->shared);
+    bind_uniform_block(ctx->rgba_prog_id, "palette", PAL_BLOCK_BINDING, pal_ubo_id);
+    bind_uniform_1i(ctx->rgba_prog_id, "framebuffer", TEX_UNIT_FBO);
+    bind_uniform_1i(ctx->rgba_prog_id, "atlas", TEX_UNIT_ATLAS);
+    bind_uniform_1i(ctx->rgba_prog_id, "remaps", TEX_UNIT_REMAPS);
+
+    INFO("OpenGL Renderer initialized!");
+    return true;
+
+error_3:
+    delete_program(ctx->palette_prog_id);
+
+error_2:
+    SDL_GL_DeleteContext(ctx->gl_context);
+
+error_1:
+    SDL_DestroyWindow(ctx->window);
+
+error_0:
+    return false;
+}
+
+static void gl_draw_atlas(void *userdata, bool draw_atlas) {
+    gl_context *ctx = userdata;
+    ctx->draw_atlas = draw_atlas;
+}
+
+static bool gl_reset_context(void *userdata, int window_w, int window_h, bool fullscreen, bool vsync) {
+    gl_context *ctx = userdata;
+    ctx->screen_w = window_w;
+    ctx->screen_h = window_h;
+    ctx->fullscreen = fullscreen;
+    ctx->vsync = vsync;
+    bool success = resize_window(ctx->window, window_w, window_h, fullscreen);
+    success = set_vsync(ctx->vsync) && success;
+
+    // Fetch viewport size which may be different from window size.
+    SDL_GL_GetDrawableSize(ctx->window, &ctx->viewport_w, &ctx->viewport_h);
+    update_frame_interval(ctx);
+    ctx->screen_dirty = true;
+
+    return success;
+}
+
+static void gl_reset_atlas(void *userdata) {
+    gl_context *ctx = userdata;
+    atlas_reset(ctx->atlas);
+}
+
+static void gl_render_prepare(void *userdata) {
+    gl_context *ctx = userdata;
+    object_array_prepare(ctx->objects);
+    atlas_next_frame(ctx->atlas);
+}
+
+static void gl_set_blend_mode(gl_context *ctx, object_array_blend_mode request_mode) {
+    if(ctx->current_blend_mode == request_mode)
+        return;
+
+    if(request_mode == MODE_SET) {
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    } else if(request_mode == MODE_ADD) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_TRUE);
+    } else {
+        glColorMask(GL_FALSE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    ctx->current_blend_mode = request_mode;
+}
+
+static void gl_render_area_capture(void *userdata, surface *sur, int x, int y, int w, int h) {
+    gl_context *ctx = userdata;
+    render_target_activate(ctx->target);
+    unsigned char *buffer = omf_calloc(1, w * h);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(x, y, w, h, GL_RED, GL_UNSIGNED_BYTE, buffer);
+    surface_create_from_data_flip(sur, w, h, buffer, BACKGROUND_TRANSPARENT_INDEX);
+    omf_free(buffer);
+}
+
+/**
+ * Hand a finished screenshot readback to its callback. Unless told to wait, returns right away if the
+ * GPU has not finished the readback yet.
+ */
+static void gl_screenshot_poll(gl_context *ctx, bool wait) {
+    if(ctx->screenshot_fence == NULL) {
+        return;
+    }
+    GLenum result;
+    do {
+        result = glClientWaitSync(ctx->screenshot_fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 100000000 : 0);
+    } while(wait && result == GL_TIMEOUT_EXPIRED);
+    if(result == GL_TIMEOUT_EXPIRED) {
+        return;
+    }
+    glDeleteSync(ctx->screenshot_fence);
+    ctx->screenshot_fence = NULL;
+    if(result == GL_WAIT_FAILED) {
+        PERROR("Screenshot readback failed");
+        return;
+    }
+
+    SDL_Rect *r = &ctx->screenshot_rect;
+    size_t size = (size_t)r->w * r->h * 3;
+    bindings_bind_pack_pbo(ctx->screenshot_pbo);
+    void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if(pixels != NULL) {
+        unsigned char *buffer = omf_malloc(size);
+        memcpy(buffer, pixels, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        ctx->screenshot_ready_cb(r, buffer, true);
+    } else {
+        PERROR("Unable to map screenshot buffer");
+    }
+    bindings_unbind_pack_pbo(ctx->screenshot_pbo);
+}
+
+/**
+ * Start reading the frame back into a pixel buffer. The copy runs on the GPU, and gl_screenshot_poll
+ * picks the pixels up on a later frame.
+ */
+static void gl_screenshot_capture(gl_context *ctx) {
+    gl_screenshot_poll(ctx, true); // Only one readback at a time
+    SDL_Rect r = {0, 0, ctx->screen_w, ctx->screen_h};
+    bindings_bind_pack_pbo(ctx->screenshot_pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)r.w * r.h * 3, NULL, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(r.x, r.y, r.w, r.h, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    bindings_unbind_pack_pbo(ctx->screenshot_pbo);
+    ctx->screenshot_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ctx->screenshot_rect = r;
+    ctx->screenshot_ready_cb = ctx->screenshot_cb;
+}
+
+/**
+ * Hand finished frame readbacks to the frame callback, oldest first. Waits for the GPU until no more than
+ * max_pending readbacks are left in flight.
+ */
+static void gl_frame_poll(gl_context *ctx, int max_pending) {
+    while(ctx->frame_pending > 0) {
+        gl_frame_readback *readback = &ctx->frames[ctx->frame_read];
+        bool wait = ctx->frame_pending > max_pending;
+        GLenum result = glClientWaitSync(readback->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 100000000 : 0);
+        if(result == GL_TIMEOUT_EXPIRED) {
+            if(wait) {
+                continue;
+            }
+            return;
+        }
+        glDeleteSync(readback->fence);
+        readback->fence = NULL;
+        ctx->frame_read = (ctx->frame_read + 1) % FRAME_READBACKS;
+        ctx->frame_pending--;
+        if(result == GL_WAIT_FAILED) {
+            PERROR("Frame readback failed");
+            continue;
+        }
+
+        bindings_bind_pack_pbo(readback->pbo);
+        const unsigned char *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, NATIVE_W * NATIVE_H, GL_MAP_READ_BIT);
+        if(pixels != NULL) {
+            // The render target is stored bottom-up.
+            for(int y = 0; y < NATIVE_H; y++) {
+                memcpy(ctx->frame_pixels + y * NATIVE_W, pixels + (NATIVE_H - 1 - y) * NATIVE_W, NATIVE_W);
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            ctx->frame_cb(ctx->frame_pixels, &readback->palette, ctx->frame_cb_data);
+        } else {
+            PERROR("Unable to map frame buffer");
+        }
+        bindings_unbind_pack_pbo(readback->pbo);
+    }
+}
+
+/**
+ * Run the RGBA conversion again, but into an indexed target, and start reading that back.
+ * Expects the RGBA program to be active.
+ */
+static void gl_frame_capture(gl_context *ctx) {
+    gl_frame_poll(ctx, FRAME_READBACKS - 1);
+    gl_frame_readback *readback = &ctx->frames[(ctx->frame_read + ctx->frame_pending) % FRAME_READBACKS];
+
+    render_target_activate(ctx->frame_target);
+    glViewport(0, 0, NATIVE_W, NATIVE_H);
+    bind_uniform_1i(ctx->rgba_prog_id, "show_atlas", 0);
+    bind_uniform_1i(ctx->rgba_prog_id, "output_index", 1);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    bind_uniform_1i(ctx->rgba_prog_id, "output_index", 0);
+
+    bindings_bind_pack_pbo(readback->pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, NATIVE_W * NATIVE_H, NULL, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, NATIVE_W, NATIVE_H, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    bindings_unbind_pack_pbo(readback->pbo);
+    render_target_deactivate();
+
+    readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback->palette = ctx->palette;
+    ctx->frame_pending++;
+}
+
+/**
+ * Set the viewport, and do screen-shakes here.
+ */
+static inline void set_screen_viewport(gl_context *ctx) {
+    float ratio = ctx->screen_w / NATIVE_W;
+    int vp_x = ctx->target_move_x * ratio;
+    int vp_y = ctx->target_move_y * ratio;
+    glViewport(vp_x, vp_y, ctx->viewport_w, ctx->viewport_h); // This is used for screen shakes.
+}
+
+static void gl_render_finish_offscreen(void *userdata) {
+    gl_context *ctx = userdata;
+    bool uploaded = atlas_flush(ctx->atlas);
+    bool changed = object_array_finish(ctx->objects);
+    if(!uploaded && !changed && !ctx->target_dirty) {
+        // Every sprite overwrites what is below it, so drawing the same sprites again would not change anything.
+        return;
+    }
+    ctx->target_dirty = false;
+    ctx->target_drawn = true;
+
+    // Set to VGA emulation state, and render to an indexed surface
+    glViewport(0, 0, NATIVE_W, NATIVE_H);
+    object_array_batch batch;
+    object_array_begin(ctx->objects, &batch);
+    activate_program(ctx->palette_prog_id);
+    render_target_activate(ctx->target);
+
+    object_array_blend_mode mode;
+    while(object_array_get_batch(ctx->objects, &batch, &mode)) {
+        gl_set_blend_mode(ctx, mode);
+        object_array_draw(ctx->objects, &batch);
+    }
+}
+
+/**
+ * Nothing changed, so the screen is left as it is. Wait about as long as presenting would have, so that the
+ * main loop keeps running at the display rate instead of spinning.
+ */
+static void gl_skip_frame(gl_context *ctx) {
+    uint64_t now = SDL_GetTicks64();
+    uint64_t next = ctx->last_frame + ctx->frame_interval;
+    if(next > now) {
+        SDL_Delay(next - now);
+        now = next;
+    }
+    ctx->last_frame = now;
+}
+
+static void gl_render_finish(void *userdata) {
+    gl_context *ctx = userdata;
+    gl_screenshot_poll(ctx, false);
+    gl_frame_poll(ctx, FRAME_READBACKS);
+    ctx->frames_finished++;
+
+    // If palette is dirty, flush it to the texture. Note that the range is inclusive (dirty area is start <= x <= end).
+    vga_index range_start, range_end;
+    vga_palette *palette;
+    bool palette_changed = vga_state_is_palette_dirty(&palette, &range_start, &range_end);
+    if(palette_changed) {
+        shared_set_palette(ctx->shared, palette, range_start, range_end);
+        memcpy(&ctx->palette.colors[range_start], &palette->colors[range_start],
+               (range_end - range_start + 1) * sizeof(vga_color));
+        vga_state_mark_palette_flushed();
+    }
+
+    // If remaps are dirty, do the flush. This should be pretty rare (once per scene change)
+    vga_remap_tables *tables;
+    if(vga_state_is_remap_dirty(&tables)) {
+        remaps_update(ctx->remaps, tables);
+        vga_state_mark_remaps_flushed();
+        ctx->target_dirty = true;
+    }
+
+    gl_render_finish_offscreen(ctx);
+
+    bool present = ctx->target_drawn || palette_changed || ctx->screen_dirty || ctx->screenshot_cb != NULL ||
+                   ctx->frame_cb != NULL || ctx->target_move_x != ctx->presented_move_x ||
+                   ctx->target_move_y != ctx->presented_move_y || ctx->draw_atlas != ctx->presented_draw_atlas;
+    if(!present) {
+        gl_skip_frame(ctx);
+        return;
+    }
+    ctx->frames_drawn += ctx->target_drawn;
+    ctx->frames_presented++;
+    ctx->target_drawn = false;
+    ctx->screen_dirty = false;
+    ctx->presented_move_x = ctx->target_move_x;
+    ctx->presented_move_y = ctx->target_move_y;
+    ctx->presented_draw_atlas = ctx->draw_atlas;
+
+    // Disable render target, and dump its contents as RGBA to the screen.
+    render_target_deactivate();
+    set_screen_viewport(ctx);
+    gl_set_blend_mode(ctx, MODE_SET);
+    activate_program(ctx->rgba_prog_id);
+    bind_uniform_1i(ctx->rgba_prog_id, "show_atlas", ctx->draw_atlas);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+
+    // Snap screenshot from the freshly rendered state.
+    if(ctx->screenshot_cb) {
+        gl_screenshot_capture(ctx);
+        ctx->screenshot_cb = NULL;
+    }
+    if(ctx->frame_cb) {
+        gl_frame_capture(ctx);
+    }
+
+    // Flip buffers. If vsync is off, we should sleep here
+    // so hat our main loop doesn't eat up all cpu :)
+    SDL_GL_SwapWindow(ctx->window);
+    ctx->last_frame = SDL_GetTicks64();
+}
+
+static void gl_close_context(void *userdata) {
+    gl_context *ctx = userdata;
+    gl_screenshot_poll(ctx, true);
+    glDeleteBuffers(1, &ctx->screenshot_pbo);
+    gl_frame_poll(ctx, 0);
+    if(ctx->frame_target != NULL) {
+        for(int i = 0; i < FRAME_READBACKS; i++) {
+            glDeleteBuffers(1, &ctx->frames[i].pbo);
+        }
+        render_target_free(&ctx->frame_target);
+        omf_free(ctx->frame_pixels);
+    }
+    remaps_free(&ctx->remaps);
+    render_target_free(&ctx->target);
+    shared_free(&ctx->shared);
+    object_array_stats stats;
+    object_array_get_stats(ctx->objects, &stats);
+    INFO("Sprite buffer: %u frames, %u had to wait for the GPU (%llu us at most), %u reused the previous sprites.",
+         stats.frames, stats.sync_waits, (unsigned long long)stats.max_frame_wait_us, stats.reused);
+    INFO("Frames: %u, render target drawn on %u and presented on %u of them.", ctx->frames_finished,
+         ctx->frames_drawn, ctx->frames_presented);
+    texture_atlas_stats atlas_stats;
+    atlas_get_stats(ctx->atlas, &atlas_stats);
+    INFO("Texture atlas: %u areas on %u pages, %u uploads in %u flushes, %u evictions, %u shared surfaces saved "
+         "%llu pixels.",
+         atlas_stats.areas, atlas_stats.pages, atlas_stats.uploads, atlas_stats.flushes, atlas_stats.evictions,
+         atlas_stats.shared, (unsigned long long)atlas_stats.shared_pixels);
+    object_array_free(&ctx->objects);
+    atlas_free(&ctx->atlas);
+    delete_program(ctx->palette_prog_id);
+    delete_program(ctx->rgba_prog_id);
+    SDL_GL_DeleteContext(ctx->gl_context);
+    SDL_DestroyWindow(ctx->window);
+    omf_free(ctx);
+    INFO("Video renderer closed.");
+}
+
+static void gl_move_target(void *userdata, int x, int y) {
+    gl_context *ctx = userdata;
+    ctx->target_move_x = x;
+    ctx->target_move_y = y;
+}
+
+static void gl_invalidate(void *userdata) {
+    gl_context *ctx = userdata;
+    ctx->screen_dirty = true;
+}
+
+static void gl_schedule_screenshot(void *userdata, video_screenshot_signal callback) {
+    gl_context *ctx = userdata;
+    ctx->screenshot_cb = callback;
+}
+
+static void gl_record_frames(void *userdata, video_frame_signal callback, void *callback_data) {
+    gl_context *ctx = userdata;
+    gl_frame_poll(ctx, 0);
+    if(callback != NULL && ctx->frame_target == NULL) {
+        ctx->frame_target = render_target_create(TEX_UNIT_FRAME, NATIVE_W, NATIVE_H, GL_R8, GL_RED);
+        for(int i = 0; i < FRAME_READBACKS; i++) {
+            glGenBuffers(1, &ctx->frames[i].pbo);
+        }
+        ctx->frame_pixels = omf_malloc(NATIVE_W * NATIVE_H);
+    }
+    ctx->frame_cb = callback;
+    ctx->frame_cb_data = callback_data;
+}
+
+static void gl_draw_surface(void *userdata, const surface *src_surface, SDL_Rect *dst, int remap_offset,
+                            int remap_rounds, int palette_offset, int palette_limit, int opacity,
+                            unsigned int flip_mode, unsigned int options) {
+    gl_context *ctx = userdata;
+    uint16_t tx, ty, tw, th, page;
+    if(atlas_get(ctx->atlas, src_surface, &tx, &ty, &tw, &th, &page)) {
+        object_array_add(ctx->objects, dst->x, dst->y, dst->w, dst->h, tx, ty, tw, th, page, flip_mode,
+                         src_surface->transparent, remap_offset, remap_rounds, palette_offset, palette_limit, opacity,
+                         options);
+    }
+}
+
+void gl_renderer_set_callbacks(renderer *renderer) {
+    renderer->create = gl_create;
+    renderer->setup_context = gl_setup_context;
+    renderer->reset_context = gl_reset_context;
+    renderer->close_context = gl_close_context;
+    renderer->reset_atlas = gl_reset_atlas;
+    renderer->draw_atlas = gl_draw_atlas;
+    renderer->move_target = gl_move_target;
+    renderer->invalidate = gl_invalidate;
+    renderer->render_prepare = gl_render_prepare;
+    renderer->render_finish_offscreen = gl_render_finish_offscreen;
+    renderer->render_finish = gl_render_finish;
+    renderer->render_area_capture = gl_render_area_capture;
+    renderer->schedule_screenshot = gl_schedule_screenshot;
+    renderer->record_frames = gl_record_frames;
+    renderer->draw_surface = gl_draw_surface;
+}
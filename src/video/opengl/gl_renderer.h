@@ -0,0 +1,8 @@
+#ifndef GL_RENDERER_H
+#define GL_RENDERER_H
+
+#include "video/renderer.h"
+
+void gl_renderer_set_callbacks(renderer *renderer);
+
+#endif // GL_RENDERER_H
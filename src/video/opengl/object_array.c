@@ -1,108 +1,251 @@
+#include <SDL.h>
 #include <assert.h>
 #include <epoxy/gl.h>
 #include <stdalign.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "utils/allocator.h"
 #include "utils/log.h"
 #include "video/enums.h"
+#include "video/opengl/bindings.h"
 #include "video/opengl/object_array.h"
 #include "video/opengl/vao.h"
 #include "video/opengl/vbo.h"
 
-#define OBJ_BYTES (sizeof(object_data) * 4)
-#define MAX_FANS 2048
-#define VBO_SIZE (MAX_FANS * OBJ_BYTES)
+// Sprites the buffers have room for at first. Both the CPU side array and the VBO grow when needed.
+#define INITIAL_CAPACITY 2048
 
+// Frames that can be in flight when the VBO is persistently mapped. Each one gets its own region of the VBO.
+#define RING_REGIONS 3
+
+/**
+ * One sprite. The vertex shader expands this to a quad, so there is no per-vertex data at all.
+ */
 typedef struct {
-    GLfloat x;
-    GLfloat y;
-    GLfloat tex_x;
-    GLfloat tex_y;
-    GLint transparency;
-    GLint remap_offset;
-    GLint remap_rounds;
-    GLint palette_offset;
-    GLint palette_limit;
-    GLint opacity;
-    GLuint options;
+    GLshort x;
+    GLshort y;
+    GLshort w;
+    GLshort h;
+    GLfloat tex_x0; // Texture coordinates for the (x, y) corner. Flipping swaps these with tex_x1/tex_y1.
+    GLfloat tex_y0;
+    GLfloat tex_x1;
+    GLfloat tex_y1;
+    GLshort transparency;
+    GLshort remap_offset;
+    GLshort remap_rounds;
+    GLshort palette_offset;
+    GLshort palette_limit;
+    GLshort opacity;
+    GLushort options;
+    GLushort page; // Atlas page
 } object_data;
 static_assert(4 == alignof(object_data), "object_data alignment is expected to be 4");
+static_assert(40 == sizeof(object_data), "object_data is expected to be tightly packed");
 
 typedef struct object_array {
     GLuint vbo_id;
     GLuint vao_id;
     GLfloat src_w; // Source texture width
     GLfloat src_h; // Source texture height
-    int vbo_flip;
+    int vbo_capacity; // Sprites per VBO region
+    int capacity;
     int item_count;
-    object_data *mapping;
-    GLint fans_starts[MAX_FANS];
-    GLsizei fans_sizes[MAX_FANS];
-    object_array_blend_mode modes[MAX_FANS];
+    object_data *items;
+    object_array_blend_mode *modes;
+
+    // Sprites of the previous frame. If nothing changed, the buffer still holds them and is not written again.
+    int prev_count;
+    object_data *prev_items;
+
+    // Persistent mapping. Without it, the whole VBO is orphaned and mapped again on every frame.
+    bool persistent;
+    char *mapping;
+    int region;
+    bool region_pending; // Region has been drawn from, but not fenced yet
+    GLsync fences[RING_REGIONS];
+
+    object_array_stats stats;
 } object_array;
 
-#define ATTRIB(index, stride, step, size, type, normalize)                                                             \
+#define ATTRIB(index, stride, step, size, type, normalize, type_size)                                                  \
     glVertexAttribPointer(index, size, type, normalize, stride, step);                                                 \
+    glVertexAttribDivisor(index, 1);                                                                                   \
     glEnableVertexAttribArray(index);                                                                                  \
-    step += size * sizeof(GLfloat);                                                                                    \
+    step += size * type_size;                                                                                          \
     index++
 
-#define ATTRIB_I(index, stride, step, size, type)                                                                      \
+#define ATTRIB_I(index, stride, step, size, type, type_size)                                                           \
     glVertexAttribIPointer(index, size, type, stride, step);                                                           \
+    glVertexAttribDivisor(index, 1);                                                                                   \
     glEnableVertexAttribArray(index);                                                                                  \
-    step += size * sizeof(GLint);                                                                                      \
+    step += size * type_size;                                                                                          \
     index++
 
-static void setup_vao_layout(void) {
-    int stride = 4 * sizeof(GLfloat) + 7 * sizeof(GLint);
+/**
+ * Point the per-instance attributes at the given sprite. GL 3.3 has no base instance for draws,
+ * so each batch re-points the attributes at its first sprite instead.
+ */
+static void setup_vao_layout(int first_item) {
+    int stride = sizeof(object_data);
     int index = 0;
     unsigned char *step = 0;
-    ATTRIB(index, stride, step, 2, GL_FLOAT, GL_FALSE);
-    ATTRIB(index, stride, step, 2, GL_FLOAT, GL_FALSE);
-    ATTRIB_I(index, stride, step, 1, GL_INT);
-    ATTRIB_I(index, stride, step, 1, GL_INT);
-    ATTRIB_I(index, stride, step, 1, GL_INT);
-    ATTRIB_I(index, stride, step, 1, GL_INT);
-    ATTRIB_I(index, stride, step, 1, GL_INT);
-    ATTRIB_I(index, stride, step, 1, GL_INT);
-    ATTRIB_I(index, stride, step, 1, GL_UNSIGNED_INT);
+    step += first_item * stride;
+    ATTRIB(index, stride, step, 4, GL_SHORT, GL_FALSE, sizeof(GLshort));
+    ATTRIB(index, stride, step, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat));
+    ATTRIB_I(index, stride, step, 1, GL_SHORT, sizeof(GLshort));
+    ATTRIB_I(index, stride, step, 1, GL_SHORT, sizeof(GLshort));
+    ATTRIB_I(index, stride, step, 1, GL_SHORT, sizeof(GLshort));
+    ATTRIB_I(index, stride, step, 1, GL_SHORT, sizeof(GLshort));
+    ATTRIB_I(index, stride, step, 1, GL_SHORT, sizeof(GLshort));
+    ATTRIB_I(index, stride, step, 1, GL_SHORT, sizeof(GLshort));
+    ATTRIB_I(index, stride, step, 1, GL_UNSIGNED_SHORT, sizeof(GLushort));
+    ATTRIB_I(index, stride, step, 1, GL_UNSIGNED_SHORT, sizeof(GLushort));
+}
+
+static void create_vbo(object_array *array) {
+    if(array->persistent) {
+        GLsizeiptr size = (GLsizeiptr)array->vbo_capacity * RING_REGIONS * sizeof(object_data);
+        array->vbo_id = vbo_create_persistent(size, (void **)&array->mapping);
+    } else {
+        array->vbo_id = vbo_create(array->vbo_capacity * sizeof(object_data));
+    }
+}
+
+/**
+ * Make sure the GPU is done with a ring region before it gets overwritten.
+ */
+static void wait_region(object_array *array, int region) {
+    GLsync fence = array->fences[region];
+    if(fence == NULL) {
+        return;
+    }
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if(status == GL_TIMEOUT_EXPIRED) {
+        uint64_t start = SDL_GetPerformanceCounter();
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while(status == GL_TIMEOUT_EXPIRED);
+        array->stats.frame_waits++;
+        array->stats.frame_wait_us += (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+    }
+    if(status == GL_WAIT_FAILED) {
+        PERROR("Waiting for sprite buffer fence failed");
+    }
+    glDeleteSync(fence);
+    array->fences[region] = NULL;
 }
 
 object_array *object_array_create(GLfloat src_w, GLfloat src_h) {
     object_array *array = omf_calloc(1, sizeof(object_array));
     array->item_count = 0;
-    array->mapping = NULL;
+    array->capacity = INITIAL_CAPACITY;
+    array->items = omf_calloc(array->capacity, sizeof(object_data));
+    array->modes = omf_calloc(array->capacity, sizeof(object_array_blend_mode));
+    array->prev_items = omf_calloc(array->capacity, sizeof(object_data));
     array->src_w = src_w;
     array->src_h = src_h;
-    array->vbo_id = vbo_create(VBO_SIZE);
+    array->vbo_capacity = INITIAL_CAPACITY;
+    array->persistent = vbo_persistent_supported();
+    create_vbo(array);
     array->vao_id = vao_create();
-    setup_vao_layout();
+    setup_vao_layout(0);
+    INFO("Sprite buffer uses %s.", array->persistent ? "a persistently mapped ring" : "buffer orphaning");
     return array;
 }
 
 void object_array_free(object_array **array) {
     object_array *obj = *array;
     if(obj != NULL) {
+        for(int i = 0; i < RING_REGIONS; i++) {
+            if(obj->fences[i] != NULL) {
+                glDeleteSync(obj->fences[i]);
+            }
+        }
         vbo_free(obj->vbo_id);
         vao_free(obj->vao_id);
+        omf_free(obj->items);
+        omf_free(obj->modes);
+        omf_free(obj->prev_items);
         omf_free(obj);
         *array = NULL;
     }
 }
 
 void object_array_prepare(object_array *array) {
-    if(array->mapping != NULL) {
-        PERROR("VBO is already mapped! Remember to call object_array_finish.");
+    array->item_count = 0;
+    array->stats.frame_waits = 0;
+    array->stats.frame_wait_us = 0;
+}
+
+static void finish_persistent(object_array *array) {
+    // Fence the draws that read the previous region, then move on to the next one.
+    if(array->region_pending) {
+        array->fences[array->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        array->region_pending = false;
+    }
+    if(array->item_count == 0) {
         return;
     }
-    array->mapping = vbo_map(array->vbo_id, VBO_SIZE);
-    array->item_count = 0;
+    array->region = (array->region + 1) % RING_REGIONS;
+
+    if(array->item_count > array->vbo_capacity) {
+        // Storage of a persistent buffer cannot be resized, so drain the ring and make a new buffer.
+        for(int i = 0; i < RING_REGIONS; i++) {
+            wait_region(array, i);
+        }
+        vbo_free(array->vbo_id);
+        array->vbo_capacity = array->capacity;
+        create_vbo(array);
+        DEBUG("Object VBO grown to %d sprites per region", array->vbo_capacity);
+    } else {
+        wait_region(array, array->region);
+    }
+
+    size_t offset = (size_t)array->region * array->vbo_capacity * sizeof(object_data);
+    memcpy(array->mapping + offset, array->items, array->item_count * sizeof(object_data));
+    array->region_pending = true;
 }
 
-void object_array_finish(object_array *array) {
-    vbo_unmap(array->vbo_id, array->item_count * OBJ_BYTES);
-    array->mapping = NULL;
+bool object_array_finish(object_array *array) {
+    array->stats.frames++;
+    // The blend modes follow from the sprite data, so comparing the sprites is enough.
+    size_t size = array->item_count * sizeof(object_data);
+    if(array->item_count == array->prev_count && memcmp(array->items, array->prev_items, size) == 0) {
+        array->stats.reused++;
+        return false;
+    }
+    memcpy(array->prev_items, array->items, size);
+    array->prev_count = array->item_count;
+
+    if(array->persistent) {
+        finish_persistent(array);
+        if(array->stats.frame_waits > 0) {
+            array->stats.sync_waits++;
+        }
+        if(array->stats.frame_wait_us > array->stats.max_frame_wait_us) {
+            array->stats.max_frame_wait_us = array->stats.frame_wait_us;
+            DEBUG("Frame %u waited %llu us for the GPU, the longest so far", array->stats.frames,
+                  (unsigned long long)array->stats.frame_wait_us);
+        }
+        return true;
+    }
+    if(array->item_count == 0) {
+        return true;
+    }
+    if(array->item_count > array->vbo_capacity) {
+        array->vbo_capacity = array->capacity;
+        vbo_resize(array->vbo_id, array->vbo_capacity * sizeof(object_data));
+        DEBUG("Object VBO grown to %d sprites", array->vbo_capacity);
+    }
+    void *mapping = vbo_map(array->vbo_id, size);
+    memcpy(mapping, array->items, size);
+    vbo_unmap(array->vbo_id, size);
+    return true;
+}
+
+void object_array_get_stats(const object_array *array, object_array_stats *stats) {
+    *stats = array->stats;
 }
 
 void object_array_begin(const object_array *array, object_array_batch *state) {
@@ -129,56 +272,56 @@ bool object_array_get_batch(const object_array *array, object_array_batch *state
 
 void object_array_draw(const object_array *array, object_array_batch *state) {
     int count = state->end - state->start;
-    glMultiDrawArrays(GL_TRIANGLE_FAN, array->fans_starts + state->start, array->fans_sizes + state->start, count);
+    vao_use(array->vao_id);
+    bindings_bind_vbo(array->vbo_id);
+    setup_vao_layout(array->region * array->vbo_capacity + state->start);
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, count);
+}
+
+static void grow(object_array *array) {
+    array->capacity *= 2;
+    array->items = omf_realloc(array->items, array->capacity * sizeof(object_data));
+    array->modes = omf_realloc(array->modes, array->capacity * sizeof(object_array_blend_mode));
+    array->prev_items = omf_realloc(array->prev_items, array->capacity * sizeof(object_data));
 }
 
-#define COORDS(ptr, cx, cy, tx, ty, transparency, remap_offset, remap_rounds, pal_offset, pal_limit, opacity, options) \
-    ptr.x = cx;                                                                                                        \
-    ptr.y = cy;                                                                                                        \
-    ptr.tex_x = tx;                                                                                                    \
-    ptr.tex_y = ty;                                                                                                    \
-    ptr.transparency = transparency;                                                                                   \
-    ptr.remap_offset = remap_offset;                                                                                   \
-    ptr.remap_rounds = remap_rounds;                                                                                   \
-    ptr.palette_offset = pal_offset;                                                                                   \
-    ptr.palette_limit = pal_limit;                                                                                     \
-    ptr.opacity = opacity;                                                                                             \
-    ptr.options = options;
-
-static void add_item(object_array *array, float dx, float dy, int x, int y, int w, int h, int tx, int ty, int tw,
-                     int th, int flags, int transparency, int remap_offset, int remap_rounds, int pal_offset,
-                     int pal_limit, int opacity, unsigned int options) {
-    float tx0, tx1;
+void object_array_add(object_array *array, int x, int y, int w, int h, int tx, int ty, int tw, int th, int page,
+                      int flags, int transparency, int remap_offset, int remap_rounds, int pal_offset, int pal_limit,
+                      int opacity, unsigned int options) {
+    if(array->item_count >= array->capacity) {
+        grow(array);
+    }
+    float dx = 1.0f / array->src_w;
+    float dy = 1.0f / array->src_h;
+
+    object_data *data = &array->items[array->item_count];
+    data->x = x;
+    data->y = y;
+    data->w = w;
+    data->h = h;
     if(flags & FLIP_HORIZONTAL) {
-        tx0 = (tx + tw) * dx;
-        tx1 = tx * dx;
+        data->tex_x0 = (tx + tw) * dx;
+        data->tex_x1 = tx * dx;
     } else {
-        tx0 = tx * dx;
-        tx1 = (tx + tw) * dx;
+        data->tex_x0 = tx * dx;
+        data->tex_x1 = (tx + tw) * dx;
     }
-
-    float ty0, ty1;
     if(flags & FLIP_VERTICAL) {
-        ty0 = (ty + th) * dy;
-        ty1 = ty * dy;
+        data->tex_y0 = (ty + th) * dy;
+        data->tex_y1 = ty * dy;
     } else {
-        ty0 = ty * dy;
-        ty1 = (ty + th) * dy;
-    }
-
-    object_data *data = (object_data *)array->mapping;
-    int row = array->item_count * 4;
-    COORDS(data[row + 0], x + w, y + h, tx1, ty1, transparency, remap_offset, remap_rounds, pal_offset, pal_limit,
-           opacity, options);
-    COORDS(data[row + 1], x, y + h, tx0, ty1, transparency, remap_offset, remap_rounds, pal_offset, pal_limit, opacity,
-           options);
-    COORDS(data[row + 2], x, y, tx0, ty0, transparency, remap_offset, remap_rounds, pal_offset, pal_limit, opacity,
-           options);
-    COORDS(data[row + 3], x + w, y, tx1, ty0, transparency, remap_offset, remap_rounds, pal_offset, pal_limit, opacity,
-           options);
-
-    array->fans_starts[array->item_count] = array->item_count * 4;
-    array->fans_sizes[array->item_count] = 4;
+        data->tex_y0 = ty * dy;
+        data->tex_y1 = (ty + th) * dy;
+    }
+    data->transparency = transparency;
+    data->remap_offset = remap_offset;
+    data->remap_rounds = remap_rounds;
+    data->palette_offset = pal_offset;
+    data->palette_limit = pal_limit;
+    data->opacity = opacity;
+    data->options = options;
+    data->page = page;
+
     if(remap_rounds > 0) {
         array->modes[array->item_count] = MODE_REMAP;
     } else if(options & SPRITE_INDEX_ADD) {
@@ -188,16 +331,3 @@ static void add_item(object_array *array, float dx, float dy, int x, int y, int
     }
     array->item_count++;
 }
-
-void object_array_add(object_array *array, int x, int y, int w, int h, int tx, int ty, int tw, int th, int flags,
-                      int transparency, int remap_offset, int remap_rounds, int pal_offset, int pal_limit, int opacity,
-                      unsigned int options) {
-    if(array->item_count >= MAX_FANS) {
-        PERROR("Too many objects!");
-        return;
-    }
-    float dx = 1.0f / array->src_w;
-    float dy = 1.0f / array->src_h;
-    add_item(array, dx, dy, x, y, w, h, tx, ty, tw, th, flags, transparency, remap_offset, remap_rounds, pal_offset,
-             pal_limit, opacity, options);
-}
@@ -2,6 +2,7 @@
 #define OBJECT_ARRAY_H
 
 #include "video/enums.h"
+#include <stdint.h>
 
 typedef struct object_array object_array;
 
@@ -12,6 +13,19 @@ typedef enum object_array_blend_mode
     MODE_ADD = 2,
 } object_array_blend_mode;
 
+/**
+ * Counters over all frames so far, and the GPU waits of the last frame. The last frame is the one given to the
+ * latest object_array_finish call.
+ */
+typedef struct object_array_stats {
+    unsigned frames;            ///< Frames submitted
+    unsigned sync_waits;        ///< Frames that had to wait for the GPU to release a buffer region
+    unsigned reused;            ///< Frames that had the same sprites as the previous one, and were not uploaded again
+    unsigned frame_waits;       ///< Times the last frame waited for the GPU
+    uint64_t frame_wait_us;     ///< Microseconds the last frame spent waiting for the GPU
+    uint64_t max_frame_wait_us; ///< Most microseconds any single frame spent waiting for the GPU
+} object_array_stats;
+
 typedef struct {
     int start;
     int end;
@@ -22,12 +36,19 @@ object_array *object_array_create(GLfloat src_w, GLfloat src_h);
 void object_array_free(object_array **array);
 
 void object_array_prepare(object_array *array);
-void object_array_finish(object_array *array);
+
+/**
+ * Upload the sprites of the frame to the GPU.
+ *
+ * @return true if the sprites differ from the ones given to the previous call.
+ */
+bool object_array_finish(object_array *array);
 void object_array_begin(const object_array *array, object_array_batch *state);
 bool object_array_get_batch(const object_array *array, object_array_batch *state, object_array_blend_mode *mode);
 void object_array_draw(const object_array *array, object_array_batch *state);
-void object_array_add(object_array *array, int x, int y, int w, int h, int tx, int ty, int tw, int th, int flags,
-                      int transparency, int remap_offset, int remap_rounds, int pal_offset, int pal_limit, int opacity,
-                      unsigned int options);
+void object_array_get_stats(const object_array *array, object_array_stats *stats);
+void object_array_add(object_array *array, int x, int y, int w, int h, int tx, int ty, int tw, int th, int page,
+                      int flags, int transparency, int remap_offset, int remap_rounds, int pal_offset, int pal_limit,
+                      int opacity, unsigned int options);
 
 #endif // OBJECT_ARRAY_H
@@ -25,3 +25,54 @@ void texture_free(GLuint tex_unit, GLuint id) {
     bindings_unbind_tex(tex_unit, id);
     glDeleteTextures(1, &id);
 }
+
+static void set_array_parameters(void) {
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+}
+
+GLuint texture_array_create(GLuint tex_unit, GLsizei w, GLsizei h, GLsizei layers, GLint internal_format,
+                            GLenum format) {
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    bindings_bind_tex_array(tex_unit, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    set_array_parameters();
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internal_format, w, h, layers, 0, format, GL_UNSIGNED_BYTE, NULL);
+    return id;
+}
+
+/**
+ * Create a larger texture array and copy the old layers into it. The old texture is freed.
+ * Copying goes through a temporary framebuffer, so this only works for color-renderable formats.
+ */
+GLuint texture_array_grow(GLuint tex_unit, GLuint id, GLsizei w, GLsizei h, GLsizei layers, GLsizei new_layers,
+                          GLint internal_format, GLenum format) {
+    GLuint new_id = texture_array_create(tex_unit, w, h, new_layers, internal_format, format);
+    GLuint fbo_id;
+    glGenFramebuffers(1, &fbo_id);
+    bindings_bind_fbo(fbo_id);
+    for(GLsizei layer = 0; layer < layers; layer++) {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, id, 0, layer);
+        glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, w, h);
+    }
+    bindings_unbind_fbo(fbo_id);
+    glDeleteFramebuffers(1, &fbo_id);
+    glDeleteTextures(1, &id);
+    return new_id;
+}
+
+void texture_array_update(GLuint tex_unit, GLuint id, int layer, int x, int y, int w, int h, GLenum format,
+                          const char *bytes) {
+    bindings_bind_tex_array(tex_unit, id);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, w, h, 1, format, GL_UNSIGNED_BYTE, bytes);
+}
+
+void texture_array_free(GLuint tex_unit, GLuint id) {
+    bindings_unbind_tex_array(tex_unit, id);
+    glDeleteTextures(1, &id);
+}
@@ -7,4 +7,12 @@ GLuint texture_create(GLuint tex_unit, GLsizei w, GLsizei h, GLint internal_form
 void texture_update(GLuint tex_unit, GLuint id, int x, int y, int w, int h, GLenum format, const char *bytes);
 void texture_free(GLuint tex_unit, GLuint id);
 
+GLuint texture_array_create(GLuint tex_unit, GLsizei w, GLsizei h, GLsizei layers, GLint internal_format,
+                            GLenum format);
+GLuint texture_array_grow(GLuint tex_unit, GLuint id, GLsizei w, GLsizei h, GLsizei layers, GLsizei new_layers,
+                          GLint internal_format, GLenum format);
+void texture_array_update(GLuint tex_unit, GLuint id, int layer, int x, int y, int w, int h, GLenum format,
+                          const char *bytes);
+void texture_array_free(GLuint tex_unit, GLuint id);
+
 #endif // TEXTURE_H
@@ -1,47 +1,141 @@
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "utils/allocator.h"
 #include "utils/hashmap.h"
 #include "utils/log.h"
-#include "utils/vector.h"
+#include "video/opengl/bindings.h"
 #include "video/opengl/texture.h"
 #include "video/opengl/texture_atlas.h"
 
-// WIP
+// Upper limit for atlas pages. Every page is a full size R8 layer of the texture array.
+#define ATLAS_MAX_PAGES 8
 
 typedef struct {
     uint16_t x;
     uint16_t y;
     uint16_t w;
     uint16_t h;
+    uint16_t page;
+    uint32_t generation; // Page generation the zone was placed in
 } zone;
-static_assert(8 == sizeof(zone), "zone should pack into 8 bytes");
+
+/**
+ * Identifies a surface by its size and pixels, so that the same image keeps its atlas area even when it
+ * is loaded again as a new surface.
+ */
+typedef struct {
+    uint64_t hash;
+    uint16_t w;
+    uint16_t h;
+    uint32_t unused; // Keeps the key free of padding, since it is hashed as raw bytes
+} content_key;
+
+/**
+ * Remembers which content a surface guid had, so that the pixels are only hashed once per surface.
+ */
+typedef struct {
+    content_key key;
+    zone zone;
+} surface_alias;
+
+typedef struct {
+    zone zone;
+    unsigned char *pixels; // Copy of the content, since equal hashes do not prove equal pixels
+} atlas_area;
+
+/**
+ * One segment of the skyline; the area below y is taken, everything above it is free.
+ */
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+} skyline_node;
+
+typedef struct {
+    skyline_node *nodes; // Sorted by x, always covers the whole page width
+    int node_count;
+    uint32_t last_used;  // Last frame any item of the page was drawn on
+    uint32_t generation; // Bumped whenever the page is emptied
+    uint32_t surfaces;   // Surfaces given an area of this page since the last atlas_reset
+} atlas_page;
+
+/**
+ * An area waiting to be uploaded. The pixels are in the staging buffer, starting at offset.
+ */
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t page;
+    size_t offset;
+} pending_upload;
 
 typedef struct texture_atlas {
-    hashmap items;
-    vector free_space;
+    hashmap items;   // content_key -> atlas_area
+    hashmap aliases; // surface guid -> surface_alias
+    atlas_page pages[ATLAS_MAX_PAGES];
+    int page_count;
+    int max_pages;
+    uint32_t frame;
+    texture_atlas_stats stats;
+
+    // Misses of the current frame, uploaded together by atlas_flush.
+    char *staging;
+    size_t staging_size;
+    size_t staging_used;
+    pending_upload *pending;
+    int pending_count;
+    int pending_capacity;
+    GLuint pbo_id;
+
     GLuint texture_id;
     uint16_t w;
     uint16_t h;
     GLuint tex_unit;
 } texture_atlas;
 
-static inline int zone_perimeter(zone *zone) {
-    return zone->w * 2 + zone->h * 2;
+static void page_reset(texture_atlas *atlas, atlas_page *page) {
+    page->nodes[0].x = 0;
+    page->nodes[0].y = 0;
+    page->nodes[0].w = atlas->w;
+    page->node_count = 1;
+    page->last_used = 0;
+    page->generation++;
+    page->surfaces = 0;
+}
+
+static void page_create(texture_atlas *atlas, atlas_page *page) {
+    // Every node is at least one pixel wide, so the skyline can never have more nodes than that.
+    page->nodes = omf_calloc(atlas->w, sizeof(skyline_node));
+    page_reset(atlas, page);
+}
+
+static void area_free(void *value) {
+    atlas_area *area = value;
+    omf_free(area->pixels);
 }
 
 texture_atlas *atlas_create(GLuint tex_unit, uint16_t width, uint16_t height) {
     texture_atlas *atlas = omf_calloc(1, sizeof(texture_atlas));
-    hashmap_create(&atlas->items);
-    vector_create(&atlas->free_space, sizeof(zone));
+    hashmap_create_cb(&atlas->items, area_free);
+    hashmap_create(&atlas->aliases);
     atlas->w = width;
     atlas->h = height;
     atlas->tex_unit = tex_unit;
-    atlas->texture_id = texture_create(tex_unit, width, height, GL_R8, GL_RED);
-    zone item = {0, 0, width, height};
-    vector_append(&atlas->free_space, &item);
-    DEBUG("Texture atlas %dx%d created", width, height);
+    atlas->frame = 1;
+
+    GLint max_layers;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    atlas->max_pages = max_layers < ATLAS_MAX_PAGES ? max_layers : ATLAS_MAX_PAGES;
+    atlas->page_count = 1;
+    page_create(atlas, &atlas->pages[0]);
+    atlas->texture_id = texture_array_create(tex_unit, width, height, 1, GL_R8, GL_RED);
+    glGenBuffers(1, &atlas->pbo_id);
+    DEBUG("Texture atlas %dx%d created, up to %d pages", width, height, atlas->max_pages);
     return atlas;
 }
 
@@ -49,8 +143,15 @@ void atlas_free(texture_atlas **atlas) {
     texture_atlas *obj = *atlas;
     if(obj != NULL) {
         hashmap_free(&obj->items);
-        vector_free(&obj->free_space);
-        texture_free(obj->tex_unit, obj->texture_id);
+        hashmap_free(&obj->aliases);
+        for(int i = 0; i < obj->page_count; i++) {
+            omf_free(obj->pages[i].nodes);
+        }
+        texture_array_free(obj->tex_unit, obj->texture_id);
+        bindings_unbind_pbo(obj->pbo_id);
+        glDeleteBuffers(1, &obj->pbo_id);
+        omf_free(obj->staging);
+        omf_free(obj->pending);
         omf_free(obj);
         *atlas = NULL;
         DEBUG("Texture atlas freed");
@@ -58,141 +159,357 @@ void atlas_free(texture_atlas **atlas) {
 }
 
 /**
- * Finds the first free area that matches our minimum requirements.
+ * Finds the height an area of width w would sit at, if its left edge were placed on the given node.
+ * Returns -1 if the area would not fit there.
  */
-static bool find_free_space(const texture_atlas *atlas, uint16_t w, uint16_t h, int *got_index, zone *got_zone) {
-    unsigned int vec_size = vector_size(&atlas->free_space);
-    zone *best_item = NULL, *item;
-    int seek_limit = 10;
-    int best_index = -1, index;
-    int best_perimeter = 4 * 4096 + 1, perimeter;
-    for(int i = 0; i < (int)vec_size; i++) {
-        index = vec_size - i - 1;
-        item = vector_get(&atlas->free_space, index);
-        if(item->w >= w && item->h >= h) {
-            perimeter = zone_perimeter(item);
-            if(perimeter < best_perimeter) {
-                best_index = index;
-                best_perimeter = perimeter;
-                best_item = item;
-            }
+static int skyline_fit(const texture_atlas *atlas, const atlas_page *page, int index, uint16_t w, uint16_t h) {
+    int x = page->nodes[index].x;
+    if(x + w > atlas->w) {
+        return -1;
+    }
+    int y = 0;
+    int width_left = w;
+    for(int i = index; width_left > 0; i++) {
+        if(page->nodes[i].y > y) {
+            y = page->nodes[i].y;
         }
-        if(best_index >= 0)
-            seek_limit--;
-        if(!seek_limit)
-            break;
+        if(y + h > atlas->h) {
+            return -1;
+        }
+        width_left -= page->nodes[i].w;
     }
-    if(best_index == -1) {
+    return y;
+}
+
+/**
+ * Finds the bottom-left position for an area: the lowest top edge, and the leftmost one of those.
+ */
+static bool skyline_find(const texture_atlas *atlas, const atlas_page *page, uint16_t w, uint16_t h, int *got_index,
+                         uint16_t *got_y) {
+    int best_index = -1;
+    int best_top = atlas->h + 1;
+    int best_y = 0;
+    for(int i = 0; i < page->node_count; i++) {
+        int y = skyline_fit(atlas, page, i, w, h);
+        if(y >= 0 && y + h < best_top) {
+            best_index = i;
+            best_top = y + h;
+            best_y = y;
+        }
+    }
+    if(best_index < 0) {
         return false;
     }
     *got_index = best_index;
-    memcpy(got_zone, best_item, sizeof(zone));
+    *got_y = best_y;
     return true;
 }
 
 /**
- * Split found space into smaller pieces.
+ * Raise the skyline over a newly placed area, and merge the nodes it covers.
  */
-static void split_space(const zone *src, uint16_t w, uint16_t h, zone *a, zone *b) {
-    uint16_t rw = src->w - w;
-    uint16_t rh = src->h - h;
-    if(rh > rw) {
-        a->x = src->x + w;
-        a->y = src->y;
-        a->w = rw;
-        a->h = h;
-        b->x = src->x;
-        b->y = src->y + h;
-        b->w = src->w;
-        b->h = rh;
-    } else {
-        a->x = src->x + w;
-        a->y = src->y;
-        a->w = rw;
-        a->h = src->h;
-        b->x = src->x;
-        b->y = src->y + h;
-        b->w = w;
-        b->h = rh;
+static void skyline_add(atlas_page *page, int index, uint16_t w, uint16_t h, uint16_t y) {
+    skyline_node node = {page->nodes[index].x, y + h, w};
+    memmove(&page->nodes[index + 1], &page->nodes[index], (page->node_count - index) * sizeof(skyline_node));
+    page->nodes[index] = node;
+    page->node_count++;
+
+    // Cut away the parts of the following nodes that are now under the new one.
+    int i = index + 1;
+    while(i < page->node_count) {
+        skyline_node *prev = &page->nodes[i - 1];
+        skyline_node *cur = &page->nodes[i];
+        int overlap = prev->x + prev->w - cur->x;
+        if(overlap <= 0) {
+            break;
+        }
+        if(overlap < cur->w) {
+            cur->x += overlap;
+            cur->w -= overlap;
+            break;
+        }
+        memmove(cur, cur + 1, (page->node_count - i - 1) * sizeof(skyline_node));
+        page->node_count--;
     }
-}
 
-static int space_sort(const void *a_ptr, const void *b_ptr) {
-    zone *a = (zone *)a_ptr;
-    zone *b = (zone *)b_ptr;
-    int a_size = a->w + a->h;
-    int b_size = b->w + b->h;
-    return b_size - a_size;
+    // Merge neighbours at the same height.
+    for(i = 0; i < page->node_count - 1; i++) {
+        if(page->nodes[i].y == page->nodes[i + 1].y) {
+            page->nodes[i].w += page->nodes[i + 1].w;
+            memmove(&page->nodes[i + 1], &page->nodes[i + 2], (page->node_count - i - 2) * sizeof(skyline_node));
+            page->node_count--;
+            i--;
+        }
+    }
 }
 
-bool atlas_insert(texture_atlas *atlas, const char *bytes, uint16_t w, uint16_t h, uint16_t *nx, uint16_t *ny) {
-    zone free;
+static bool page_insert(texture_atlas *atlas, int page_index, uint16_t w, uint16_t h, zone *got) {
+    atlas_page *page = &atlas->pages[page_index];
     int index;
-    if(!find_free_space(atlas, w, h, &index, &free)) {
+    uint16_t y;
+    if(!skyline_find(atlas, page, w, h, &index, &y)) {
+        return false;
+    }
+    got->x = page->nodes[index].x;
+    got->y = y;
+    got->w = w;
+    got->h = h;
+    got->page = page_index;
+    got->generation = page->generation;
+    skyline_add(page, index, w, h, y);
+    return true;
+}
+
+static bool add_page(texture_atlas *atlas) {
+    if(atlas->page_count >= atlas->max_pages) {
+        return false;
+    }
+    atlas->texture_id = texture_array_grow(atlas->tex_unit, atlas->texture_id, atlas->w, atlas->h, atlas->page_count,
+                                           atlas->page_count + 1, GL_R8, GL_RED);
+    page_create(atlas, &atlas->pages[atlas->page_count]);
+    atlas->page_count++;
+    INFO("Texture atlas grown to %d pages", atlas->page_count);
+    return true;
+}
+
+static bool evict_before(const atlas_page *a, const atlas_page *b) {
+    if((a->surfaces == 0) != (b->surfaces == 0)) {
+        return a->surfaces == 0;
+    }
+    return a->last_used < b->last_used;
+}
+
+/**
+ * Empty a page to make room. Pages that no current surface refers to go first, since their pixels are
+ * only kept in case an earlier image comes back. Otherwise the least recently used page goes. Pages used
+ * on the current frame are never evicted, since sprites that have already been queued would then be
+ * drawn with the wrong pixels.
+ */
+static bool evict_page(texture_atlas *atlas, int *evicted) {
+    int oldest = -1;
+    for(int i = 0; i < atlas->page_count; i++) {
+        if(atlas->pages[i].last_used >= atlas->frame) {
+            continue;
+        }
+        if(oldest < 0 || evict_before(&atlas->pages[i], &atlas->pages[oldest])) {
+            oldest = i;
+        }
+    }
+    if(oldest < 0) {
+        return false;
+    }
+
+    iterator it;
+    hashmap_pair *pair;
+    hashmap_iter_begin(&atlas->items, &it);
+    while((pair = iter_next(&it)) != NULL) {
+        if(((atlas_area *)pair->value)->zone.page == oldest) {
+            hashmap_delete(&atlas->items, &it);
+        }
+    }
+    // Uploads still waiting for this page would land under the new areas.
+    int kept = 0;
+    for(int i = 0; i < atlas->pending_count; i++) {
+        if(atlas->pending[i].page != oldest) {
+            atlas->pending[kept++] = atlas->pending[i];
+        }
+    }
+    atlas->pending_count = kept;
+
+    page_reset(atlas, &atlas->pages[oldest]);
+    atlas->stats.evictions++;
+    DEBUG("Texture atlas page %d evicted", oldest);
+    *evicted = oldest;
+    return true;
+}
+
+static void queue_upload(texture_atlas *atlas, const zone *zone, const char *bytes) {
+    size_t size = (size_t)zone->w * zone->h;
+    if(atlas->staging_used + size > atlas->staging_size) {
+        size_t new_size = atlas->staging_size > 0 ? atlas->staging_size : 65536;
+        while(atlas->staging_used + size > new_size) {
+            new_size *= 2;
+        }
+        atlas->staging = omf_realloc(atlas->staging, new_size);
+        atlas->staging_size = new_size;
+    }
+    if(atlas->pending_count >= atlas->pending_capacity) {
+        atlas->pending_capacity = atlas->pending_capacity > 0 ? atlas->pending_capacity * 2 : 64;
+        atlas->pending = omf_realloc(atlas->pending, atlas->pending_capacity * sizeof(pending_upload));
+    }
+
+    pending_upload *upload = &atlas->pending[atlas->pending_count++];
+    upload->x = zone->x;
+    upload->y = zone->y;
+    upload->w = zone->w;
+    upload->h = zone->h;
+    upload->page = zone->page;
+    upload->offset = atlas->staging_used;
+    memcpy(atlas->staging + atlas->staging_used, bytes, size);
+    atlas->staging_used += size;
+}
+
+static bool atlas_place(texture_atlas *atlas, const char *bytes, uint16_t w, uint16_t h, zone *found) {
+    if(w > atlas->w || h > atlas->h) {
+        PERROR("Texture atlas cannot fit a %dx%d area", w, h);
+        return false;
+    }
+
+    bool placed = false;
+    for(int i = 0; i < atlas->page_count && !placed; i++) {
+        placed = page_insert(atlas, i, w, h, found);
+    }
+    if(!placed && add_page(atlas)) {
+        placed = page_insert(atlas, atlas->page_count - 1, w, h, found);
+    }
+    int evicted;
+    if(!placed && evict_page(atlas, &evicted)) {
+        placed = page_insert(atlas, evicted, w, h, found);
+    }
+    if(!placed) {
         PERROR("Texture atlas has no room for %dx%d area", w, h);
         return false;
     }
 
-    // Try to split the found space into smaller areas, and add those to the end of the list.
-    // Note that if the found area exactly matches the wanted one, we just clear out the found block.
-    if(free.w == w && free.h == h) {
-        vector_delete_at(&atlas->free_space, index);
+    queue_upload(atlas, found, bytes);
+    atlas->pages[found->page].last_used = atlas->frame;
+    atlas->stats.uploads++;
+    return true;
+}
+
+bool atlas_insert(texture_atlas *atlas, const char *bytes, uint16_t w, uint16_t h, uint16_t *nx, uint16_t *ny,
+                  uint16_t *npage) {
+    zone found;
+    if(!atlas_place(atlas, bytes, w, h, &found)) {
+        return false;
+    }
+    *nx = found.x;
+    *ny = found.y;
+    *npage = found.page;
+    return true;
+}
+
+// Multiplicative hash that eats the pixels eight bytes at a time, with a splitmix64 finalizer.
+static uint64_t hash_pixels(const unsigned char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ len;
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(uint64_t));
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 32;
+    }
+    for(; i < len; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+static void content_key_create(content_key *key, const surface *surface) {
+    key->hash = hash_pixels(surface->data, (size_t)surface->w * surface->h);
+    key->w = surface->w;
+    key->h = surface->h;
+    key->unused = 0;
+}
+
+static inline bool zone_valid(const texture_atlas *atlas, const zone *zone) {
+    return zone->generation == atlas->pages[zone->page].generation;
+}
+
+bool atlas_get(texture_atlas *atlas, const surface *surface, uint16_t *x, uint16_t *y, uint16_t *w, uint16_t *h,
+               uint16_t *page) {
+    content_key key;
+    zone found;
+
+    // Surfaces that have been drawn before know their content key, and usually their area as well.
+    surface_alias *alias;
+    if(hashmap_iget(&atlas->aliases, surface->guid, (void **)&alias, NULL) == 0) {
+        if(zone_valid(atlas, &alias->zone)) {
+            found = alias->zone;
+            goto found_zone;
+        }
+        key = alias->key;
     } else {
-        zone split_a, split_b;
-        split_space(&free, w, h, &split_a, &split_b);
-        int size_a = split_a.w * split_a.h;
-        int size_b = split_b.w * split_b.h;
-        if(size_a == 0) {
-            vector_set(&atlas->free_space, index, &split_b);
-        } else if(size_b == 0) {
-            vector_set(&atlas->free_space, index, &split_a);
-        } else if(size_a < size_b) {
-            vector_set(&atlas->free_space, index, &split_b);
-            vector_append(&atlas->free_space, &split_a);
-        } else {
-            vector_set(&atlas->free_space, index, &split_a);
-            vector_append(&atlas->free_space, &split_b);
+        content_key_create(&key, surface);
+    }
+
+    // The same pixels may already be in the atlas from another surface, or from an earlier scene. Equal
+    // hashes are confirmed against the stored pixels; on a collision the surface gets an area of its own,
+    // which is not offered for sharing.
+    size_t size = (size_t)surface->w * surface->h;
+    atlas_area *area;
+    bool known = hashmap_get(&atlas->items, &key, sizeof(content_key), (void **)&area, NULL) == 0;
+    if(known && memcmp(area->pixels, surface->data, size) == 0) {
+        atlas->stats.shared++;
+        atlas->stats.shared_pixels += size;
+        found = area->zone;
+    } else {
+        if(!atlas_place(atlas, (const char *)surface->data, surface->w, surface->h, &found)) {
+            return false;
+        }
+        if(!known) {
+            atlas_area new_area = {found, omf_malloc(size)};
+            memcpy(new_area.pixels, surface->data, size);
+            hashmap_put(&atlas->items, &key, sizeof(content_key), &new_area, sizeof(atlas_area));
         }
-        vector_sort(&atlas->free_space, space_sort);
     }
+    atlas->pages[found.page].surfaces++;
+    surface_alias new_alias = {key, found};
+    hashmap_iput(&atlas->aliases, surface->guid, &new_alias, sizeof(surface_alias));
 
-    // Split found, add the area to the atlas.
-    texture_update(atlas->tex_unit, atlas->texture_id, free.x, free.y, w, h, GL_RED, bytes);
-    *nx = free.x;
-    *ny = free.y;
+found_zone:
+    atlas->pages[found.page].last_used = atlas->frame;
+    *x = found.x;
+    *y = found.y;
+    *w = surface->w;
+    *h = surface->h;
+    *page = found.page;
     return true;
 }
 
-bool atlas_get(texture_atlas *atlas, const surface *surface, uint16_t *x, uint16_t *y, uint16_t *w, uint16_t *h) {
-    // First, check if item is already in the texture atlas. If it is, return coords immediately.
-    zone *coords;
-    if(hashmap_iget(&atlas->items, surface->guid, (void **)&coords, NULL) == 0) {
-        *x = coords->x;
-        *y = coords->y;
-        *w = surface->w;
-        *h = surface->h;
-        return true;
+bool atlas_flush(texture_atlas *atlas) {
+    if(atlas->pending_count == 0) {
+        return false;
     }
 
-    // If item is NOT in the texture atlas, add it now.
-    uint16_t nx, ny;
-    if(atlas_insert(atlas, (const char *)surface->data, surface->w, surface->h, &nx, &ny)) {
-        *x = nx;
-        *y = ny;
-        *w = surface->w;
-        *h = surface->h;
-        zone cached = {nx, ny, surface->w, surface->h};
-        hashmap_iput(&atlas->items, surface->guid, &cached, sizeof(zone));
-        return true;
+    // Hand all staged pixels to the driver at once. While the buffer is bound, the pixel pointers
+    // given to texture uploads are offsets into it.
+    bindings_bind_pbo(atlas->pbo_id);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, atlas->staging_used, atlas->staging, GL_STREAM_DRAW);
+    for(int i = 0; i < atlas->pending_count; i++) {
+        const pending_upload *upload = &atlas->pending[i];
+        texture_array_update(atlas->tex_unit, atlas->texture_id, upload->page, upload->x, upload->y, upload->w,
+                             upload->h, GL_RED, (const char *)(uintptr_t)upload->offset);
     }
+    bindings_unbind_pbo(atlas->pbo_id);
+
+    atlas->stats.flushes++;
+    atlas->pending_count = 0;
+    atlas->staging_used = 0;
+    return true;
+}
 
-    return false;
+void atlas_next_frame(texture_atlas *atlas) {
+    atlas->frame++;
 }
 
 void atlas_reset(texture_atlas *atlas) {
-    hashmap_clear(&atlas->items);
-    vector_clear(&atlas->free_space);
-    zone item = {0, 0, atlas->w, atlas->h};
-    vector_append(&atlas->free_space, &item);
-    INFO("Texture atlas reset");
+    // Pixels stay in place for the next users of the same content; only the surfaces are forgotten.
+    DEBUG("Texture atlas forgets %u surfaces, keeps %u areas", hashmap_reserved(&atlas->aliases),
+          hashmap_reserved(&atlas->items));
+    hashmap_clear(&atlas->aliases);
+    for(int i = 0; i < atlas->page_count; i++) {
+        atlas->pages[i].surfaces = 0;
+    }
+}
+
+void atlas_get_stats(const texture_atlas *atlas, texture_atlas_stats *stats) {
+    *stats = atlas->stats;
+    stats->areas = hashmap_reserved(&atlas->items);
+    stats->pages = atlas->page_count;
 }
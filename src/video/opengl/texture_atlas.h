@@ -7,11 +7,41 @@
 
 typedef struct texture_atlas texture_atlas;
 
+typedef struct texture_atlas_stats {
+    unsigned uploads;       ///< Areas placed and uploaded
+    unsigned shared;        ///< Surfaces that got the pixels of another surface with identical content
+    uint64_t shared_pixels; ///< Atlas pixels that sharing saved from being uploaded again
+    unsigned evictions;     ///< Pages emptied to make room
+    unsigned flushes;       ///< Frames that had uploads to flush
+    unsigned areas;         ///< Areas currently in the atlas
+    unsigned pages;         ///< Pages currently allocated
+} texture_atlas_stats;
+
 texture_atlas *atlas_create(GLuint tex_unit, uint16_t width, uint16_t height);
 void atlas_free(texture_atlas **atlas);
 
-bool atlas_insert(texture_atlas *atlas, const char *bytes, uint16_t w, uint16_t h, uint16_t *nx, uint16_t *ny);
-bool atlas_get(texture_atlas *atlas, const surface *surface, uint16_t *x, uint16_t *y, uint16_t *w, uint16_t *h);
+bool atlas_insert(texture_atlas *atlas, const char *bytes, uint16_t w, uint16_t h, uint16_t *nx, uint16_t *ny,
+                  uint16_t *npage);
+bool atlas_get(texture_atlas *atlas, const surface *surface, uint16_t *x, uint16_t *y, uint16_t *w, uint16_t *h,
+               uint16_t *page);
+
+/**
+ * Upload the pixels of every area added since the last flush. Must be called before drawing from the atlas.
+ *
+ * @return true if anything was uploaded.
+ */
+bool atlas_flush(texture_atlas *atlas);
+
+/**
+ * Start a new frame. Pages that have not been used on the current frame may be evicted to make room.
+ */
+void atlas_next_frame(texture_atlas *atlas);
+
+/**
+ * Forget the surfaces that have been drawn so far. Their pixels stay in the atlas, and are reused by
+ * any later surface with the same content.
+ */
 void atlas_reset(texture_atlas *atlas);
+void atlas_get_stats(const texture_atlas *atlas, texture_atlas_stats *stats);
 
 #endif // TEXTURE_ATLAS_H
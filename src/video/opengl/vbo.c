@@ -9,6 +9,25 @@ GLuint vbo_create(GLsizeiptr size) {
     return id;
 }
 
+bool vbo_persistent_supported(void) {
+    return epoxy_gl_version() >= 44 || epoxy_has_gl_extension("GL_ARB_buffer_storage");
+}
+
+GLuint vbo_create_persistent(GLsizeiptr size, void **mapping) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLuint id;
+    glGenBuffers(1, &id);
+    bindings_bind_vbo(id);
+    glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+    *mapping = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    return id;
+}
+
+void vbo_resize(GLuint id, GLsizeiptr size) {
+    bindings_bind_vbo(id);
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+}
+
 void *vbo_map(GLuint id, GLsizei size) {
     bindings_bind_vbo(id);
     return glMapBufferRange(GL_ARRAY_BUFFER, 0, size,
@@ -2,8 +2,14 @@
 #define VBO_H
 
 #include <epoxy/gl.h>
+#include <stdbool.h>
 
 GLuint vbo_create(GLsizeiptr size);
+void vbo_resize(GLuint id, GLsizeiptr size);
+
+// Persistently mapped buffers stay mapped until freed. The mapping is coherent, so writes need no flushing.
+bool vbo_persistent_supported(void);
+GLuint vbo_create_persistent(GLsizeiptr size, void **mapping);
 void *vbo_map(GLuint id, GLsizei size);
 void vbo_unmap(GLuint id, GLsizei size);
 void vbo_free(GLuint id);
@@ -0,0 +1,39 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <SDL.h>
+#include <stdbool.h>
+
+#include "video/surface.h"
+#include "video/video.h"
+
+/**
+ * Rendering backend interface. video.c forwards all of its work to one of these, so that the
+ * rest of the engine does not need to know whether there is a real window and GL context behind it.
+ */
+typedef struct renderer {
+    void *ctx;
+
+    void (*create)(struct renderer *renderer);
+    bool (*setup_context)(void *ctx, int window_w, int window_h, bool fullscreen, bool vsync);
+    bool (*reset_context)(void *ctx, int window_w, int window_h, bool fullscreen, bool vsync);
+    void (*close_context)(void *ctx);
+
+    void (*reset_atlas)(void *ctx);
+    void (*draw_atlas)(void *ctx, bool draw_atlas);
+    void (*move_target)(void *ctx, int x, int y);
+    void (*invalidate)(void *ctx);
+
+    void (*render_prepare)(void *ctx);
+    void (*render_finish_offscreen)(void *ctx);
+    void (*render_finish)(void *ctx);
+    void (*render_area_capture)(void *ctx, surface *sur, int x, int y, int w, int h);
+    void (*schedule_screenshot)(void *ctx, video_screenshot_signal callback);
+    void (*record_frames)(void *ctx, video_frame_signal callback, void *userdata);
+
+    void (*draw_surface)(void *ctx, const surface *src_surface, SDL_Rect *dst, int remap_offset, int remap_rounds,
+                         int palette_offset, int palette_limit, int opacity, unsigned int flip_mode,
+                         unsigned int options);
+} renderer;
+
+#endif // RENDERER_H
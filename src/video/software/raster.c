@@ -0,0 +1,209 @@
+#include <math.h>
+#include <string.h>
+
+#include "utils/allocator.h"
+#include "utils/miscmath.h"
+#include "video/enums.h"
+#include "video/software/raster.h"
+
+// Picked the same way as object_array_add picks the blend mode.
+typedef enum
+{
+    RASTER_SET,
+    RASTER_REMAP,
+    RASTER_ADD,
+} raster_mode;
+
+void raster_target_create(raster_target *target, int w, int h) {
+    size_t size = (size_t)w * h;
+    target->w = w;
+    target->h = h;
+    target->index = omf_calloc(4, size);
+    target->remap_index = target->index + size;
+    target->remap_rounds = target->index + size * 2;
+    target->add = target->index + size * 3;
+    target->columns = omf_calloc(w, sizeof(int));
+    target->row = omf_calloc(w, 1);
+    target->keep = omf_calloc(w, 1);
+}
+
+void raster_target_free(raster_target *target) {
+    omf_free(target->index);
+    target->remap_index = NULL;
+    target->remap_rounds = NULL;
+    target->add = NULL;
+    omf_free(target->columns);
+    omf_free(target->row);
+    omf_free(target->keep);
+}
+
+/**
+ * Every step of palette.frag apart from the opacity noise depends only on the source index. Run those
+ * steps once for each possible index, so that the pixel loops are plain table lookups.
+ */
+static void build_lut(const raster_sprite *s, const vga_remap_tables *remaps, raster_mode mode, uint8_t *lut) {
+    int row = clamp(s->remap_offset, 0, VGA_REMAP_COUNT - 1);
+    for(int i = 0; i < 256; i++) {
+        int index = i;
+        if(index <= s->palette_limit) {
+            index = min2(max2(index + s->palette_offset, 0), s->palette_limit);
+        }
+        int remapped = remaps->tables[row].data[index];
+        if(s->options & REMAP_SPRITE) {
+            index = remapped;
+        }
+        if(s->options & SPRITE_MASK) {
+            index = 1;
+        }
+        switch(mode) {
+            case RASTER_REMAP:
+                lut[i] = clamp(s->remap_offset + index, 0, 255);
+                break;
+            case RASTER_ADD:
+                lut[i] = min2(index * 60, 255);
+                break;
+            default:
+                lut[i] = index;
+                break;
+        }
+    }
+}
+
+// The noise() function of palette.frag, at the given fragment center.
+static inline float decimate_noise(float x, float y) {
+    const float phi = 1.61803398874989484820459f;
+    float dx = x * phi - x;
+    float dy = y * phi - y;
+    float v = tanf(sqrtf(dx * dx + dy * dy)) * x;
+    return v - floorf(v);
+}
+
+// Nearest texel for a destination pixel, sampled at its center like the GPU does.
+static inline int source_coord(int dst, int dst_size, int src_size, bool flip) {
+    int src = (int)(((int64_t)dst * 2 + 1) * src_size / (dst_size * 2));
+    return flip ? src_size - 1 - src : src;
+}
+
+void raster_draw(raster_target *target, const vga_remap_tables *remaps, const raster_sprite *sprite) {
+    const raster_sprite *s = sprite;
+    if(s->w <= 0 || s->h <= 0 || s->src_w <= 0 || s->src_h <= 0) {
+        return;
+    }
+    int x0 = max2(s->x, 0);
+    int x1 = min2(s->x + s->w, target->w);
+    int y0 = max2(s->y, 0);
+    int y1 = min2(s->y + s->h, target->h);
+    if(x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    raster_mode mode = RASTER_SET;
+    if(s->remap_rounds > 0) {
+        mode = RASTER_REMAP;
+    } else if(s->options & SPRITE_INDEX_ADD) {
+        mode = RASTER_ADD;
+    }
+    uint8_t lut[256];
+    build_lut(s, remaps, mode, lut);
+    uint8_t rounds = clamp(s->remap_rounds, 0, 255);
+
+    int count = x1 - x0;
+    bool hflip = s->flip_mode & FLIP_HORIZONTAL;
+    bool direct = s->w == s->src_w && !hflip;
+    for(int i = 0; i < count; i++) {
+        target->columns[i] = source_coord(x0 + i - s->x, s->w, s->src_w, hflip);
+    }
+    bool decimate = s->opacity < 255;
+    float limit = s->opacity / 255.0f;
+
+    for(int y = y0; y < y1; y++) {
+        int sy = source_coord(y - s->y, s->h, s->src_h, s->flip_mode & FLIP_VERTICAL);
+        const uint8_t *src = s->pixels + (size_t)sy * s->src_w;
+        uint8_t *row = target->row;
+        uint8_t *keep = target->keep;
+
+        // Fetch the source row, and find the pixels that survive the transparency and opacity tests.
+        if(direct) {
+            memcpy(row, src + target->columns[0], count);
+        } else {
+            for(int i = 0; i < count; i++) {
+                row[i] = src[target->columns[i]];
+            }
+        }
+        for(int i = 0; i < count; i++) {
+            keep[i] = row[i] != s->transparent;
+        }
+        if(decimate) {
+            // The render target is stored bottom-up on the GPU, so fragment y runs the other way.
+            float frag_y = target->h - y - 0.5f;
+            for(int i = 0; i < count; i++) {
+                keep[i] &= decimate_noise(x0 + i + 0.5f, frag_y) <= limit;
+            }
+        }
+
+        size_t at = (size_t)y * target->w + x0;
+        uint8_t *index = target->index + at;
+        uint8_t *remap_index = target->remap_index + at;
+        uint8_t *remap_rounds = target->remap_rounds + at;
+        uint8_t *add = target->add + at;
+        switch(mode) {
+            case RASTER_SET:
+                // All four channels are written.
+                for(int i = 0; i < count; i++) {
+                    index[i] = keep[i] ? lut[row[i]] : index[i];
+                    remap_index[i] = keep[i] ? 0 : remap_index[i];
+                    remap_rounds[i] = keep[i] ? 0 : remap_rounds[i];
+                    add[i] = keep[i] ? 0 : add[i];
+                }
+                break;
+            case RASTER_REMAP:
+                // Color index is masked out.
+                for(int i = 0; i < count; i++) {
+                    remap_index[i] = keep[i] ? lut[row[i]] : remap_index[i];
+                    remap_rounds[i] = keep[i] ? rounds : remap_rounds[i];
+                    add[i] = keep[i] ? 0 : add[i];
+                }
+                break;
+            case RASTER_ADD:
+                // Only the addition channel is written.
+                for(int i = 0; i < count; i++) {
+                    add[i] = keep[i] ? lut[row[i]] : add[i];
+                }
+                break;
+        }
+    }
+}
+
+// The color index that rgba.frag picks for one target pixel.
+static inline uint8_t resolve_index(const raster_target *target, const vga_remap_tables *remaps, size_t at) {
+    int value = target->index[at] + target->add[at];
+    value = value < 255 ? value : 255;
+    int row = target->remap_index[at];
+    const vga_remap_table *table = &remaps->tables[row < VGA_REMAP_COUNT ? row : VGA_REMAP_COUNT - 1];
+    for(int round = 0; round < target->remap_rounds[at]; round++) {
+        value = table->data[value];
+    }
+    return value;
+}
+
+void raster_to_rgba(const raster_target *target, const vga_remap_tables *remaps, const vga_palette *palette,
+                    uint8_t *rgba, int pitch) {
+    for(int y = 0; y < target->h; y++) {
+        uint8_t *out = rgba + (size_t)y * pitch;
+        size_t at = (size_t)y * target->w;
+        for(int x = 0; x < target->w; x++, at++) {
+            const vga_color *color = &palette->colors[resolve_index(target, remaps, at)];
+            out[x * 4 + 0] = color->r;
+            out[x * 4 + 1] = color->g;
+            out[x * 4 + 2] = color->b;
+            out[x * 4 + 3] = 255;
+        }
+    }
+}
+
+void raster_to_indexed(const raster_target *target, const vga_remap_tables *remaps, uint8_t *pixels) {
+    size_t size = (size_t)target->w * target->h;
+    for(size_t at = 0; at < size; at++) {
+        pixels[at] = resolve_index(target, remaps, at);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "video/vga_palette.h"
+#include "video/vga_remap.h"
+
+/**
+ * CPU implementation of the palette shaders. The target has the four channels of the OpenGL renderer's
+ * RGBA render target, stored as separate planes so that the pixel loops stay simple byte loops.
+ */
+typedef struct raster_target {
+    int w;
+    int h;
+    uint8_t *index;        ///< Color index (red)
+    uint8_t *remap_index;  ///< Remap row plus color index, for remapped sprites (green)
+    uint8_t *remap_rounds; ///< Remapping rounds (blue)
+    uint8_t *add;          ///< Index addition from SPRITE_INDEX_ADD sprites (alpha)
+
+    // Scratch rows for raster_draw, so that drawing does not allocate.
+    int *columns;
+    uint8_t *row;
+    uint8_t *keep;
+} raster_target;
+
+/**
+ * One sprite draw, with the same parameters as renderer.draw_surface.
+ */
+typedef struct raster_sprite {
+    const uint8_t *pixels;
+    int src_w;
+    int src_h;
+    int x;
+    int y;
+    int w;
+    int h;
+    int transparent;
+    int remap_offset;
+    int remap_rounds;
+    int palette_offset;
+    int palette_limit;
+    int opacity;
+    unsigned int flip_mode;
+    unsigned int options;
+} raster_sprite;
+
+void raster_target_create(raster_target *target, int w, int h);
+void raster_target_free(raster_target *target);
+
+/**
+ * Draw a sprite like shaders/palette.frag does.
+ *
+ * The result matches the shader exactly, apart from the opacity decimation noise: GLSL leaves the
+ * precision of tan() to the implementation, so the noise pattern differs a little between GPUs.
+ */
+void raster_draw(raster_target *target, const vga_remap_tables *remaps, const raster_sprite *sprite);
+
+/**
+ * Convert the target to RGBA like shaders/rgba.frag does.
+ *
+ * @param target Target to convert
+ * @param remaps Remap tables
+ * @param palette Palette
+ * @param rgba Output, 4 bytes per pixel in R, G, B, A order
+ * @param pitch Bytes per output row
+ */
+void raster_to_rgba(const raster_target *target, const vga_remap_tables *remaps, const vga_palette *palette,
+                    uint8_t *rgba, int pitch);
+
+/**
+ * Resolve the target to the palette indexes that raster_to_rgba would look up.
+ *
+ * @param target Target to convert
+ * @param remaps Remap tables
+ * @param pixels Output, one byte per pixel, w * h bytes
+ */
+void raster_to_indexed(const raster_target *target, const vga_remap_tables *remaps, uint8_t *pixels);
+
+#endif // RASTER_H
@@ -0,0 +1,279 @@
+#include <SDL.h>
+#include <string.h>
+
+#include "formats/transparent.h"
+#include "utils/allocator.h"
+#include "utils/log.h"
+#include "video/sdl_window.h"
+#include "video/software/raster.h"
+#include "video/software/software_renderer.h"
+#include "video/vga_state.h"
+
+typedef struct software_context {
+    SDL_Window *window;
+    SDL_Renderer *sdl_renderer;
+    SDL_Texture *texture;
+    raster_target target;
+    uint8_t *rgba;
+
+    // Copies of the VGA state, refreshed once per frame like the OpenGL renderer refreshes its buffers.
+    vga_palette palette;
+    vga_remap_tables remaps;
+
+    int screen_w;
+    int screen_h;
+    bool fullscreen;
+    bool vsync;
+
+    int target_move_x;
+    int target_move_y;
+
+    video_screenshot_signal screenshot_cb;
+
+    video_frame_signal frame_cb;
+    void *frame_cb_data;
+    uint8_t *frame_pixels;
+} software_context;
+
+static void software_create(renderer *renderer) {
+    renderer->ctx = omf_calloc(1, sizeof(software_context));
+}
+
+static bool create_sdl_renderer(software_context *ctx) {
+    Uint32 flags = ctx->vsync ? SDL_RENDERER_PRESENTVSYNC : 0;
+    ctx->sdl_renderer = SDL_CreateRenderer(ctx->window, -1, flags);
+    if(ctx->sdl_renderer == NULL) {
+        PERROR("Could not create SDL renderer: %s", SDL_GetError());
+        return false;
+    }
+    ctx->texture = SDL_CreateTexture(ctx->sdl_renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING,
+                                     NATIVE_W, NATIVE_H);
+    if(ctx->texture == NULL) {
+        PERROR("Could not create SDL texture: %s", SDL_GetError());
+        SDL_DestroyRenderer(ctx->sdl_renderer);
+        ctx->sdl_renderer = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void free_sdl_renderer(software_context *ctx) {
+    SDL_DestroyTexture(ctx->texture);
+    SDL_DestroyRenderer(ctx->sdl_renderer);
+    ctx->texture = NULL;
+    ctx->sdl_renderer = NULL;
+}
+
+static bool software_setup_context(void *userdata, int window_w, int window_h, bool fullscreen, bool vsync) {
+    software_context *ctx = userdata;
+    ctx->screen_w = window_w;
+    ctx->screen_h = window_h;
+    ctx->fullscreen = fullscreen;
+    ctx->vsync = vsync;
+
+    if(!create_window(&ctx->window, window_w, window_h, fullscreen, false)) {
+        goto error_0;
+    }
+    if(!create_sdl_renderer(ctx)) {
+        goto error_1;
+    }
+    raster_target_create(&ctx->target, NATIVE_W, NATIVE_H);
+    ctx->rgba = omf_calloc(NATIVE_W * NATIVE_H, 4);
+    vga_palette_init(&ctx->palette);
+    vga_remaps_init(&ctx->remaps);
+
+    SDL_RendererInfo info;
+    SDL_GetRendererInfo(ctx->sdl_renderer, &info);
+    INFO("Software renderer initialized, presenting with '%s'!", info.name);
+    return true;
+
+error_1:
+    SDL_DestroyWindow(ctx->window);
+
+error_0:
+    return false;
+}
+
+static bool software_reset_context(void *userdata, int window_w, int window_h, bool fullscreen, bool vsync) {
+    software_context *ctx = userdata;
+    ctx->screen_w = window_w;
+    ctx->screen_h = window_h;
+    ctx->fullscreen = fullscreen;
+    bool success = resize_window(ctx->window, window_w, window_h, fullscreen);
+    if(ctx->vsync != vsync) {
+        // SDL can only pick the present mode when a renderer is created.
+        ctx->vsync = vsync;
+        free_sdl_renderer(ctx);
+        success = create_sdl_renderer(ctx) && success;
+    }
+    return success;
+}
+
+static void software_close_context(void *userdata) {
+    software_context *ctx = userdata;
+    raster_target_free(&ctx->target);
+    omf_free(ctx->rgba);
+    omf_free(ctx->frame_pixels);
+    free_sdl_renderer(ctx);
+    SDL_DestroyWindow(ctx->window);
+    omf_free(ctx);
+    INFO("Video renderer closed.");
+}
+
+static void software_reset_atlas(void *userdata) {
+    // Sprites are read straight from their surfaces; there is no atlas.
+}
+
+static void software_draw_atlas(void *userdata, bool draw_atlas) {
+}
+
+static void software_move_target(void *userdata, int x, int y) {
+    software_context *ctx = userdata;
+    ctx->target_move_x = x;
+    ctx->target_move_y = y;
+}
+
+static void software_invalidate(void *userdata) {
+    // Every frame is presented anyway.
+}
+
+static void software_render_prepare(void *userdata) {
+}
+
+static void software_render_finish_offscreen(void *userdata) {
+    // Sprites are drawn as they come in, so the target is already complete.
+}
+
+static void software_screenshot_capture(software_context *ctx) {
+    SDL_Rect r = {0, 0, NATIVE_W, NATIVE_H};
+    unsigned char *buffer = omf_malloc(NATIVE_W * NATIVE_H * 3);
+    for(int i = 0; i < NATIVE_W * NATIVE_H; i++) {
+        memcpy(buffer + i * 3, ctx->rgba + i * 4, 3);
+    }
+    ctx->screenshot_cb(&r, buffer, false);
+}
+
+/**
+ * The OpenGL renderer picks up new remaps before it draws the frame. Sprites are drawn as they come in
+ * here, so check for new tables before every draw.
+ */
+static void flush_remaps(software_context *ctx) {
+    vga_remap_tables *tables;
+    if(vga_state_is_remap_dirty(&tables)) {
+        memcpy(&ctx->remaps, tables, sizeof(vga_remap_tables));
+        vga_state_mark_remaps_flushed();
+    }
+}
+
+static void software_render_finish(void *userdata) {
+    software_context *ctx = userdata;
+
+    vga_index range_start, range_end;
+    vga_palette *palette;
+    if(vga_state_is_palette_dirty(&palette, &range_start, &range_end)) {
+        memcpy(&ctx->palette.colors[range_start], &palette->colors[range_start],
+               (range_end - range_start + 1) * sizeof(vga_color));
+        vga_state_mark_palette_flushed();
+    }
+    flush_remaps(ctx);
+
+    raster_to_rgba(&ctx->target, &ctx->remaps, &ctx->palette, ctx->rgba, NATIVE_W * 4);
+    if(ctx->frame_cb) {
+        raster_to_indexed(&ctx->target, &ctx->remaps, ctx->frame_pixels);
+        ctx->frame_cb(ctx->frame_pixels, &ctx->palette, ctx->frame_cb_data);
+    }
+    SDL_UpdateTexture(ctx->texture, NULL, ctx->rgba, NATIVE_W * 4);
+
+    // Screen shakes move the whole picture, like the OpenGL renderer does with its viewport.
+    int viewport_w, viewport_h;
+    SDL_GetRendererOutputSize(ctx->sdl_renderer, &viewport_w, &viewport_h);
+    float ratio = ctx->screen_w / NATIVE_W;
+    SDL_Rect dst = {ctx->target_move_x * ratio, ctx->target_move_y * ratio, viewport_w, viewport_h};
+    SDL_RenderClear(ctx->sdl_renderer);
+    SDL_RenderCopy(ctx->sdl_renderer, ctx->texture, NULL, &dst);
+
+    if(ctx->screenshot_cb) {
+        software_screenshot_capture(ctx);
+        ctx->screenshot_cb = NULL;
+    }
+
+    SDL_RenderPresent(ctx->sdl_renderer);
+}
+
+static void software_render_area_capture(void *userdata, surface *sur, int x, int y, int w, int h) {
+    software_context *ctx = userdata;
+    unsigned char *buffer = omf_calloc(1, w * h);
+
+    // Same area as the OpenGL renderer reads; it addresses the target from the bottom row up.
+    for(int row = 0; row < h; row++) {
+        int src_y = NATIVE_H - y - h + row;
+        if(src_y < 0 || src_y >= NATIVE_H) {
+            continue;
+        }
+        for(int col = 0; col < w; col++) {
+            int src_x = x + col;
+            if(src_x >= 0 && src_x < NATIVE_W) {
+                buffer[row * w + col] = ctx->target.index[src_y * NATIVE_W + src_x];
+            }
+        }
+    }
+    surface_create_from_data(sur, w, h, buffer, BACKGROUND_TRANSPARENT_INDEX);
+    omf_free(buffer);
+}
+
+static void software_schedule_screenshot(void *userdata, video_screenshot_signal callback) {
+    software_context *ctx = userdata;
+    ctx->screenshot_cb = callback;
+}
+
+static void software_record_frames(void *userdata, video_frame_signal callback, void *callback_data) {
+    software_context *ctx = userdata;
+    if(callback != NULL && ctx->frame_pixels == NULL) {
+        ctx->frame_pixels = omf_malloc(NATIVE_W * NATIVE_H);
+    }
+    ctx->frame_cb = callback;
+    ctx->frame_cb_data = callback_data;
+}
+
+static void software_draw_surface(void *userdata, const surface *src_surface, SDL_Rect *dst, int remap_offset,
+                                  int remap_rounds, int palette_offset, int palette_limit, int opacity,
+                                  unsigned int flip_mode, unsigned int options) {
+    software_context *ctx = userdata;
+    flush_remaps(ctx);
+    raster_sprite sprite = {
+        .pixels = src_surface->data,
+        .src_w = src_surface->w,
+        .src_h = src_surface->h,
+        .x = dst->x,
+        .y = dst->y,
+        .w = dst->w,
+        .h = dst->h,
+        .transparent = src_surface->transparent,
+        .remap_offset = remap_offset,
+        .remap_rounds = remap_rounds,
+        .palette_offset = palette_offset,
+        .palette_limit = palette_limit,
+        .opacity = opacity,
+        .flip_mode = flip_mode,
+        .options = options,
+    };
+    raster_draw(&ctx->target, &ctx->remaps, &sprite);
+}
+
+void software_renderer_set_callbacks(renderer *renderer) {
+    renderer->create = software_create;
+    renderer->setup_context = software_setup_context;
+    renderer->reset_context = software_reset_context;
+    renderer->close_context = software_close_context;
+    renderer->reset_atlas = software_reset_atlas;
+    renderer->draw_atlas = software_draw_atlas;
+    renderer->move_target = software_move_target;
+    renderer->invalidate = software_invalidate;
+    renderer->render_prepare = software_render_prepare;
+    renderer->render_finish_offscreen = software_render_finish_offscreen;
+    renderer->render_finish = software_render_finish;
+    renderer->render_area_capture = software_render_area_capture;
+    renderer->schedule_screenshot = software_schedule_screenshot;
+    renderer->record_frames = software_record_frames;
+    renderer->draw_surface = software_draw_surface;
+}
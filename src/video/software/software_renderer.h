@@ -0,0 +1,12 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include "video/renderer.h"
+
+/**
+ * Renderer that draws on the CPU, and only uses SDL to put the finished frame on the screen.
+ * Used on machines that have no usable OpenGL 3.3 driver.
+ */
+void software_renderer_set_callbacks(renderer *renderer);
+
+#endif // SOFTWARE_RENDERER_H
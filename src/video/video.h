@@ -8,14 +8,32 @@
 #include "video/enums.h"
 #include "video/image.h"
 #include "video/surface.h"
+#include "video/vga_palette.h"
 
 #define NATIVE_W 320
 #define NATIVE_H 200
 
-typedef void (*video_screenshot_signal)(const SDL_Rect *rect, unsigned char *data,
-                                        bool flipped); // Asynchronous screenshot signal
+typedef enum video_renderer_type
+{
+    VIDEO_RENDERER_OPENGL = 0,
+    VIDEO_RENDERER_NULL,     // No window or GL context; draw calls are discarded. Used for headless runs.
+    VIDEO_RENDERER_SOFTWARE, // Draws on the CPU; used when OpenGL is not available.
+} video_renderer_type;
 
-int video_init(int window_w, int window_h, bool fullscreen, bool vsync);
+/**
+ * Asynchronous screenshot signal. Called some frames after the request, once the pixels have been read back.
+ * The callback owns the RGB data, and must free it with omf_free.
+ */
+typedef void (*video_screenshot_signal)(const SDL_Rect *rect, unsigned char *data, bool flipped);
+
+/**
+ * Recorded frame signal. Called once for every rendered frame while frame recording is on, possibly a couple of
+ * frames late. The pixels are NATIVE_W x NATIVE_H palette indexes, top row first. Pixels and palette are only
+ * valid during the call.
+ */
+typedef void (*video_frame_signal)(const unsigned char *pixels, const vga_palette *palette, void *userdata);
+
+int video_init(video_renderer_type renderer_type, int window_w, int window_h, bool fullscreen, bool vsync);
 int video_reinit(int window_w, int window_h, bool fullscreen, bool vsync);
 void video_reinit_renderer(void);
 void video_get_state(int *w, int *h, int *fs, int *vsync);
@@ -88,6 +106,10 @@ void video_draw_size(const surface *src_surface, int x, int y, int w, int h);
 void video_draw_full(const surface *src_surface, int x, int y, int w, int h, int remap_offset, int remap_rounds,
                      int palette_offset, int palette_limit, int opacity, unsigned int flip_mode, unsigned int options);
 
+/**
+ * Forget the surfaces known to the texture atlas, e.g. when they are about to be freed. Already uploaded
+ * pixels are kept and reused by new surfaces with the same content.
+ */
 void video_reset_atlas(void);
 
 void video_render_prepare(void);
@@ -97,6 +119,21 @@ void video_close(void);
 void video_area_capture(surface *sur, int x, int y, int w, int h);
 void video_schedule_screenshot(video_screenshot_signal callback);
 
+/**
+ * Start or stop handing the rendered frames to a callback. Stopping hands over the frames that are still
+ * being read back before returning.
+ *
+ * @param callback Called for every frame, or NULL to stop
+ * @param userdata Passed to the callback
+ */
+void video_record_frames(video_frame_signal callback, void *userdata);
+
 void video_draw_atlas(bool draw_atlas);
 
+/**
+ * Make sure the next frame is presented, even if nothing in it changed. Frames that are identical to the
+ * previous one are otherwise skipped, which leaves stale contents on the screen if the window system lost them.
+ */
+void video_invalidate(void);
+
 #endif // VIDEO_H
@@ -0,0 +1,65 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <string.h>
+#include <utils/hash64.h>
+
+void test_hash64_known_values(void) {
+    // Reference values from the xxHash XXH64 implementation
+    CU_ASSERT(hash64("", 0, 0) == 0xEF46DB3751D8E999ULL);
+    CU_ASSERT(hash64("a", 1, 0) == 0xD24EC4F1A98C6E5BULL);
+    CU_ASSERT(hash64("abc", 3, 0) == 0x44BC2CF5AD770999ULL);
+    CU_ASSERT(hash64("abc", 3, 2097) == 0x646BB72A6E2428D3ULL);
+
+    const char *text = "Nobody inspects the spammish repetition";
+    CU_ASSERT(hash64(text, strlen(text), 0) == 0xFBCEA83C8A378BF1ULL);
+    CU_ASSERT(hash64(text, strlen(text), 2097) == 0x21D87F8BE9DA14DBULL);
+
+    unsigned char bytes[100];
+    for(int i = 0; i < 100; i++) {
+        bytes[i] = i;
+    }
+    CU_ASSERT(hash64(bytes, sizeof(bytes), 0) == 0x6AC1E58032166597ULL);
+}
+
+void test_hash64_streaming(void) {
+    // Feeding the input in pieces of any size gives the same result as hashing it at once.
+    unsigned char bytes[100];
+    for(int i = 0; i < 100; i++) {
+        bytes[i] = i;
+    }
+    for(size_t step = 1; step < 40; step++) {
+        hash64_state h;
+        hash64_reset(&h, 0);
+        for(size_t pos = 0; pos < sizeof(bytes); pos += step) {
+            size_t len = sizeof(bytes) - pos < step ? sizeof(bytes) - pos : step;
+            hash64_update(&h, bytes + pos, len);
+        }
+        CU_ASSERT(hash64_digest(&h) == 0x6AC1E58032166597ULL);
+    }
+}
+
+void test_hash64_values(void) {
+    // Values are hashed in little endian order regardless of the platform.
+    unsigned char bytes[] = {0x78, 0x56, 0x34, 0x12, 0x00, 0x00, 0x80, 0x3F};
+    hash64_state h;
+    hash64_reset(&h, 0);
+    hash64_update_u32(&h, 0x12345678);
+    hash64_update_float(&h, 1.0f);
+    CU_ASSERT(hash64_digest(&h) == hash64(bytes, sizeof(bytes), 0));
+
+    hash64_reset(&h, 0);
+    hash64_update_u64(&h, 0x3F80000012345678ULL);
+    CU_ASSERT(hash64_digest(&h) == hash64(bytes, sizeof(bytes), 0));
+}
+
+void hash64_test_suite(CU_pSuite suite) {
+    if(CU_add_test(suite, "test of known hash values", test_hash64_known_values) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of streaming hash updates", test_hash64_streaming) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of hashing values", test_hash64_values) == NULL) {
+        return;
+    }
+}
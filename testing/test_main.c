@@ -14,6 +14,14 @@ void list_test_suite(CU_pSuite suite);
 void array_test_suite(CU_pSuite suite);
 void text_render_test_suite(CU_pSuite suite);
 void cp437_test_suite(CU_pSuite suite);
+void raster_test_suite(CU_pSuite suite);
+void hash64_test_suite(CU_pSuite suite);
+void vidrec_test_suite(CU_pSuite suite);
+void spectator_stream_test_suite(CU_pSuite suite);
+void net_transcript_test_suite(CU_pSuite suite);
+void pool_test_suite(CU_pSuite suite);
+void object_index_test_suite(CU_pSuite suite);
+void object_hash_test_suite(CU_pSuite suite);
 
 int main(int argc, char **argv) {
     CU_pSuite suite = NULL;
@@ -48,6 +56,11 @@ int main(int argc, char **argv) {
         goto end;
     trn_test_suite(suite);
 
+    suite = CU_add_suite("Video recordings", NULL, NULL);
+    if(suite == NULL)
+        goto end;
+    vidrec_test_suite(suite);
+
     suite = CU_add_suite("Script", NULL, NULL);
     if(suite == NULL)
         goto end;
@@ -79,6 +92,21 @@ int main(int argc, char **argv) {
         goto end;
     array_test_suite(array_suite);
 
+    CU_pSuite pool_suite = CU_add_suite("Pool", NULL, NULL);
+    if(pool_suite == NULL)
+        goto end;
+    pool_test_suite(pool_suite);
+
+    CU_pSuite object_index_suite = CU_add_suite("Object index", NULL, NULL);
+    if(object_index_suite == NULL)
+        goto end;
+    object_index_test_suite(object_index_suite);
+
+    CU_pSuite object_hash_suite = CU_add_suite("Object hash", NULL, NULL);
+    if(object_hash_suite == NULL)
+        goto end;
+    object_hash_test_suite(object_hash_suite);
+
     CU_pSuite text_render_suite = CU_add_suite("Text Renderer", NULL, NULL);
     if(text_render_suite == NULL)
         goto end;
@@ -89,6 +117,26 @@ int main(int argc, char **argv) {
         goto end;
     cp437_test_suite(cp437_suite);
 
+    CU_pSuite raster_suite = CU_add_suite("Software raster", NULL, NULL);
+    if(raster_suite == NULL)
+        goto end;
+    raster_test_suite(raster_suite);
+
+    CU_pSuite hash64_suite = CU_add_suite("Hash64", NULL, NULL);
+    if(hash64_suite == NULL)
+        goto end;
+    hash64_test_suite(hash64_suite);
+
+    CU_pSuite spectator_suite = CU_add_suite("Spectator stream", NULL, NULL);
+    if(spectator_suite == NULL)
+        goto end;
+    spectator_stream_test_suite(spectator_suite);
+
+    CU_pSuite transcript_suite = CU_add_suite("Net transcript", NULL, NULL);
+    if(transcript_suite == NULL)
+        goto end;
+    net_transcript_test_suite(transcript_suite);
+
     // Run tests
     CU_basic_set_mode(CU_BRM_VERBOSE);
     CU_basic_run_tests();
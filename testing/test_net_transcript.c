@@ -0,0 +1,143 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <controller/controller.h>
+#include <controller/net_transcript.h>
+
+static net_transcript transcript;
+
+// Count the ticks the iterator visits from the given tick, and check they come in order
+static unsigned count_ticks(uint32_t from, uint32_t *last) {
+    iterator it;
+    tick_events *ev;
+    unsigned count = 0;
+    net_transcript_iter_begin(&transcript, &it, from);
+    while((ev = iter_next(&it)) != NULL) {
+        CU_ASSERT(count == 0 || ev->tick > *last);
+        *last = ev->tick;
+        count++;
+    }
+    return count;
+}
+
+void test_net_transcript_insert(void) {
+    net_transcript_create(&transcript);
+    CU_ASSERT(transcript.capacity == NET_TRANSCRIPT_INITIAL_CAPACITY);
+    CU_ASSERT(net_transcript_get(&transcript, 0) == NULL);
+
+    CU_ASSERT(net_transcript_insert(&transcript, 5, ACT_PUNCH, 0));
+    CU_ASSERT(net_transcript_insert(&transcript, 5, ACT_LEFT, 0));
+    CU_ASSERT(net_transcript_insert(&transcript, 5, ACT_KICK, 1));
+    tick_events *ev = net_transcript_get(&transcript, 5);
+    CU_ASSERT_FATAL(ev != NULL);
+    CU_ASSERT(ev->tick == 5);
+    CU_ASSERT(ev->events[0] == (ACT_PUNCH | ACT_LEFT));
+    CU_ASSERT(ev->events[1] == ACT_KICK);
+    CU_ASSERT(ev->seen_peer == 3);
+    CU_ASSERT(net_transcript_get(&transcript, 4) == NULL);
+
+    // Only player 1 has gone past tick 6
+    CU_ASSERT(net_transcript_insert(&transcript, 9, ACT_UP, 0));
+    CU_ASSERT(net_transcript_insert(&transcript, 6, ACT_DOWN, 0));
+    ev = net_transcript_get(&transcript, 6);
+    CU_ASSERT_FATAL(ev != NULL);
+    CU_ASSERT(ev->seen_peer == 1);
+
+    uint32_t last = 0;
+    CU_ASSERT(count_ticks(0, &last) == 3);
+    CU_ASSERT(last == 9);
+    CU_ASSERT(count_ticks(6, &last) == 2);
+    CU_ASSERT(count_ticks(10, &last) == 0);
+
+    net_transcript_clear(&transcript);
+    CU_ASSERT(net_transcript_get(&transcript, 5) == NULL);
+    CU_ASSERT(count_ticks(0, &last) == 0);
+    net_transcript_free(&transcript);
+}
+
+void test_net_transcript_trim(void) {
+    net_transcript_create(&transcript);
+    for(uint32_t tick = 0; tick < 100; tick += 10) {
+        CU_ASSERT(net_transcript_insert(&transcript, tick, ACT_PUNCH, 0));
+    }
+    net_transcript_trim(&transcript, 35);
+    CU_ASSERT(transcript.base_tick == 35);
+    CU_ASSERT(net_transcript_get(&transcript, 30) == NULL);
+    CU_ASSERT(net_transcript_get(&transcript, 40) != NULL);
+
+    // Iterating from before the start begins at the start
+    uint32_t last = 0;
+    CU_ASSERT(count_ticks(0, &last) == 6);
+    CU_ASSERT(last == 90);
+
+    // Trimmed ticks can not come back
+    CU_ASSERT(!net_transcript_insert(&transcript, 20, ACT_KICK, 1));
+    CU_ASSERT(net_transcript_get(&transcript, 20) == NULL);
+
+    // Trimming past everything that is stored leaves the transcript empty
+    net_transcript_trim(&transcript, 500);
+    CU_ASSERT(count_ticks(0, &last) == 0);
+    CU_ASSERT(net_transcript_insert(&transcript, 500, ACT_KICK, 1));
+    CU_ASSERT(count_ticks(0, &last) == 1);
+    net_transcript_free(&transcript);
+}
+
+void test_net_transcript_wraparound(void) {
+    net_transcript_create(&transcript);
+    // Keep a short window moving over the ring several times
+    for(uint32_t tick = 0; tick < 4 * NET_TRANSCRIPT_INITIAL_CAPACITY; tick++) {
+        CU_ASSERT(net_transcript_insert(&transcript, tick, ACT_UP, tick & 1));
+        if(tick >= 100) {
+            net_transcript_trim(&transcript, tick - 100);
+        }
+    }
+    CU_ASSERT(transcript.capacity == NET_TRANSCRIPT_INITIAL_CAPACITY);
+
+    uint32_t last = 0;
+    CU_ASSERT(count_ticks(0, &last) == 101);
+    CU_ASSERT(last == 4 * NET_TRANSCRIPT_INITIAL_CAPACITY - 1);
+    tick_events *ev = net_transcript_get(&transcript, last);
+    CU_ASSERT_FATAL(ev != NULL);
+    CU_ASSERT(ev->tick == last);
+    CU_ASSERT(ev->events[1] == ACT_UP);
+    CU_ASSERT(net_transcript_get(&transcript, last - NET_TRANSCRIPT_INITIAL_CAPACITY) == NULL);
+    net_transcript_free(&transcript);
+}
+
+void test_net_transcript_grow(void) {
+    net_transcript_create(&transcript);
+    net_transcript_trim(&transcript, 1000);
+    CU_ASSERT(net_transcript_insert(&transcript, 1000, ACT_PUNCH, 0));
+    CU_ASSERT(net_transcript_insert(&transcript, 1500, ACT_KICK, 1));
+
+    // Going past the end of the ring grows it, and keeps what was stored
+    CU_ASSERT(net_transcript_insert(&transcript, 1000 + 3 * NET_TRANSCRIPT_INITIAL_CAPACITY, ACT_DOWN, 0));
+    CU_ASSERT(transcript.capacity == 4 * NET_TRANSCRIPT_INITIAL_CAPACITY);
+    tick_events *ev = net_transcript_get(&transcript, 1500);
+    CU_ASSERT_FATAL(ev != NULL);
+    CU_ASSERT(ev->events[1] == ACT_KICK);
+    uint32_t last = 0;
+    CU_ASSERT(count_ticks(0, &last) == 3);
+    CU_ASSERT(last == 1000 + 3 * NET_TRANSCRIPT_INITIAL_CAPACITY);
+
+    // There is a limit though
+    CU_ASSERT(!net_transcript_insert(&transcript, 1000 + NET_TRANSCRIPT_MAX_CAPACITY, ACT_UP, 1));
+    CU_ASSERT(net_transcript_insert(&transcript, 999 + NET_TRANSCRIPT_MAX_CAPACITY, ACT_UP, 1));
+    CU_ASSERT(transcript.capacity == NET_TRANSCRIPT_MAX_CAPACITY);
+    CU_ASSERT(count_ticks(0, &last) == 4);
+    net_transcript_free(&transcript);
+}
+
+void net_transcript_test_suite(CU_pSuite suite) {
+    if(CU_add_test(suite, "test of net transcript insert", test_net_transcript_insert) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of net transcript trim", test_net_transcript_trim) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of net transcript wraparound", test_net_transcript_wraparound) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of net transcript grow", test_net_transcript_grow) == NULL) {
+        return;
+    }
+}
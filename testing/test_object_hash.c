@@ -0,0 +1,52 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <game/game_state_type.h>
+#include <game/protos/object.h>
+#include <string.h>
+#include <utils/hash64.h>
+#include <utils/random.h>
+
+static game_state gs;
+
+// Create an object the way a peer would, with its own process-wide random seed, and hash it
+static uint64_t hash_new_object(uint32_t global_seed) {
+    rand_seed(global_seed);
+    random_seed(&gs.rand, 1234);
+
+    object obj;
+    object_create(&obj, &gs, vec2i_create(100, 150), vec2f_create(1.5f, -2.0f));
+    hash64_state h;
+    hash64_reset(&h, 0);
+    object_hash(&obj, &h);
+    object_free(&obj);
+    return hash64_digest(&h);
+}
+
+void test_object_hash_global_seed(void) {
+    memset(&gs, 0, sizeof(gs));
+    vector_create(&gs.objects, sizeof(object *));
+
+    // The peers of a network game seed their own random generators differently, which must not show up
+    uint64_t first = hash_new_object(1);
+    CU_ASSERT(hash_new_object(0xDEADBEEF) == first);
+    CU_ASSERT(hash_new_object(1) == first);
+
+    // The game state generator is shared by the peers, and does
+    rand_seed(1);
+    random_seed(&gs.rand, 4321);
+    object obj;
+    object_create(&obj, &gs, vec2i_create(100, 150), vec2f_create(1.5f, -2.0f));
+    hash64_state h;
+    hash64_reset(&h, 0);
+    object_hash(&obj, &h);
+    object_free(&obj);
+    CU_ASSERT(hash64_digest(&h) != first);
+
+    vector_free(&gs.objects);
+}
+
+void object_hash_test_suite(CU_pSuite suite) {
+    if(CU_add_test(suite, "test of object hash with different global seeds", test_object_hash_global_seed) == NULL) {
+        return;
+    }
+}
@@ -0,0 +1,151 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <game/protos/object.h>
+#include <game/utils/object_index.h>
+#include <string.h>
+
+#define TEST_OBJECTS 200
+
+static object_index test_index;
+static object objects[TEST_OBJECTS];
+
+// Set up an object with the given id. Only the id matters to the index.
+static object *make_object(int n, uint32_t id) {
+    memset(&objects[n], 0, sizeof(object));
+    objects[n].id = id;
+    return &objects[n];
+}
+
+void test_object_index_collisions(void) {
+    object_index_create(&test_index);
+    CU_ASSERT_FATAL(test_index.capacity == 64);
+
+    // All of these want the same slot
+    object *a = make_object(0, 5);
+    object *b = make_object(1, 5 + 64);
+    object *c = make_object(2, 5 + 128);
+    object *d = make_object(3, 6);
+    object_index_insert(&test_index, a);
+    object_index_insert(&test_index, b);
+    object_index_insert(&test_index, c);
+    object_index_insert(&test_index, d);
+    CU_ASSERT(test_index.count == 4);
+    CU_ASSERT(object_index_get(&test_index, 5) == a);
+    CU_ASSERT(object_index_get(&test_index, 5 + 64) == b);
+    CU_ASSERT(object_index_get(&test_index, 5 + 128) == c);
+    CU_ASSERT(object_index_get(&test_index, 6) == d);
+    CU_ASSERT(object_index_get(&test_index, 5 + 192) == NULL);
+    CU_ASSERT(object_index_get(&test_index, 0) == NULL);
+
+    // Same id again replaces the object
+    object *a2 = make_object(4, 5);
+    object_index_insert(&test_index, a2);
+    CU_ASSERT(test_index.count == 4);
+    CU_ASSERT(object_index_get(&test_index, 5) == a2);
+
+    // Objects without an id are not indexed
+    object_index_insert(&test_index, make_object(5, 0));
+    CU_ASSERT(test_index.count == 4);
+    object_index_free(&test_index);
+}
+
+void test_object_index_remove(void) {
+    object_index_create(&test_index);
+    object *a = make_object(0, 10);
+    object *b = make_object(1, 10 + 64);
+    object *c = make_object(2, 10 + 128);
+    object *d = make_object(3, 11);
+    object_index_insert(&test_index, a);
+    object_index_insert(&test_index, b);
+    object_index_insert(&test_index, c);
+    object_index_insert(&test_index, d);
+
+    // Removing from the middle of a probe run keeps the rest of the run reachable
+    object_index_remove(&test_index, b);
+    CU_ASSERT(test_index.count == 3);
+    CU_ASSERT(object_index_get(&test_index, 10 + 64) == NULL);
+    CU_ASSERT(object_index_get(&test_index, 10) == a);
+    CU_ASSERT(object_index_get(&test_index, 10 + 128) == c);
+    CU_ASSERT(object_index_get(&test_index, 11) == d);
+
+    // An object that is not the indexed one for its id is left alone
+    object *other = make_object(4, 10);
+    object_index_remove(&test_index, other);
+    CU_ASSERT(object_index_get(&test_index, 10) == a);
+    object_index_remove(&test_index, make_object(5, 12));
+    CU_ASSERT(test_index.count == 3);
+
+    object_index_remove(&test_index, a);
+    object_index_remove(&test_index, c);
+    object_index_remove(&test_index, d);
+    CU_ASSERT(test_index.count == 0);
+    for(uint32_t i = 0; i < test_index.capacity; i++) {
+        CU_ASSERT(test_index.slots[i].id == 0);
+    }
+    object_index_free(&test_index);
+}
+
+void test_object_index_wraparound(void) {
+    object_index_create(&test_index);
+    // The probe run for the last slot continues from the first one
+    object *a = make_object(0, 63);
+    object *b = make_object(1, 63 + 64);
+    object *c = make_object(2, 63 + 128);
+    object *d = make_object(3, 64);
+    object_index_insert(&test_index, a);
+    object_index_insert(&test_index, b);
+    object_index_insert(&test_index, c);
+    object_index_insert(&test_index, d);
+    CU_ASSERT(test_index.slots[63].id == 63);
+    CU_ASSERT(test_index.slots[0].id == 63 + 64);
+    CU_ASSERT(object_index_get(&test_index, 64) == d);
+
+    object_index_remove(&test_index, a);
+    CU_ASSERT(object_index_get(&test_index, 63) == NULL);
+    CU_ASSERT(object_index_get(&test_index, 63 + 64) == b);
+    CU_ASSERT(object_index_get(&test_index, 63 + 128) == c);
+    CU_ASSERT(object_index_get(&test_index, 64) == d);
+    object_index_remove(&test_index, b);
+    CU_ASSERT(object_index_get(&test_index, 63 + 128) == c);
+    CU_ASSERT(object_index_get(&test_index, 64) == d);
+    CU_ASSERT(test_index.count == 2);
+    object_index_free(&test_index);
+}
+
+void test_object_index_grow(void) {
+    object_index_create(&test_index);
+    for(int i = 0; i < TEST_OBJECTS; i++) {
+        object_index_insert(&test_index, make_object(i, 1000 + i * 3));
+    }
+    CU_ASSERT(test_index.count == TEST_OBJECTS);
+    CU_ASSERT(test_index.capacity >= 2 * TEST_OBJECTS);
+    for(int i = 0; i < TEST_OBJECTS; i++) {
+        CU_ASSERT(object_index_get(&test_index, 1000 + i * 3) == &objects[i]);
+        CU_ASSERT(object_index_get(&test_index, 1001 + i * 3) == NULL);
+    }
+
+    // Every other object goes away
+    for(int i = 0; i < TEST_OBJECTS; i += 2) {
+        object_index_remove(&test_index, &objects[i]);
+    }
+    CU_ASSERT(test_index.count == TEST_OBJECTS / 2);
+    for(int i = 0; i < TEST_OBJECTS; i++) {
+        CU_ASSERT(object_index_get(&test_index, 1000 + i * 3) == (i % 2 ? &objects[i] : NULL));
+    }
+    object_index_free(&test_index);
+}
+
+void object_index_test_suite(CU_pSuite suite) {
+    if(CU_add_test(suite, "test of object index collisions", test_object_index_collisions) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of object index remove", test_object_index_remove) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of object index wraparound", test_object_index_wraparound) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of object index grow", test_object_index_grow) == NULL) {
+        return;
+    }
+}
@@ -0,0 +1,90 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <string.h>
+#include <utils/pool.h>
+
+#define TEST_ITEMS 20
+
+typedef struct test_item {
+    double value;
+    char name[13];
+} test_item;
+
+static pool test_pool = POOL_INIT("test", test_item, 8);
+
+void test_pool_alloc(void) {
+    test_item *items[TEST_ITEMS];
+    for(int i = 0; i < TEST_ITEMS; i++) {
+        items[i] = pool_alloc(&test_pool);
+        CU_ASSERT_FATAL(items[i] != NULL);
+        CU_ASSERT(pool_owns(&test_pool, items[i]));
+        CU_ASSERT((uintptr_t)items[i] % sizeof(max_align_t) == 0);
+        CU_ASSERT(items[i]->value == 0.0 && items[i]->name[0] == 0);
+        items[i]->value = i;
+        strcpy(items[i]->name, "test item");
+    }
+    CU_ASSERT(test_pool.slab_count == 3);
+    CU_ASSERT(test_pool.in_use == TEST_ITEMS);
+
+    // Items do not overlap
+    for(int i = 0; i < TEST_ITEMS; i++) {
+        CU_ASSERT(items[i]->value == i);
+    }
+
+    test_item outside;
+    CU_ASSERT(!pool_owns(&test_pool, &outside));
+
+    for(int i = 0; i < TEST_ITEMS; i++) {
+        pool_release(&test_pool, items[i]);
+    }
+    CU_ASSERT(test_pool.in_use == 0);
+    CU_ASSERT(pool_high_water(&test_pool) == TEST_ITEMS);
+}
+
+void test_pool_reuse(void) {
+    // Released items are handed out again, zeroed, without new slabs
+    test_item *first = pool_alloc(&test_pool);
+    first->value = 1.0;
+    pool_release(&test_pool, first);
+    test_item *again = pool_alloc(&test_pool);
+    CU_ASSERT(again == first);
+    CU_ASSERT(again->value == 0.0);
+
+    for(int i = 0; i < 1000; i++) {
+        test_item *item = pool_alloc(&test_pool);
+        pool_release(&test_pool, item);
+    }
+    pool_release(&test_pool, again);
+    pool_release(&test_pool, NULL);
+    CU_ASSERT(test_pool.slab_count == 3);
+    CU_ASSERT(test_pool.in_use == 0);
+    CU_ASSERT(pool_high_water(&test_pool) == TEST_ITEMS);
+}
+
+void test_pool_close(void) {
+    test_item *item = pool_alloc(&test_pool);
+    pool_release(&test_pool, item);
+    pool_close_all();
+    CU_ASSERT(test_pool.slab_count == 0);
+    CU_ASSERT(test_pool.slabs == NULL);
+    CU_ASSERT(!pool_owns(&test_pool, item));
+
+    // A closed pool can be used again
+    item = pool_alloc(&test_pool);
+    CU_ASSERT(pool_owns(&test_pool, item));
+    pool_release(&test_pool, item);
+    pool_close_all();
+}
+
+void pool_test_suite(CU_pSuite suite) {
+    if(CU_add_test(suite, "test of pool alloc", test_pool_alloc) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of pool reuse", test_pool_reuse) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of pool close", test_pool_close) == NULL) {
+        return;
+    }
+}
@@ -0,0 +1,205 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <string.h>
+#include <video/enums.h>
+#include <video/software/raster.h>
+
+static raster_target target;
+static vga_remap_tables remaps;
+
+static const uint8_t sprite_pixels[] = {
+    1, 2, 0, //
+    4, 5, 6, //
+};
+
+static raster_sprite make_sprite(void) {
+    raster_sprite s = {
+        .pixels = sprite_pixels,
+        .src_w = 3,
+        .src_h = 2,
+        .x = 0,
+        .y = 0,
+        .w = 3,
+        .h = 2,
+        .transparent = 0,
+        .remap_offset = 0,
+        .remap_rounds = 0,
+        .palette_offset = 0,
+        .palette_limit = 255,
+        .opacity = 255,
+        .flip_mode = FLIP_NONE,
+        .options = 0,
+    };
+    return s;
+}
+
+static void setup(void) {
+    raster_target_create(&target, 4, 3);
+    vga_remaps_init(&remaps);
+    for(int row = 0; row < VGA_REMAP_COUNT; row++) {
+        for(int i = 0; i < 256; i++) {
+            remaps.tables[row].data[i] = (i + row + 1) & 0xFF;
+        }
+    }
+}
+
+void test_raster_draw_plain(void) {
+    setup();
+    raster_sprite s = make_sprite();
+    s.x = 1;
+    s.y = 1;
+    memset(target.index, 9, 4 * 3);
+    raster_draw(&target, &remaps, &s);
+
+    // Transparent pixel keeps what was below it
+    const uint8_t expected[] = {
+        9, 9, 9, 9, //
+        9, 1, 2, 9, //
+        9, 4, 5, 6, //
+    };
+    CU_ASSERT(memcmp(target.index, expected, sizeof(expected)) == 0);
+    raster_target_free(&target);
+}
+
+void test_raster_draw_flip_and_clip(void) {
+    setup();
+    raster_sprite s = make_sprite();
+    s.x = -1;
+    s.flip_mode = FLIP_HORIZONTAL | FLIP_VERTICAL;
+    raster_draw(&target, &remaps, &s);
+
+    const uint8_t expected[] = {
+        5, 4, 0, 0, //
+        2, 1, 0, 0, //
+        0, 0, 0, 0, //
+    };
+    CU_ASSERT(memcmp(target.index, expected, sizeof(expected)) == 0);
+    raster_target_free(&target);
+}
+
+void test_raster_draw_scaled(void) {
+    setup();
+    raster_sprite s = make_sprite();
+    s.w = 4;
+    s.h = 3;
+    raster_draw(&target, &remaps, &s);
+
+    // Sampled at pixel centers: columns 0, 1, 1, 2 and rows 0, 1, 1
+    const uint8_t expected[] = {
+        1, 2, 2, 0, //
+        4, 5, 5, 6, //
+        4, 5, 5, 6, //
+    };
+    CU_ASSERT(memcmp(target.index, expected, sizeof(expected)) == 0);
+    raster_target_free(&target);
+}
+
+void test_raster_draw_palette_offset(void) {
+    setup();
+    raster_sprite s = make_sprite();
+    s.palette_offset = 3;
+    s.palette_limit = 5;
+    raster_draw(&target, &remaps, &s);
+
+    // Indexes up to the limit are offset and clamped to it, the rest are left alone
+    const uint8_t expected[] = {4, 5, 0, 0, 5, 5, 6, 0};
+    CU_ASSERT(memcmp(target.index, expected, sizeof(expected)) == 0);
+    raster_target_free(&target);
+}
+
+void test_raster_draw_remap(void) {
+    setup();
+    raster_sprite s = make_sprite();
+    s.remap_offset = 2;
+    s.remap_rounds = 3;
+    target.index[0] = 7;
+    raster_draw(&target, &remaps, &s);
+
+    // Color index is left alone; the remap channels get offset + index and the round count
+    CU_ASSERT_EQUAL(target.index[0], 7);
+    CU_ASSERT_EQUAL(target.remap_index[0], 3);
+    CU_ASSERT_EQUAL(target.remap_index[5], 7);
+    CU_ASSERT_EQUAL(target.remap_rounds[0], 3);
+    CU_ASSERT_EQUAL(target.remap_rounds[2], 0);
+
+    // Sprite remap goes through the table row picked by the remap offset
+    s.remap_rounds = 0;
+    s.options = REMAP_SPRITE;
+    raster_draw(&target, &remaps, &s);
+    CU_ASSERT_EQUAL(target.index[0], 4);
+    CU_ASSERT_EQUAL(target.index[5], 8);
+    CU_ASSERT_EQUAL(target.remap_rounds[0], 0);
+    raster_target_free(&target);
+}
+
+void test_raster_draw_mask_and_add(void) {
+    setup();
+    raster_sprite s = make_sprite();
+    s.options = SPRITE_MASK;
+    raster_draw(&target, &remaps, &s);
+    CU_ASSERT_EQUAL(target.index[0], 1);
+    CU_ASSERT_EQUAL(target.index[6], 1);
+    CU_ASSERT_EQUAL(target.index[2], 0);
+
+    // Index addition only touches the add channel, and saturates
+    s.options = SPRITE_INDEX_ADD;
+    raster_draw(&target, &remaps, &s);
+    CU_ASSERT_EQUAL(target.index[0], 1);
+    CU_ASSERT_EQUAL(target.add[0], 60);
+    CU_ASSERT_EQUAL(target.add[1], 120);
+    CU_ASSERT_EQUAL(target.add[4], 240);
+    CU_ASSERT_EQUAL(target.add[5], 255);
+    raster_target_free(&target);
+}
+
+void test_raster_to_rgba(void) {
+    setup();
+    vga_palette palette;
+    for(int i = 0; i < 256; i++) {
+        palette.colors[i].r = i;
+        palette.colors[i].g = 255 - i;
+        palette.colors[i].b = i / 2;
+    }
+    target.index[0] = 10;
+    target.index[1] = 200;
+    target.add[1] = 100;
+    target.index[2] = 20;
+    target.remap_index[2] = 30;
+    target.remap_rounds[2] = 2;
+
+    uint8_t rgba[4 * 3 * 4];
+    raster_to_rgba(&target, &remaps, &palette, rgba, 4 * 4);
+    const uint8_t expected[] = {
+        10,  245, 5,  255, // Plain index
+        255, 0,   127, 255, // Addition saturates
+        58,  197, 29,  255, // Two rounds through the last remap row
+    };
+    CU_ASSERT(memcmp(rgba, expected, sizeof(expected)) == 0);
+    raster_target_free(&target);
+}
+
+void raster_test_suite(CU_pSuite suite) {
+    // Add tests
+    if(CU_add_test(suite, "Test for raster_draw", test_raster_draw_plain) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "Test for raster_draw with flipping and clipping", test_raster_draw_flip_and_clip) ==
+       NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "Test for raster_draw with scaling", test_raster_draw_scaled) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "Test for raster_draw with palette offset", test_raster_draw_palette_offset) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "Test for raster_draw with remapping", test_raster_draw_remap) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "Test for raster_draw with mask and index add", test_raster_draw_mask_and_add) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "Test for raster_to_rgba", test_raster_to_rgba) == NULL) {
+        return;
+    }
+}
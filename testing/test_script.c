@@ -95,6 +95,37 @@ void test_script_get_frame_at(void) {
     CU_ASSERT(sd_script_get_frame_at(&script, 144) == NULL);
 }
 
+void test_script_get_frame_index_near(void) {
+    CU_ASSERT(sd_script_get_frame_index_near(NULL, 0, 0) == -1);
+    CU_ASSERT(sd_script_get_frame_index_near(&script, -1, 0) == -1);
+    CU_ASSERT(sd_script_get_frame_index_near(&script, 0, 0) == 0);
+    CU_ASSERT(sd_script_get_frame_index_near(&script, 100, 0) == 1);  // Forward to the next frame
+    CU_ASSERT(sd_script_get_frame_index_near(&script, 99, 1) == 0);   // Backwards to the previous frame
+    CU_ASSERT(sd_script_get_frame_index_near(&script, 143, 0) == 2);  // Jump
+    CU_ASSERT(sd_script_get_frame_index_near(&script, 110, -5) == 2); // Bad hint
+    CU_ASSERT(sd_script_get_frame_index_near(&script, 144, 2) == -1);
+}
+
+void test_script_tick_positions(void) {
+    sd_script s;
+    CU_ASSERT(sd_script_create(&s) == SD_SUCCESS);
+    CU_ASSERT(sd_script_decode(&s, OK_STR, NULL) == SD_SUCCESS);
+
+    // Changing a frame length must move all the following frames
+    CU_ASSERT(sd_script_set_tick_len_at_frame(&s, 0, 50) == SD_SUCCESS);
+    CU_ASSERT(sd_script_get_tick_pos_at_frame(&s, 1) == 50);
+    CU_ASSERT(sd_script_get_tick_pos_at_frame(&s, 2) == 60);
+    CU_ASSERT(sd_script_get_total_ticks(&s) == 94);
+    CU_ASSERT(sd_script_get_frame_at(&s, 50) == sd_script_get_frame(&s, 1));
+    CU_ASSERT(sd_script_get_frame_at(&s, 94) == NULL);
+
+    // Zero length frames are never returned
+    CU_ASSERT(sd_script_set_tick_len_at_frame(&s, 1, 0) == SD_SUCCESS);
+    CU_ASSERT(sd_script_get_frame_at(&s, 50) == sd_script_get_frame(&s, 2));
+    CU_ASSERT(sd_script_get_frame_index_at(&s, 49) == 0);
+    sd_script_free(&s);
+}
+
 void test_script_get_tag(void) {
     const sd_script_frame *frame = sd_script_get_frame(&script, 0);
     CU_ASSERT(sd_script_get_tag(frame, NULL) == NULL);
@@ -186,6 +217,57 @@ void test_script_get(void) {
     CU_ASSERT(sd_script_get(sd_script_get_frame(&script, 0), "mp") == 0);
 }
 
+void test_script_isset_id(void) {
+    CU_ASSERT(sd_script_isset_id(NULL, SD_TAG_BPS) == 0);
+    CU_ASSERT(sd_script_isset_id(sd_script_get_frame(&script, 0), SD_TAG_BPS) == 1);
+    CU_ASSERT(sd_script_isset_id(sd_script_get_frame(&script, 0), SD_TAG_BPD) == 1);
+    CU_ASSERT(sd_script_isset_id(sd_script_get_frame(&script, 0), SD_TAG_MP) == 0);
+    CU_ASSERT(sd_script_isset_id(sd_script_get_frame(&script, 0), SD_TAG_INVALID) == 0);
+}
+
+void test_script_get_id(void) {
+    CU_ASSERT(sd_script_get_id(NULL, SD_TAG_BPS) == 0);
+    CU_ASSERT(sd_script_get_id(sd_script_get_frame(&script, 0), SD_TAG_BPS) == 1);
+    CU_ASSERT(sd_script_get_id(sd_script_get_frame(&script, 0), SD_TAG_BPN) == 64);
+    CU_ASSERT(sd_script_get_id(sd_script_get_frame(&script, 0), SD_TAG_S) == 5);
+    CU_ASSERT(sd_script_get_id(sd_script_get_frame(&script, 0), SD_TAG_MP) == 0);
+    CU_ASSERT(sd_script_get_id(sd_script_get_frame(&script, 1), SD_TAG_SF) == 3);
+}
+
+void test_script_compiled_tags(void) {
+    sd_script s;
+    sd_script c;
+    const sd_script_frame *frame;
+
+    CU_ASSERT(sd_tag_find("x=") == SD_TAG_X_EQ);
+    CU_ASSERT(sd_tag_find("jf2") == SD_TAG_JF2);
+    CU_ASSERT(sd_tag_find("forkingandcountry") == SD_TAG_INVALID);
+
+    // Tag modifications must be reflected in the compiled tables
+    CU_ASSERT(sd_script_create(&s) == SD_SUCCESS);
+    CU_ASSERT(sd_script_append_frame(&s, 100, 0) == SD_SUCCESS);
+    CU_ASSERT(sd_script_set_tag(&s, 0, "bpn", 10) == SD_SUCCESS);
+    CU_ASSERT(sd_script_set_tag(&s, 0, "x=", -5) == SD_SUCCESS);
+    frame = sd_script_get_frame(&s, 0);
+    CU_ASSERT(sd_script_get_id(frame, SD_TAG_BPN) == 10);
+    CU_ASSERT(sd_script_get_id(frame, SD_TAG_X_EQ) == -5);
+    CU_ASSERT(sd_script_set_tag(&s, 0, "bpn", 20) == SD_SUCCESS);
+    CU_ASSERT(sd_script_get_id(frame, SD_TAG_BPN) == 20);
+    CU_ASSERT(sd_script_delete_tag(&s, 0, "bpn") == SD_SUCCESS);
+    CU_ASSERT(sd_script_isset_id(frame, SD_TAG_BPN) == 0);
+    CU_ASSERT(sd_script_get_id(frame, SD_TAG_BPN) == 0);
+    CU_ASSERT(sd_script_isset_id(frame, SD_TAG_X_EQ) == 1);
+
+    // Clones carry the compiled tables along
+    CU_ASSERT(sd_script_clone(&s, &c) == SD_SUCCESS);
+    CU_ASSERT(sd_script_get_id(sd_script_get_frame(&c, 0), SD_TAG_X_EQ) == -5);
+    sd_script_free(&c);
+
+    CU_ASSERT(sd_script_clear_tags(&s, 0) == SD_SUCCESS);
+    CU_ASSERT(sd_script_isset_id(frame, SD_TAG_X_EQ) == 0);
+    sd_script_free(&s);
+}
+
 void test_script_tag_vars(void) {
     CU_ASSERT(sd_script_get(sd_script_get_frame(&script, 0), "s") == 5); // 05 -> 5 should work
 }
@@ -391,6 +473,12 @@ void script_test_suite(CU_pSuite suite) {
     if(CU_add_test(suite, "test of sd_script_get_frame_at", test_script_get_frame_at) == NULL) {
         return;
     }
+    if(CU_add_test(suite, "test of sd_script_get_frame_index_near", test_script_get_frame_index_near) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of frame tick positions", test_script_tick_positions) == NULL) {
+        return;
+    }
     if(CU_add_test(suite, "test of sd_script_get_tag", test_script_get_tag) == NULL) {
         return;
     }
@@ -421,6 +509,15 @@ void script_test_suite(CU_pSuite suite) {
     if(CU_add_test(suite, "test of sd_script_get", test_script_get) == NULL) {
         return;
     }
+    if(CU_add_test(suite, "test of sd_script_isset_id", test_script_isset_id) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of sd_script_get_id", test_script_get_id) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of compiled script tags", test_script_compiled_tags) == NULL) {
+        return;
+    }
     if(CU_add_test(suite, "test of sd_script_next_frame_with_sprite", test_next_frame_with_sprite) == NULL) {
         return;
     }
@@ -0,0 +1,142 @@
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <controller/controller.h>
+#include <controller/spectator_relay.h>
+#include <controller/spectator_stream.h>
+#include <string.h>
+
+static net_transcript transcript;
+
+void test_spectator_setup(void) {
+    spectator_setup in, out;
+    memset(&in, 0, sizeof(in));
+    in.arena = 12;
+    in.speed = 13;
+    in.warmup = 77;
+    in.seed = 0xDEADBEEF;
+    for(int i = 0; i < 2; i++) {
+        in.players[i].har_id = 10 + i;
+        in.players[i].pilot_id = 3 + i;
+        for(int k = 0; k < 3; k++) {
+            in.players[i].colors[k] = 4 * i + k;
+        }
+        for(int k = 0; k < 9; k++) {
+            in.players[i].stats[k] = 9 * i + k;
+        }
+    }
+
+    serial ser;
+    serial_create(&ser);
+    spectator_setup_write(&ser, &in);
+    CU_ASSERT(serial_read_int8(&ser) == EVENT_TYPE_SPECTATE_SETUP);
+    CU_ASSERT(spectator_setup_read(&ser, &out));
+    CU_ASSERT(memcmp(&in, &out, sizeof(in)) == 0);
+    CU_ASSERT(ser.rpos == ser.wpos);
+
+    // A message cut short is rejected
+    serial_read_reset(&ser);
+    ser.wpos--;
+    serial_read_int8(&ser);
+    CU_ASSERT(!spectator_setup_read(&ser, &out));
+    serial_free(&ser);
+}
+
+void test_spectator_inputs(void) {
+    net_transcript_create(&transcript);
+    net_transcript_insert(&transcript, 0, ACT_PUNCH, 0);
+    net_transcript_insert(&transcript, 3, ACT_LEFT, 1);
+    net_transcript_insert(&transcript, 30, ACT_UP | ACT_KICK, 0);
+    net_transcript_insert(&transcript, 30, ACT_RIGHT, 1);
+    net_transcript_insert(&transcript, 400, ACT_DOWN, 0);
+
+    // Two consecutive messages, the second one covering a long stretch
+    serial ser;
+    serial_create(&ser);
+    spectator_inputs_write(&ser, &transcript, 0, 25);
+    spectator_inputs_write(&ser, &transcript, 25, 401);
+
+    vector inputs;
+    vector_create(&inputs, sizeof(spectator_input));
+    uint32_t final = 0;
+    CU_ASSERT(serial_read_int8(&ser) == EVENT_TYPE_SPECTATE_INPUTS);
+    CU_ASSERT(spectator_inputs_read(&ser, final, &final, &inputs));
+    CU_ASSERT(final == 25);
+    CU_ASSERT(vector_size(&inputs) == 2);
+    CU_ASSERT(serial_read_int8(&ser) == EVENT_TYPE_SPECTATE_INPUTS);
+    CU_ASSERT(spectator_inputs_read(&ser, final, &final, &inputs));
+    CU_ASSERT(final == 401);
+    CU_ASSERT(ser.rpos == ser.wpos);
+
+    CU_ASSERT_FATAL(vector_size(&inputs) == 4);
+    spectator_input *input = vector_get(&inputs, 0);
+    CU_ASSERT(input->tick == 0 && input->actions[0] == ACT_PUNCH && input->actions[1] == 0);
+    input = vector_get(&inputs, 1);
+    CU_ASSERT(input->tick == 3 && input->actions[0] == 0 && input->actions[1] == ACT_LEFT);
+    input = vector_get(&inputs, 2);
+    CU_ASSERT(input->tick == 30 && input->actions[0] == (ACT_UP | ACT_KICK) && input->actions[1] == ACT_RIGHT);
+    input = vector_get(&inputs, 3);
+    CU_ASSERT(input->tick == 400 && input->actions[0] == ACT_DOWN && input->actions[1] == 0);
+
+    // A message cut short is rejected
+    serial_write_reset(&ser);
+    spectator_inputs_write(&ser, &transcript, 0, 25);
+    ser.wpos--;
+    serial_read_int8(&ser);
+    final = 0;
+    CU_ASSERT(!spectator_inputs_read(&ser, final, &final, &inputs));
+
+    vector_free(&inputs);
+    serial_free(&ser);
+    net_transcript_free(&transcript);
+}
+
+void test_spectator_relay_source(void) {
+    static ENetPeer player, intruder, spectator;
+    const char setup[] = {EVENT_TYPE_SPECTATE_SETUP, SPECTATOR_STREAM_VERSION};
+    const char inputs[] = {EVENT_TYPE_SPECTATE_INPUTS, 10, 0};
+    const char end[] = {EVENT_TYPE_SPECTATE_END};
+    spectator_relay relay;
+    spectator_relay_create(&relay);
+    spectator_relay_add(&relay, &player);
+    spectator_relay_add(&relay, &intruder);
+    spectator_relay_add(&relay, &spectator);
+
+    // Nothing is taken before a setup
+    CU_ASSERT(!spectator_relay_receive(&relay, &player, inputs, sizeof(inputs)));
+    CU_ASSERT(relay.source == NULL);
+
+    // The first peer to send a setup is the source, and no longer a spectator
+    CU_ASSERT(spectator_relay_receive(&relay, &player, setup, sizeof(setup)));
+    CU_ASSERT(relay.source == &player);
+    CU_ASSERT(vector_size(&relay.audience) == 2);
+    CU_ASSERT(spectator_relay_receive(&relay, &player, inputs, sizeof(inputs)));
+
+    // Others can not take over or add to the stream
+    CU_ASSERT(!spectator_relay_receive(&relay, &intruder, setup, sizeof(setup)));
+    CU_ASSERT(!spectator_relay_receive(&relay, &intruder, inputs, sizeof(inputs)));
+    CU_ASSERT(!spectator_relay_receive(&relay, &intruder, end, sizeof(end)));
+    CU_ASSERT(relay.source == &player);
+    CU_ASSERT(vector_size(&relay.messages) == 2);
+    CU_ASSERT(vector_size(&relay.audience) == 2);
+
+    // Once the source leaves, the next match can come from someone else
+    spectator_relay_remove(&relay, &player);
+    CU_ASSERT(relay.source == NULL);
+    CU_ASSERT(spectator_relay_receive(&relay, &intruder, setup, sizeof(setup)));
+    CU_ASSERT(relay.source == &intruder);
+    CU_ASSERT(vector_size(&relay.messages) == 1);
+    CU_ASSERT(vector_size(&relay.audience) == 1);
+    spectator_relay_free(&relay);
+}
+
+void spectator_stream_test_suite(CU_pSuite suite) {
+    if(CU_add_test(suite, "test of spectator setup messages", test_spectator_setup) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of spectator inputs messages", test_spectator_inputs) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of spectator relay source", test_spectator_relay_source) == NULL) {
+        return;
+    }
+}
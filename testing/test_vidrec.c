@@ -0,0 +1,116 @@
+#include "formats/error.h"
+#include "formats/vidrec.h"
+#include "utils/allocator.h"
+#include <CUnit/Basic.h>
+#include <CUnit/CUnit.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t frames[3][SD_VIDREC_PIXELS];
+static uint8_t encoded[SD_VIDREC_MAX_ENCODED];
+
+static void make_frames(void) {
+    // Flat background, then some noise and a moving block on top of it.
+    memset(frames[0], 3, SD_VIDREC_PIXELS);
+    memcpy(frames[1], frames[0], SD_VIDREC_PIXELS);
+    srand(2097);
+    for(int i = 0; i < 2000; i++) {
+        frames[1][rand() % SD_VIDREC_PIXELS] = rand() & 0xFF;
+    }
+    memcpy(frames[2], frames[1], SD_VIDREC_PIXELS);
+    for(int y = 50; y < 90; y++) {
+        memset(frames[2] + y * SD_VIDREC_WIDTH + 100, 200, 60);
+    }
+}
+
+void test_vidrec_encode_roundtrip(void) {
+    make_frames();
+    static uint8_t decoded[SD_VIDREC_PIXELS];
+    static uint8_t prev[SD_VIDREC_PIXELS];
+    memset(decoded, 0, sizeof(decoded));
+    memset(prev, 0, sizeof(prev));
+    for(int i = 0; i < 3; i++) {
+        size_t len = sd_vidrec_encode(encoded, prev, frames[i]);
+        CU_ASSERT(len <= SD_VIDREC_MAX_ENCODED);
+        CU_ASSERT(sd_vidrec_decode(decoded, encoded, len) == SD_SUCCESS);
+        CU_ASSERT(memcmp(decoded, frames[i], SD_VIDREC_PIXELS) == 0);
+        memcpy(prev, frames[i], SD_VIDREC_PIXELS);
+    }
+
+    // Unchanged frame takes one byte per 128 pixels
+    CU_ASSERT(sd_vidrec_encode(encoded, frames[2], frames[2]) == SD_VIDREC_PIXELS / 128);
+}
+
+void test_vidrec_encode_worst_case(void) {
+    // Every pixel changes and no two neighbours match, so everything is stored as literals.
+    static uint8_t prev[SD_VIDREC_PIXELS];
+    static uint8_t cur[SD_VIDREC_PIXELS];
+    for(int i = 0; i < SD_VIDREC_PIXELS; i++) {
+        cur[i] = i & 1;
+        prev[i] = 2;
+    }
+    size_t len = sd_vidrec_encode(encoded, prev, cur);
+    CU_ASSERT(len <= SD_VIDREC_MAX_ENCODED);
+    CU_ASSERT(sd_vidrec_decode(prev, encoded, len) == SD_SUCCESS);
+    CU_ASSERT(memcmp(prev, cur, SD_VIDREC_PIXELS) == 0);
+}
+
+void test_vidrec_decode_broken(void) {
+    make_frames();
+    static uint8_t decoded[SD_VIDREC_PIXELS];
+    memset(decoded, 0, sizeof(decoded));
+    size_t len = sd_vidrec_encode(encoded, decoded, frames[1]);
+    CU_ASSERT(sd_vidrec_decode(decoded, encoded, len - 1) == SD_FILE_PARSE_ERROR);
+
+    // Too many pixels
+    uint8_t skips[SD_VIDREC_PIXELS / 128 + 1];
+    memset(skips, 0x7F, sizeof(skips));
+    CU_ASSERT(sd_vidrec_decode(decoded, skips, sizeof(skips)) == SD_FILE_PARSE_ERROR);
+}
+
+void test_vidrec_file_roundtrip(void) {
+    make_frames();
+    sd_vidrec_stream *stream = omf_calloc(1, sizeof(sd_vidrec_stream));
+    vga_palette palettes[3];
+    for(int i = 0; i < 3; i++) {
+        for(int c = 0; c < 256; c++) {
+            palettes[i].colors[c].r = c;
+            palettes[i].colors[c].g = 255 - c;
+            palettes[i].colors[c].b = 17;
+        }
+    }
+    palettes[2].colors[40].b = 255; // Only one color changes on the last frame
+
+    CU_ASSERT(sd_vidrec_create(stream, "test.omfv") == SD_SUCCESS);
+    for(int i = 0; i < 3; i++) {
+        CU_ASSERT(sd_vidrec_write_frame(stream, i * 16, frames[i], &palettes[i]) == SD_SUCCESS);
+    }
+    sd_vidrec_close(stream);
+
+    CU_ASSERT(sd_vidrec_open(stream, "test.omfv") == SD_SUCCESS);
+    for(int i = 0; i < 3; i++) {
+        CU_ASSERT(sd_vidrec_read_frame(stream) == SD_SUCCESS);
+        CU_ASSERT(stream->time == (uint32_t)i * 16);
+        CU_ASSERT(memcmp(stream->pixels, frames[i], SD_VIDREC_PIXELS) == 0);
+        CU_ASSERT(memcmp(&stream->palette, &palettes[i], sizeof(vga_palette)) == 0);
+    }
+    CU_ASSERT(sd_vidrec_read_frame(stream) == SD_FILE_READ_ERROR);
+    CU_ASSERT(stream->frames == 3);
+    sd_vidrec_close(stream);
+    omf_free(stream);
+}
+
+void vidrec_test_suite(CU_pSuite suite) {
+    if(CU_add_test(suite, "test of frame encoding roundtrip", test_vidrec_encode_roundtrip) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of frame encoding worst case", test_vidrec_encode_worst_case) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of decoding broken frames", test_vidrec_decode_broken) == NULL) {
+        return;
+    }
+    if(CU_add_test(suite, "test of video recording file roundtrip", test_vidrec_file_roundtrip) == NULL) {
+        return;
+    }
+}
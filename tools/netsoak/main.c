@@ -0,0 +1,591 @@
+/** @file main.c
+ * @brief Netplay soak test. Runs two network peers against each other over a simulated connection.
+ * @license MIT
+ */
+
+#include "controller/ai_controller.h"
+#include "controller/controller.h"
+#include "controller/net_controller.h"
+#include "engine.h"
+#include "game/common_defines.h"
+#include "game/game_player.h"
+#include "game/game_state.h"
+#include "game/utils/score.h"
+#include "game/utils/settings.h"
+#include "resources/ids.h"
+#include "resources/pathmanager.h"
+#include "utils/allocator.h"
+#include "utils/log.h"
+#include "utils/random.h"
+#include <SDL.h>
+#if ARGTABLE2_FOUND
+#include <argtable2.h>
+#elif ARGTABLE3_FOUND
+#include <argtable3.h>
+#endif
+#include <enet/enet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define STATIC_TICKS 10
+#define CONNECT_TIMEOUT_MS 10000
+#define SYNC_TIMEOUT_MS 30000
+#define LINGER_MS 2000 // Keep running after the end, so that the peer can reach its end too
+#define HASH_SAMPLES 64
+
+typedef struct soak_options {
+    int role;
+    const char *host;
+    int port;
+    int ticks;
+    int arena;
+    int har;
+    int difficulty;
+    uint32_t seed;
+    int seed_given;
+    const char *log_prefix;
+    int result_fd; // Write the result here instead of printing it, or -1
+} soak_options;
+
+// Filled in by a peer. In the two process mode, this is sent to the parent process through a pipe.
+typedef struct soak_result {
+    int connected;
+    int synchronized;
+    int disconnected; // Connection was lost before the end
+    uint32_t ticks;   // Arena ticks run
+    uint64_t elapsed_ms;
+    net_controller_stats stats;
+    int hash_count;
+    uint32_t hash_ticks[HASH_SAMPLES];
+    uint64_t hashes[HASH_SAMPLES];
+} soak_result;
+
+static const char *role_name(int role) {
+    return role == ROLE_SERVER ? "server" : "client";
+}
+
+// Same order as the game, with the engine in headless mode.
+static int engine_start(engine_init_flags *init_flags) {
+    if(SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS)) {
+        PERROR("SDL2 initialization failed: %s", SDL_GetError());
+        goto exit_0;
+    }
+    if(enet_initialize() != 0) {
+        PERROR("Failed to initialize enet");
+        goto exit_1;
+    }
+    if(engine_init(init_flags)) {
+        goto exit_2;
+    }
+    return 0;
+
+exit_2:
+    enet_deinitialize();
+exit_1:
+    SDL_Quit();
+exit_0:
+    return 1;
+}
+
+static void engine_stop(void) {
+    engine_close();
+    enet_deinitialize();
+    SDL_Quit();
+}
+
+static ENetPeer *connect_peer(ENetHost **host, const soak_options *opts) {
+    ENetAddress address;
+    ENetEvent event;
+    address.port = opts->port;
+    if(opts->role == ROLE_SERVER) {
+        address.host = ENET_HOST_ANY;
+        *host = enet_host_create(&address, 1, 2, 0, 0);
+    } else {
+        enet_address_set_host(&address, opts->host);
+        *host = enet_host_create(NULL, 1, 2, 0, 0);
+        if(*host && enet_host_connect(*host, &address, 2, 0) == NULL) {
+            enet_host_destroy(*host);
+            *host = NULL;
+        }
+    }
+    if(*host == NULL) {
+        PERROR("Failed to set up the %s host on port %d", role_name(opts->role), opts->port);
+        return NULL;
+    }
+
+    uint64_t start = SDL_GetTicks64();
+    while(SDL_GetTicks64() - start < CONNECT_TIMEOUT_MS) {
+        if(enet_host_service(*host, &event, 100) > 0 && event.type == ENET_EVENT_TYPE_CONNECT) {
+            return event.peer;
+        }
+    }
+    PERROR("Timed out waiting for the peer to connect");
+    enet_host_destroy(*host);
+    *host = NULL;
+    return NULL;
+}
+
+// Player 1 is the server and player 2 the client, like in the netplay menus. Both are played by the AI, and
+// the network controller stands in for the player on the other side.
+static void setup_players(game_state *gs, ENetHost *host, ENetPeer *peer, const soak_options *opts) {
+    int local = opts->role == ROLE_SERVER ? 0 : 1;
+    game_state_set_speed(gs, 10);
+    for(int i = 0; i < 2; i++) {
+        game_player *player = game_state_get_player(gs, i);
+        player->pilot->har_id = HAR_JAGUAR + opts->har;
+        player->pilot->pilot_id = 0;
+        chr_score_set_difficulty(game_player_get_score(player), AI_DIFFICULTY_CHAMPION);
+
+        controller *ctrl = omf_calloc(1, sizeof(controller));
+        controller_init(ctrl, gs);
+        ctrl->har_obj_id = player->har_obj_id;
+        if(i == local) {
+            ai_controller_create(ctrl, opts->difficulty, player->pilot, player->pilot->pilot_id);
+        } else {
+            net_controller_create(ctrl, host, peer, NULL, opts->role);
+        }
+        game_player_set_ctrl(player, ctrl);
+    }
+
+    // Local inputs go to the peer, like melee sets up
+    controller *local_ctrl = game_player_get_ctrl(game_state_get_player(gs, local));
+    controller *net_ctrl = game_player_get_ctrl(game_state_get_player(gs, !local));
+    controller_add_hook(local_ctrl, net_ctrl, net_ctrl->controller_hook);
+}
+
+static void collect_hashes(controller *net_ctrl, soak_result *result) {
+    uint32_t last = net_controller_last_hash_tick(net_ctrl);
+    result->hash_count = 0;
+    for(uint32_t tick = last; tick + HASH_SAMPLES > last && result->hash_count < HASH_SAMPLES; tick--) {
+        uint64_t hash;
+        if(net_controller_get_hash(net_ctrl, tick, &hash)) {
+            result->hash_ticks[result->hash_count] = tick;
+            result->hashes[result->hash_count] = hash;
+            result->hash_count++;
+        }
+        if(tick == 0) {
+            break;
+        }
+    }
+}
+
+// Runs one peer to the end with the engine tick loop, paced by the wall clock like in the game. Until the peers
+// are synchronized, only the network controller is ticked, the way the netplay menus wait for it before the
+// match is started.
+static void run_peer(const soak_options *opts, engine_init_flags *init_flags, soak_result *result) {
+    memset(result, 0, sizeof(soak_result));
+
+    ENetHost *host = NULL;
+    ENetPeer *peer = connect_peer(&host, opts);
+    if(peer == NULL) {
+        return;
+    }
+    result->connected = 1;
+
+    game_state *gs = omf_calloc(1, sizeof(game_state));
+    if(game_state_create(gs, init_flags)) {
+        PERROR("Failed to create the game state");
+        game_state_free(&gs);
+        enet_host_destroy(host);
+        return;
+    }
+    gs->role = opts->role;
+    setup_players(gs, host, peer, opts);
+    int net_index = opts->role == ROLE_SERVER ? 1 : 0;
+
+    uint64_t start = SDL_GetTicks64();
+    uint64_t frame_start = start;
+    uint64_t fight_start = 0;
+    uint64_t end = 0;
+    uint32_t first_tick = 0;
+    engine_clock clock = {0, 0};
+    while(game_state_is_running(gs)) {
+        gs = engine_swap_state(gs);
+        controller *net_ctrl = game_player_get_ctrl(game_state_get_player(gs, net_index));
+        uint64_t now = SDL_GetTicks64();
+
+        if(!result->synchronized) {
+            if(net_controller_ready(net_ctrl)) {
+                result->synchronized = 1;
+                fight_start = now;
+                first_tick = gs->int_tick;
+                game_state_set_next(gs, SCENE_ARENA0 + opts->arena);
+            } else if(now - start > SYNC_TIMEOUT_MS) {
+                PERROR("Timed out waiting for the peers to synchronize");
+                break;
+            }
+        } else if(is_arena(gs->this_id) && gs->next_id != gs->this_id) {
+            // Leaving the arena; either the match is over or the connection was lost
+            if(end == 0) {
+                result->disconnected = !net_controller_ready(net_ctrl);
+            }
+            break;
+        }
+
+        if(result->synchronized && end == 0 && gs->int_tick - first_tick >= (uint32_t)opts->ticks) {
+            end = now;
+        }
+        if(end != 0 && result->ticks == 0) {
+            result->ticks = gs->int_tick - first_tick;
+            result->elapsed_ms = end - fight_start;
+            net_controller_get_stats(net_ctrl, &result->stats);
+            collect_hashes(net_ctrl, result);
+        }
+        if(end != 0 && now - end > LINGER_MS) {
+            break;
+        }
+
+        int frame_dt = now - frame_start;
+        frame_start = now;
+        if(result->synchronized) {
+            engine_tick(gs, &clock, frame_dt);
+        } else {
+            clock.static_wait += frame_dt;
+            clock.dynamic_wait += frame_dt;
+            for(; clock.static_wait > STATIC_TICKS; clock.static_wait -= STATIC_TICKS) {
+                ctrl_event *ev = NULL;
+                controller_tick(net_ctrl, gs->int_tick, &ev);
+                controller_free_chain(ev);
+            }
+            int ms_per_dyntick = game_state_ms_per_dyntick(gs);
+            for(; clock.dynamic_wait > ms_per_dyntick; clock.dynamic_wait -= ms_per_dyntick) {
+                gs->int_tick++;
+            }
+        }
+        SDL_Delay(1);
+    }
+
+    if(result->synchronized && result->ticks == 0) {
+        // Ended before the requested number of ticks
+        controller *net_ctrl = game_player_get_ctrl(game_state_get_player(gs, net_index));
+        result->ticks = gs->int_tick - first_tick;
+        result->elapsed_ms = SDL_GetTicks64() - fight_start;
+        net_controller_get_stats(net_ctrl, &result->stats);
+        collect_hashes(net_ctrl, result);
+    }
+
+    // The network controller closes the connection and destroys the host
+    game_state_free(&gs);
+}
+
+static void print_report(const char *name, const soak_result *r) {
+    if(!r->connected || !r->synchronized) {
+        printf("%s: %s\n", name, r->connected ? "did not synchronize" : "did not connect");
+        return;
+    }
+    const net_controller_stats *s = &r->stats;
+    float seconds = r->elapsed_ms / 1000.0f;
+    printf("%s: %" PRIu32 " ticks in %.1f s%s\n", name, r->ticks, seconds,
+           r->disconnected ? ", connection lost" : "");
+    printf("  input delay %d ticks\n", s->input_delay);
+    printf("  rollbacks %" PRIu32 " (%.2f/s), depth %.1f on average, %" PRIu32 " at most, %" PRIu32
+           " deeper than the limit\n",
+           s->rollbacks, seconds > 0 ? s->rollbacks / seconds : 0.0f,
+           s->rollbacks > 0 ? (float)s->rollback_ticks / s->rollbacks : 0.0f, s->max_rollback, s->deep_rollbacks);
+    printf("  resimulated ticks %" PRIu32 "\n", s->rollback_ticks);
+    printf("  stalled for the peer %" PRIu32 " times\n", s->stalls);
+    printf("  packets sent %" PRIu32 ", dropped %" PRIu32 "\n", s->packets_sent, s->packets_dropped);
+}
+
+// Compares the hashes both peers have for the same ticks. Returns 1 if any of them differ.
+static int compare_hashes(const soak_result *a, const soak_result *b) {
+    int common = 0;
+    int mismatches = 0;
+    uint32_t final_tick = 0;
+    uint64_t final_a = 0, final_b = 0;
+    for(int i = 0; i < a->hash_count; i++) {
+        for(int k = 0; k < b->hash_count; k++) {
+            if(a->hash_ticks[i] != b->hash_ticks[k]) {
+                continue;
+            }
+            if(common == 0 || a->hash_ticks[i] > final_tick) {
+                final_tick = a->hash_ticks[i];
+                final_a = a->hashes[i];
+                final_b = b->hashes[k];
+            }
+            mismatches += a->hashes[i] != b->hashes[k];
+            common++;
+        }
+    }
+    if(common == 0) {
+        // The peers only keep their most recent hashes, and a peer that fell far behind has none in common
+        printf("no state hashes of the same tick to compare\n");
+        return 0;
+    }
+    printf("state hashes: %d compared, %d differ\n", common, mismatches);
+    printf("final hash at tick %" PRIu32 ": %016" PRIx64 " / %016" PRIx64 " %s\n", final_tick, final_a, final_b,
+           final_a == final_b ? "match" : "MISMATCH");
+    return mismatches > 0;
+}
+
+static int result_ok(const soak_result *r) {
+    return r->connected && r->synchronized && !r->disconnected;
+}
+
+static void start_log(const soak_options *opts) {
+    if(opts->log_prefix) {
+        char filename[512];
+        snprintf(filename, sizeof(filename), "%s_%s.log", opts->log_prefix, role_name(opts->role));
+        log_init(filename);
+    }
+}
+
+static int run_single(soak_options *opts) {
+    soak_result result;
+    engine_init_flags init_flags;
+    memset(&init_flags, 0, sizeof(init_flags));
+    init_flags.net_mode = NET_MODE_NONE;
+    init_flags.headless = 1;
+
+    start_log(opts);
+    // Same seed on both peers, so that a run can be repeated exactly. Nothing that is hashed may depend on it.
+    rand_seed(opts->seed);
+    if(engine_start(&init_flags)) {
+        memset(&result, 0, sizeof(result));
+    } else {
+        run_peer(opts, &init_flags, &result);
+        engine_stop();
+    }
+#ifndef _WIN32
+    if(opts->result_fd >= 0) {
+        // Started by run_both, which prints the reports
+        ssize_t written = write(opts->result_fd, &result, sizeof(result));
+        close(opts->result_fd);
+        return written == sizeof(result) ? 0 : 1;
+    }
+#endif
+    print_report(role_name(opts->role), &result);
+    return result_ok(&result) ? 0 : 1;
+}
+
+#ifndef _WIN32
+// Starts a peer as a new process running this tool with --role, like a player starting the game on their own
+// machine. Nothing is shared with the other peer, so that object ids and allocations differ between the two as
+// they would in a real match. The result comes back through a pipe.
+static pid_t spawn_peer(const soak_options *opts, int role, int argc, char *argv[], int *fd) {
+    int fds[2];
+    if(pipe(fds) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(fds[0]);
+        char fd_arg[16];
+        char seed_arg[16];
+        snprintf(fd_arg, sizeof(fd_arg), "%d", fds[1]);
+        snprintf(seed_arg, sizeof(seed_arg), "%d", (int)opts->seed);
+        char **args = omf_calloc(argc + 7, sizeof(char *));
+        int n = 0;
+        for(int i = 0; i < argc; i++) {
+            args[n++] = argv[i];
+        }
+        args[n++] = "--role";
+        args[n++] = (char *)role_name(role);
+        args[n++] = "--result-fd";
+        args[n++] = fd_arg;
+        if(!opts->seed_given) {
+            // Both peers need the same seed
+            args[n++] = "--seed";
+            args[n++] = seed_arg;
+        }
+        args[n] = NULL;
+        execvp(argv[0], args);
+        PERROR("Failed to start %s: %s", argv[0], strerror(errno));
+        _exit(1);
+    }
+    close(fds[1]);
+    if(pid < 0) {
+        close(fds[0]);
+        return -1;
+    }
+    *fd = fds[0];
+    return pid;
+}
+
+static int read_result(int fd, soak_result *result) {
+    size_t got = 0;
+    while(got < sizeof(soak_result)) {
+        ssize_t n = read(fd, (char *)result + got, sizeof(soak_result) - got);
+        if(n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    close(fd);
+    if(got != sizeof(soak_result)) {
+        memset(result, 0, sizeof(soak_result));
+        return 1;
+    }
+    return 0;
+}
+
+static int run_both(const soak_options *opts, int argc, char *argv[]) {
+    soak_result results[2];
+    int fds[2];
+    pid_t pids[2];
+    fflush(stdout);
+    for(int i = 0; i < 2; i++) {
+        pids[i] = spawn_peer(opts, i == 0 ? ROLE_SERVER : ROLE_CLIENT, argc, argv, &fds[i]);
+        if(pids[i] < 0) {
+            printf("Failed to start the %s process\n", role_name(i == 0 ? ROLE_SERVER : ROLE_CLIENT));
+            if(i == 1) {
+                close(fds[0]);
+                waitpid(pids[0], NULL, 0);
+            }
+            return 1;
+        }
+    }
+    for(int i = 0; i < 2; i++) {
+        read_result(fds[i], &results[i]);
+        waitpid(pids[i], NULL, 0);
+    }
+
+    print_report("server", &results[0]);
+    print_report("client", &results[1]);
+    int ret = !result_ok(&results[0]) || !result_ok(&results[1]);
+    if(results[0].synchronized && results[1].synchronized) {
+        ret |= compare_hashes(&results[0], &results[1]);
+    }
+    printf("%s\n", ret ? "FAILED" : "OK");
+    return ret;
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    // commandline argument parser options
+    struct arg_lit *help = arg_lit0("h", "help", "print this help and exit");
+    struct arg_lit *vers = arg_lit0("v", "version", "print version information and exit");
+    struct arg_str *role = arg_str0("r", "role", "<role>", "Run only one peer: server or client");
+    struct arg_str *host = arg_str0(NULL, "host", "<host>", "Server to connect to as client (default: 127.0.0.1)");
+    struct arg_int *port = arg_int0("p", "port", "<port>", "Port to use (default: 2098)");
+    struct arg_int *ticks = arg_int0("t", "ticks", "<ticks>", "Arena ticks to run (default: 3000)");
+    struct arg_int *delay = arg_int0(NULL, "delay", "<ms>", "Simulated one way delay (default: 0)");
+    struct arg_int *jitter = arg_int0(NULL, "jitter", "<ms>", "Simulated random extra delay (default: 0)");
+    struct arg_int *loss = arg_int0(NULL, "loss", "<percent>", "Simulated packet loss (default: 0)");
+    struct arg_int *input_delay = arg_int0(NULL, "input-delay", "<ticks>", "Fixed input delay (default: auto)");
+    struct arg_int *max_rollback = arg_int0(NULL, "max-rollback", "<ticks>", "Latency to cover with rollback");
+    struct arg_int *arena = arg_int0("a", "arena", "<arena>", "Arena number 0-4 (default: 0)");
+    struct arg_int *har = arg_int0(NULL, "har", "<har>", "HAR number 0-10 for both players (default: 0)");
+    struct arg_int *difficulty = arg_int0(NULL, "difficulty", "<level>", "AI difficulty 0-6 (default: 4)");
+    struct arg_int *seed = arg_int0(NULL, "seed", "<seed>", "Seed for the AI players (default: time)");
+    struct arg_str *log = arg_str0(NULL, "log", "<prefix>", "Write the game logs to <prefix>_server.log and so on");
+    struct arg_int *result_fd = arg_int0(NULL, "result-fd", "<fd>", "Pipe the result of --role to the parent process");
+    struct arg_end *end = arg_end(20);
+    void *argtable[] = {help,  vers, role,       host, port, ticks,     delay, jitter, loss, input_delay, max_rollback,
+                        arena, har,  difficulty, seed, log,  result_fd, end};
+    const char *progname = "netsoak";
+    int ret = 1;
+
+    // Make sure everything got allocated
+    if(arg_nullcheck(argtable) != 0) {
+        printf("%s: insufficient memory\n", progname);
+        goto exit_0;
+    }
+
+    // Parse arguments
+    int nerrors = arg_parse(argc, argv, argtable);
+
+    // Handle help
+    if(help->count > 0) {
+        printf("Usage: %s", progname);
+        arg_print_syntax(stdout, argtable, "\n");
+        printf("\nArguments:\n");
+        arg_print_glossary(stdout, argtable, "%-25s %s\n");
+        ret = 0;
+        goto exit_0;
+    }
+
+    // Handle version
+    if(vers->count > 0) {
+        printf("%s v0.1\n", progname);
+        printf("Command line OpenOMF netplay soak test.\n");
+        printf("Source code is available at https://github.com/omf2097 under MIT license.\n");
+        ret = 0;
+        goto exit_0;
+    }
+
+    // Handle errors
+    if(nerrors > 0) {
+        arg_print_errors(stdout, end, progname);
+        printf("Try '%s --help' for more information.\n", progname);
+        goto exit_0;
+    }
+
+    soak_options opts;
+    opts.role = -1;
+    opts.host = host->count > 0 ? host->sval[0] : "127.0.0.1";
+    opts.port = port->count > 0 ? port->ival[0] : 2098;
+    opts.ticks = ticks->count > 0 ? ticks->ival[0] : 3000;
+    opts.arena = arena->count > 0 ? arena->ival[0] : 0;
+    opts.har = har->count > 0 ? har->ival[0] : 0;
+    opts.difficulty = difficulty->count > 0 ? difficulty->ival[0] : AI_DIFFICULTY_CHAMPION;
+    opts.seed = seed->count > 0 ? (uint32_t)seed->ival[0] : (uint32_t)time(NULL);
+    opts.seed_given = seed->count > 0;
+    opts.log_prefix = log->count > 0 ? log->sval[0] : NULL;
+    opts.result_fd = result_fd->count > 0 ? result_fd->ival[0] : -1;
+    if(role->count > 0) {
+        if(strcmp(role->sval[0], "server") == 0) {
+            opts.role = ROLE_SERVER;
+        } else if(strcmp(role->sval[0], "client") == 0) {
+            opts.role = ROLE_CLIENT;
+        } else {
+            printf("Unknown role '%s'; use server or client.\n", role->sval[0]);
+            goto exit_0;
+        }
+    }
+    if(opts.arena < 0 || opts.arena > 4 || opts.har < 0 || opts.har > 10 || opts.difficulty < 0 ||
+       opts.difficulty >= NUMBER_OF_AI_DIFFICULTY_TYPES || opts.ticks <= 0) {
+        printf("Arena, HAR, difficulty or tick count is out of range.\n");
+        goto exit_0;
+    }
+
+    // Game resources and settings are found the same way as the game does
+    if(pm_init() != 0) {
+        printf("Error: %s.\n", pm_get_errormsg());
+        goto exit_0;
+    }
+    if(settings_init(pm_get_local_path(CONFIG_PATH))) {
+        printf("Failed to initialize settings\n");
+        goto exit_1;
+    }
+    settings_load();
+
+    // The settings are not saved, so these only apply to this run
+    settings_network *net = &settings_get()->net;
+    net->net_sim_delay = delay->count > 0 ? delay->ival[0] : 0;
+    net->net_sim_jitter = jitter->count > 0 ? jitter->ival[0] : 0;
+    net->net_sim_loss = loss->count > 0 ? loss->ival[0] : 0;
+    if(input_delay->count > 0) {
+        net->net_input_delay = input_delay->ival[0];
+    }
+    if(max_rollback->count > 0) {
+        net->net_max_rollback = max_rollback->ival[0];
+    }
+    omf_free(net->trace_file);
+    net->trace_file = NULL;
+
+    if(opts.role >= 0) {
+        ret = run_single(&opts);
+    } else {
+#ifndef _WIN32
+        ret = run_both(&opts, argc, argv);
+#else
+        printf("Running both peers is not supported on this platform; start one --role server and one --role "
+               "client.\n");
+#endif
+    }
+
+    settings_free();
+exit_1:
+    pm_free();
+exit_0:
+    arg_freetable(argtable, sizeof(argtable) / sizeof(argtable[0]));
+    return ret;
+}
@@ -0,0 +1,131 @@
+/** @file main.c
+ * @brief Spectator relay. Receives a netplay match from one of the players and fans it out to spectators.
+ * @license MIT
+ */
+
+#include "controller/controller.h"
+#include "controller/spectator_relay.h"
+#include "controller/spectator_stream.h"
+#if ARGTABLE2_FOUND
+#include <argtable2.h>
+#elif ARGTABLE3_FOUND
+#include <argtable3.h>
+#endif
+#include <enet/enet.h>
+#include <signal.h>
+#include <stdio.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig) {
+    running = 0;
+}
+
+static int run_relay(int port, int peers) {
+    ENetAddress address;
+    address.host = ENET_HOST_ANY;
+    address.port = port;
+    ENetHost *host = enet_host_create(&address, peers, SPECTATOR_STREAM_CHANNELS, 0, 0);
+    if(host == NULL) {
+        printf("Unable to listen on port %d\n", port);
+        return 1;
+    }
+    printf("Relaying spectator streams on port %d\n", port);
+
+    spectator_relay relay;
+    spectator_relay_create(&relay);
+    ENetEvent event;
+    while(running) {
+        while(enet_host_service(host, &event, 10) > 0) {
+            switch(event.type) {
+                case ENET_EVENT_TYPE_CONNECT:
+                    // everyone is a spectator until they send a match
+                    spectator_relay_add(&relay, event.peer);
+                    printf("Peer connected\n");
+                    break;
+                case ENET_EVENT_TYPE_RECEIVE:
+                    // only the stream channel is relayed, and only from the source
+                    if(event.channelID == SPECTATOR_STREAM_CHANNEL &&
+                       spectator_relay_receive(&relay, event.peer, (const char *)event.packet->data,
+                                               event.packet->dataLength) &&
+                       event.packet->data[0] == EVENT_TYPE_SPECTATE_SETUP) {
+                        printf("Match started\n");
+                    }
+                    enet_packet_destroy(event.packet);
+                    break;
+                case ENET_EVENT_TYPE_DISCONNECT:
+                    printf(event.peer == relay.source ? "Match source disconnected\n" : "Peer disconnected\n");
+                    spectator_relay_remove(&relay, event.peer);
+                    break;
+                default:
+                    break;
+            }
+        }
+        spectator_relay_service(&relay);
+        enet_host_flush(host);
+    }
+
+    spectator_relay_free(&relay);
+    enet_host_destroy(host);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // commandline argument parser options
+    struct arg_lit *help = arg_lit0("h", "help", "print this help and exit");
+    struct arg_lit *vers = arg_lit0("v", "version", "print version information and exit");
+    struct arg_int *port = arg_int0("p", "port", "<port>", "Port to listen on (default: 2099)");
+    struct arg_int *peers = arg_int0(NULL, "peers", "<count>", "Most spectators and players at once (default: 64)");
+    struct arg_end *end = arg_end(20);
+    void *argtable[] = {help, vers, port, peers, end};
+    const char *progname = "specrelay";
+    int ret = 1;
+
+    // Make sure everything got allocated
+    if(arg_nullcheck(argtable) != 0) {
+        printf("%s: insufficient memory\n", progname);
+        goto exit_0;
+    }
+
+    // Parse arguments
+    int nerrors = arg_parse(argc, argv, argtable);
+
+    // Handle help
+    if(help->count > 0) {
+        printf("Usage: %s", progname);
+        arg_print_syntax(stdout, argtable, "\n");
+        printf("\nArguments:\n");
+        arg_print_glossary(stdout, argtable, "%-25s %s\n");
+        ret = 0;
+        goto exit_0;
+    }
+
+    // Handle version
+    if(vers->count > 0) {
+        printf("%s v0.1\n", progname);
+        printf("Command line OpenOMF spectator relay.\n");
+        printf("Source code is available at https://github.com/omf2097 under MIT license.\n");
+        ret = 0;
+        goto exit_0;
+    }
+
+    // Handle errors
+    if(nerrors > 0) {
+        arg_print_errors(stdout, end, progname);
+        printf("Try '%s --help' for more information.\n", progname);
+        goto exit_0;
+    }
+
+    if(enet_initialize() != 0) {
+        printf("Failed to initialize ENet\n");
+        goto exit_0;
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    ret = run_relay(port->count > 0 ? port->ival[0] : 2099, peers->count > 0 ? peers->ival[0] : 64);
+    enet_deinitialize();
+
+exit_0:
+    arg_freetable(argtable, sizeof(argtable) / sizeof(argtable[0]));
+    return ret;
+}
@@ -0,0 +1,114 @@
+/** @file main.c
+ * @brief Video recording converter tool
+ * @license MIT
+ */
+
+#include "formats/error.h"
+#include "formats/vidrec.h"
+#include "utils/allocator.h"
+#include "utils/png_writer.h"
+#if ARGTABLE2_FOUND
+#include <argtable2.h>
+#elif ARGTABLE3_FOUND
+#include <argtable3.h>
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]) {
+    // commandline argument parser options
+    struct arg_lit *help = arg_lit0("h", "help", "print this help and exit");
+    struct arg_lit *vers = arg_lit0("v", "version", "print version information and exit");
+    struct arg_file *file = arg_file1("f", "file", "<file>", "Input video recording file");
+    struct arg_str *output = arg_str0("o", "output", "<prefix>", "Write frames to <prefix>_000000.png and so on");
+    struct arg_int *first = arg_int0(NULL, "first", "<frame>", "First frame to write (default: 0)");
+    struct arg_int *last = arg_int0(NULL, "last", "<frame>", "Last frame to write (default: all)");
+    struct arg_end *end = arg_end(20);
+    void *argtable[] = {help, vers, file, output, first, last, end};
+    const char *progname = "vidtool";
+
+    // Make sure everything got allocated
+    if(arg_nullcheck(argtable) != 0) {
+        printf("%s: insufficient memory\n", progname);
+        goto exit_0;
+    }
+
+    // Parse arguments
+    int nerrors = arg_parse(argc, argv, argtable);
+
+    // Handle help
+    if(help->count > 0) {
+        printf("Usage: %s", progname);
+        arg_print_syntax(stdout, argtable, "\n");
+        printf("\nArguments:\n");
+        arg_print_glossary(stdout, argtable, "%-25s %s\n");
+        goto exit_0;
+    }
+
+    // Handle version
+    if(vers->count > 0) {
+        printf("%s v0.1\n", progname);
+        printf("Command line OpenOMF video recording converter.\n");
+        printf("Source code is available at https://github.com/omf2097 under MIT license.\n");
+        goto exit_0;
+    }
+
+    // Handle errors
+    if(nerrors > 0) {
+        arg_print_errors(stdout, end, progname);
+        printf("Try '%s --help' for more information.\n", progname);
+        goto exit_0;
+    }
+
+    // Open file. The stream keeps a couple of frames in it, so keep it off the stack.
+    sd_vidrec_stream *stream = omf_calloc(1, sizeof(sd_vidrec_stream));
+    int ret = sd_vidrec_open(stream, file->filename[0]);
+    if(ret != SD_SUCCESS) {
+        printf("Unable to load video recording %s: %s.\n", file->filename[0], sd_get_error(ret));
+        goto exit_1;
+    }
+
+    uint32_t first_frame = first->count > 0 ? first->ival[0] : 0;
+    uint32_t last_frame = last->count > 0 ? last->ival[0] : UINT32_MAX;
+    uint32_t written = 0;
+    char filename[512];
+    while((ret = sd_vidrec_read_frame(stream)) == SD_SUCCESS) {
+        uint32_t frame = stream->frames - 1;
+        if(output->count == 0 || frame < first_frame) {
+            continue;
+        }
+        if(frame > last_frame) {
+            break;
+        }
+        snprintf(filename, sizeof(filename), "%s_%06u.png", output->sval[0], frame);
+        if(!png_write_paletted(filename, SD_VIDREC_WIDTH, SD_VIDREC_HEIGHT, &stream->palette, stream->pixels)) {
+            printf("Unable to write frame %u to %s.\n", frame, filename);
+            goto exit_2;
+        }
+        written++;
+    }
+    if(ret == SD_FILE_PARSE_ERROR) {
+        printf("Frame %u is broken; stopping there.\n", stream->frames);
+    }
+
+    // Recordings run at the display refresh rate, so report the timing for putting the frames back together.
+    printf("Frames: %u\n", stream->frames);
+    printf("Duration: %.2f seconds\n", stream->time / 1000.0);
+    if(stream->time > 0) {
+        printf("Average rate: %.2f fps\n", (stream->frames - 1) * 1000.0 / stream->time);
+    }
+    if(output->count > 0) {
+        printf("Wrote %u frames.\n", written);
+    }
+
+    // Quit
+exit_2:
+    sd_vidrec_close(stream);
+exit_1:
+    omf_free(stream);
+exit_0:
+    arg_freetable(argtable, sizeof(argtable) / sizeof(argtable[0]));
+    return 0;
+}